@@ -0,0 +1,348 @@
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/file_piece.hh"
+#include "util/murmur_hash.hh"
+#include "util/read_compressed.hh"
+#include "util/string_piece.hh"
+#include "util/tokenize_piece.hh"
+#ifndef NTHREAD
+#include "util/thread_pool.hh"
+#endif
+
+#include <boost/lexical_cast.hpp>
+#include <boost/unordered_set.hpp>
+#ifndef NTHREAD
+#include <boost/utility/in_place_factory.hpp>
+#endif
+
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace lm {
+namespace {
+
+void DisplayHelp(const char *name) {
+  std::cerr
+    << "Usage: " << name << " [max_length:m] [factors:f,g] [threads:m] [block_size:m] source_text [table] <table >filtered\n\n"
+    "Keeps the lines of a phrase table (or lexicalized reordering table) whose\n"
+    "    source phrase occurs in source_text.  The table is read from the file\n"
+    "    named after source_text or from stdin, and may be compressed.  Lines are\n"
+    "    written in their original order, so a sorted table stays sorted and the\n"
+    "    output can go straight to processPhraseTableMin or CreateProbingPT.\n\n"
+    "max_length:m only considers source phrases of up to m words (default 10).\n"
+    "factors:f,g reduces each word of source_text to the given factors, for\n"
+    "    tables over a subset of the input factors.\n"
+    "block_size:m reads the table in blocks of about m bytes of whole lines\n"
+    "    (default 4194304).\n"
+#ifndef NTHREAD
+    "threads:m sets m threads (default: concurrency detected by boost).  Each thread\n"
+    "    splits and matches whole blocks.  Expect memory usage from this of about\n"
+    "    4*threads*block_size bytes.\n"
+#else
+    "This binary was compiled with -DNTHREAD, disabling threading.  If you wanted\n"
+    "    threading, compile without this flag against Boost >=1.42.0.\n"
+#endif
+    ;
+}
+
+struct Config {
+  Config() :
+#ifndef NTHREAD
+    threads(boost::thread::hardware_concurrency()),
+#endif
+    block_size(1 << 22),
+    max_length(10) {
+#ifndef NTHREAD
+    if (!threads) threads = 1;
+#endif
+  }
+
+#ifndef NTHREAD
+  size_t threads;
+#endif
+  size_t block_size;
+  size_t max_length;
+  std::vector<size_t> factors;
+};
+
+// Hashes of all source n-grams of the input up to the maximum length.  Hash
+// collisions let a few extra lines through, which is harmless.
+class SourcePhrases {
+  public:
+    SourcePhrases(const Config &config) : max_length_(config.max_length), factors_(config.factors) {}
+
+    void AddSentence(StringPiece sentence) {
+      canonical_.clear();
+      starts_.clear();
+      starts_.push_back(0);
+      for (util::TokenIter<util::AnyCharacter, true> i(sentence, StringPiece("\0 \t", 3)); i; ++i) {
+        AppendWord(*i);
+        canonical_ += ' ';
+        starts_.push_back(canonical_.size());
+      }
+      for (std::size_t i = 0; i + 1 < starts_.size(); ++i) {
+        const char *start = canonical_.data() + starts_[i];
+        for (std::size_t j = i + 1; j < std::min(starts_.size(), i + max_length_ + 1); ++j) {
+          hashes_.insert(util::MurmurHash64A(start, canonical_.data() + starts_[j] - start - 1));
+        }
+      }
+    }
+
+    // Assumes single space-delimited phrase with no space at the beginning or end.
+    bool Contains(StringPiece phrase) const {
+      return hashes_.find(util::MurmurHash64A(phrase.data(), phrase.size())) != hashes_.end();
+    }
+
+    std::size_t Size() const { return hashes_.size(); }
+
+  private:
+    void AppendWord(StringPiece word) {
+      if (factors_.empty()) {
+        canonical_.append(word.data(), word.size());
+        return;
+      }
+      factor_pieces_.clear();
+      for (util::TokenIter<util::SingleCharacter> i(word, '|'); i; ++i) {
+        factor_pieces_.push_back(*i);
+      }
+      for (std::vector<size_t>::const_iterator f = factors_.begin(); f != factors_.end(); ++f) {
+        UTIL_THROW_IF(*f >= factor_pieces_.size(), util::Exception, "Word " << word << " has no factor " << *f);
+        if (f != factors_.begin()) canonical_ += '|';
+        canonical_.append(factor_pieces_[*f].data(), factor_pieces_[*f].size());
+      }
+    }
+
+    const std::size_t max_length_;
+    const std::vector<size_t> factors_;
+
+    boost::unordered_set<uint64_t> hashes_;
+
+    // Temporaries in AddSentence.
+    std::string canonical_;
+    std::vector<std::size_t> starts_;
+    std::vector<StringPiece> factor_pieces_;
+};
+
+// Source phrase of a table line, without surrounding spaces.
+StringPiece SourceOf(StringPiece line) {
+  util::TokenIter<util::MultiCharacter> it(line, StringPiece("|||"));
+  StringPiece source(*it);
+  while (!source.empty() && source[0] == ' ') source.remove_prefix(1);
+  while (!source.empty() && source[source.size() - 1] == ' ') source.remove_suffix(1);
+  return source;
+}
+
+// Whole lines of the table, each ending in a newline, and the lines of them
+// that were kept.
+struct Block {
+  uint64_t sequence;
+  std::string text;
+  std::string kept;
+  uint64_t lines;
+  uint64_t kept_lines;
+};
+
+// Splits the decompressed table into blocks of whole lines.  The reader only
+// looks for the last newline of each block; splitting into lines is left to
+// FilterBlock, which runs on the worker threads.
+class BlockReader {
+  public:
+    BlockReader(int fd, std::size_t block_size) : in_(fd), block_size_(block_size), eof_(false) {}
+
+    // Returns false at the end of the table.
+    bool Read(std::string &text) {
+      text.assign(carry_);
+      carry_.clear();
+      while (!eof_) {
+        std::size_t had = text.size();
+        text.resize(had + block_size_);
+        std::size_t got = in_.ReadOrEOF(&text[had], block_size_);
+        text.resize(had + got);
+        if (got < block_size_) eof_ = true;
+        for (std::size_t i = text.size(); i > had; --i) {
+          if (text[i - 1] == '\n') {
+            carry_.assign(text, i, std::string::npos);
+            text.resize(i);
+            return true;
+          }
+        }
+        // The block ends in the middle of a line that started before it; read on.
+      }
+      if (text.empty()) return false;
+      if (text[text.size() - 1] != '\n') text += '\n';
+      return true;
+    }
+
+  private:
+    util::ReadCompressed in_;
+    const std::size_t block_size_;
+    bool eof_;
+    // Start of the line that the last block ended in the middle of.
+    std::string carry_;
+};
+
+void FilterBlock(const SourcePhrases &phrases, Block &block) {
+  block.kept.clear();
+  block.lines = 0;
+  block.kept_lines = 0;
+  const char *begin = block.text.data();
+  const char *end = begin + block.text.size();
+  while (begin != end) {
+    const char *eol = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+    ++block.lines;
+    if (phrases.Contains(SourceOf(StringPiece(begin, eol - begin)))) {
+      block.kept.append(begin, eol + 1 - begin);
+      ++block.kept_lines;
+    }
+    begin = eol + 1;
+  }
+}
+
+struct Totals {
+  Totals() : lines(0), kept_lines(0) {}
+  uint64_t lines;
+  uint64_t kept_lines;
+};
+
+void WriteBlock(const Block &block, Totals &totals) {
+  util::WriteOrThrow(1, block.kept.data(), block.kept.size());
+  totals.lines += block.lines;
+  totals.kept_lines += block.kept_lines;
+}
+
+#ifndef NTHREAD
+class FilterWorker {
+  public:
+    typedef Block *Request;
+
+    FilterWorker(const SourcePhrases &phrases, util::PCQueue<Request> &done) : phrases_(phrases), done_(done) {}
+
+    void operator()(Request block) {
+      FilterBlock(phrases_, *block);
+      done_.Produce(block);
+    }
+
+  private:
+    const SourcePhrases &phrases_;
+    util::PCQueue<Request> &done_;
+};
+
+// There should only be one OutputWorker.  It writes the blocks in their
+// original order and hands them back to the reader.
+class OutputWorker {
+  public:
+    typedef Block *Request;
+
+    OutputWorker(Totals &totals, util::PCQueue<Request> &done) : totals_(totals), done_(done), base_sequence_(0) {}
+
+    void operator()(Request block) {
+      uint64_t pos = block->sequence - base_sequence_;
+      if (pos >= ordering_.size()) {
+        ordering_.resize(pos + 1, NULL);
+      }
+      ordering_[pos] = block;
+      while (!ordering_.empty() && ordering_.front()) {
+        WriteBlock(*ordering_.front(), totals_);
+        done_.Produce(ordering_.front());
+        ordering_.pop_front();
+        ++base_sequence_;
+      }
+    }
+
+  private:
+    Totals &totals_;
+    util::PCQueue<Request> &done_;
+    std::deque<Request> ordering_;
+    uint64_t base_sequence_;
+};
+
+void RunThreaded(BlockReader &reader, const SourcePhrases &phrases, std::size_t threads, Totals &totals) {
+  std::vector<Block> blocks(threads * 2);
+  util::PCQueue<Block*> to_read(blocks.size());
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    to_read.Produce(&blocks[i]);
+  }
+  // The filter pool is destroyed first, so all blocks have reached the output
+  // pool before it is joined.
+  util::ThreadPool<OutputWorker> output(blocks.size(), 1, boost::in_place(boost::ref(totals), boost::ref(to_read)), NULL);
+  util::ThreadPool<FilterWorker> filter(blocks.size(), threads, boost::in_place(boost::ref(phrases), boost::ref(output.In())), NULL);
+  for (uint64_t sequence = 0; ; ++sequence) {
+    Block *block = to_read.Consume();
+    if (!reader.Read(block->text)) break;
+    block->sequence = sequence;
+    filter.Produce(block);
+  }
+}
+#endif
+
+} // namespace
+} // namespace lm
+
+int main(int argc, char *argv[]) {
+  try {
+    lm::Config config;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; ++i) {
+      const char *str = argv[i];
+      if (!std::strncmp(str, "max_length:", 11)) {
+        config.max_length = boost::lexical_cast<size_t>(str + 11);
+      } else if (!std::strncmp(str, "factors:", 8)) {
+        for (util::TokenIter<util::SingleCharacter> f(StringPiece(str + 8), ','); f; ++f) {
+          config.factors.push_back(boost::lexical_cast<size_t>(*f));
+        }
+#ifndef NTHREAD
+      } else if (!std::strncmp(str, "threads:", 8)) {
+        config.threads = boost::lexical_cast<size_t>(str + 8);
+        if (!config.threads) {
+          std::cerr << "Specify at least one thread." << std::endl;
+          return 1;
+        }
+#endif
+      } else if (!std::strncmp(str, "block_size:", 11)) {
+        config.block_size = boost::lexical_cast<size_t>(str + 11);
+        if (!config.block_size) {
+          std::cerr << "Block size must be at least one." << std::endl;
+          return 1;
+        }
+      } else {
+        files.push_back(str);
+      }
+    }
+    if (files.empty() || files.size() > 2 || !config.max_length) {
+      lm::DisplayHelp(argv[0]);
+      return 1;
+    }
+
+    lm::SourcePhrases phrases(config);
+    {
+      util::FilePiece text(files[0], &std::cerr);
+      StringPiece line;
+      while (text.ReadLineOrEOF(line)) phrases.AddSentence(line);
+    }
+    std::cerr << "Collected " << phrases.Size() << " source phrases" << std::endl;
+
+    lm::BlockReader reader(files.size() == 2 ? util::OpenReadOrThrow(files[1]) : 0, config.block_size);
+    lm::Totals totals;
+#ifndef NTHREAD
+    if (config.threads == 1) {
+#endif
+      lm::Block block;
+      while (reader.Read(block.text)) {
+        lm::FilterBlock(phrases, block);
+        lm::WriteBlock(block, totals);
+      }
+#ifndef NTHREAD
+    } else {
+      lm::RunThreaded(reader, phrases, config.threads, totals);
+    }
+#endif
+    std::cerr << totals.kept_lines << " of " << totals.lines << " lines kept" << std::endl;
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
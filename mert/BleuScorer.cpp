@@ -8,6 +8,11 @@
 #include <iostream>
 #include <stdexcept>
 
+#include <boost/static_assert.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
 #include "util/exception.hh"
 #include "Ngram.h"
 #include "Reference.h"
@@ -27,6 +32,28 @@ const char REFLEN_AVERAGE[] = "average";
 const char REFLEN_SHORTEST[] = "shortest";
 const char REFLEN_CLOSEST[] = "closest";
 
+BOOST_STATIC_ASSERT(MosesTuning::kBleuNgramOrder <= MosesTuning::NgramTable::kMaxOrder);
+
+// Buffers for CalcBleuStats(), reused across calls
+struct BleuWorkspace {
+  std::vector<int> tokens;
+  // hypothesis counts of the reference n-grams, by slot of the reference index
+  std::vector<int> hits;
+  std::vector<int> touched;
+};
+
+BleuWorkspace& GetWorkspace()
+{
+#ifdef WITH_THREADS
+  static boost::thread_specific_ptr<BleuWorkspace> workspace;
+  if (!workspace.get()) workspace.reset(new BleuWorkspace);
+  return *workspace;
+#else
+  static BleuWorkspace workspace;
+  return workspace;
+#endif
+}
+
 } // namespace
 
 namespace MosesTuning
@@ -148,6 +175,7 @@ void BleuScorer::ProcessReferenceLine(const std::string& line, Reference* ref) c
   }
   //add in the length
   ref->push_back(length);
+  ref->BuildIndex();
 }
 
 bool BleuScorer::GetNextReferenceFromStreams(std::vector<boost::shared_ptr<std::ifstream> >& referenceStreams, Reference& ref) const
@@ -169,6 +197,43 @@ void BleuScorer::prepareStats(size_t sid, const string& text, ScoreStats& entry)
 }
 
 void BleuScorer::CalcBleuStats(const Reference& ref, const std::string& text, ScoreStats& entry) const
+{
+  const NgramTable& index = ref.get_index();
+  if (index.size() != ref.get_counts()->size()) {
+    // the counts were changed after the index was built
+    CalcBleuStatsFromCounts(ref, text, entry);
+    return;
+  }
+
+  // Count the matches of each hypothesis n-gram in the reference index,
+  // clipping by the reference count as the hits for each slot come in.
+  BleuWorkspace& ws = GetWorkspace();
+  ws.tokens.clear();
+  TokenizeAndEncodeTesting(preprocessSentence(text), ws.tokens);
+  const size_t length = ws.tokens.size();
+  if (ws.hits.size() < index.capacity()) ws.hits.resize(index.capacity(), 0);
+
+  vector<ScoreStatsType> stats(kBleuNgramOrder * 2);
+  for (size_t i = 0; i < length; ++i) {
+    const int* ngram = &ws.tokens[i];
+    boost::uint64_t hash = 0;
+    for (size_t n = 1; n <= kBleuNgramOrder && i + n <= length; ++n) {
+      hash = NgramTable::Extend(hash, ngram[n - 1]);
+      stats[n * 2 - 1] += 1;
+      const int slot = index.Find(ngram, n, hash);
+      if (slot < 0) continue;
+      if (ws.hits[slot]++ == 0) ws.touched.push_back(slot);
+      if (ws.hits[slot] <= index.count(slot)) stats[n * 2 - 2] += 1;
+    }
+  }
+  for (size_t i = 0; i < ws.touched.size(); ++i) ws.hits[ws.touched[i]] = 0;
+  ws.touched.clear();
+
+  stats.push_back(CalcReferenceLength(ref, length));
+  entry.set(stats);
+}
+
+void BleuScorer::CalcBleuStatsFromCounts(const Reference& ref, const std::string& text, ScoreStats& entry) const
 {
   NgramCounts testcounts;
   // stats for this line
@@ -41,9 +41,15 @@ public:
   virtual std::size_t NumberOfScores() const {
     return 2 * kBleuNgramOrder + 1;
   }
+  virtual bool isThreadSafe() const {
+    return true;
+  }
 
   void CalcBleuStats(const Reference& ref, const std::string& text, ScoreStats& entry) const;
 
+  /** As CalcBleuStats(), but counting the hypothesis n-grams in a map. */
+  void CalcBleuStatsFromCounts(const Reference& ref, const std::string& text, ScoreStats& entry) const;
+
   int CalcReferenceLength(const Reference& ref, std::size_t length) const;
 
   ReferenceLengthType GetReferenceLengthType() const {
@@ -232,6 +232,28 @@ BOOST_AUTO_TEST_CASE(bleu_clipped_counts)
   BOOST_CHECK_EQUAL(entry.get(7), 3);  // fourgram
 }
 
+BOOST_AUTO_TEST_CASE(bleu_indexed_counts)
+{
+  BleuScorer scorer;
+  SetUpReferences(scorer);
+  const Reference& ref = *scorer.GetReferences()[0];
+  const char* lines[] = {
+    "israeli officials responsibility of airport safety",
+    "israeli officials are responsible for airport security security security",
+    "airport airport airport the the unseen words",
+    ""
+  };
+  for (std::size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i) {
+    ScoreStats indexed, counted;
+    scorer.CalcBleuStats(ref, lines[i], indexed);
+    scorer.CalcBleuStatsFromCounts(ref, lines[i], counted);
+    BOOST_REQUIRE_EQUAL(indexed.size(), counted.size());
+    for (std::size_t j = 0; j < indexed.size(); ++j) {
+      BOOST_CHECK_EQUAL(indexed.get(j), counted.get(j));
+    }
+  }
+}
+
 BOOST_AUTO_TEST_CASE(calculate_actual_score)
 {
   BOOST_REQUIRE(4 == kBleuNgramOrder);
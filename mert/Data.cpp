@@ -22,11 +22,76 @@
 #include "util/string_piece.hh"
 #include "FeatureDataIterator.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
+
 using namespace std;
 
 namespace MosesTuning
 {
 
+namespace
+{
+
+// Lines of an n-best list scored together in loadNBest()
+const size_t kNBestBlockSize = 10000;
+
+struct NBestLine {
+  int sentence_index;
+  string sentence;
+  string feature_str;
+};
+
+void ParseNBestLine(StringPiece line, bool useAlignment, NBestLine* out)
+{
+  string alignment;
+  util::TokenIter<util::MultiCharacter> it(line, util::MultiCharacter("|||"));
+
+  out->sentence_index = ParseInt(*it);
+  ++it;
+  out->sentence = it->as_string();
+  ++it;
+  out->feature_str = it->as_string();
+  ++it;
+
+  if (it) {
+    ++it;                             // skip model score.
+
+    if (it) {
+      alignment = it->as_string(); //fifth field (if present) is either phrase or word alignment
+      ++it;
+      if (it) {
+        alignment = it->as_string(); //sixth field (if present) is word alignment
+      }
+    }
+  }
+  //TODO check alignment exists if scorers need it
+
+  if (useAlignment) {
+    out->sentence += "|||";
+    out->sentence += alignment;
+  }
+}
+
+// Statistics of every stride-th line, from begin on
+struct StatsTask {
+  Scorer* scorer;
+  const vector<NBestLine>* lines;
+  vector<ScoreStats>* stats;
+  size_t begin;
+  size_t stride;
+
+  void operator()() const {
+    for (size_t i = begin; i < lines->size(); i += stride) {
+      (*stats)[i].clear();
+      scorer->prepareStats((*lines)[i].sentence_index, (*lines)[i].sentence, (*stats)[i]);
+    }
+  }
+};
+
+}
+
 Data::Data(Scorer* scorer, const string& sparse_weights_file)
   : m_scorer(scorer),
     m_score_type(m_scorer->getName()),
@@ -136,14 +201,18 @@ void Data::load(const std::string &featfile, const std::string &scorefile)
   m_score_data->load(scorefile);
 }
 
-void Data::loadNBest(const string &file, bool oneBest)
+void Data::loadNBest(const string &file, bool oneBest, size_t threads)
 {
   TRACE_ERR("loading nbest from " << file << endl);
   util::FilePiece in(file.c_str());
 
+  if (threads > 1 && !oneBest && m_scorer->isThreadSafe()) {
+    loadNBest(in, threads);
+    return;
+  }
+
   ScoreStats scoreentry;
-  string sentence, feature_str, alignment;
-  int sentence_index;
+  NBestLine entry;
 
   while (true) {
     try {
@@ -152,42 +221,18 @@ void Data::loadNBest(const string &file, bool oneBest)
       // adding statistics for error measures
       scoreentry.clear();
 
-      util::TokenIter<util::MultiCharacter> it(line, util::MultiCharacter("|||"));
+      ParseNBestLine(line, m_scorer->useAlignment(), &entry);
+      if (oneBest && m_score_data->exists(entry.sentence_index)) continue;
 
-      sentence_index = ParseInt(*it);
-      if (oneBest && m_score_data->exists(sentence_index)) continue;
-      ++it;
-      sentence = it->as_string();
-      ++it;
-      feature_str = it->as_string();
-      ++it;
-
-      if (it) {
-        ++it;                             // skip model score.
-
-        if (it) {
-          alignment = it->as_string(); //fifth field (if present) is either phrase or word alignment
-          ++it;
-          if (it) {
-            alignment = it->as_string(); //sixth field (if present) is word alignment
-          }
-        }
-      }
-      //TODO check alignment exists if scorers need it
-
-      if (m_scorer->useAlignment()) {
-        sentence += "|||";
-        sentence += alignment;
-      }
-      m_scorer->prepareStats(sentence_index, sentence, scoreentry);
+      m_scorer->prepareStats(entry.sentence_index, entry.sentence, scoreentry);
 
-      m_score_data->add(scoreentry, sentence_index);
+      m_score_data->add(scoreentry, entry.sentence_index);
 
       // examine first line for name of features
       if (!existsFeatureNames()) {
-        InitFeatureMap(feature_str);
+        InitFeatureMap(entry.feature_str);
       }
-      AddFeatures(feature_str, sentence_index);
+      AddFeatures(entry.feature_str, entry.sentence_index);
     } catch (util::EndOfFileException &e) {
       PrintUserTime("Loaded N-best lists");
       break;
@@ -195,6 +240,57 @@ void Data::loadNBest(const string &file, bool oneBest)
   }
 }
 
+void Data::loadNBest(util::FilePiece &in, size_t threads)
+{
+  // Read a block of lines, compute their statistics in parallel, then
+  // add them in file order, as above.
+  vector<NBestLine> lines(kNBestBlockSize);
+  vector<ScoreStats> stats(kNBestBlockSize);
+  bool eof = false;
+  while (!eof) {
+    size_t count = 0;
+    try {
+      while (count < kNBestBlockSize) {
+        StringPiece line = in.ReadLine();
+        if (line.empty()) continue;
+        ParseNBestLine(line, m_scorer->useAlignment(), &lines[count++]);
+      }
+    } catch (util::EndOfFileException &e) {
+      eof = true;
+    }
+    lines.resize(count);
+
+    vector<StatsTask> tasks(min(threads, max<size_t>(count, 1)));
+    for (size_t t = 0; t < tasks.size(); ++t) {
+      tasks[t].scorer = m_scorer;
+      tasks[t].lines = &lines;
+      tasks[t].stats = &stats;
+      tasks[t].begin = t;
+      tasks[t].stride = tasks.size();
+    }
+#ifdef WITH_THREADS
+    boost::thread_group group;
+    for (size_t t = 1; t < tasks.size(); ++t)
+      group.create_thread(tasks[t]);
+    tasks[0]();
+    group.join_all();
+#else
+    for (size_t t = 0; t < tasks.size(); ++t)
+      tasks[t]();
+#endif
+
+    for (size_t i = 0; i < count; ++i) {
+      m_score_data->add(stats[i], lines[i].sentence_index);
+      if (!existsFeatureNames()) {
+        InitFeatureMap(lines[i].feature_str);
+      }
+      AddFeatures(lines[i].feature_str, lines[i].sentence_index);
+    }
+    lines.resize(kNBestBlockSize);
+  }
+  PrintUserTime("Loaded N-best lists");
+}
+
 void Data::save(const std::string &featfile, const std::string &scorefile, bool bin)
 {
   if (bin)
@@ -16,6 +16,11 @@
 #include "FeatureData.h"
 #include "ScoreData.h"
 
+namespace util
+{
+class FilePiece;
+}
+
 namespace MosesTuning
 {
 
@@ -67,7 +72,11 @@ public:
     m_feature_data->Features(f);
   }
 
-  void loadNBest(const std::string &file, bool oneBest=false);
+  /**
+   * Load an n-best list, computing the statistics in the given number of
+   * threads if the scorer allows it.
+   */
+  void loadNBest(const std::string &file, bool oneBest=false, std::size_t threads=1);
 
   void load(const std::string &featfile, const std::string &scorefile);
 
@@ -102,6 +111,9 @@ public:
   void InitFeatureMap(const std::string& str);
   void AddFeatures(const std::string& str,
                    int sentence_index);
+
+private:
+  void loadNBest(util::FilePiece &in, std::size_t threads);
 };
 
 }
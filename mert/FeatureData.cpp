@@ -11,6 +11,7 @@
 #include <limits>
 #include "FileStream.h"
 #include "Util.h"
+#include "TuningStore.h"
 
 using namespace std;
 
@@ -67,9 +68,44 @@ void FeatureData::load(istream* is, const SparseVector& sparseWeights)
 }
 
 
+void FeatureData::load(const TuningStore& store, const SparseVector& sparseWeights)
+{
+  vector<FeatureDataItem> items;
+  for (size_t s = 0; s < store.NumSentences(); ++s) {
+    store.GetFeatures(s, items);
+    FeatureArray entry;
+    entry.setIndex(store.SentenceId(s));
+    entry.NumberOfFeatures(store.NumFeatures());
+    entry.Features(store.FeatureNames());
+    for (size_t i = 0; i < items.size(); ++i) {
+      FeatureStats stats;
+      for (size_t j = 0; j < items[i].dense.size(); ++j)
+        stats.add(items[i].dense[j]);
+      if (sparseWeights.size()) {
+        // merge the sparse features, as in FeatureStats::set()
+        stats.add(inner_product(sparseWeights, items[i].sparse));
+      } else {
+        const vector<size_t> feats = items[i].sparse.feats();
+        for (size_t j = 0; j < feats.size(); ++j)
+          stats.addSparse(SparseVector::decode(feats[j]), items[i].sparse.get(feats[j]));
+      }
+      entry.add(stats);
+    }
+
+    if (size() == 0)
+      setFeatureMap(entry.Features());
+
+    add(entry);
+  }
+}
+
 void FeatureData::load(const string &file, const SparseVector& sparseWeights)
 {
   TRACE_ERR("loading feature data from " << file << endl);
+  if (TuningStore::IsTuningStore(file)) {
+    load(TuningStore(file), sparseWeights);
+    return;
+  }
   inputfilestream input_stream(file); // matches a stream with a file. Opens the file
   if (!input_stream) {
     throw runtime_error("Unable to open feature file: " + file);
@@ -18,6 +18,7 @@
 namespace MosesTuning
 {
 
+class TuningStore;
 
 class FeatureData
 {
@@ -87,6 +88,7 @@ public:
   void save(bool bin=false);
 
   void load(std::istream* is, const SparseVector& sparseWeights);
+  void load(const TuningStore& store, const SparseVector& sparseWeights);
   void load(const std::string &file, const SparseVector& sparseWeights);
 
   bool check_consistency() const;
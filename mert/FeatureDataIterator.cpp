@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "FeatureArray.h"
 #include "FeatureDataIterator.h"
+#include "TuningStore.h"
 
 
 using namespace std;
@@ -69,11 +70,15 @@ size_t hash_value(FeatureDataItem const& item)
 }
 
 
-FeatureDataIterator::FeatureDataIterator() {}
+FeatureDataIterator::FeatureDataIterator() : m_store_position(0) {}
 
-FeatureDataIterator::FeatureDataIterator(const string& filename)
+FeatureDataIterator::FeatureDataIterator(const string& filename) : m_store_position(0)
 {
-  m_in.reset(new FilePiece(filename.c_str()));
+  if (TuningStore::IsTuningStore(filename)) {
+    m_store.reset(new TuningStore(filename));
+  } else {
+    m_in.reset(new FilePiece(filename.c_str()));
+  }
   readNext();
 }
 
@@ -82,6 +87,14 @@ FeatureDataIterator::~FeatureDataIterator() {}
 void FeatureDataIterator::readNext()
 {
   m_next.clear();
+  if (m_store) {
+    if (m_store_position < m_store->NumSentences()) {
+      m_store->GetFeatures(m_store_position++, m_next);
+    } else {
+      m_store.reset();
+    }
+    return;
+  }
   try {
     StringPiece marker = m_in->ReadDelimited();
     if (marker != StringPiece(FEATURES_TXT_BEGIN)) {
@@ -131,7 +144,9 @@ void FeatureDataIterator::increment()
 
 bool FeatureDataIterator::equal(const FeatureDataIterator& rhs) const
 {
-  if (!m_in && !rhs.m_in) {
+  if (m_store || rhs.m_store) {
+    return m_store == rhs.m_store && m_store_position == rhs.m_store_position;
+  } else if (!m_in && !rhs.m_in) {
     return true;
   } else if (!m_in) {
     return false;
@@ -45,6 +45,7 @@ class FilePiece;
 namespace MosesTuning
 {
 
+class TuningStore;
 
 class FileFormatException : public util::Exception
 {
@@ -97,6 +98,9 @@ private:
   void readNext();
 
   boost::shared_ptr<util::FilePiece> m_in;
+  // instead of m_in, if reading from a binary tuning store
+  boost::shared_ptr<TuningStore> m_store;
+  std::size_t m_store_position;
   std::vector<FeatureDataItem> m_next;
 };
 
@@ -22,8 +22,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <iterator>
 
 #define BOOST_FILESYSTEM_VERSION 3
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/function.hpp>
 #include <boost/lexical_cast.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
 
 #include "util/exception.hh"
 #include "util/file_piece.hh"
@@ -39,6 +44,49 @@ namespace MosesTuning
 
 static const ValType BLEU_RATIO = 5;
 
+namespace
+{
+
+// Examples per thread in each batch of Evaluate()
+const size_t kEvaluateBatch = 64;
+
+struct StrideTask {
+  boost::function<void (size_t)> job;
+  size_t begin;
+  size_t end;
+  size_t stride;
+
+  void operator()() const {
+    for (size_t i = begin; i < end; i += stride) job(i);
+  }
+};
+
+// Runs job(i) for i in [0,n) on up to the given number of threads. Every
+// index is handled by one thread only, so results stored by index do not
+// depend on the number of threads.
+void ParallelFor(size_t n, size_t threads, const boost::function<void (size_t)>& job)
+{
+  vector<StrideTask> tasks(max<size_t>(1, min(threads, n)));
+  for (size_t t = 0; t < tasks.size(); ++t) {
+    tasks[t].job = job;
+    tasks[t].begin = t;
+    tasks[t].end = n;
+    tasks[t].stride = tasks.size();
+  }
+#ifdef WITH_THREADS
+  boost::thread_group group;
+  for (size_t t = 1; t < tasks.size(); ++t)
+    group.create_thread(tasks[t]);
+  tasks[0]();
+  group.join_all();
+#else
+  for (size_t t = 0; t < tasks.size(); ++t)
+    tasks[t]();
+#endif
+}
+
+}
+
 std::pair<MiraWeightVector*,size_t>
 InitialiseWeights(const string& denseInitFile, const string& sparseInitFile,
                   const string& type, bool verbose)
@@ -132,14 +180,27 @@ InitialiseWeights(const string& denseInitFile, const string& sparseInitFile,
   return pair<MiraWeightVector*,size_t>(new MiraWeightVector(initParams), initDenseSize);
 }
 
-ValType HopeFearDecoder::Evaluate(const AvgWeightVector& wv)
+ValType HopeFearDecoder::Evaluate(const AvgWeightVector& wv, size_t threads)
 {
   vector<ValType> stats(scorer_->NumberOfScores(),0);
-  for(reset(); !finished(); next()) {
-    vector<ValType> sent;
-    MaxModel(wv,&sent);
-    for(size_t i=0; i<sent.size(); i++) {
-      stats[i]+=sent[i];
+  if (threads <= 1) {
+    for(reset(); !finished(); next()) {
+      vector<ValType> sent;
+      MaxModel(wv,&sent);
+      for(size_t i=0; i<sent.size(); i++) {
+        stats[i]+=sent[i];
+      }
+    }
+  } else {
+    // sums in example order, as above
+    vector<vector<ValType> > batch;
+    for(reset(); !finished(); ) {
+      MaxModelBatch(wv, kEvaluateBatch * threads, threads, &batch);
+      for (size_t j = 0; j < batch.size(); ++j) {
+        for(size_t i=0; i<batch[j].size(); i++) {
+          stats[i]+=batch[j][i];
+        }
+      }
     }
   }
   return scorer_->calculateScore(stats);
@@ -152,7 +213,7 @@ NbestHopeFearDecoder::NbestHopeFearDecoder(
   bool  no_shuffle,
   bool safe_hope,
   Scorer* scorer
-) : safe_hope_(safe_hope)
+) : safe_hope_(safe_hope), streaming_(streaming)
 {
   scorer_ = scorer;
   if (streaming) {
@@ -178,11 +239,51 @@ void NbestHopeFearDecoder::reset()
   train_->reset();
 }
 
+void NbestHopeFearDecoder::CurrentPack(HypPack* pack, bool copy)
+{
+  pack->features.resize(train_->cur_size());
+  pack->scores.resize(train_->cur_size());
+  for(size_t i=0; i< train_->cur_size(); i++) {
+    if (copy) {
+      featureBuffer_.push_back(train_->featuresAt(i));
+      scoreBuffer_.push_back(train_->scoresAt(i));
+      pack->features[i] = &featureBuffer_.back();
+      pack->scores[i] = &scoreBuffer_.back();
+    } else {
+      pack->features[i] = &train_->featuresAt(i);
+      pack->scores[i] = &train_->scoresAt(i);
+    }
+  }
+}
+
+void NbestHopeFearDecoder::NextBatch(size_t batchSize, vector<HypPack>* packs)
+{
+  featureBuffer_.clear();
+  scoreBuffer_.clear();
+  packs->clear();
+  for (; packs->size() < batchSize && !finished(); next()) {
+    packs->push_back(HypPack());
+    CurrentPack(&packs->back(), streaming_);
+  }
+}
+
 void NbestHopeFearDecoder::HopeFear(
   const std::vector<ValType>& backgroundBleu,
   const MiraWeightVector& wv,
   HopeFearData* hopeFear
 )
+{
+  HypPack pack;
+  CurrentPack(&pack, false);
+  HopeFear(pack, backgroundBleu, wv, hopeFear);
+}
+
+void NbestHopeFearDecoder::HopeFear(
+  const HypPack& pack,
+  const std::vector<ValType>& backgroundBleu,
+  const MiraWeightVector& wv,
+  HopeFearData* hopeFear
+) const
 {
 
 
@@ -192,10 +293,10 @@ void NbestHopeFearDecoder::HopeFear(
   ValType hope_score=0, fear_score=0, model_score=0;
   for(size_t safe_loop=0; safe_loop<2; safe_loop++) {
     ValType hope_bleu=0, hope_model=0;
-    for(size_t i=0; i< train_->cur_size(); i++) {
-      const MiraFeatureVector& vec=train_->featuresAt(i);
+    for(size_t i=0; i< pack.features.size(); i++) {
+      const MiraFeatureVector& vec=*pack.features[i];
       ValType score = wv.score(vec);
-      ValType bleu = scorer_->calculateSentenceLevelBackgroundScore(train_->scoresAt(i),backgroundBleu);
+      ValType bleu = scorer_->calculateSentenceLevelBackgroundScore(*pack.scores[i],backgroundBleu);
       // Hope
       if(i==0 || (hope_scale*score + bleu) > hope_score) {
         hope_score = hope_scale*score + bleu;
@@ -221,33 +322,80 @@ void NbestHopeFearDecoder::HopeFear(
       hope_scale = abs(hope_bleu) / abs(hope_model);
     else break;
   }
-  hopeFear->modelFeatures = train_->featuresAt(model_index);
-  hopeFear->hopeFeatures = train_->featuresAt(hope_index);
-  hopeFear->fearFeatures = train_->featuresAt(fear_index);
+  hopeFear->modelFeatures = *pack.features[model_index];
+  hopeFear->hopeFeatures = *pack.features[hope_index];
+  hopeFear->fearFeatures = *pack.features[fear_index];
 
-  hopeFear->hopeStats = train_->scoresAt(hope_index);
+  hopeFear->hopeStats = *pack.scores[hope_index];
   hopeFear->hopeBleu = scorer_->calculateSentenceLevelBackgroundScore(hopeFear->hopeStats, backgroundBleu);
-  const vector<float>& fear_stats = train_->scoresAt(fear_index);
+  const vector<float>& fear_stats = *pack.scores[fear_index];
   hopeFear->fearBleu = scorer_->calculateSentenceLevelBackgroundScore(fear_stats, backgroundBleu);
 
-  hopeFear->modelStats = train_->scoresAt(model_index);
+  hopeFear->modelStats = *pack.scores[model_index];
   hopeFear->hopeFearEqual = (hope_index == fear_index);
 }
 
+void NbestHopeFearDecoder::HopeFearBatch(
+  const std::vector<ValType>& backgroundBleu,
+  const MiraWeightVector& wv,
+  size_t batchSize,
+  size_t threads,
+  std::vector<HopeFearData>* batch
+)
+{
+  vector<HypPack> packs;
+  NextBatch(batchSize, &packs);
+  batch->clear();
+  batch->resize(packs.size());
+  ParallelFor(packs.size(), threads, boost::bind(&NbestHopeFearDecoder::HopeFearAt, this, _1,
+              boost::cref(packs), boost::cref(backgroundBleu), boost::cref(wv), batch));
+}
+
+void NbestHopeFearDecoder::HopeFearAt(size_t i, const vector<HypPack>& packs,
+                                      const vector<ValType>& backgroundBleu,
+                                      const MiraWeightVector& wv,
+                                      vector<HopeFearData>* batch) const
+{
+  HopeFear(packs[i], backgroundBleu, wv, &(*batch)[i]);
+}
+
 void NbestHopeFearDecoder::MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats)
+{
+  HypPack pack;
+  CurrentPack(&pack, false);
+  *stats = *pack.scores[MaxModel(pack, wv)];
+}
+
+size_t NbestHopeFearDecoder::MaxModel(const HypPack& pack, const AvgWeightVector& wv) const
 {
   // Find max model
   size_t max_index=0;
   ValType max_score=0;
-  for(size_t i=0; i<train_->cur_size(); i++) {
-    MiraFeatureVector vec(train_->featuresAt(i));
-    ValType score = wv.score(vec);
+  for(size_t i=0; i<pack.features.size(); i++) {
+    ValType score = wv.score(*pack.features[i]);
     if(i==0 || score > max_score) {
       max_index = i;
       max_score = score;
     }
   }
-  *stats = train_->scoresAt(max_index);
+  return max_index;
+}
+
+void NbestHopeFearDecoder::MaxModelBatch(const AvgWeightVector& wv, size_t batchSize,
+    size_t threads, std::vector<std::vector<ValType> >* stats)
+{
+  vector<HypPack> packs;
+  NextBatch(batchSize, &packs);
+  stats->resize(packs.size());
+  ParallelFor(packs.size(), threads, boost::bind(&NbestHopeFearDecoder::MaxModelAt, this, _1,
+              boost::cref(packs), boost::cref(wv), stats));
+}
+
+void NbestHopeFearDecoder::MaxModelAt(size_t i, const vector<HypPack>& packs,
+                                      const AvgWeightVector& wv,
+                                      vector<vector<ValType> >* stats) const
+{
+  (*stats)[i] = *packs[i].scores[MaxModel(packs[i], wv)];
 }
 
 
@@ -287,10 +435,7 @@ HypergraphHopeFearDecoder::HypergraphHopeFearDecoder
     //  cerr << "Reading " << hgpath.filename() << endl;
     Graph graph(vocab_);
     size_t id = boost::lexical_cast<size_t>(hgpath.stem().string());
-    util::scoped_fd fd(util::OpenReadOrThrow(hgpath.string().c_str()));
-    //util::FilePiece file(di->path().string().c_str());
-    util::FilePiece file(fd.release());
-    ReadGraph(file,graph);
+    ReadGraph(hgpath.string(), graph);
 
     //cerr << "ref length " << references_.Length(id) << endl;
     size_t edgeCount = hg_pruning * references_.Length(id);
@@ -328,16 +473,60 @@ bool HypergraphHopeFearDecoder::finished()
   return sentenceIdIter_ == sentenceIds_.end();
 }
 
+void HypergraphHopeFearDecoder::NextBatch(size_t batchSize, vector<size_t>* ids)
+{
+  ids->clear();
+  for (; ids->size() < batchSize && !finished(); next()) {
+    ids->push_back(*sentenceIdIter_);
+  }
+}
+
 void HypergraphHopeFearDecoder::HopeFear(
   const vector<ValType>& backgroundBleu,
   const MiraWeightVector& wv,
   HopeFearData* hopeFear
 )
 {
-  size_t sentenceId = *sentenceIdIter_;
   SparseVector weights;
   wv.ToSparse(&weights, num_dense_);
-  const Graph& graph = *(graphs_[sentenceId]);
+  HopeFear(*sentenceIdIter_, weights, backgroundBleu, hopeFear);
+}
+
+void HypergraphHopeFearDecoder::HopeFearBatch(
+  const vector<ValType>& backgroundBleu,
+  const MiraWeightVector& wv,
+  size_t batchSize,
+  size_t threads,
+  vector<HopeFearData>* batch
+)
+{
+  vector<size_t> ids;
+  NextBatch(batchSize, &ids);
+  // the weights are converted once for the whole batch
+  SparseVector weights;
+  wv.ToSparse(&weights, num_dense_);
+  batch->clear();
+  batch->resize(ids.size());
+  ParallelFor(ids.size(), threads, boost::bind(&HypergraphHopeFearDecoder::HopeFearAt, this, _1,
+              boost::cref(ids), boost::cref(weights), boost::cref(backgroundBleu), batch));
+}
+
+void HypergraphHopeFearDecoder::HopeFearAt(size_t i, const vector<size_t>& ids,
+    const SparseVector& weights,
+    const vector<ValType>& backgroundBleu,
+    vector<HopeFearData>* batch) const
+{
+  HopeFear(ids[i], weights, backgroundBleu, &(*batch)[i]);
+}
+
+void HypergraphHopeFearDecoder::HopeFear(
+  size_t sentenceId,
+  const SparseVector& weights,
+  const vector<ValType>& backgroundBleu,
+  HopeFearData* hopeFear
+) const
+{
+  const Graph& graph = *(graphs_.find(sentenceId)->second);
 
   // ValType hope_scale = 1.0;
   HgHypothesis hopeHypo, fearHypo, modelHypo;
@@ -428,13 +617,37 @@ void HypergraphHopeFearDecoder::HopeFear(
 void HypergraphHopeFearDecoder::MaxModel(const AvgWeightVector& wv, vector<ValType>* stats)
 {
   assert(!finished());
-  HgHypothesis bestHypo;
-  size_t sentenceId = *sentenceIdIter_;
   SparseVector weights;
   wv.ToSparse(&weights, num_dense_);
+  MaxModel(*sentenceIdIter_, weights, stats);
+}
+
+void HypergraphHopeFearDecoder::MaxModelBatch(const AvgWeightVector& wv, size_t batchSize,
+    size_t threads, vector<vector<ValType> >* stats)
+{
+  vector<size_t> ids;
+  NextBatch(batchSize, &ids);
+  SparseVector weights;
+  wv.ToSparse(&weights, num_dense_);
+  stats->resize(ids.size());
+  ParallelFor(ids.size(), threads, boost::bind(&HypergraphHopeFearDecoder::MaxModelAt, this, _1,
+              boost::cref(ids), boost::cref(weights), stats));
+}
+
+void HypergraphHopeFearDecoder::MaxModelAt(size_t i, const vector<size_t>& ids,
+    const SparseVector& weights,
+    vector<vector<ValType> >* stats) const
+{
+  MaxModel(ids[i], weights, &(*stats)[i]);
+}
+
+void HypergraphHopeFearDecoder::MaxModel(size_t sentenceId, const SparseVector& weights,
+    vector<ValType>* stats) const
+{
+  HgHypothesis bestHypo;
   vector<ValType> bg(scorer_->NumberOfScores());
   //cerr << "Calculating bleu on " << sentenceId << endl;
-  Viterbi(*(graphs_[sentenceId]), weights, 0, references_, sentenceId, bg, &bestHypo);
+  Viterbi(*(graphs_.find(sentenceId)->second), weights, 0, references_, sentenceId, bg, &bestHypo);
   stats->resize(bestHypo.bleuStats.size());
   /*
   for (size_t i = 0; i < bestHypo.text.size(); ++i) {
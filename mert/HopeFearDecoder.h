@@ -18,6 +18,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 #pragma once
 
+#include <deque>
 #include <vector>
 
 #include <boost/scoped_ptr.hpp>
@@ -80,12 +81,30 @@ public:
     HopeFearData* hopeFear
   ) = 0;
 
+  /**
+    * Calculate hope, fear and model hypotheses for a mini-batch: up to
+    * batchSize examples from the current one on, all against the same
+    * weights, spread over the given number of threads. Leaves the decoder
+    * positioned after the batch.
+    **/
+  virtual void HopeFearBatch(
+    const std::vector<ValType>& backgroundBleu,
+    const MiraWeightVector& wv,
+    std::size_t batchSize,
+    std::size_t threads,
+    std::vector<HopeFearData>* batch
+  ) = 0;
+
   /** Max score decoding */
   virtual void MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats)
   = 0;
 
+  /** Max score decoding of a batch, as in HopeFearBatch() */
+  virtual void MaxModelBatch(const AvgWeightVector& wv, std::size_t batchSize,
+                             std::size_t threads, std::vector<std::vector<ValType> >* stats) = 0;
+
   /** Calculate bleu on training set */
-  ValType Evaluate(const AvgWeightVector& wv);
+  ValType Evaluate(const AvgWeightVector& wv, std::size_t threads = 1);
 
 protected:
   Scorer* scorer_;
@@ -114,11 +133,46 @@ public:
     HopeFearData* hopeFear
   );
 
+  virtual void HopeFearBatch(
+    const std::vector<ValType>& backgroundBleu,
+    const MiraWeightVector& wv,
+    std::size_t batchSize,
+    std::size_t threads,
+    std::vector<HopeFearData>* batch
+  );
+
   virtual void MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats);
 
+  virtual void MaxModelBatch(const AvgWeightVector& wv, std::size_t batchSize,
+                             std::size_t threads, std::vector<std::vector<ValType> >* stats);
+
 private:
+  /** The hypotheses of one example */
+  struct HypPack {
+    std::vector<const MiraFeatureVector*> features;
+    std::vector<const ScoreDataItem*> scores;
+  };
+
+  /** Collect up to batchSize examples from the current one on, and advance past them */
+  void NextBatch(std::size_t batchSize, std::vector<HypPack>* packs);
+  void CurrentPack(HypPack* pack, bool copy);
+
+  void HopeFear(const HypPack& pack, const std::vector<ValType>& backgroundBleu,
+                const MiraWeightVector& wv, HopeFearData* hopeFear) const;
+  void HopeFearAt(std::size_t i, const std::vector<HypPack>& packs,
+                  const std::vector<ValType>& backgroundBleu,
+                  const MiraWeightVector& wv, std::vector<HopeFearData>* batch) const;
+  /** Index of the max model hypothesis */
+  std::size_t MaxModel(const HypPack& pack, const AvgWeightVector& wv) const;
+  void MaxModelAt(std::size_t i, const std::vector<HypPack>& packs,
+                  const AvgWeightVector& wv, std::vector<std::vector<ValType> >* stats) const;
+
   boost::scoped_ptr<HypPackEnumerator> train_;
   bool safe_hope_;
+  // the streaming enumerator reuses its storage, so batches are copied here
+  bool streaming_;
+  std::deque<MiraFeatureVector> featureBuffer_;
+  std::deque<ScoreDataItem> scoreBuffer_;
 
 };
 
@@ -150,9 +204,32 @@ public:
     HopeFearData* hopeFear
   );
 
+  virtual void HopeFearBatch(
+    const std::vector<ValType>& backgroundBleu,
+    const MiraWeightVector& wv,
+    std::size_t batchSize,
+    std::size_t threads,
+    std::vector<HopeFearData>* batch
+  );
+
   virtual void MaxModel(const AvgWeightVector& wv, std::vector<ValType>* stats);
 
+  virtual void MaxModelBatch(const AvgWeightVector& wv, std::size_t batchSize,
+                             std::size_t threads, std::vector<std::vector<ValType> >* stats);
+
 private:
+  /** Collect up to batchSize sentence ids from the current one on, and advance past them */
+  void NextBatch(std::size_t batchSize, std::vector<std::size_t>* ids);
+
+  void HopeFear(std::size_t sentenceId, const SparseVector& weights,
+                const std::vector<ValType>& backgroundBleu, HopeFearData* hopeFear) const;
+  void HopeFearAt(std::size_t i, const std::vector<std::size_t>& ids, const SparseVector& weights,
+                  const std::vector<ValType>& backgroundBleu, std::vector<HopeFearData>* batch) const;
+  void MaxModel(std::size_t sentenceId, const SparseVector& weights,
+                std::vector<ValType>* stats) const;
+  void MaxModelAt(std::size_t i, const std::vector<std::size_t>& ids, const SparseVector& weights,
+                  std::vector<std::vector<ValType> >* stats) const;
+
   size_t num_dense_;
   //maps sentence Id to graph ptr
   typedef std::map<size_t, boost::shared_ptr<Graph> > GraphColl;
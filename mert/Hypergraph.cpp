@@ -16,12 +16,16 @@ You should have received a copy of the GNU Lesser General Public
 License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
+#include <cstring>
 #include <iostream>
 #include <set>
 
+#include <boost/cstdint.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include "util/double-conversion/double-conversion.h"
+#include "util/file.hh"
+#include "util/mmap.hh"
 #include "util/string_piece.hh"
 #include "util/tokenize_piece.hh"
 
@@ -320,4 +324,250 @@ void ReadGraph(util::FilePiece &from, Graph &graph)
   }
 }
 
+/**
+  * Binary format, in native byte order. The header (see below) is followed
+  * by a topology block:
+  *   uint64 vertex_edges[vertices+1]   edges of vertex v are [vertex_edges[v], vertex_edges[v+1])
+  *   uint64 edge_words[edges+1]        words of each edge, likewise
+  *   uint64 edge_children[edges+1]     children of each edge, likewise
+  *   uint32 source_covered[vertices]
+  *   uint32 words[words]               vocabulary ids, kBinaryNonTerminal for non-terminals
+  *   uint32 children[children]         vertex ids, which are below the id of the head
+  * then by a feature block:
+  *   uint64 edge_features[edges+1]
+  *   uint32 feature_names[features]    feature name ids
+  *   float feature_values[features]
+  * and finally by the NUL-terminated vocabulary and feature names. Every
+  * array starts at a multiple of 8 bytes. Keep in sync with the writer in
+  * moses/HypergraphOutput.cpp.
+**/
+namespace
+{
+
+const char kBinaryMagic[8] = {'m', 'o', 's', 'e', 's', 'H', 'G', '1'};
+const boost::uint32_t kBinaryNonTerminal = 0xffffffff;
+
+struct BinaryHeader {
+  char magic[8];
+  boost::uint64_t vertices;
+  boost::uint64_t edges;
+  boost::uint64_t words;
+  boost::uint64_t children;
+  boost::uint64_t features;
+  boost::uint64_t vocab_size;
+  boost::uint64_t vocab_bytes;
+  boost::uint64_t names_size;
+  boost::uint64_t names_bytes;
+};
+
+inline size_t Padded(size_t bytes)
+{
+  return (bytes + 7) & ~size_t(7);
+}
+
+// Carves consecutive arrays out of the mapped file.
+class BinaryBlocks
+{
+public:
+  BinaryBlocks(const char *data, size_t size) : p_(data), end_(data + size) {}
+
+  template <class T> const T *Next(size_t count) {
+    const T *ret = reinterpret_cast<const T*>(p_);
+    size_t bytes = Padded(count * sizeof(T));
+    UTIL_THROW_IF(static_cast<size_t>(end_ - p_) < bytes, HypergraphException, "Binary hypergraph is truncated");
+    p_ += bytes;
+    return ret;
+  }
+
+  // Split size NUL-terminated strings occupying bytes.
+  void Strings(size_t size, size_t bytes, std::vector<StringPiece> &out) {
+    const char *str = Next<char>(bytes);
+    const char *end = str + bytes;
+    out.clear();
+    for (size_t i = 0; i < size; ++i) {
+      const char *nul = static_cast<const char*>(memchr(str, 0, end - str));
+      UTIL_THROW_IF(!nul, HypergraphException, "Binary hypergraph has bad string table");
+      out.push_back(StringPiece(str, nul - str));
+      str = nul + 1;
+    }
+  }
+
+  bool AtEnd() const {
+    return p_ == end_;
+  }
+
+private:
+  const char *p_;
+  const char *end_;
+};
+
+void WritePadded(ostream &out, const void *data, size_t bytes)
+{
+  static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  out.write(reinterpret_cast<const char*>(data), bytes);
+  out.write(zeros, Padded(bytes) - bytes);
+}
+
+template <class T> void WriteArray(ostream &out, const vector<T> &v)
+{
+  WritePadded(out, v.empty() ? NULL : &v[0], v.size() * sizeof(T));
+}
+
+// Id of key, appending str to the NUL-terminated strings if it is new.
+template <class Key> boost::uint32_t Intern(boost::unordered_map<Key, boost::uint32_t> &ids, const Key &key, const StringPiece &str, string &strings)
+{
+  pair<typename boost::unordered_map<Key, boost::uint32_t>::iterator, bool> ret = ids.insert(make_pair(key, static_cast<boost::uint32_t>(ids.size())));
+  if (ret.second) {
+    strings.append(str.data(), str.size());
+    strings.push_back('\0');
+  }
+  return ret.first->second;
+}
+
+} // namespace
+
+void ReadBinaryGraph(const char *data, size_t size, Graph &graph)
+{
+  UTIL_THROW_IF(size < sizeof(BinaryHeader), HypergraphException, "Binary hypergraph is truncated");
+  BinaryHeader header;
+  memcpy(&header, data, sizeof(header));
+  UTIL_THROW_IF(memcmp(header.magic, kBinaryMagic, sizeof(kBinaryMagic)), HypergraphException, "Not a binary hypergraph");
+
+  BinaryBlocks blocks(data + sizeof(header), size - sizeof(header));
+  const boost::uint64_t *vertexEdges = blocks.Next<boost::uint64_t>(header.vertices + 1);
+  const boost::uint64_t *edgeWords = blocks.Next<boost::uint64_t>(header.edges + 1);
+  const boost::uint64_t *edgeChildren = blocks.Next<boost::uint64_t>(header.edges + 1);
+  const boost::uint32_t *sourceCovered = blocks.Next<boost::uint32_t>(header.vertices);
+  const boost::uint32_t *words = blocks.Next<boost::uint32_t>(header.words);
+  const boost::uint32_t *children = blocks.Next<boost::uint32_t>(header.children);
+  const boost::uint64_t *edgeFeatures = blocks.Next<boost::uint64_t>(header.edges + 1);
+  const boost::uint32_t *featureNames = blocks.Next<boost::uint32_t>(header.features);
+  const float *featureValues = blocks.Next<float>(header.features);
+
+  // Strings are looked up once per file rather than once per occurrence.
+  vector<StringPiece> strings;
+  blocks.Strings(header.vocab_size, header.vocab_bytes, strings);
+  vector<const Vocab::Entry*> vocab(strings.size());
+  for (size_t i = 0; i < strings.size(); ++i) {
+    vocab[i] = &graph.MutableVocab().FindOrAdd(strings[i]);
+  }
+  blocks.Strings(header.names_size, header.names_bytes, strings);
+  vector<size_t> names(strings.size());
+  for (size_t i = 0; i < strings.size(); ++i) {
+    names[i] = SparseVector::encode(strings[i].as_string());
+  }
+  UTIL_THROW_IF(!blocks.AtEnd(), HypergraphException, "Binary hypergraph has trailing data");
+  UTIL_THROW_IF(vertexEdges[0] || vertexEdges[header.vertices] != header.edges ||
+                edgeWords[0] || edgeWords[header.edges] != header.words ||
+                edgeChildren[0] || edgeChildren[header.edges] != header.children ||
+                edgeFeatures[0] || edgeFeatures[header.edges] != header.features,
+                HypergraphException, "Binary hypergraph has inconsistent offsets");
+
+  graph.SetCounts(header.vertices, header.edges);
+  for (size_t v = 0; v < header.vertices; ++v) {
+    Vertex *vertex = graph.NewVertex();
+    vertex->SetSourceCovered(sourceCovered[v]);
+    UTIL_THROW_IF(vertexEdges[v] > vertexEdges[v + 1], HypergraphException, "Binary hypergraph has inconsistent offsets");
+    for (size_t e = vertexEdges[v]; e < vertexEdges[v + 1]; ++e) {
+      Edge *edge = graph.NewEdge();
+      UTIL_THROW_IF(edgeWords[e] > edgeWords[e + 1] || edgeChildren[e] > edgeChildren[e + 1] ||
+                    edgeFeatures[e] > edgeFeatures[e + 1],
+                    HypergraphException, "Binary hypergraph has inconsistent offsets");
+      for (size_t w = edgeWords[e]; w < edgeWords[e + 1]; ++w) {
+        if (words[w] == kBinaryNonTerminal) {
+          edge->AddWord(NULL);
+        } else {
+          UTIL_THROW_IF(words[w] >= vocab.size(), HypergraphException, "Bad word id " << words[w]);
+          edge->AddWord(vocab[words[w]]);
+        }
+      }
+      for (size_t c = edgeChildren[e]; c < edgeChildren[e + 1]; ++c) {
+        UTIL_THROW_IF(children[c] >= v, HypergraphException, "Reference to vertex " << children[c] << " from vertex " << v << ".  Is the file in bottom-up format?");
+        edge->AddChild(children[c]);
+      }
+      for (size_t f = edgeFeatures[e]; f < edgeFeatures[e + 1]; ++f) {
+        UTIL_THROW_IF(featureNames[f] >= names.size(), HypergraphException, "Bad feature id " << featureNames[f]);
+        edge->AddFeature(names[featureNames[f]], featureValues[f]);
+      }
+      vertex->AddEdge(edge);
+    }
+  }
+}
+
+void WriteBinaryGraph(const Graph &graph, ostream &out)
+{
+  vector<boost::uint64_t> vertexEdges(1, 0), edgeWords(1, 0), edgeChildren(1, 0), edgeFeatures(1, 0);
+  vector<boost::uint32_t> sourceCovered, words, children, featureNames;
+  vector<float> featureValues;
+  boost::unordered_map<const Vocab::Entry*, boost::uint32_t> vocabIds;
+  boost::unordered_map<size_t, boost::uint32_t> nameIds;
+  string vocab, names;
+
+  for (size_t v = 0; v < graph.VertexSize(); ++v) {
+    const Vertex &vertex = graph.GetVertex(v);
+    sourceCovered.push_back(vertex.SourceCovered());
+    for (size_t e = 0; e < vertex.GetIncoming().size(); ++e) {
+      const Edge &edge = *vertex.GetIncoming()[e];
+      for (WordVec::const_iterator w = edge.Words().begin(); w != edge.Words().end(); ++w) {
+        words.push_back(*w ? Intern(vocabIds, *w, StringPiece((*w)->first), vocab) : kBinaryNonTerminal);
+      }
+      children.insert(children.end(), edge.Children().begin(), edge.Children().end());
+      const SparseVector &features = *edge.Features();
+      vector<size_t> ids = features.feats();
+      for (size_t f = 0; f < ids.size(); ++f) {
+        featureNames.push_back(Intern(nameIds, ids[f], SparseVector::decode(ids[f]), names));
+        featureValues.push_back(features.get(ids[f]));
+      }
+      edgeWords.push_back(words.size());
+      edgeChildren.push_back(children.size());
+      edgeFeatures.push_back(featureNames.size());
+    }
+    vertexEdges.push_back(edgeWords.size() - 1);
+  }
+
+  BinaryHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+  header.vertices = sourceCovered.size();
+  header.edges = edgeWords.size() - 1;
+  header.words = words.size();
+  header.children = children.size();
+  header.features = featureNames.size();
+  header.vocab_size = vocabIds.size();
+  header.vocab_bytes = vocab.size();
+  header.names_size = nameIds.size();
+  header.names_bytes = names.size();
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  WriteArray(out, vertexEdges);
+  WriteArray(out, edgeWords);
+  WriteArray(out, edgeChildren);
+  WriteArray(out, sourceCovered);
+  WriteArray(out, words);
+  WriteArray(out, children);
+
+  WriteArray(out, edgeFeatures);
+  WriteArray(out, featureNames);
+  WriteArray(out, featureValues);
+
+  WritePadded(out, vocab.data(), vocab.size());
+  WritePadded(out, names.data(), names.size());
+}
+
+void ReadGraph(const string &filename, Graph &graph)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(filename.c_str()));
+  char magic[sizeof(kBinaryMagic)];
+  if (util::ReadOrEOF(fd.get(), magic, sizeof(magic)) == sizeof(magic) &&
+      !memcmp(magic, kBinaryMagic, sizeof(kBinaryMagic))) {
+    util::scoped_memory mem;
+    util::MapRead(util::POPULATE_OR_READ, fd.get(), 0, util::SizeOrThrow(fd.get()), mem);
+    ReadBinaryGraph(mem.begin(), mem.size(), graph);
+  } else {
+    util::SeekOrThrow(fd.get(), 0);
+    util::FilePiece file(fd.release());
+    ReadGraph(file, graph);
+  }
+}
+
 };
@@ -20,6 +20,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef MERT_HYPERGRAPH_H
 #define MERT_HYPERGRAPH_H
 
+#include <ostream>
 #include <string>
 
 #include <boost/noncopyable.hpp>
@@ -152,6 +153,10 @@ public:
     features_->set(name.as_string(),value);
   }
 
+  void AddFeature(std::size_t id, FeatureStatsType value) {
+    features_->set(id,value);
+  }
+
 
   const WordVec &Words() const {
     return words_;
@@ -272,6 +277,24 @@ public:
 
 void ReadGraph(util::FilePiece &from, Graph &graph);
 
+/**
+ * Read the binary hypergraph format (written by moses for the "bin" type of
+ * output-search-graph-hypergraph) from the given memory.
+**/
+void ReadBinaryGraph(const char *data, std::size_t size, Graph &graph);
+
+/**
+ * Write the graph in the binary format read by ReadBinaryGraph, e.g. to
+ * convert a text hypergraph.
+**/
+void WriteBinaryGraph(const Graph &graph, std::ostream &out);
+
+/**
+ * Read a hypergraph file, which may be in the text format (possibly
+ * compressed) or in the binary format. Binary files are memory mapped.
+**/
+void ReadGraph(const std::string &filename, Graph &graph);
+
 
 };
 
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <sstream>
 
 #define BOOST_TEST_MODULE MertForestRescore
 #include <boost/test/unit_test.hpp>
@@ -149,3 +150,84 @@ BOOST_AUTO_TEST_CASE(prune)
 
 
 }
+
+BOOST_AUTO_TEST_CASE(binary_roundtrip)
+{
+  Vocab vocab;
+  WordVec words;
+  string wordStrings[] = {"<s>", "</s>", "a", "b"};
+  for (size_t i = 0; i < 4; ++i) {
+    words.push_back(&(vocab.FindOrAdd((wordStrings[i]))));
+  }
+
+  Graph graph(vocab);
+  graph.SetCounts(3,4);
+
+  Edge* e0 = graph.NewEdge();
+  e0->AddWord(words[0]);
+  Vertex* v0 = graph.NewVertex();
+  v0->AddEdge(e0);
+
+  Edge* e1 = graph.NewEdge();
+  e1->AddWord(NULL);
+  e1->AddChild(0);
+  e1->AddWord(words[2]);
+  e1->AddFeature("foo",1.5);
+  e1->AddFeature("bar",-2);
+  Edge* e2 = graph.NewEdge();
+  e2->AddWord(NULL);
+  e2->AddChild(0);
+  e2->AddWord(words[3]);
+  e2->AddFeature("foo",0.25);
+  Vertex* v1 = graph.NewVertex();
+  v1->AddEdge(e1);
+  v1->AddEdge(e2);
+  v1->SetSourceCovered(1);
+
+  Edge* e3 = graph.NewEdge();
+  e3->AddWord(NULL);
+  e3->AddChild(1);
+  e3->AddWord(words[1]);
+  Vertex* v2 = graph.NewVertex();
+  v2->AddEdge(e3);
+  v2->SetSourceCovered(1);
+
+  ostringstream out;
+  WriteBinaryGraph(graph, out);
+  const string binary = out.str();
+
+  Vocab readVocab;
+  Graph read(readVocab);
+  ReadBinaryGraph(binary.data(), binary.size(), read);
+
+  BOOST_REQUIRE_EQUAL(graph.VertexSize(), read.VertexSize());
+  BOOST_REQUIRE_EQUAL(graph.EdgeSize(), read.EdgeSize());
+  for (size_t v = 0; v < graph.VertexSize(); ++v) {
+    const Vertex& expected = graph.GetVertex(v);
+    const Vertex& actual = read.GetVertex(v);
+    BOOST_CHECK_EQUAL(expected.SourceCovered(), actual.SourceCovered());
+    BOOST_REQUIRE_EQUAL(expected.GetIncoming().size(), actual.GetIncoming().size());
+    for (size_t e = 0; e < expected.GetIncoming().size(); ++e) {
+      const Edge* expectedEdge = expected.GetIncoming()[e];
+      const Edge* actualEdge = actual.GetIncoming()[e];
+      BOOST_REQUIRE_EQUAL(expectedEdge->Words().size(), actualEdge->Words().size());
+      for (size_t w = 0; w < expectedEdge->Words().size(); ++w) {
+        if (expectedEdge->Words()[w]) {
+          BOOST_REQUIRE(actualEdge->Words()[w]);
+          BOOST_CHECK_EQUAL(string(expectedEdge->Words()[w]->first), string(actualEdge->Words()[w]->first));
+        } else {
+          BOOST_CHECK_EQUAL((Vocab::Entry*)NULL, actualEdge->Words()[w]);
+        }
+      }
+      BOOST_CHECK(expectedEdge->Children() == actualEdge->Children());
+      BOOST_CHECK(*expectedEdge->Features() == *actualEdge->Features());
+    }
+  }
+
+  // the sentence boundaries are recognised in the new vocabulary
+  BOOST_CHECK(read.IsBoundary(read.GetVertex(0).GetIncoming()[0]->Words()[0]));
+
+  Vocab truncatedVocab;
+  Graph truncated(truncatedVocab);
+  BOOST_CHECK_THROW(ReadBinaryGraph(binary.data(), binary.size() - 8, truncated), HypergraphException);
+}
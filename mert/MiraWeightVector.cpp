@@ -44,6 +44,21 @@ void MiraWeightVector::update(const MiraFeatureVector& fv, float tau)
   }
 }
 
+/**
+ * Update the model with several feature vectors, as a single update
+ * \param fvs  Feature vectors to be added to the weights
+ * \param taus Each FV will be scaled by its value before update
+ */
+void MiraWeightVector::update(const vector<MiraFeatureVector>& fvs, const vector<float>& taus)
+{
+  m_numUpdates++;
+  for(size_t j=0; j<fvs.size(); j++) {
+    for(size_t i=0; i<fvs[j].size(); i++) {
+      update(fvs[j].feat(i), fvs[j].val(i)*taus[j]);
+    }
+  }
+}
+
 /**
  * Perform an empty update (affects averaging)
  */
@@ -42,6 +42,13 @@ public:
    */
   void update(const MiraFeatureVector& fv, float tau);
 
+  /**
+   * Update the model with several feature vectors, as a single update
+   * \param fvs  Feature vectors to be added to the weights
+   * \param taus Each FV will be scaled by its value before update
+   */
+  void update(const std::vector<MiraFeatureVector>& fvs, const std::vector<float>& taus);
+
   /**
    * Perform an empty update (affects averaging)
    */
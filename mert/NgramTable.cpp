@@ -0,0 +1,51 @@
+#include "NgramTable.h"
+
+using namespace std;
+
+namespace MosesTuning
+{
+
+void NgramTable::Build(const NgramCounts& counts)
+{
+  m_size = counts.size();
+  // at most half full
+  size_t capacity = 8;
+  while (capacity < 2 * m_size) capacity *= 2;
+  Entry empty;
+  empty.hash = 0;
+  empty.order = 0;
+  empty.count = 0;
+  m_entries.assign(capacity, empty);
+  m_mask = capacity - 1;
+
+  for (NgramCounts::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+    const NgramCounts::Key& ngram = it->first;
+    // longer n-grams can never be looked up
+    if (ngram.empty() || ngram.size() > kMaxOrder) continue;
+    boost::uint64_t hash = 0;
+    for (size_t i = 0; i < ngram.size(); ++i) hash = Extend(hash, ngram[i]);
+
+    size_t slot = Bucket(hash) & m_mask;
+    while (m_entries[slot].order) slot = (slot + 1) & m_mask;
+    Entry& entry = m_entries[slot];
+    entry.hash = hash;
+    entry.order = ngram.size();
+    entry.count = it->second;
+    for (size_t i = 0; i < ngram.size(); ++i) entry.ids[i] = ngram[i];
+  }
+}
+
+int NgramTable::Find(const int* ids, size_t order, boost::uint64_t hash) const
+{
+  if (m_entries.empty()) return -1;
+  for (size_t slot = Bucket(hash) & m_mask; m_entries[slot].order; slot = (slot + 1) & m_mask) {
+    const Entry& entry = m_entries[slot];
+    if (entry.hash != hash || static_cast<size_t>(entry.order) != order) continue;
+    size_t i = 0;
+    while (i < order && entry.ids[i] == ids[i]) ++i;
+    if (i == order) return static_cast<int>(slot);
+  }
+  return -1;
+}
+
+}
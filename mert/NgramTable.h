@@ -0,0 +1,73 @@
+#ifndef MERT_NGRAM_TABLE_H_
+#define MERT_NGRAM_TABLE_H_
+
+#include <cstddef>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+#include "Ngram.h"
+
+namespace MosesTuning
+{
+
+/**
+ * Read-only copy of NgramCounts in a flat open-addressing table, for
+ * n-grams up to kMaxOrder words. N-grams are looked up by a hash that
+ * is extended one word at a time, so all the n-grams starting at one
+ * position of a sentence can be found without building any keys.
+ */
+class NgramTable
+{
+public:
+  static const std::size_t kMaxOrder = 4;
+
+  NgramTable() : m_mask(0), m_size(0) {}
+
+  /** Rebuild the table from the given counts. */
+  void Build(const NgramCounts& counts);
+
+  /** Number of n-grams in the counts the table was built from. */
+  std::size_t size() const {
+    return m_size;
+  }
+
+  /** Number of slots; slot numbers are below this. */
+  std::size_t capacity() const {
+    return m_entries.size();
+  }
+
+  /** Hash of the n-gram extended by one word; start from Extend(0, first word). */
+  static boost::uint64_t Extend(boost::uint64_t hash, int id) {
+    return (hash ^ static_cast<boost::uint32_t>(id)) * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL;
+  }
+
+  /**
+   * Find the n-gram ids[0..order), whose hash is given. Returns its slot,
+   * or -1 if it is not in the table.
+   */
+  int Find(const int* ids, std::size_t order, boost::uint64_t hash) const;
+
+  int count(std::size_t slot) const {
+    return m_entries[slot].count;
+  }
+
+private:
+  struct Entry {
+    boost::uint64_t hash;
+    int ids[kMaxOrder];
+    int order; // 0 for empty slots
+    int count;
+  };
+
+  static std::size_t Bucket(boost::uint64_t hash) {
+    return static_cast<std::size_t>(hash ^ (hash >> 29));
+  }
+
+  std::vector<Entry> m_entries;
+  std::size_t m_mask;
+  std::size_t m_size;
+};
+
+}
+
+#endif  // MERT_NGRAM_TABLE_H_
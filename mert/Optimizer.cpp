@@ -8,6 +8,10 @@
 #include <cfloat>
 #include <iostream>
 #include <stdint.h>
+#include <algorithm>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
 
 #include "Point.h"
 #include "Util.h"
@@ -39,7 +43,8 @@ namespace MosesTuning
 
 
 Optimizer::Optimizer(unsigned Pd, const vector<unsigned>& i2O, const vector<bool>& pos, const vector<parameter_t>& start, unsigned int nrandom)
-  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom), m_positive(pos)
+  : m_scorer(NULL), m_feature_data(), m_num_random_directions(nrandom),
+    m_num_threads(1), m_parallel_directions(false), m_positive(pos)
 {
   // Warning: the init vector is a full set of parameters, of dimension m_pdim!
   Point::m_pdim = Pd;
@@ -71,196 +76,239 @@ statscore_t Optimizer::GetStatScore(const Point& param) const
   return score;
 }
 
-map<float,diff_t >::iterator AddThreshold(map<float,diff_t >& thresholdmap, float newt, const pair<unsigned,unsigned>& newdiff)
+void Optimizer::SentenceEnvelope(unsigned int S, const Point& origin, const Point& direction,
+                                 unsigned& first1best, vector<LineThreshold>& thresholds) const
 {
-  map<float,diff_t>::iterator it = thresholdmap.find(newt);
-  if (it != thresholdmap.end()) {
-    // the threshold already exists!! this is very unlikely
-    if (it->second.back().first == newdiff.first)
-      // there was already a diff for this sentence, we change the 1 best;
-      it->second.back().second = newdiff.second;
-    else
-      it->second.push_back(newdiff);
-  } else {
-    // normal case
-    pair<map<float,diff_t>::iterator, bool> ins = thresholdmap.insert(threshold(newt, diff_t(1, newdiff)));
-    UTIL_THROW_IF(!ins.second, util::Exception, "Error");                // we really inserted something
-    it = ins.first;
+  float min_int = 0.0001;
+  const size_t begin = thresholds.size();
+
+  // First, we determine the translation with the best feature score
+  // for each sentence and each value of x.
+  //cerr << "Sentence " << S << endl;
+  multimap<float, unsigned> gradient;
+  vector<float> f0;
+  f0.resize(m_feature_data->get(S).size());
+  for (unsigned j = 0; j < m_feature_data->get(S).size(); j++) {
+    // gradient of the feature function for this particular target sentence
+    gradient.insert(pair<float, unsigned>(direction * (m_feature_data->get(S,j)), j));
+    // compute the feature function at the origin point
+    f0[j] = origin * m_feature_data->get(S, j);
   }
-  return it;
+  // Now let's compute the 1best for each value of x.
+
+  multimap<float,unsigned>::iterator gradientit = gradient.begin();
+  multimap<float,unsigned>::iterator highest_f0 = gradient.begin();
+
+  float smallest = gradientit->first;//smallest gradient
+  // Several candidates can have the lowest slope (e.g., for word penalty where the gradient is an integer).
+
+  gradientit++;
+  while (gradientit != gradient.end() && gradientit->first == smallest) {
+    if (f0[gradientit->second] > f0[highest_f0->second])
+      highest_f0 = gradientit;//the highest line is the one with he highest f0
+    gradientit++;
+  }
+
+  gradientit = highest_f0;
+  first1best = highest_f0->second;
+
+  // Now we look for the intersections points indicating a change of 1 best.
+  // We use the fact that the function is convex, which means that the gradient can only go up.
+  while (gradientit != gradient.end()) {
+    map<float,unsigned>::iterator leftmost = gradientit;
+    float m = gradientit->first;
+    float b = f0[gradientit->second];
+    multimap<float,unsigned>::iterator gradientit2 = gradientit;
+    gradientit2++;
+    float leftmostx = MAX_FLOAT;
+    for (; gradientit2 != gradient.end(); gradientit2++) {
+      // Look for all candidate with a gradient bigger than the current one, and
+      // find the one with the leftmost intersection.
+      float curintersect;
+      if (m != gradientit2->first) {
+        curintersect = intersect(m, b, gradientit2->first, f0[gradientit2->second]);
+        if (curintersect<=leftmostx) {
+          // We have found an intersection to the left of the leftmost we had so far.
+          // We might have curintersect==leftmostx for example is 2 candidates are the same
+          // in that case its better its better to update leftmost to gradientit2 to avoid some recomputing later.
+          leftmostx = curintersect;
+          leftmost = gradientit2; // this is the new reference
+        }
+      }
+    }
+    if (leftmost == gradientit) {
+      // We didn't find any more intersections.
+      // The rightmost bestindex is the one with the highest slope.
+
+      // They should be equal but there might be.
+      UTIL_THROW_IF(abs(leftmost->first-gradient.rbegin()->first) >= 0.0001,
+                    util::Exception, "Error");
+      // A small difference due to rounding error
+      break;
+    }
+    // We have found the next intersection!
+    LineThreshold t = { leftmostx, S, leftmost->second }; // new onebest for Sentence S is leftmost->second
+
+    if (thresholds.size() > begin && leftmostx - thresholds.back().x < min_int) {
+      // Require that the intersection Point be at least min_int to the right of the previous
+      // one (for this sentence). If not, we replace the previous intersection Point with
+      // this one.
+      // Yes, it can even happen that the new intersection Point is slightly to the left of
+      // the old one, because of numerical imprecision. We do not check that we are to the
+      // right of the penultimate point also. It this happen the 1best the interval will
+      // be wrong we are going to replace the previous one by the new one because we do not want to keep
+      // 2 very close threshold: if the minima is there it could be an artifact.
+      thresholds.back() = t;
+    } else { //normal insertion process
+      thresholds.push_back(t);
+    }
+    gradientit = leftmost;
+  } // while (gradientit!=gradient.end()){
 }
 
-statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction, Point& bestpoint) const
+namespace
 {
-  // We are looking for the best Point on the line y=Origin+x*direction
-  float min_int = 0.0001;
-  //typedef pair<unsigned,unsigned> diff;//first the sentence that changes, second is the new 1best for this sentence
-  //list<threshold> thresholdlist;
-
-  map<float,diff_t> thresholdmap;
-  thresholdmap[MIN_FLOAT] = diff_t();
-  vector<unsigned> first1best;       // the vector of nbests for x=-inf
-  for (unsigned int S = 0; S < size(); S++) {
-    map<float,diff_t >::iterator previnserted = thresholdmap.begin();
-    // First, we determine the translation with the best feature score
-    // for each sentence and each value of x.
-    //cerr << "Sentence " << S << endl;
-    multimap<float, unsigned> gradient;
-    vector<float> f0;
-    f0.resize(m_feature_data->get(S).size());
-    for (unsigned j = 0; j < m_feature_data->get(S).size(); j++) {
-      // gradient of the feature function for this particular target sentence
-      gradient.insert(pair<float, unsigned>(direction * (m_feature_data->get(S,j)), j));
-      // compute the feature function at the origin point
-      f0[j] = origin * m_feature_data->get(S, j);
-    }
-    // Now let's compute the 1best for each value of x.
 
-    //    vector<pair<float,unsigned> > onebest;
+// Computes the envelopes of a range of sentences; the thresholds are
+// sorted by position on the line, then by sentence.
+struct EnvelopeTask {
+  const Optimizer* optimizer;
+  const Point* origin;
+  const Point* direction;
+  unsigned begin, end;
+  vector<unsigned>* first1best;
+  vector<Optimizer::LineThreshold>* thresholds;
+
+  void operator()() const {
+    for (unsigned S = begin; S < end; ++S)
+      optimizer->SentenceEnvelope(S, *origin, *direction, (*first1best)[S], *thresholds);
+    stable_sort(thresholds->begin(), thresholds->end());
+  }
+};
 
+// Merges two sorted threshold lists; on ties, a precedes b.
+struct MergeTask {
+  const vector<Optimizer::LineThreshold>* a;
+  const vector<Optimizer::LineThreshold>* b;
+  vector<Optimizer::LineThreshold>* out;
 
-    multimap<float,unsigned>::iterator gradientit = gradient.begin();
-    multimap<float,unsigned>::iterator highest_f0 = gradient.begin();
+  void operator()() const {
+    out->resize(a->size() + b->size());
+    merge(a->begin(), a->end(), b->begin(), b->end(), out->begin());
+  }
+};
 
-    float smallest = gradientit->first;//smallest gradient
-    // Several candidates can have the lowest slope (e.g., for word penalty where the gradient is an integer).
+template<typename Task>
+void RunTasks(const vector<Task>& tasks)
+{
+#ifdef WITH_THREADS
+  boost::thread_group threads;
+  for (size_t i = 1; i < tasks.size(); ++i)
+    threads.create_thread(tasks[i]);
+  if (tasks.size()) tasks[0]();
+  threads.join_all();
+#else
+  for (size_t i = 0; i < tasks.size(); ++i)
+    tasks[i]();
+#endif
+}
 
-    gradientit++;
-    while (gradientit != gradient.end() && gradientit->first == smallest) {
-      //   cerr<<"ni"<<gradientit->second<<endl;;
-      //cerr<<"fos"<<f0[gradientit->second]<<" "<<f0[index]<<" "<<index<<endl;
-      if (f0[gradientit->second] > f0[highest_f0->second])
-        highest_f0 = gradientit;//the highest line is the one with he highest f0
-      gradientit++;
-    }
+} // namespace
 
-    gradientit = highest_f0;
-    first1best.push_back(highest_f0->second);
-
-    // Now we look for the intersections points indicating a change of 1 best.
-    // We use the fact that the function is convex, which means that the gradient can only go up.
-    while (gradientit != gradient.end()) {
-      map<float,unsigned>::iterator leftmost = gradientit;
-      float m = gradientit->first;
-      float b = f0[gradientit->second];
-      multimap<float,unsigned>::iterator gradientit2 = gradientit;
-      gradientit2++;
-      float leftmostx = MAX_FLOAT;
-      for (; gradientit2 != gradient.end(); gradientit2++) {
-        //cerr<<"--"<<d++<<' '<<gradientit2->first<<' '<<gradientit2->second<<endl;
-        // Look for all candidate with a gradient bigger than the current one, and
-        // find the one with the leftmost intersection.
-        float curintersect;
-        if (m != gradientit2->first) {
-          curintersect = intersect(m, b, gradientit2->first, f0[gradientit2->second]);
-          //cerr << "curintersect: " << curintersect << " leftmostx: " << leftmostx << endl;
-          if (curintersect<=leftmostx) {
-            // We have found an intersection to the left of the leftmost we had so far.
-            // We might have curintersect==leftmostx for example is 2 candidates are the same
-            // in that case its better its better to update leftmost to gradientit2 to avoid some recomputing later.
-            leftmostx = curintersect;
-            leftmost = gradientit2; // this is the new reference
-          }
-        }
-      }
-      if (leftmost == gradientit) {
-        // We didn't find any more intersections.
-        // The rightmost bestindex is the one with the highest slope.
-
-        // They should be equal but there might be.
-        UTIL_THROW_IF(abs(leftmost->first-gradient.rbegin()->first) >= 0.0001,
-                      util::Exception, "Error");
-        // A small difference due to rounding error
-        break;
-      }
-      // We have found the next intersection!
-
-      pair<unsigned,unsigned> newd(S, leftmost->second);//new onebest for Sentence S is leftmost->second
-
-      if (leftmostx-previnserted->first < min_int) {
-        // Require that the intersection Point be at least min_int to the right of the previous
-        // one (for this sentence). If not, we replace the previous intersection Point with
-        // this one.
-        // Yes, it can even happen that the new intersection Point is slightly to the left of
-        // the old one, because of numerical imprecision. We do not check that we are to the
-        // right of the penultimate point also. It this happen the 1best the interval will
-        // be wrong we are going to replace previnsert by the new one because we do not want to keep
-        // 2 very close threshold: if the minima is there it could be an artifact.
-
-        map<float,diff_t>::iterator tit = thresholdmap.find(leftmostx);
-        if (tit == previnserted) {
-          // The threshold is the same as before can happen if 2 candidates are the same for example.
-          UTIL_THROW_IF(previnserted->second.back().first != newd.first,
-                        util::Exception,
-                        "Error");
-          previnserted->second.back()=newd; // just replace the 1 best for sentence S
-          // previnsert doesn't change
-        } else {
-
-          if (tit == thresholdmap.end()) {
-            thresholdmap[leftmostx]=previnserted->second; // We keep the diffs at previnsert
-            thresholdmap.erase(previnserted); // erase old previnsert
-            previnserted = thresholdmap.find(leftmostx); // point previnsert to the new threshold
-            previnserted->second.back()=newd; // We update the diff for sentence S
-            // Threshold already exists but is not the previous one.
-          } else {
-            // We append the diffs in previnsert to tit before destroying previnsert.
-            tit->second.insert(tit->second.end(),previnserted->second.begin(),previnserted->second.end());
-            UTIL_THROW_IF(tit->second.back().first != newd.first,
-                          util::Exception,
-                          "Error");
-            tit->second.back()=newd;    // change diff for sentence S
-            thresholdmap.erase(previnserted); // erase old previnsert
-            previnserted = tit;  // point previnsert to the new threshold
-          }
-        }
+statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction, Point& bestpoint) const
+{
+  return LineOptimize(origin, direction, bestpoint, m_parallel_directions ? 1 : m_num_threads);
+}
 
-        UTIL_THROW_IF(previnserted == thresholdmap.end(),
-                      util::Exception,
-                      "Error");
-      } else { //normal insertion process
-        previnserted = AddThreshold(thresholdmap, leftmostx, newd);
-      }
-      gradientit = leftmost;
-    } // while (gradientit!=gradient.end()){
-  }   // loop on S
+statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction, Point& bestpoint,
+                                    size_t num_threads) const
+{
+  // We are looking for the best Point on the line y=Origin+x*direction
+
+  // The upper envelope of each sentence is computed independently, with the
+  // sentences split into one contiguous range per thread. The per-range
+  // threshold lists are then merged pairwise (again in parallel) into one
+  // list sorted by position on the line.
+  const unsigned num_sentences = size();
+  const size_t num_chunks = max(size_t(1), min(num_threads, size_t(num_sentences)));
+  vector<unsigned> first1best(num_sentences); // the vector of nbests for x=-inf
+  vector<vector<LineThreshold> > chunks(num_chunks);
+  vector<EnvelopeTask> envelope_tasks(num_chunks);
+  for (size_t c = 0; c < num_chunks; ++c) {
+    EnvelopeTask& task = envelope_tasks[c];
+    task.optimizer = this;
+    task.origin = &origin;
+    task.direction = &direction;
+    task.begin = num_sentences * c / num_chunks;
+    task.end = num_sentences * (c + 1) / num_chunks;
+    task.first1best = &first1best;
+    task.thresholds = &chunks[c];
+  }
+  RunTasks(envelope_tasks);
+
+  while (chunks.size() > 1) {
+    vector<vector<LineThreshold> > merged((chunks.size() + 1) / 2);
+    vector<MergeTask> merge_tasks;
+    for (size_t c = 0; c + 1 < chunks.size(); c += 2) {
+      MergeTask task = { &chunks[c], &chunks[c+1], &merged[c/2] };
+      merge_tasks.push_back(task);
+    }
+    if (chunks.size() % 2) merged.back().swap(chunks.back());
+    RunTasks(merge_tasks);
+    chunks.swap(merged);
+  }
+  const vector<LineThreshold>& thresholds = chunks[0];
+
+  // Group the thresholds by position: xs[i] is the start of the i-th interval
+  // (the first one starting at MIN_FLOAT), diffs[i-1] the changes of the
+  // 1 best at that point.
+  vector<float> xs(1, MIN_FLOAT);
+  diffs_t diffs;
+  for (size_t i = 0; i < thresholds.size(); ++i) {
+    const LineThreshold& t = thresholds[i];
+    if (diffs.empty() || t.x != xs.back()) {
+      xs.push_back(t.x);
+      diffs.push_back(diff_t());
+    }
+    diff_t& diff = diffs.back();
+    if (diff.size() && diff.back().first == t.sentence)
+      // there was already a diff for this sentence, we change the 1 best;
+      diff.back().second = t.best;
+    else
+      diff.push_back(make_pair(t.sentence, t.best));
+  }
 
   // Now the thresholdlist is up to date: it contains a list of all the parameter_ts where
   // the function changed its value, along with the nbest list for the interval after each threshold.
 
-  map<float,diff_t >::iterator thrit;
   if (verboselevel() > 6) {
-    cerr << "Thresholds:(" << thresholdmap.size() << ")" << endl;
-    for (thrit = thresholdmap.begin(); thrit != thresholdmap.end(); thrit++) {
-      cerr << "x: " << thrit->first << " diffs";
-      for (size_t j = 0; j < thrit->second.size(); ++j) {
-        cerr << " " <<thrit->second[j].first << "," << thrit->second[j].second;
+    cerr << "Thresholds:(" << xs.size() << ")" << endl;
+    for (size_t i = 0; i < xs.size(); ++i) {
+      cerr << "x: " << xs[i] << " diffs";
+      if (i > 0) {
+        for (size_t j = 0; j < diffs[i-1].size(); ++j) {
+          cerr << " " << diffs[i-1][j].first << "," << diffs[i-1][j].second;
+        }
       }
       cerr << endl;
     }
   }
 
   // Last thing to do is compute the Stat score (i.e., BLEU) and find the minimum.
-  thrit = thresholdmap.begin();
-  ++thrit;       // first diff corrrespond to MIN_FLOAT and first1best
-  diffs_t diffs;
-  for (; thrit != thresholdmap.end(); thrit++)
-    diffs.push_back(thrit->second);
   vector<statscore_t> scores = GetIncStatScore(first1best, diffs);
 
-  thrit = thresholdmap.begin();
   statscore_t bestscore = MIN_FLOAT;
   float bestx = MIN_FLOAT;
 
-  // We skipped the first el of thresholdlist but GetIncStatScore return 1 more for first1best.
-  UTIL_THROW_IF(scores.size() != thresholdmap.size(),
+  // GetIncStatScore returns 1 more score than diffs, for first1best.
+  UTIL_THROW_IF(scores.size() != xs.size(),
                 util::Exception,
                 "Error");
   for (unsigned int sc = 0; sc != scores.size(); sc++) {
-    //cerr << "x=" << thrit->first << " => " << scores[sc] << endl;
+    //cerr << "x=" << xs[sc] << " => " << scores[sc] << endl;
 
     //enforce positivity
-    Point respoint = origin + direction * thrit->first;
+    Point respoint = origin + direction * xs[sc];
     bool is_valid = true;
     for (unsigned int k=0; k < respoint.getdim(); k++) {
       if (m_positive[k] && respoint[k] <= 0.0)
@@ -268,9 +316,9 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
     }
 
     if (is_valid && scores[sc] > bestscore) {
-      // This is the score for the interval [lit2->first, (lit2+1)->first]
+      // This is the score for the interval [xs[sc], xs[sc+1]]
       // unless we're at the last score, when it's the score
-      // for the interval [lit2->first,+inf].
+      // for the interval [xs[sc],+inf].
       bestscore = scores[sc];
 
       // If we're not in [-inf,x1] or [xn,+inf], then just take the value
@@ -278,16 +326,8 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
       // take x to be the last interval boundary + 0.1, and for the leftmost
       // interval, take x to be the first interval boundary - 1000.
       // These values are taken from cmert.
-      float leftx = thrit->first;
-      if (thrit == thresholdmap.begin()) {
-        leftx = MIN_FLOAT;
-      }
-      ++thrit;
-      float rightx = MAX_FLOAT;
-      if (thrit != thresholdmap.end()) {
-        rightx = thrit->first;
-      }
-      --thrit;
+      float leftx = (sc == 0) ? MIN_FLOAT : xs[sc];
+      float rightx = (sc + 1 < xs.size()) ? xs[sc+1] : MAX_FLOAT;
       //cerr << "leftx: " << leftx << " rightx: " << rightx << endl;
       if (leftx == MIN_FLOAT) {
         bestx = rightx-1000;
@@ -298,7 +338,6 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
       }
       //cerr << "x = " << "set new bestx to: " << bestx << endl;
     }
-    ++thrit;
   }
 
   if (abs(bestx) < 0.00015) {
@@ -311,14 +350,44 @@ statscore_t Optimizer::LineOptimize(const Point& origin, const Point& direction,
     if (verboselevel() > 4)
       cerr << "best point on line at origin" << endl;
   }
-  if (verboselevel() > 3) {
-//    cerr<<"end Lineopt, bestx="<<bestx<<endl;
-  }
   bestpoint = direction * bestx + origin;
   bestpoint.SetScore(bestscore);
   return bestscore;
 }
 
+namespace
+{
+
+struct LineOptimizeTask {
+  const Optimizer* optimizer;
+  const Point* origin;
+  const vector<Point>* directions;
+  vector<Point>* best;
+  vector<statscore_t>* scores;
+  size_t first, step;
+
+  void operator()() const {
+    for (size_t d = first; d < directions->size(); d += step)
+      (*scores)[d] = optimizer->LineOptimize(*origin, (*directions)[d], (*best)[d]);
+  }
+};
+
+} // namespace
+
+void Optimizer::LineOptimize(const Point& origin, const vector<Point>& directions,
+                             vector<Point>& best, vector<statscore_t>& scores) const
+{
+  best.resize(directions.size());
+  scores.resize(directions.size());
+  const size_t num_tasks = m_parallel_directions ? min(m_num_threads, directions.size()) : 1;
+  vector<LineOptimizeTask> tasks(num_tasks);
+  for (size_t t = 0; t < num_tasks; ++t) {
+    LineOptimizeTask task = { this, &origin, &directions, &best, &scores, t, num_tasks };
+    tasks[t] = task;
+  }
+  RunTasks(tasks);
+}
+
 void Optimizer::Get1bests(const Point& P, vector<unsigned>& bests) const
 {
   UTIL_THROW_IF(m_feature_data == NULL, util::Exception, "Error");
@@ -403,14 +472,11 @@ statscore_t SimpleOptimizer::TrueRun(Point& P) const
       cerr << "last diff=" << bestscore-prevscore << " nrun " << nrun << endl;
     prevscore = bestscore;
 
-    Point  linebest;
-
-    for (unsigned int d = 0; d < Point::getdim() + m_num_random_directions; d++) {
-      if (verboselevel() > 4) {
-        //	cerr<<"minimizing along direction "<<d<<endl;
-        cerr << "starting point: " << P << " => " << prevscore << endl;
-      }
-      Point direction;
+    // The directions are all searched from the same starting point, so
+    // they can be evaluated concurrently.
+    vector<Point> directions(Point::getdim() + m_num_random_directions);
+    for (unsigned int d = 0; d < directions.size(); d++) {
+      Point& direction = directions[d];
       if (d < Point::getdim()) { // regular updates along one dimension
         for (unsigned int i = 0; i < Point::getdim(); i++)
           direction[i]=0.0;
@@ -418,14 +484,24 @@ statscore_t SimpleOptimizer::TrueRun(Point& P) const
       } else { // random direction update
         direction.Randomize();
       }
-      statscore_t curscore = LineOptimize(P, direction, linebest);//find the minimum on the line
+    }
+    if (verboselevel() > 4) {
+      cerr << "starting point: " << P << " => " << prevscore << endl;
+    }
+
+    vector<Point> linebest;
+    vector<statscore_t> linescore;
+    LineOptimize(P, directions, linebest, linescore); //find the minimum on each line
+
+    for (unsigned int d = 0; d < directions.size(); d++) {
+      statscore_t curscore = linescore[d];
       if (verboselevel() > 5) {
         cerr << "direction: " << d << " => " << curscore << endl;
-        cerr << "\tending point: "<< linebest << " => " << curscore << endl;
+        cerr << "\tending point: "<< linebest[d] << " => " << curscore << endl;
       }
       if (curscore > bestscore) {
         bestscore = curscore;
-        best = linebest;
+        best = linebest[d];
         if (verboselevel() > 3) {
           cerr << "new best dir:" << d << " (" << nrun << ")" << endl;
           cerr << "new best Point " << best << " => "  << curscore << endl;
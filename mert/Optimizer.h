@@ -25,6 +25,8 @@ protected:
   Scorer *m_scorer;      // no accessor for them only child can use them
   FeatureDataHandle m_feature_data;  // no accessor for them only child can use them
   unsigned int m_num_random_directions;
+  size_t m_num_threads;        // threads used by the line search
+  bool m_parallel_directions;  // threads search different directions rather than split sentences
 
   const std::vector<bool>& m_positive;
 
@@ -37,6 +39,15 @@ public:
   void SetFeatureData(FeatureDataHandle feature_data) {
     m_feature_data = feature_data;
   }
+  /**
+   * Use multiple threads in the line search: either the sentences are split
+   * across the threads, or (with parallel_directions) several search
+   * directions are evaluated at the same time, one thread each.
+   */
+  void SetNumThreads(size_t num_threads, bool parallel_directions) {
+    m_num_threads = num_threads ? num_threads : 1;
+    m_parallel_directions = parallel_directions;
+  }
   virtual ~Optimizer();
 
   unsigned size() const {
@@ -73,6 +84,35 @@ public:
    * Get the optimal Lambda and the best score in a particular direction from a given Point.
    */
   statscore_t LineOptimize(const Point& start, const Point& direction, Point& best) const;
+
+  /**
+   * Line optimization along several directions from the same Point.
+   */
+  void LineOptimize(const Point& start, const std::vector<Point>& directions,
+                    std::vector<Point>& best, std::vector<statscore_t>& scores) const;
+
+  /**
+   * A change of the 1 best of a sentence at position x on the line.
+   */
+  struct LineThreshold {
+    float x;
+    unsigned int sentence;
+    unsigned int best;
+    bool operator<(const LineThreshold& other) const {
+      return x < other.x || (x == other.x && sentence < other.sentence);
+    }
+  };
+
+  /**
+   * Compute the upper envelope of the lines of one n-best list; appends the
+   * points where the 1 best changes to thresholds.
+   */
+  void SentenceEnvelope(unsigned int S, const Point& origin, const Point& direction,
+                        unsigned& first1best, std::vector<LineThreshold>& thresholds) const;
+
+private:
+  statscore_t LineOptimize(const Point& start, const Point& direction, Point& best,
+                           size_t num_threads) const;
 };
 
 
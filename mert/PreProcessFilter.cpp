@@ -127,6 +127,9 @@ PreProcessFilter::PreProcessFilter(const string& filterCommand)
 
 string PreProcessFilter::ProcessSentence(const string& sentence)
 {
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
   *m_toFilter << sentence << "\n";
   string processedSentence;
   m_fromFilter->getline(processedSentence);
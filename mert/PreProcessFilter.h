@@ -2,6 +2,10 @@
 
 #include <string>
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 #if defined(__GLIBCXX__) || defined(__GLIBCPP__)
 
 namespace MosesTuning
@@ -14,6 +18,7 @@ class ifdstream;
 /*
  * This class runs the filter command in a child process and
  * then use this filter to process given sentences.
+ * ProcessSentence() may be called from several threads at once.
  */
 class PreProcessFilter
 {
@@ -25,6 +30,10 @@ public:
 private:
   ofdstream* m_toFilter;
   ifdstream* m_fromFilter;
+#ifdef WITH_THREADS
+  // one sentence at a time through the pipe
+  boost::mutex m_mutex;
+#endif
 };
 
 }
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "Ngram.h"
+#include "NgramTable.h"
 
 namespace MosesTuning
 {
@@ -34,6 +35,15 @@ public:
     return m_counts;
   }
 
+  /** Hashed copy of the counts, as of the last call to BuildIndex(). */
+  const NgramTable& get_index() const {
+    return m_index;
+  }
+
+  void BuildIndex() {
+    m_index.Build(*m_counts);
+  }
+
   iterator begin() {
     return m_length.begin();
   }
@@ -62,10 +72,12 @@ public:
   void clear() {
     m_length.clear();
     m_counts->clear();
+    m_index = NgramTable();
   }
 
 private:
   NgramCounts* m_counts;
+  NgramTable m_index;
 
   // multiple reference lengths
   std::vector<std::size_t> m_length;
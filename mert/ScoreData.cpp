@@ -13,6 +13,7 @@
 #include "Scorer.h"
 #include "Util.h"
 #include "FileStream.h"
+#include "TuningStore.h"
 
 using namespace std;
 
@@ -72,9 +73,32 @@ void ScoreData::load(istream* is)
   }
 }
 
+void ScoreData::load(const TuningStore& store)
+{
+  vector<ScoreDataItem> items;
+  string score_type = store.ScoreType();
+  for (size_t s = 0; s < store.NumSentences(); ++s) {
+    store.GetScores(s, items);
+    ScoreArray entry;
+    entry.setIndex(store.SentenceId(s));
+    entry.NumberOfScores(store.NumScores());
+    entry.name(score_type);
+    for (size_t i = 0; i < items.size(); ++i) {
+      ScoreStats stats(store.NumScores());
+      stats.set(items[i]);
+      entry.add(stats);
+    }
+    add(entry);
+  }
+}
+
 void ScoreData::load(const string &file)
 {
   TRACE_ERR("loading score data from " << file << endl);
+  if (TuningStore::IsTuningStore(file)) {
+    load(TuningStore(file));
+    return;
+  }
   inputfilestream input_stream(file); // matches a stream with a file. Opens the file
   if (!input_stream) {
     throw runtime_error("Unable to open score file: " + file);
@@ -22,6 +22,7 @@ namespace MosesTuning
 
 
 class Scorer;
+class TuningStore;
 
 class ScoreData
 {
@@ -92,6 +93,7 @@ public:
   void save(bool bin=false);
 
   void load(std::istream* is);
+  void load(const TuningStore& store);
   void load(const std::string &file);
 
   bool check_consistency() const;
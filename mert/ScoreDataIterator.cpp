@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "ScoreArray.h"
 #include "ScoreDataIterator.h"
+#include "TuningStore.h"
 
 using namespace std;
 using namespace util;
@@ -31,11 +32,15 @@ namespace MosesTuning
 {
 
 
-ScoreDataIterator::ScoreDataIterator() {}
+ScoreDataIterator::ScoreDataIterator() : m_store_position(0) {}
 
-ScoreDataIterator::ScoreDataIterator(const string& filename)
+ScoreDataIterator::ScoreDataIterator(const string& filename) : m_store_position(0)
 {
-  m_in.reset(new FilePiece(filename.c_str()));
+  if (TuningStore::IsTuningStore(filename)) {
+    m_store.reset(new TuningStore(filename));
+  } else {
+    m_in.reset(new FilePiece(filename.c_str()));
+  }
   readNext();
 }
 
@@ -44,6 +49,14 @@ ScoreDataIterator::~ScoreDataIterator() {}
 void ScoreDataIterator::readNext()
 {
   m_next.clear();
+  if (m_store) {
+    if (m_store_position < m_store->NumSentences()) {
+      m_store->GetScores(m_store_position++, m_next);
+    } else {
+      m_store.reset();
+    }
+    return;
+  }
   try {
     StringPiece marker = m_in->ReadDelimited();
     if (marker != StringPiece(SCORES_TXT_BEGIN)) {
@@ -82,7 +95,9 @@ void ScoreDataIterator::increment()
 
 bool ScoreDataIterator::equal(const ScoreDataIterator& rhs) const
 {
-  if (!m_in && !rhs.m_in) {
+  if (m_store || rhs.m_store) {
+    return m_store == rhs.m_store && m_store_position == rhs.m_store_position;
+  } else if (!m_in && !rhs.m_in) {
     return true;
   } else if (!m_in) {
     return false;
@@ -69,6 +69,9 @@ private:
   void readNext();
 
   boost::shared_ptr<util::FilePiece> m_in;
+  // instead of m_in, if reading from a binary tuning store
+  boost::shared_ptr<TuningStore> m_store;
+  std::size_t m_store_position;
   std::vector<ScoreDataItem> m_next;
 };
 
@@ -83,27 +83,22 @@ void Scorer::TokenizeAndEncode(const string& line, vector<int>& encoded) const
 
 void Scorer::TokenizeAndEncodeTesting(const string& line, vector<int>& encoded) const
 {
+  // the vocabulary is only read here, so this may run in several threads
+  string token;
   for (util::TokenIter<util::AnyCharacter, true> it(line, util::AnyCharacter(" "));
        it; ++it) {
+    token.assign(it->data(), it->size());
     if (!m_enable_preserve_case) {
-      string token = it->as_string();
       for (std::string::iterator sit = token.begin();
            sit != token.end(); ++sit) {
         *sit = tolower(*sit);
       }
-      mert::Vocabulary::const_iterator cit = m_vocab->find(token);
-      if (cit == m_vocab->end()) {
-        encoded.push_back(kUnknownToken);
-      } else {
-        encoded.push_back(cit->second);
-      }
+    }
+    mert::Vocabulary::const_iterator cit = m_vocab->find(token);
+    if (cit == m_vocab->end()) {
+      encoded.push_back(kUnknownToken);
     } else {
-      mert::Vocabulary::const_iterator cit = m_vocab->find(it->as_string());
-      if (cit == m_vocab->end()) {
-        encoded.push_back(kUnknownToken);
-      } else {
-        encoded.push_back(cit->second);
-      }
+      encoded.push_back(cit->second);
     }
   }
 }
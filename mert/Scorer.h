@@ -130,6 +130,14 @@ public:
     return false;
   };
 
+  /**
+   * The scorer returns if prepareStats() may be called from several
+   * threads at once, once the reference files are set.
+   **/
+  virtual bool isThreadSafe() const {
+    return false;
+  }
+
   /**
    * Set the factors, which should be used for this metric
    */
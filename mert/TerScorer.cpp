@@ -4,6 +4,10 @@
 #include <sstream>
 #include <stdexcept>
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 #include "ScoreStats.h"
 #include "TER/tercalc.h"
 #include "TER/terAlignment.h"
@@ -15,6 +19,13 @@ using namespace TERCPPNS_TERCpp;
 namespace MosesTuning
 {
 
+#ifdef WITH_THREADS
+namespace
+{
+// TokenizeAndEncode() adds unseen words to the shared vocabulary
+boost::mutex vocab_mutex;
+}
+#endif
 
 TerScorer::TerScorer(const string& config)
   : StatisticsBasedScorer("TER",config), kLENGTH(2) {}
@@ -61,37 +72,38 @@ void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry
   result.numWords = 0.0 ;
   result.averageWords = 0.0;
 
+  double averageLength=0.0;
   for ( int incRefs = 0; incRefs < ( int ) m_multi_references.size(); incRefs++ ) {
     if ( sid >= m_multi_references.at(incRefs).size() ) {
       stringstream msg;
       msg << "Sentence id (" << sid << ") not found in reference set";
       throw runtime_error ( msg.str() );
     }
-
-    vector<int> testtokens;
-    vector<int> reftokens;
-    reftokens = m_multi_references.at ( incRefs ).at ( sid );
-    double averageLength=0.0;
-    for ( int incRefsBis = 0; incRefsBis < ( int ) m_multi_references.size(); incRefsBis++ ) {
-      if ( sid >= m_multi_references.at(incRefsBis).size() ) {
-        stringstream msg;
-        msg << "Sentence id (" << sid << ") not found in reference set";
-        throw runtime_error ( msg.str() );
-      }
-      averageLength+=(double)m_multi_references.at ( incRefsBis ).at ( sid ).size();
-    }
-    averageLength=averageLength/( double ) m_multi_references.size();
+    averageLength+=(double)m_multi_references.at ( incRefs ).at ( sid ).size();
+  }
+  averageLength=averageLength/( double ) m_multi_references.size();
+
+  // the hypothesis is the same against every reference
+  vector<int> testtokens;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(vocab_mutex);
+#endif
     TokenizeAndEncode(sentence, testtokens);
-    terCalc * evaluation=new terCalc();
-    evaluation->setDebugMode ( false );
-    terAlignment tmp_result = evaluation->TER ( reftokens, testtokens );
+  }
+
+  for ( int incRefs = 0; incRefs < ( int ) m_multi_references.size(); incRefs++ ) {
+    vector<int> reftokens = m_multi_references.at ( incRefs ).at ( sid );
+    vector<int> hyptokens = testtokens;
+    terCalc evaluation;
+    evaluation.setDebugMode ( false );
+    terAlignment tmp_result = evaluation.TER ( reftokens, hyptokens );
     tmp_result.averageWords=averageLength;
     if ( ( result.numEdits == 0.0 ) && ( result.averageWords == 0.0 ) ) {
       result = tmp_result;
     } else if ( result.scoreAv() > tmp_result.scoreAv() ) {
       result = tmp_result;
     }
-    delete evaluation;
   }
   ostringstream stats;
   // multiplication by 100 in order to keep the average precision
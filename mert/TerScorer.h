@@ -31,6 +31,10 @@ public:
     return kLENGTH + 1;
   }
 
+  virtual bool isThreadSafe() const {
+    return true;
+  }
+
   virtual float calculateScore(const std::vector<ScoreStatsType>& comps) const;
 
 private:
@@ -0,0 +1,365 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2011- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <boost/unordered_set.hpp>
+
+#include "util/exception.hh"
+#include "util/murmur_hash.hh"
+
+#include "FeatureData.h"
+#include "ScoreData.h"
+#include "TuningStore.h"
+
+using namespace std;
+
+namespace MosesTuning
+{
+
+namespace
+{
+
+const char kMagic[8] = {'M', 'E', 'R', 'T', 'S', 'T', 'O', '1'};
+
+struct SegmentHeader {
+  char magic[8];
+  boost::uint64_t bytes;     // size of the segment, this header included
+  boost::uint64_t rows;      // number of hypotheses
+  boost::uint64_t nonzeros;  // number of sparse feature values
+  boost::uint32_t sentences;
+  boost::uint32_t features;  // number of dense features
+  boost::uint32_t scores;    // number of score statistics
+  boost::uint32_t sparse_names;
+  boost::uint32_t feature_names_bytes;
+  boost::uint32_t score_type_bytes;
+  boost::uint32_t sparse_names_bytes;
+  boost::uint32_t reserved;
+};
+
+// all sections start at multiples of 8 bytes
+inline size_t Padded(size_t bytes)
+{
+  return (bytes + 7) & ~size_t(7);
+}
+
+void AppendBytes(string& buf, const void* data, size_t bytes)
+{
+  buf.append(reinterpret_cast<const char*>(data), bytes);
+  buf.append(Padded(bytes) - bytes, '\0');
+}
+
+template <class T>
+void AppendVector(string& buf, const vector<T>& v)
+{
+  if (v.size()) AppendBytes(buf, &v[0], v.size() * sizeof(T));
+}
+
+template <class T>
+const T* Take(const char*& p, size_t count)
+{
+  const T* ret = reinterpret_cast<const T*>(p);
+  p += Padded(count * sizeof(T));
+  return ret;
+}
+
+// columns stored back to back, column-major
+vector<float> Concatenate(const vector<vector<float> >& columns)
+{
+  vector<float> ret;
+  for (size_t c = 0; c < columns.size(); ++c)
+    ret.insert(ret.end(), columns[c].begin(), columns[c].end());
+  return ret;
+}
+
+// Identifies a hypothesis for deduplication. Sparse features are hashed
+// by name since feature ids are only valid within one process.
+boost::uint64_t HashHypothesis(const FeatureDataItem& features, const ScoreDataItem& scores)
+{
+  string key;
+  if (features.dense.size())
+    key.append(reinterpret_cast<const char*>(&features.dense[0]),
+               features.dense.size() * sizeof(float));
+  vector<pair<string, FeatureStatsType> > sparse;
+  const vector<size_t> feats = features.sparse.feats();
+  for (size_t i = 0; i < feats.size(); ++i)
+    sparse.push_back(make_pair(SparseVector::decode(feats[i]), features.sparse.get(feats[i])));
+  sort(sparse.begin(), sparse.end());
+  for (size_t i = 0; i < sparse.size(); ++i) {
+    key.append(sparse[i].first);
+    key.push_back('\0');
+    key.append(reinterpret_cast<const char*>(&sparse[i].second), sizeof(FeatureStatsType));
+  }
+  if (scores.size())
+    key.append(reinterpret_cast<const char*>(&scores[0]), scores.size() * sizeof(float));
+  return util::MurmurHashNative(key.data(), key.size());
+}
+
+} // namespace
+
+TuningStore::TuningStore(const string& filename)
+  : m_fd(util::OpenReadOrThrow(filename.c_str())),
+    m_num_features(0), m_num_scores(0), m_committed(0)
+{
+  const size_t size = util::SizeOrThrow(m_fd.get());
+  util::MapRead(util::LAZY, m_fd.get(), 0, size, m_mem);
+
+  map<int, vector<Part> > parts;
+  const char* p = m_mem.begin();
+  while (p < m_mem.end()) {
+    // an append that was interrupted leaves an incomplete last segment
+    const SegmentHeader& header = *reinterpret_cast<const SegmentHeader*>(p);
+    if (p + sizeof(SegmentHeader) > m_mem.end() || header.bytes > size_t(m_mem.end() - p)) {
+      cerr << "Warning: ignoring incomplete last segment of tuning store " << filename
+           << " (" << m_mem.end() - p << " bytes)" << endl;
+      break;
+    }
+    UTIL_THROW_IF(memcmp(header.magic, kMagic, sizeof(kMagic)) || header.bytes < sizeof(SegmentHeader),
+                  util::Exception, "Corrupt tuning store " << filename);
+    const char* end = p + header.bytes;
+    p += sizeof(SegmentHeader);
+
+    string feature_names(Take<char>(p, header.feature_names_bytes), header.feature_names_bytes);
+    string score_type(Take<char>(p, header.score_type_bytes), header.score_type_bytes);
+    if (m_segments.empty()) {
+      m_num_features = header.features;
+      m_num_scores = header.scores;
+      m_feature_names = feature_names;
+      m_score_type = score_type;
+    }
+    UTIL_THROW_IF(header.features != m_num_features || header.scores != m_num_scores ||
+                  feature_names != m_feature_names || score_type != m_score_type,
+                  util::Exception, "Inconsistent segments in tuning store " << filename);
+
+    Segment seg;
+    seg.rows = header.rows;
+    const char* names = Take<char>(p, header.sparse_names_bytes);
+    for (size_t i = 0; i < header.sparse_names; ++i) {
+      seg.sparse_names.push_back(names);
+      names += strlen(names) + 1;
+    }
+    seg.row_begin = Take<boost::uint64_t>(p, header.sentences + 1);
+    seg.sentence_id = Take<boost::int32_t>(p, header.sentences);
+    seg.dense = Take<float>(p, header.rows * header.features);
+    seg.scores = Take<float>(p, header.rows * header.scores);
+    seg.sparse_begin = Take<boost::uint64_t>(p, header.rows + 1);
+    seg.sparse_name = Take<boost::uint32_t>(p, header.nonzeros);
+    seg.sparse_value = Take<float>(p, header.nonzeros);
+    UTIL_THROW_IF(p != end, util::Exception, "Corrupt tuning store " << filename);
+
+    for (size_t s = 0; s < header.sentences; ++s)
+      parts[seg.sentence_id[s]].push_back(Part(m_segments.size(), s));
+    m_segments.push_back(seg);
+  }
+  m_committed = p - m_mem.begin();
+
+  for (map<int, vector<Part> >::iterator it = parts.begin(); it != parts.end(); ++it) {
+    m_ids.push_back(it->first);
+    m_parts.push_back(vector<Part>());
+    m_parts.back().swap(it->second);
+  }
+}
+
+bool TuningStore::IsTuningStore(const string& filename)
+{
+  util::scoped_fd fd(open(filename.c_str(), O_RDONLY));
+  if (fd.get() == -1) return false;
+  char magic[sizeof(kMagic)];
+  return util::ReadOrEOF(fd.get(), magic, sizeof(magic)) == sizeof(magic) &&
+         !memcmp(magic, kMagic, sizeof(kMagic));
+}
+
+void TuningStore::GetFeatures(size_t sentence, vector<FeatureDataItem>& out) const
+{
+  out.clear();
+  const vector<Part>& parts = m_parts[sentence];
+  for (size_t i = 0; i < parts.size(); ++i) {
+    const Segment& seg = m_segments[parts[i].first];
+    for (size_t r = seg.row_begin[parts[i].second]; r < seg.row_begin[parts[i].second + 1]; ++r) {
+      out.push_back(FeatureDataItem());
+      FeatureDataItem& item = out.back();
+      item.dense.resize(m_num_features);
+      for (size_t f = 0; f < m_num_features; ++f)
+        item.dense[f] = seg.dense[f * seg.rows + r];
+      for (size_t k = seg.sparse_begin[r]; k < seg.sparse_begin[r + 1]; ++k)
+        item.sparse.set(seg.sparse_names[seg.sparse_name[k]], seg.sparse_value[k]);
+    }
+  }
+}
+
+void TuningStore::GetScores(size_t sentence, vector<ScoreDataItem>& out) const
+{
+  out.clear();
+  const vector<Part>& parts = m_parts[sentence];
+  for (size_t i = 0; i < parts.size(); ++i) {
+    const Segment& seg = m_segments[parts[i].first];
+    for (size_t r = seg.row_begin[parts[i].second]; r < seg.row_begin[parts[i].second + 1]; ++r) {
+      out.push_back(ScoreDataItem(m_num_scores));
+      for (size_t c = 0; c < m_num_scores; ++c)
+        out.back()[c] = seg.scores[c * seg.rows + r];
+    }
+  }
+}
+
+size_t TuningStore::Append(const string& filename, const FeatureData& features, const ScoreData& scores)
+{
+  UTIL_THROW_IF(features.size() != scores.size(), util::Exception,
+                "Feature and score data differ in number of sentences");
+
+  // hashes of the hypotheses already stored, by sentence id
+  map<int, boost::unordered_set<boost::uint64_t> > seen;
+  size_t num_features = features.NumberOfFeatures();
+  size_t num_scores = scores.NumberOfScores();
+  string feature_names = features.Features();
+  string score_type = scores.name();
+  // length of the complete segments; anything after them is cut off
+  boost::uint64_t committed = 0;
+  if (IsTuningStore(filename)) {
+    TuningStore store(filename);
+    committed = store.m_committed;
+    UTIL_THROW_IF(store.NumSentences() &&
+                  (store.NumFeatures() != num_features || store.NumScores() != num_scores ||
+                   store.ScoreType() != score_type || store.FeatureNames() != feature_names),
+                  util::Exception, "Data does not match the features and scores in " << filename);
+    vector<FeatureDataItem> f;
+    vector<ScoreDataItem> sc;
+    for (size_t s = 0; s < store.NumSentences(); ++s) {
+      store.GetFeatures(s, f);
+      store.GetScores(s, sc);
+      boost::unordered_set<boost::uint64_t>& hashes = seen[store.SentenceId(s)];
+      for (size_t j = 0; j < f.size(); ++j)
+        hashes.insert(HashHypothesis(f[j], sc[j]));
+    }
+  } else {
+    // only a missing or empty file may become a store, or one that a
+    // crash left with a partial magic number
+    util::scoped_fd existing(open(filename.c_str(), O_RDONLY));
+    if (existing.get() != -1) {
+      char magic[sizeof(kMagic)];
+      size_t got = util::ReadOrEOF(existing.get(), magic, sizeof(magic));
+      UTIL_THROW_IF(got == sizeof(magic) || memcmp(magic, kMagic, got), util::Exception,
+                    filename << " exists and is not a tuning store");
+    }
+  }
+
+  // collect the new hypotheses, in columns
+  vector<boost::uint64_t> row_begin(1, 0);
+  vector<boost::int32_t> sentence_id;
+  vector<vector<float> > dense(num_features), score_columns(num_scores);
+  vector<boost::uint64_t> sparse_begin(1, 0);
+  vector<boost::uint32_t> sparse_name;
+  vector<float> sparse_value;
+  map<string, boost::uint32_t> sparse_ids;
+  vector<string> sparse_names;
+
+  FeatureDataItem item;
+  for (size_t s = 0; s < features.size(); ++s) {
+    const FeatureArray& fa = features.get(s);
+    const ScoreArray& sa = scores.get(s);
+    UTIL_THROW_IF(fa.getIndex() != sa.getIndex() || fa.size() != sa.size(), util::Exception,
+                  "Feature and score data differ for sentence " << fa.getIndex());
+    boost::unordered_set<boost::uint64_t>& hashes = seen[fa.getIndex()];
+    size_t rows = 0;
+    for (size_t j = 0; j < fa.size(); ++j) {
+      const FeatureStats& fs = fa.get(j);
+      const ScoreStats& ss = sa.get(j);
+      UTIL_THROW_IF(fs.size() != num_features || ss.size() != num_scores, util::Exception,
+                    "Wrong number of features or scores for sentence " << fa.getIndex());
+      item.dense.assign(fs.getArray(), fs.getArray() + fs.size());
+      item.sparse = fs.getSparse();
+      ScoreDataItem sc(ss.getArray(), ss.getArray() + ss.size());
+      if (!hashes.insert(HashHypothesis(item, sc)).second) continue; // duplicate
+
+      for (size_t f = 0; f < num_features; ++f) dense[f].push_back(item.dense[f]);
+      for (size_t c = 0; c < num_scores; ++c) score_columns[c].push_back(sc[c]);
+      const vector<size_t> feats = item.sparse.feats();
+      for (size_t k = 0; k < feats.size(); ++k) {
+        const string name = SparseVector::decode(feats[k]);
+        map<string, boost::uint32_t>::iterator id = sparse_ids.find(name);
+        if (id == sparse_ids.end()) {
+          id = sparse_ids.insert(make_pair(name, boost::uint32_t(sparse_names.size()))).first;
+          sparse_names.push_back(name);
+        }
+        sparse_name.push_back(id->second);
+        sparse_value.push_back(item.sparse.get(feats[k]));
+      }
+      sparse_begin.push_back(sparse_name.size());
+      ++rows;
+    }
+    if (rows) {
+      sentence_id.push_back(fa.getIndex());
+      row_begin.push_back(row_begin.back() + rows);
+    }
+  }
+  const size_t num_rows = row_begin.back();
+  if (num_rows == 0) return 0;
+
+  string names;
+  for (size_t i = 0; i < sparse_names.size(); ++i) {
+    names += sparse_names[i];
+    names.push_back('\0');
+  }
+
+  SegmentHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.rows = num_rows;
+  header.nonzeros = sparse_name.size();
+  header.sentences = sentence_id.size();
+  header.features = num_features;
+  header.scores = num_scores;
+  header.sparse_names = sparse_names.size();
+  header.feature_names_bytes = feature_names.size();
+  header.score_type_bytes = score_type.size();
+  header.sparse_names_bytes = names.size();
+
+  string buf;
+  buf.append(sizeof(header), '\0');
+  AppendBytes(buf, feature_names.data(), feature_names.size());
+  AppendBytes(buf, score_type.data(), score_type.size());
+  AppendBytes(buf, names.data(), names.size());
+  AppendVector(buf, row_begin);
+  AppendVector(buf, sentence_id);
+  AppendVector(buf, Concatenate(dense));
+  AppendVector(buf, Concatenate(score_columns));
+  AppendVector(buf, sparse_begin);
+  AppendVector(buf, sparse_name);
+  AppendVector(buf, sparse_value);
+  header.bytes = buf.size();
+  memcpy(&buf[0], &header, sizeof(header));
+
+  util::scoped_fd out(open(filename.c_str(), O_WRONLY | O_CREAT, 0644));
+  UTIL_THROW_IF(out.get() == -1, util::ErrnoException, "Cannot open " << filename << " for appending");
+  try {
+    util::ResizeOrThrow(out.get(), committed);
+    util::SeekOrThrow(out.get(), committed);
+    util::WriteOrThrow(out.get(), buf.data(), buf.size());
+  } catch (const util::Exception&) {
+    // don't leave a partial segment for later appends to follow
+    try {
+      util::ResizeOrThrow(out.get(), committed);
+    } catch (const util::Exception&) {}
+    throw;
+  }
+  return num_rows;
+}
+
+}
@@ -0,0 +1,129 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2011- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef MERT_TUNING_STORE_H_
+#define MERT_TUNING_STORE_H_
+
+/**
+  * Binary store of n-best features and sufficient statistics, read by
+  * memory mapping instead of parsing.
+  *
+  * A store is a sequence of segments, one per call to Append() (typically
+  * one per tuning iteration). Each segment keeps its data in columns:
+  * for every dense feature and every score statistic one float column
+  * over all hypotheses of the segment, and the sparse features in
+  * compressed sparse row format. Hypotheses that are already in the store
+  * for the same sentence are not appended again.
+  *
+  * The same file serves as both feature and score file: FeatureData,
+  * ScoreData and their iterators recognise it by its magic number.
+  *
+  * A segment is complete once it has been written in full. An incomplete
+  * last segment, left by an append that was interrupted, is ignored when
+  * the store is read and cut off by the next Append().
+**/
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+#include "util/file.hh"
+#include "util/mmap.hh"
+
+#include "FeatureDataIterator.h"
+#include "ScoreDataIterator.h"
+
+namespace MosesTuning
+{
+
+class FeatureData;
+class ScoreData;
+
+class TuningStore
+{
+public:
+  explicit TuningStore(const std::string& filename);
+
+  /** Does the file start with the magic number of a tuning store? */
+  static bool IsTuningStore(const std::string& filename);
+
+  /**
+   * Append the hypotheses in features/scores to the store (which is
+   * created if necessary), skipping those already stored for the sentence.
+   * Returns the number of hypotheses added.
+   */
+  static std::size_t Append(const std::string& filename,
+                            const FeatureData& features,
+                            const ScoreData& scores);
+
+  /** Number of distinct sentences; these are numbered in order of id. */
+  std::size_t NumSentences() const {
+    return m_ids.size();
+  }
+  std::size_t NumFeatures() const {
+    return m_num_features;
+  }
+  std::size_t NumScores() const {
+    return m_num_scores;
+  }
+  const std::string& FeatureNames() const {
+    return m_feature_names;
+  }
+  const std::string& ScoreType() const {
+    return m_score_type;
+  }
+
+  int SentenceId(std::size_t sentence) const {
+    return m_ids[sentence];
+  }
+
+  void GetFeatures(std::size_t sentence, std::vector<FeatureDataItem>& out) const;
+  void GetScores(std::size_t sentence, std::vector<ScoreDataItem>& out) const;
+
+private:
+  struct Segment {
+    std::size_t rows;
+    std::vector<const char*> sparse_names;
+    const boost::uint64_t* row_begin;    // per sentence, size sentences+1
+    const boost::int32_t* sentence_id;   // per sentence
+    const float* dense;                  // column-major, rows x features
+    const float* scores;                 // column-major, rows x scores
+    const boost::uint64_t* sparse_begin; // per row, size rows+1
+    const boost::uint32_t* sparse_name;
+    const float* sparse_value;
+  };
+  // rows of one sentence within one segment
+  typedef std::pair<std::size_t, std::size_t> Part; // (segment, sentence in segment)
+
+  util::scoped_fd m_fd;
+  util::scoped_memory m_mem;
+  std::size_t m_num_features;
+  std::size_t m_num_scores;
+  std::string m_feature_names;
+  std::string m_score_type;
+  std::vector<Segment> m_segments;
+  std::vector<int> m_ids;                 // sentence ids, sorted
+  std::vector<std::vector<Part> > m_parts; // per sentence
+  boost::uint64_t m_committed;            // length of the complete segments
+};
+
+}
+
+#endif  // MERT_TUNING_STORE_H_
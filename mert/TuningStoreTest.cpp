@@ -0,0 +1,169 @@
+#include "TuningStore.h"
+
+#define BOOST_TEST_MODULE TuningStore
+#include <boost/test/unit_test.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "Data.h"
+#include "FeatureData.h"
+#include "ScoreData.h"
+#include "Scorer.h"
+#include "ScorerFactory.h"
+
+using namespace MosesTuning;
+
+namespace
+{
+
+struct StoreFile {
+  StoreFile()
+    : name((boost::filesystem::temp_directory_path() /
+            boost::filesystem::unique_path("tuning-store-%%%%-%%%%")).string()) {}
+  ~StoreFile() {
+    boost::filesystem::remove(name);
+  }
+  std::string name;
+};
+
+// Adds a hypothesis for the given sentence; every score statistic is
+// set to score.
+void AddHypothesis(Data& data, int sentence, const std::string& features, float score)
+{
+  if (data.getFeatureData()->Features().empty())
+    data.InitFeatureMap(features);
+  data.AddFeatures(features, sentence);
+  std::vector<ScoreStatsType> stats(data.getScoreData()->NumberOfScores(), score);
+  ScoreStats entry(stats.size());
+  entry.set(stats);
+  data.getScoreData()->add(entry, sentence);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(tuning_store_round_trip)
+{
+  boost::scoped_ptr<Scorer> scorer(ScorerFactory::getScorer("BLEU", ""));
+  Data data(scorer.get());
+  AddHypothesis(data, 0, "d= -1 lm= -2.5 w= -3 ", 1);
+  AddHypothesis(data, 0, "d= -2 lm= -1.5 w= -4 tm_foo= 0.5 ", 2);
+  AddHypothesis(data, 3, "d= 0 lm= -7 w= -5 tm_bar= 1.5 ", 3);
+
+  StoreFile store;
+  BOOST_CHECK(!TuningStore::IsTuningStore(store.name));
+  BOOST_CHECK_EQUAL(TuningStore::Append(store.name, *data.getFeatureData(), *data.getScoreData()),
+                    (std::size_t)3);
+  BOOST_REQUIRE(TuningStore::IsTuningStore(store.name));
+
+  FeatureData features;
+  features.load(store.name, SparseVector());
+  ScoreData scores(scorer.get());
+  scores.load(store.name);
+
+  const FeatureData& expected = *data.getFeatureData();
+  BOOST_CHECK_EQUAL(features.Features(), expected.Features());
+  BOOST_REQUIRE_EQUAL(features.size(), expected.size());
+  BOOST_REQUIRE_EQUAL(scores.size(), expected.size());
+  BOOST_CHECK_EQUAL(scores.name(), "BLEU");
+  for (std::size_t s = 0; s < expected.size(); ++s) {
+    BOOST_CHECK_EQUAL(features.get(s).getIndex(), expected.get(s).getIndex());
+    BOOST_CHECK_EQUAL(scores.get(s).getIndex(), expected.get(s).getIndex());
+    BOOST_REQUIRE_EQUAL(features.get(s).size(), expected.get(s).size());
+    for (std::size_t j = 0; j < expected.get(s).size(); ++j) {
+      const FeatureStats& got = features.get(s, j);
+      const FeatureStats& want = expected.get(s, j);
+      BOOST_REQUIRE_EQUAL(got.size(), want.size());
+      for (std::size_t f = 0; f < want.size(); ++f)
+        BOOST_CHECK_EQUAL(got.get(f), want.get(f));
+      BOOST_CHECK_EQUAL(got.getSparse().size(), want.getSparse().size());
+      BOOST_CHECK(got.getSparse() == want.getSparse());
+      const ScoreStats& stats = scores.get(s, j);
+      BOOST_REQUIRE_EQUAL(stats.size(), data.getScoreData()->get(s, j).size());
+      for (std::size_t c = 0; c < stats.size(); ++c)
+        BOOST_CHECK_EQUAL(stats.get(c), data.getScoreData()->get(s, j).get(c));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(tuning_store_skips_duplicates)
+{
+  boost::scoped_ptr<Scorer> scorer(ScorerFactory::getScorer("BLEU", ""));
+  Data first(scorer.get());
+  AddHypothesis(first, 0, "d= -1 lm= -2 ", 1);
+  AddHypothesis(first, 1, "d= -3 lm= -4 ", 2);
+
+  StoreFile store;
+  BOOST_CHECK_EQUAL(TuningStore::Append(store.name, *first.getFeatureData(), *first.getScoreData()),
+                    (std::size_t)2);
+  // the same n-best list again, as in a tuning iteration that changed nothing
+  BOOST_CHECK_EQUAL(TuningStore::Append(store.name, *first.getFeatureData(), *first.getScoreData()),
+                    (std::size_t)0);
+
+  // one repeated and one new hypothesis for sentence 1; a hypothesis of
+  // sentence 0 listed for sentence 1 is not a duplicate
+  Data second(scorer.get());
+  AddHypothesis(second, 1, "d= -3 lm= -4 ", 2);
+  AddHypothesis(second, 1, "d= -5 lm= -6 ", 3);
+  AddHypothesis(second, 1, "d= -1 lm= -2 ", 1);
+  BOOST_CHECK_EQUAL(TuningStore::Append(store.name, *second.getFeatureData(), *second.getScoreData()),
+                    (std::size_t)2);
+
+  TuningStore loaded(store.name);
+  BOOST_REQUIRE_EQUAL(loaded.NumSentences(), (std::size_t)2);
+  std::vector<FeatureDataItem> items;
+  loaded.GetFeatures(0, items);
+  BOOST_CHECK_EQUAL(items.size(), (std::size_t)1);
+  loaded.GetFeatures(1, items);
+  BOOST_CHECK_EQUAL(items.size(), (std::size_t)3);
+}
+
+BOOST_AUTO_TEST_CASE(tuning_store_drops_incomplete_segment)
+{
+  boost::scoped_ptr<Scorer> scorer(ScorerFactory::getScorer("BLEU", ""));
+  Data first(scorer.get());
+  AddHypothesis(first, 0, "d= -1 lm= -2 ", 1);
+  Data second(scorer.get());
+  AddHypothesis(second, 0, "d= -3 lm= -4 ", 2);
+  Data third(scorer.get());
+  AddHypothesis(third, 2, "d= -5 lm= -6 ", 3);
+
+  StoreFile store;
+  TuningStore::Append(store.name, *first.getFeatureData(), *first.getScoreData());
+  const boost::uintmax_t committed = boost::filesystem::file_size(store.name);
+  TuningStore::Append(store.name, *second.getFeatureData(), *second.getScoreData());
+  // an append that was interrupted halfway through
+  const boost::uintmax_t segment = boost::filesystem::file_size(store.name) - committed;
+  boost::filesystem::resize_file(store.name, committed + segment / 2);
+
+  {
+    TuningStore loaded(store.name);
+    BOOST_REQUIRE_EQUAL(loaded.NumSentences(), (std::size_t)1);
+    std::vector<FeatureDataItem> items;
+    loaded.GetFeatures(0, items);
+    BOOST_CHECK_EQUAL(items.size(), (std::size_t)1);
+  }
+
+  // the next append replaces the incomplete segment
+  BOOST_CHECK_EQUAL(TuningStore::Append(store.name, *third.getFeatureData(), *third.getScoreData()),
+                    (std::size_t)1);
+  TuningStore loaded(store.name);
+  BOOST_REQUIRE_EQUAL(loaded.NumSentences(), (std::size_t)2);
+  BOOST_CHECK_EQUAL(loaded.SentenceId(1), 2);
+  BOOST_CHECK_EQUAL(boost::filesystem::file_size(store.name), committed + segment);
+}
+
+BOOST_AUTO_TEST_CASE(tuning_store_refuses_other_files)
+{
+  boost::scoped_ptr<Scorer> scorer(ScorerFactory::getScorer("BLEU", ""));
+  Data data(scorer.get());
+  AddHypothesis(data, 0, "d= -1 lm= -2 ", 1);
+
+  StoreFile store;
+  {
+    std::ofstream out(store.name.c_str());
+    out << "FEATURES_TXT_BEGIN_0 0 1 2 d_0 lm_0\n";
+  }
+  BOOST_CHECK_THROW(TuningStore::Append(store.name, *data.getFeatureData(), *data.getScoreData()),
+                    util::Exception);
+}
@@ -14,6 +14,7 @@
 #include "Data.h"
 #include "Scorer.h"
 #include "ScorerFactory.h"
+#include "TuningStore.h"
 #include "Timer.h"
 #include "Util.h"
 
@@ -36,9 +37,12 @@ void usage()
   cerr << "[--ffile|-F] the feature data output file" << endl;
   cerr << "[--prev-ffile|-E] comma separated list of previous feature data" << endl;
   cerr << "[--prev-scfile|-R] comma separated list of previous scorer data" << endl;
+  cerr << "[--store|-T] append features and scores to this binary tuning store" << endl;
+  cerr << "\tinstead of writing feature and scorer data files" << endl;
   cerr << "[--factors|-f] list of factors passed to the scorer (e.g. 0|2)" << endl;
   cerr << "[--filter|-l] filter command used to preprocess the sentences" << endl;
   cerr << "[--allow-duplicates|-d] omit the duplicate removal step" << endl;
+  cerr << "[--threads|-t] number of threads for computing scorer statistics (default 1)" << endl;
   cerr << "[-v] verbose level" << endl;
   cerr << "[--help|-h] print this message and exit" << endl;
   exit(1);
@@ -56,9 +60,11 @@ static struct option long_options[] = {
   {"ffile", required_argument, 0, 'F'},
   {"prev-scfile", required_argument, 0, 'R'},
   {"prev-ffile", required_argument, 0, 'E'},
+  {"store", required_argument, 0, 'T'},
   {"verbose", required_argument, 0, 'v'},
   {"help", no_argument, 0, 'h'},
   {"allow-duplicates", no_argument, 0, 'd'},
+  {"threads", required_argument, 0, 't'},
   {0, 0, 0, 0}
 };
 
@@ -74,8 +80,10 @@ struct ProgramOption {
   string featureDataFile;
   string prevScoreDataFile;
   string prevFeatureDataFile;
+  string storeFile;
   bool binmode;
   bool allowDuplicates;
+  size_t threads;
   int verbosity;
 
   ProgramOption()
@@ -89,8 +97,10 @@ struct ProgramOption {
       featureDataFile("features.data"),
       prevScoreDataFile(""),
       prevFeatureDataFile(""),
+      storeFile(""),
       binmode(false),
       allowDuplicates(false),
+      threads(1),
       verbosity(0) { }
 };
 
@@ -99,7 +109,7 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
   int c;
   int option_index;
 
-  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:hbd", long_options, &option_index)) != -1) {
+  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:T:t:v:hbd", long_options, &option_index)) != -1) {
     switch (c) {
     case 's':
       opt->scorerType = string(optarg);
@@ -134,12 +144,18 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
     case 'R':
       opt->prevScoreDataFile = string(optarg);
       break;
+    case 'T':
+      opt->storeFile = string(optarg);
+      break;
     case 'v':
       opt->verbosity = atoi(optarg);
       break;
     case 'd':
       opt->allowDuplicates = true;
       break;
+    case 't':
+      opt->threads = std::max(1, atoi(optarg));
+      break;
     default:
       usage();
     }
@@ -227,7 +243,7 @@ int main(int argc, char** argv)
 
     // computing score statistics of each nbest file
     for (size_t i = 0; i < nbestFiles.size(); i++) {
-      data.loadNBest(nbestFiles.at(i));
+      data.loadNBest(nbestFiles.at(i), false, option.threads);
     }
 
 //    PrintUserTime("Nbest entries loaded and scored");
@@ -238,7 +254,12 @@ int main(int argc, char** argv)
     }
     //END_ADDED
 
-    data.save(option.featureDataFile, option.scoreDataFile, option.binmode);
+    if (option.storeFile.size()) {
+      size_t added = TuningStore::Append(option.storeFile, *data.getFeatureData(), *data.getScoreData());
+      cerr << "Added " << added << " hypotheses to " << option.storeFile << endl;
+    } else {
+      data.save(option.featureDataFile, option.scoreDataFile, option.binmode);
+    }
     PrintUserTime("Stopping...");
 
     return EXIT_SUCCESS;
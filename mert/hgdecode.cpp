@@ -81,9 +81,7 @@ int main(int argc, char** argv)
 
   //Load hypergraph
   Graph graph(vocab);
-  util::scoped_fd fd(util::OpenReadOrThrow(hypergraphFile.c_str()));
-  util::FilePiece file(fd.release());
-  ReadGraph(file,graph);
+  ReadGraph(hypergraphFile, graph);
 
   boost::shared_ptr<Graph> prunedGraph;
   prunedGraph.reset(new Graph(vocab));
@@ -79,6 +79,8 @@ int main(int argc, char** argv)
   bool verbose = false; // Verbose updates
   bool safe_hope = false; // Model score cannot have more than BLEU_RATIO times more influence than BLEU
   size_t hgPruning = 50; //prune hypergraphs to have this many edges per reference word
+  size_t threads = 1; // Threads for hope/fear and model decoding
+  size_t batchSize = 1; // Sentences decoded with the same weights before updating
 
   // Command-line processing follows pro.cpp
   po::options_description desc("Allowed options");
@@ -105,6 +107,8 @@ int main(int argc, char** argv)
   ("verbose", po::value(&verbose)->zero_tokens()->default_value(false), "Verbose updates")
   ("safe-hope", po::value(&safe_hope)->zero_tokens()->default_value(false), "Mode score's influence on hope decoding is limited")
   ("hg-prune", po::value<size_t>(&hgPruning), "Prune hypergraphs to have this many edges per reference word")
+  ("threads", po::value<size_t>(&threads), "Number of threads for hope/fear and model decoding (default 1)")
+  ("batch-size", po::value<size_t>(&batchSize), "Decode this many sentences with the same weights, then apply the average of their updates (default 1). Threads only decode the sentences of a batch in parallel, so a batch size of 1 keeps the online updates of single-threaded training")
   ;
 
   po::options_description cmdline_options;
@@ -119,7 +123,13 @@ int main(int argc, char** argv)
     exit(0);
   }
 
-  cerr << "kbmira with c=" << c << " decay=" << decay << " no_shuffle=" << no_shuffle << endl;
+  UTIL_THROW_IF(threads == 0 || batchSize == 0, util::Exception, "Number of threads and batch size must be positive");
+
+  cerr << "kbmira with c=" << c << " decay=" << decay << " no_shuffle=" << no_shuffle;
+  if (batchSize > 1 || threads > 1) cerr << " batch_size=" << batchSize << " threads=" << threads;
+  cerr << endl;
+  if (threads > batchSize)
+    cerr << "Warning: only " << batchSize << " of " << threads << " threads are used for hope/fear decoding; see --batch-size" << endl;
 
   if (vm.count("random-seed")) {
     cerr << "Initialising random seed to " << seed << endl;
@@ -154,7 +164,7 @@ int main(int argc, char** argv)
 
   // Training loop
   if (!streaming_out)
-    cerr << "Initial BLEU = " << decoder->Evaluate(wv->avg()) << endl;
+    cerr << "Initial BLEU = " << decoder->Evaluate(wv->avg(), threads) << endl;
   ValType bestBleu = 0;
   for(int j=0; j<n_iters; j++) {
     // MIRA train for one epoch
@@ -162,46 +172,61 @@ int main(int argc, char** argv)
     int iNumUpdates = 0;
     ValType totalLoss = 0.0;
     size_t sentenceIndex = 0;
-    for(decoder->reset(); !decoder->finished(); decoder->next()) {
-      HopeFearData hfd;
-      decoder->HopeFear(bg,*wv,&hfd);
+    vector<HopeFearData> batch;
+    vector<MiraFeatureVector> diffs;
+    vector<float> etas;
+    for(decoder->reset(); !decoder->finished(); ) {
+      // All sentences of a batch are decoded against the same weights and
+      // background, and their updates are averaged, so that the result does
+      // not depend on the order in which threads finish.
+      decoder->HopeFearBatch(bg,*wv,batchSize,threads,&batch);
+      diffs.clear();
+      etas.clear();
+      for (size_t b = 0; b < batch.size(); ++b) {
+        const HopeFearData& hfd = batch[b];
 
-      // Update weights
-      if (!hfd.hopeFearEqual && hfd.hopeBleu  > hfd.fearBleu) {
-        // Vector difference
-        MiraFeatureVector diff = hfd.hopeFeatures - hfd.fearFeatures;
-        // Bleu difference
-        //assert(hfd.hopeBleu + 1e-8 >= hfd.fearBleu);
-        ValType delta = hfd.hopeBleu - hfd.fearBleu;
-        // Loss and update
-        ValType diff_score = wv->score(diff);
-        ValType loss = delta - diff_score;
-        if(verbose) {
-          cerr << "Updating sent " << sentenceIndex << endl;
-          cerr << "Wght: " << *wv << endl;
-          cerr << "Hope: " << hfd.hopeFeatures << " BLEU:" << hfd.hopeBleu << " Score:" << wv->score(hfd.hopeFeatures) << endl;
-          cerr << "Fear: " << hfd.fearFeatures << " BLEU:" << hfd.fearBleu << " Score:" << wv->score(hfd.fearFeatures) << endl;
-          cerr << "Diff: " << diff << " BLEU:" << delta << " Score:" << diff_score << endl;
-          cerr << "Loss: " << loss <<  " Scale: " << 1 << endl;
-          cerr << endl;
-        }
-        if(loss > 0) {
-          ValType eta = min(c, loss / diff.sqrNorm());
-          wv->update(diff,eta);
-          totalLoss+=loss;
-          iNumUpdates++;
-        }
-        // Update BLEU statistics
-        for(size_t k=0; k<bg.size(); k++) {
-          bg[k]*=decay;
-          if(model_bg)
-            bg[k]+=hfd.modelStats[k];
-          else
-            bg[k]+=hfd.hopeStats[k];
+        // Update weights
+        if (!hfd.hopeFearEqual && hfd.hopeBleu  > hfd.fearBleu) {
+          // Vector difference
+          MiraFeatureVector diff = hfd.hopeFeatures - hfd.fearFeatures;
+          // Bleu difference
+          //assert(hfd.hopeBleu + 1e-8 >= hfd.fearBleu);
+          ValType delta = hfd.hopeBleu - hfd.fearBleu;
+          // Loss and update
+          ValType diff_score = wv->score(diff);
+          ValType loss = delta - diff_score;
+          if(verbose) {
+            cerr << "Updating sent " << sentenceIndex << endl;
+            cerr << "Wght: " << *wv << endl;
+            cerr << "Hope: " << hfd.hopeFeatures << " BLEU:" << hfd.hopeBleu << " Score:" << wv->score(hfd.hopeFeatures) << endl;
+            cerr << "Fear: " << hfd.fearFeatures << " BLEU:" << hfd.fearBleu << " Score:" << wv->score(hfd.fearFeatures) << endl;
+            cerr << "Diff: " << diff << " BLEU:" << delta << " Score:" << diff_score << endl;
+            cerr << "Loss: " << loss <<  " Scale: " << 1 << endl;
+            cerr << endl;
+          }
+          if(loss > 0) {
+            ValType eta = min(c, loss / diff.sqrNorm());
+            diffs.push_back(diff);
+            etas.push_back(eta);
+            totalLoss+=loss;
+            iNumUpdates++;
+          }
+          // Update BLEU statistics
+          for(size_t k=0; k<bg.size(); k++) {
+            bg[k]*=decay;
+            if(model_bg)
+              bg[k]+=hfd.modelStats[k];
+            else
+              bg[k]+=hfd.hopeStats[k];
+          }
         }
+        iNumExamples++;
+        ++sentenceIndex;
+      }
+      if (!diffs.empty()) {
+        for (size_t k = 0; k < etas.size(); ++k) etas[k] /= etas.size();
+        wv->update(diffs, etas);
       }
-      iNumExamples++;
-      ++sentenceIndex;
       if (streaming_out)
         cout << *wv << endl;
     }
@@ -212,7 +237,7 @@ int main(int argc, char** argv)
 
     // Evaluate current average weights
     AvgWeightVector avg = wv->avg();
-    ValType bleu = decoder->Evaluate(avg);
+    ValType bleu = decoder->Evaluate(avg, threads);
     cerr << ", BLEU = " << bleu << endl;
     if(bleu > bestBleu) {
       /*
@@ -118,6 +118,8 @@ void usage(int ret)
   cerr<<"[--sparse-weights|-p] required for merging sparse features"<<endl;
 #ifdef WITH_THREADS
   cerr<<"[--threads|-T] use multiple threads (default 1)"<<endl;
+  cerr<<"[--line-search-threads] threads used within each line search (default 1)"<<endl;
+  cerr<<"[--parallel-directions] line search threads evaluate different directions"<<endl;
 #endif
   cerr<<"[--shard-count] Split data into shards, optimize for each shard and average"<<endl;
   cerr<<"[--shard-size] Shard size as proportion of data. If 0, use non-overlapping shards"<<endl;
@@ -141,6 +143,8 @@ static struct option long_options[] = {
   {"sparse-weights",required_argument,0,'p'},
 #ifdef WITH_THREADS
   {"threads", required_argument,0,'T'},
+  {"line-search-threads", required_argument, 0, 'L'},
+  {"parallel-directions", no_argument, 0, 'D'},
 #endif
   {"shard-count", required_argument, 0, 'a'},
   {"shard-size", required_argument, 0, 'b'},
@@ -165,6 +169,8 @@ struct ProgramOption {
   string positive_string;
   string sparse_weights_file;
   size_t num_threads;
+  size_t line_search_threads;
+  bool parallel_directions;
   float shard_size;
   size_t shard_count;
 
@@ -184,6 +190,8 @@ struct ProgramOption {
       positive_string(kDefaultPositiveString),
       sparse_weights_file(kDefaultSparseWeightsFile),
       num_threads(1),
+      line_search_threads(1),
+      parallel_directions(false),
       shard_size(0),
       shard_count(0) { }
 };
@@ -240,6 +248,13 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
       opt->num_threads = strtol(optarg, NULL, 10);
       if (opt->num_threads < 1) opt->num_threads = 1;
       break;
+    case 'L':
+      opt->line_search_threads = strtol(optarg, NULL, 10);
+      if (opt->line_search_threads < 1) opt->line_search_threads = 1;
+      break;
+    case 'D':
+      opt->parallel_directions = true;
+      break;
 #endif
     case 'a':
       opt->shard_count = strtof(optarg, NULL);
@@ -471,6 +486,7 @@ int main(int argc, char **argv)
     Optimizer *optimizer = OptimizerFactory::BuildOptimizer(option.pdim, to_optimize, positive, start_list[0], option.optimize_type, option.nrandom);
     optimizer->SetScorer(data_ref.getScorer());
     optimizer->SetFeatureData(data_ref.getFeatureData());
+    optimizer->SetNumThreads(option.line_search_threads, option.parallel_directions);
     // A task for each start point
     for (size_t j = 0; j < startingPoints.size(); ++j) {
       boost::shared_ptr<OptimizationTask>
@@ -0,0 +1,67 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2014- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+/**
+  Compile a text rule table (Moses format) into the binary snapshot described
+  in moses/TranslationModel/RuleTable/BinaryRuleTable.h.  The decoder picks
+  the format up by its magic number, so the output can replace the text table
+  in moses.ini as is, or be served without loading by PhraseDictionaryMapped.
+**/
+
+#include <iostream>
+
+#include "moses/TranslationModel/RuleTable/BinaryRuleTable.h"
+#include "util/file.hh"
+#include "util/file_piece.hh"
+#include "util/string_piece.hh"
+#include "util/usage.hh"
+
+using namespace std;
+using Moses::BinaryRuleTableWriter;
+
+int main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    cerr << "Usage: " << argv[0] << " rule_table output" << endl;
+    cerr << "Compiles a Moses-format text rule table (optionally compressed) into a" << endl;
+    cerr << "binary file that PhraseDictionaryMemory and the other in-memory rule" << endl;
+    cerr << "tables load without parsing, and that PhraseDictionaryMapped serves" << endl;
+    cerr << "from the mapped file.  Use it in place of the text table." << endl;
+    return 1;
+  }
+
+  try {
+    BinaryRuleTableWriter writer;
+    util::FilePiece in(argv[1], &cerr);
+    StringPiece line;
+    size_t lineNum = 0;
+    while (in.ReadLineOrEOF(line)) {
+      writer.Add(line, ++lineNum);
+    }
+    util::scoped_fd out(util::CreateOrThrow(argv[2]));
+    writer.Write(out.get());
+    cerr << "Wrote " << writer.Rules() << " rules to " << argv[2] << endl;
+  } catch (const std::exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  util::PrintUsage(cerr);
+  return 0;
+}
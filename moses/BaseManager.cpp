@@ -42,6 +42,13 @@ OutputSearchGraphAsHypergraph(std::ostream& out) const
   UTIL_THROW2("Not implemented.");
 }
 
+void
+BaseManager::
+OutputSearchGraphAsBinaryHypergraph(std::ostream& out) const
+{
+  UTIL_THROW2("Not implemented.");
+}
+
 void
 BaseManager::
 OutputSearchGraphAsHypergraph(std::string const& fname, size_t const precision) const
@@ -67,6 +74,20 @@ OutputSearchGraphAsHypergraph(std::string const& fname, size_t const precision)
   StaticData::Instance().GetAllWeights().Save(weightsOut);
   weightsOut.close();
 
+  if (boost::ends_with(fname, ".bin")) {
+    ofstream file(fname.c_str(), ios_base::out | ios_base::binary);
+    if (file.good()) {
+      this->OutputSearchGraphAsBinaryHypergraph(file);
+    } else {
+      TRACE_ERR("Cannot output hypergraph for line "
+                << this->GetSource().GetTranslationId()
+                << " because the output file " << fname
+                << " is not open or not ready for writing"
+                << std::endl);
+    }
+    return;
+  }
+
   boost::iostreams::filtering_ostream file;
   if (boost::ends_with(fname, ".gz"))
     file.push(boost::iostreams::gzip_compressor());
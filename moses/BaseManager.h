@@ -66,6 +66,7 @@ public:
   // virtual void OutputSearchGraphHypergraph() const = 0;
 
   virtual void OutputSearchGraphAsHypergraph(std::ostream& out) const;
+  virtual void OutputSearchGraphAsBinaryHypergraph(std::ostream& out) const;
   virtual void OutputSearchGraphAsHypergraph(std::string const& fname,
       size_t const precision) const;
   /***
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "BitmapContainer.h"
 #include "HypothesisStackCubePruning.h"
 #include "moses/FF/DistortionScoreProducer.h"
+#include "moses/FF/StatefulFeatureFunction.h"
 #include "TranslationOptionList.h"
 #include "Manager.h"
 
@@ -203,24 +204,30 @@ BackwardsEdge::~BackwardsEdge()
 void
 BackwardsEdge::Initialize()
 {
+  Hypothesis *expanded = CreateCorner();
+  if (expanded != NULL) {
+    expanded->EvaluateWhenApplied(m_estimatedScore);
+    m_parent.Enqueue(0, 0, expanded, this);
+  }
+}
+
+Hypothesis *BackwardsEdge::CreateCorner()
+{
+  m_initialized = true;
   if(m_hypotheses.size() == 0 || m_translations.size() == 0) {
-    m_initialized = true;
-    return;
+    return NULL;
   }
 
   const Bitmap &bm = m_hypotheses[0]->GetWordsBitmap();
   const Range &newRange = m_translations.Get(0)->GetSourceWordsRange();
   m_estimatedScore = m_estimatedScores.CalcEstimatedScore(bm, newRange.GetStartPos(), newRange.GetEndPos());
 
-  Hypothesis *expanded = CreateHypothesis(*m_hypotheses[0], *m_translations.Get(0));
-  m_parent.Enqueue(0, 0, expanded, this);
   SetSeenPosition(0, 0);
-  m_initialized = true;
+  return BuildHypothesis(*m_hypotheses[0], *m_translations.Get(0));
 }
 
-Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const TranslationOption &transOpt)
+Hypothesis *BackwardsEdge::BuildHypothesis(const Hypothesis &hypothesis, const TranslationOption &transOpt)
 {
-  // create hypothesis and calculate all its scores
   IFVERBOSE(2) {
     hypothesis.GetManager().GetSentenceStats().StartTimeBuildHyp();
   }
@@ -229,6 +236,13 @@ Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const
   IFVERBOSE(2) {
     hypothesis.GetManager().GetSentenceStats().StopTimeBuildHyp();
   }
+  return newHypo;
+}
+
+Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const TranslationOption &transOpt)
+{
+  // create hypothesis and calculate all its scores
+  Hypothesis *newHypo = BuildHypothesis(hypothesis, transOpt);
   newHypo->EvaluateWhenApplied(m_estimatedScore);
 
   return newHypo;
@@ -429,11 +443,36 @@ BitmapContainer::InitializeEdges()
   BackwardsEdgeSet::iterator iter = m_edges.begin();
   BackwardsEdgeSet::iterator iterEnd = m_edges.end();
 
-  while (iter != iterEnd) {
-    BackwardsEdge *edge = *iter;
-    edge->Initialize();
+  const std::vector<const StatefulFeatureFunction*> batchedFFs
+  = StatefulFeatureFunction::GetBatchedFeatureFunctions();
 
-    ++iter;
+  if (batchedFFs.empty()) {
+    while (iter != iterEnd) {
+      BackwardsEdge *edge = *iter;
+      edge->Initialize();
+
+      ++iter;
+    }
+    return;
+  }
+
+  // create the corner hypotheses of all edges first and score them as one
+  // batch; successors are scored one by one as they are pushed
+  std::vector<Hypothesis*> batch;
+  std::vector<BackwardsEdge*> batchEdges;
+  for (; iter != iterEnd; ++iter) {
+    Hypothesis *expanded = (*iter)->CreateCorner();
+    if (expanded != NULL) {
+      batch.push_back(expanded);
+      batchEdges.push_back(*iter);
+    }
+  }
+  for (size_t i = 0; i < batchedFFs.size(); ++i) {
+    batchedFFs[i]->EvaluateWhenAppliedBatch(batch);
+  }
+  for (size_t i = 0; i < batch.size(); ++i) {
+    batch[i]->EvaluateWhenApplied(batchEdges[i]->m_estimatedScore);
+    Enqueue(0, 0, batch[i], batchEdges[i]);
   }
 }
 
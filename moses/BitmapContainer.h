@@ -195,12 +195,15 @@ private:
   // We don't want to instantiate "empty" objects.
   BackwardsEdge();
 
+  Hypothesis *BuildHypothesis(const Hypothesis &hypothesis, const TranslationOption &transOpt);
   Hypothesis *CreateHypothesis(const Hypothesis &hypothesis, const TranslationOption &transOpt);
   bool SeenPosition(const size_t x, const size_t y);
   void SetSeenPosition(const size_t x, const size_t y);
 
 protected:
   void Initialize();
+  //! set up the edge and return its corner hypothesis, not yet scored
+  Hypothesis *CreateCorner();
 
 public:
   BackwardsEdge(const BitmapContainer &prevBitmapContainer
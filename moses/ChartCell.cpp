@@ -30,6 +30,8 @@
 #include "ChartTranslationOptions.h"
 #include "ChartTranslationOptionList.h"
 #include "ChartManager.h"
+#include "RuleCubeItem.h"
+#include "FF/StatefulFeatureFunction.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -94,11 +96,37 @@ void ChartCell::Decode(const ChartTranslationOptionList &transOptList
   // priority queue for applicable rules with selected hypotheses
   RuleCubeQueue queue(m_manager);
 
-  // add all trans opt into queue. using only 1st child node.
-  for (size_t i = 0; i < transOptList.GetSize(); ++i) {
-    const ChartTranslationOptions &transOpt = transOptList.Get(i);
-    RuleCube *ruleCube = new RuleCube(transOpt, allChartCells, m_manager);
-    queue.Add(ruleCube);
+  const std::vector<const StatefulFeatureFunction*> batchedFFs
+  = StatefulFeatureFunction::GetBatchedFeatureFunctions();
+
+  if (batchedFFs.empty() || m_manager.options()->cube.lazy_scoring) {
+    // add all trans opt into queue. using only 1st child node.
+    for (size_t i = 0; i < transOptList.GetSize(); ++i) {
+      const ChartTranslationOptions &transOpt = transOptList.Get(i);
+      RuleCube *ruleCube = new RuleCube(transOpt, allChartCells, m_manager);
+      queue.Add(ruleCube);
+    }
+  } else {
+    // create the corner items of all rule cubes first and score their
+    // hypotheses as one batch
+    std::vector<RuleCube*> cubes;
+    std::vector<ChartHypothesis*> batch;
+    std::vector<RuleCubeItem*> items;
+    cubes.reserve(transOptList.GetSize());
+    for (size_t i = 0; i < transOptList.GetSize(); ++i) {
+      const ChartTranslationOptions &transOpt = transOptList.Get(i);
+      cubes.push_back(new RuleCube(transOpt, allChartCells, m_manager,
+                                   batch, items));
+    }
+    for (size_t i = 0; i < batchedFFs.size(); ++i) {
+      batchedFFs[i]->EvaluateWhenAppliedBatch(batch);
+    }
+    for (size_t i = 0; i < items.size(); ++i) {
+      items[i]->EvaluateHypothesis();
+    }
+    for (size_t i = 0; i < cubes.size(); ++i) {
+      queue.Add(cubes[i]);
+    }
   }
 
   // pluck things out of queue and add to hypo collection
@@ -298,6 +298,15 @@ OutputSearchGraphAsHypergraph(std::ostream& out) const
   WriteSearchGraph(writer);
 }
 
+void
+ChartManager::
+OutputSearchGraphAsBinaryHypergraph(std::ostream& out) const
+{
+  ChartSearchGraphWriterBinaryHypergraph writer(options(), &out);
+  WriteSearchGraph(writer);
+  writer.Flush();
+}
+
 void ChartManager::OutputSearchGraphMoses(std::ostream &outputSearchGraphStream) const
 {
   ChartSearchGraphWriterMoses writer(options(), &outputSearchGraphStream,
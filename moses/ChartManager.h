@@ -114,6 +114,9 @@ public:
   /** Output in (modified) Kenneth hypergraph format */
   void OutputSearchGraphAsHypergraph(std::ostream &outputSearchGraphStream) const;
 
+  /** Output in the binary hypergraph format read by mert */
+  void OutputSearchGraphAsBinaryHypergraph(std::ostream &outputSearchGraphStream) const;
+
   //! debug data collected when decoding sentence
   SentenceStats& GetSentenceStats() const {
     return *m_sentenceStats;
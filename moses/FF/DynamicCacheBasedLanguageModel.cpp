@@ -19,6 +19,7 @@ DynamicCacheBasedLanguageModel::DynamicCacheBasedLanguageModel(const std::string
   m_maxAge = 1000;
   m_name = "default";
   m_constant = false;
+  m_cache.reset(new decaying_cache_t);
 
   ReadParameters();
   UTIL_THROW_IF2(s_instance_map.find(m_name) != s_instance_map.end(), "Only 1 DynamicCacheBasedLanguageModel feature named " + m_name + " is allowed");
@@ -32,9 +33,6 @@ DynamicCacheBasedLanguageModel::~DynamicCacheBasedLanguageModel() {};
 
 void DynamicCacheBasedLanguageModel::SetPreComputedScores()
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   precomputedScores.clear();
   for (unsigned int i=0; i<m_maxAge; i++) {
     precomputedScores.push_back(decaying_score(i));
@@ -90,13 +88,14 @@ void DynamicCacheBasedLanguageModel::EvaluateInIsolation(const Phrase &sp
     , ScoreComponentCollection &scoreBreakdown
     , ScoreComponentCollection &estimatedScores) const
 {
+  CachePtr cache = GetCache();
   float score = m_lower_score;
   switch(m_query_type) {
   case CBLM_QUERY_TYPE_WHOLESTRING:
-    score = Evaluate_Whole_String(tp);
+    score = Evaluate_Whole_String(*cache, tp);
     break;
   case CBLM_QUERY_TYPE_ALLSUBSTRINGS:
-    score = Evaluate_All_Substrings(tp);
+    score = Evaluate_All_Substrings(*cache, tp);
     break;
   default:
     UTIL_THROW_IF2(false, "This score type (" << m_query_type << ") is unknown.");
@@ -105,7 +104,7 @@ void DynamicCacheBasedLanguageModel::EvaluateInIsolation(const Phrase &sp
   scoreBreakdown.Assign(this, score);
 }
 
-float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const TargetPhrase& tp) const
+float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const decaying_cache_t &cache, const TargetPhrase& tp) const
 {
   //consider all words in the TargetPhrase as one n-gram
   // and compute the decaying_score for the whole n-gram
@@ -122,10 +121,10 @@ float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const TargetPhrase&
       w += " ";
     }
   }
-  it = m_cache.find(w);
+  it = cache.find(w);
 
   VERBOSE(4,"cblm::Evaluate_Whole_String: searching w:|" << w << "|" << std::endl);
-  if (it != m_cache.end()) { //found!
+  if (it != cache.end()) { //found!
     score = ((*it).second).second;
     VERBOSE(4,"cblm::Evaluate_Whole_String: found w:|" << w << "|" << std::endl);
   }
@@ -134,7 +133,7 @@ float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const TargetPhrase&
   return score;
 }
 
-float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const TargetPhrase& tp) const
+float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const decaying_cache_t &cache, const TargetPhrase& tp) const
 {
   //loop over all n-grams in the TargetPhrase (no matter of n)
   //and compute the decaying_score for all words
@@ -147,9 +146,9 @@ float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const TargetPhrase
     std::string w = "";
     for (size_t endpos = startpos; endpos < tp.GetSize() ; ++endpos) {
       w += tp.GetWord(endpos).GetFactor(0)->GetString().as_string();
-      it = m_cache.find(w);
+      it = cache.find(w);
 
-      if (it != m_cache.end()) { //found!
+      if (it != cache.end()) { //found!
         score += ((*it).second).second;
         VERBOSE(3,"cblm::Evaluate_All_Substrings: found w:|" << w << "| actual score:|" << ((*it).second).second << "| score:|" << score << "|" << std::endl);
       } else {
@@ -166,47 +165,50 @@ float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const TargetPhrase
   return score;
 }
 
+DynamicCacheBasedLanguageModel::CachePtr DynamicCacheBasedLanguageModel::GetCache() const
+{
+  return boost::atomic_load(&m_cache);
+}
+
+void DynamicCacheBasedLanguageModel::Publish(const boost::shared_ptr<decaying_cache_t> &cache)
+{
+  CachePtr next = cache;
+  boost::atomic_store(&m_cache, next);
+}
+
 void DynamicCacheBasedLanguageModel::Print() const
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
+  CachePtr cache = GetCache();
   decaying_cache_t::const_iterator it;
   std::cout << "Content of the cache of Cache-Based Language Model" << std::endl;
-  std::cout << "Size of the cache of Cache-Based Language Model:|" << m_cache.size() << "|" << std::endl;
-  for ( it=m_cache.begin() ; it != m_cache.end(); it++ ) {
+  std::cout << "Size of the cache of Cache-Based Language Model:|" << cache->size() << "|" << std::endl;
+  for ( it=cache->begin() ; it != cache->end(); it++ ) {
     std::cout << "word:|" << (*it).first << "| age:|" << ((*it).second).first << "| score:|" << ((*it).second).second << "|" << std::endl;
   }
 }
 
-void DynamicCacheBasedLanguageModel::Decay()
+void DynamicCacheBasedLanguageModel::Decay(decaying_cache_t &cache)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
-  decaying_cache_t::iterator it;
+  decaying_cache_t::iterator it = cache.begin();
 
   unsigned int age;
   float score;
-  for ( it=m_cache.begin() ; it != m_cache.end(); it++ ) {
+  while (it != cache.end()) {
     age=((*it).second).first + 1;
     if (age > m_maxAge) {
-      m_cache.erase(it);
-      it--;
+      it = cache.erase(it);
     } else {
       score = GetPreComputedScores(age);
 //      score = decaying_score(age);
       decaying_cache_value_t p (age, score);
       (*it).second = p;
+      ++it;
     }
   }
 }
 
-void DynamicCacheBasedLanguageModel::Update(std::vector<std::string> words, int age)
+void DynamicCacheBasedLanguageModel::Update(decaying_cache_t &cache, std::vector<std::string> words, int age)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   VERBOSE(3,"words.size():|" << words.size() << "|" << std::endl);
   for (size_t j=0; j<words.size(); j++) {
     words[j] = Trim(words[j]);
@@ -214,9 +216,7 @@ void DynamicCacheBasedLanguageModel::Update(std::vector<std::string> words, int
 //    decaying_cache_value_t p (age,decaying_score(age));
     VERBOSE(3,"CacheBasedLanguageModel::Update   word[" << j << "]:"<< words[j] << " age:" << age << " GetPreComputedScores(age):" << GetPreComputedScores(age) << std::endl);
     decaying_cache_value_t p (age,GetPreComputedScores(age));
-    std::pair<std::string, decaying_cache_value_t> e (words[j],p);
-    m_cache.erase(words[j]); //always erase the element (do nothing if the entry does not exist)
-    m_cache.insert(e); //insert the entry
+    cache[words[j]] = p; //overwrite the entry if it already exists
   }
 }
 
@@ -233,14 +233,16 @@ void DynamicCacheBasedLanguageModel::ClearEntries(std::string &entries)
 void DynamicCacheBasedLanguageModel::ClearEntries(std::vector<std::string> words)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::mutex::scoped_lock lock(m_updateLock);
 #endif
+  boost::shared_ptr<decaying_cache_t> cache(new decaying_cache_t(*GetCache()));
   VERBOSE(3,"words.size():|" << words.size() << "|" << std::endl);
   for (size_t j=0; j<words.size(); j++) {
     words[j] = Trim(words[j]);
     VERBOSE(3,"CacheBasedLanguageModel::ClearEntries   word[" << j << "]:"<< words[j] << std::endl);
-    m_cache.erase(words[j]); //always erase the element (do nothing if the entry does not exist)
+    cache->erase(words[j]); //always erase the element (do nothing if the entry does not exist)
   }
+  Publish(cache);
 }
 
 void DynamicCacheBasedLanguageModel::Insert(std::string &entries)
@@ -256,10 +258,18 @@ void DynamicCacheBasedLanguageModel::Insert(std::string &entries)
 void DynamicCacheBasedLanguageModel::Insert(std::vector<std::string> ngrams)
 {
   VERBOSE(3,"DynamicCacheBasedLanguageModel Insert ngrams.size():|" << ngrams.size() << "|" << std::endl);
-  if (m_constant == false) {
-    Decay();
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+    // decay and insertion go into one new snapshot
+    boost::shared_ptr<decaying_cache_t> cache(new decaying_cache_t(*GetCache()));
+    if (m_constant == false) {
+      Decay(*cache);
+    }
+    Update(*cache, ngrams, 1);
+    Publish(cache);
   }
-  Update(ngrams,1);
   IFVERBOSE(3) Print();
 }
 
@@ -318,9 +328,9 @@ void DynamicCacheBasedLanguageModel::Execute_Single_Command(std::string command)
 void DynamicCacheBasedLanguageModel::Clear()
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::mutex::scoped_lock lock(m_updateLock);
 #endif
-  m_cache.clear();
+  Publish(boost::shared_ptr<decaying_cache_t>(new decaying_cache_t));
 }
 
 void DynamicCacheBasedLanguageModel::Load(AllOptions::ptr const& opts)
@@ -336,19 +346,27 @@ void DynamicCacheBasedLanguageModel::Load(const std::string filestr)
   VERBOSE(2,"DynamicCacheBasedLanguageModel::Load(const std::string filestr)" << std::endl);
 //  std::vector<std::string> files = Tokenize(m_initfiles, "||");
   std::vector<std::string> files = Tokenize(filestr, "||");
-  Load_Multiple_Files(files);
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+    boost::shared_ptr<decaying_cache_t> cache(new decaying_cache_t(*GetCache()));
+    Load_Multiple_Files(*cache, files);
+    Publish(cache);
+  }
+  IFVERBOSE(2) Print();
 }
 
 
-void DynamicCacheBasedLanguageModel::Load_Multiple_Files(std::vector<std::string> files)
+void DynamicCacheBasedLanguageModel::Load_Multiple_Files(decaying_cache_t &cache, std::vector<std::string> files)
 {
   VERBOSE(2,"DynamicCacheBasedLanguageModel::Load_Multiple_Files(std::vector<std::string> files)" << std::endl);
   for(size_t j = 0; j < files.size(); ++j) {
-    Load_Single_File(files[j]);
+    Load_Single_File(cache, files[j]);
   }
 }
 
-void DynamicCacheBasedLanguageModel::Load_Single_File(const std::string file)
+void DynamicCacheBasedLanguageModel::Load_Single_File(decaying_cache_t &cache, const std::string file)
 {
   VERBOSE(2,"DynamicCacheBasedLanguageModel::Load_Single_File(const std::string file)" << std::endl);
   //file format
@@ -374,20 +392,15 @@ void DynamicCacheBasedLanguageModel::Load_Single_File(const std::string file)
     if (vecStr.size() >= 2) {
       age = Scan<int>(vecStr[0]);
       vecStr.erase(vecStr.begin());
-      Update(vecStr,age);
+      Update(cache, vecStr, age);
     } else {
       UTIL_THROW_IF2(false, "The format of the loaded file is wrong: " << line);
     }
   }
-  IFVERBOSE(2) Print();
 }
 
 void DynamicCacheBasedLanguageModel::SetQueryType(size_t type)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
-
   m_query_type = type;
   if ( m_query_type != CBLM_QUERY_TYPE_WHOLESTRING
        && m_query_type != CBLM_QUERY_TYPE_ALLSUBSTRINGS ) {
@@ -400,9 +413,6 @@ void DynamicCacheBasedLanguageModel::SetQueryType(size_t type)
 
 void DynamicCacheBasedLanguageModel::SetScoreType(size_t type)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
   m_score_type = type;
   if ( m_score_type != CBLM_SCORE_TYPE_HYPERBOLA
        && m_score_type != CBLM_SCORE_TYPE_POWER
@@ -419,9 +429,6 @@ void DynamicCacheBasedLanguageModel::SetScoreType(size_t type)
 
 void DynamicCacheBasedLanguageModel::SetMaxAge(unsigned int age)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
   m_maxAge = age;
   VERBOSE(2, "CacheBasedLanguageModel MaxAge:  " << m_maxAge << std::endl);
 };
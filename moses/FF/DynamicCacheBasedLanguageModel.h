@@ -6,13 +6,15 @@
 #include "moses/Util.h"
 #include "FeatureFunction.h"
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
-#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 #endif
 
 typedef std::pair<int, float> decaying_cache_value_t;
-typedef std::map<std::string, decaying_cache_value_t > decaying_cache_t;
+typedef boost::unordered_map<std::string, decaying_cache_value_t > decaying_cache_t;
 
 #define CBLM_QUERY_TYPE_UNDEFINED (-1)
 #define CBLM_QUERY_TYPE_ALLSUBSTRINGS 0
@@ -34,12 +36,18 @@ namespace Moses
 class Range;
 
 /** Calculates score for the Dynamic Cache-Based pseudo LM
+ *
+ * The cache is an immutable snapshot: scoring reads the current one without
+ * locking, while updates build a new snapshot and publish it atomically.
  */
 class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
 {
+  typedef boost::shared_ptr<const decaying_cache_t> CachePtr;
+
   // data structure for the cache;
-  // the key is the word and the value is the decaying score
-  decaying_cache_t m_cache;
+  // the key is the word and the value is the decaying score;
+  // only accessed with boost::atomic_load and boost::atomic_store
+  CachePtr m_cache;
   size_t m_query_type; //way of querying the cache
   size_t m_score_type; //way of scoring entries of the cache
   std::string m_initfiles; // vector of files loaded in the initialization phase
@@ -50,27 +58,30 @@ class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
   unsigned int m_maxAge;
 
 #ifdef WITH_THREADS
-  //multiple readers - single writer lock
-  mutable boost::shared_mutex m_cacheLock;
+  //serializes the updates; readers don't take it
+  boost::mutex m_updateLock;
 #endif
 
   float decaying_score(unsigned int age);
   void SetPreComputedScores();
   float GetPreComputedScores(const unsigned int age);
 
-  float Evaluate_Whole_String( const TargetPhrase&) const;
-  float Evaluate_All_Substrings( const TargetPhrase&) const;
+  float Evaluate_Whole_String(const decaying_cache_t &cache, const TargetPhrase&) const;
+  float Evaluate_All_Substrings(const decaying_cache_t &cache, const TargetPhrase&) const;
+
+  CachePtr GetCache() const;
+  void Publish(const boost::shared_ptr<decaying_cache_t> &cache);
 
-  void Decay();
-  void Update(std::vector<std::string> words, int age);
+  void Decay(decaying_cache_t &cache);
+  void Update(decaying_cache_t &cache, std::vector<std::string> words, int age);
 
   void ClearEntries(std::vector<std::string> entries);
 
   void Execute(std::vector<std::string> commands);
   void Execute_Single_Command(std::string command);
 
-  void Load_Multiple_Files(std::vector<std::string> files);
-  void Load_Single_File(const std::string file);
+  void Load_Multiple_Files(decaying_cache_t &cache, std::vector<std::string> files);
+  void Load_Single_File(decaying_cache_t &cache, const std::string file);
 
   void Insert(std::vector<std::string> ngrams);
 
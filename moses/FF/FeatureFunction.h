@@ -75,6 +75,12 @@ public:
     m_options = opts;
   }
 
+  //! names of features whose Load() must have finished before this one's
+  //! starts, when feature functions are loaded in parallel
+  virtual std::vector<std::string> GetLoadDependencies() const {
+    return std::vector<std::string>();
+  }
+
   AllOptions::ptr const&
   options() const {
     return m_options;
@@ -47,6 +47,16 @@ GetNumScoreComponents() const
           : score_per_dir + m_additionalScoreComponents);
 }
 
+size_t
+LRModel::
+GetNumTableScores() const
+{
+  // tables always hold uncollapsed scores
+  return ((m_direction == Bidirectional)
+          ? 2 * GetNumberOfTypes()
+          : GetNumberOfTypes());
+}
+
 void
 LRModel::
 ConfigureSparse(const std::map<std::string,std::string>& sparseArgs,
@@ -75,6 +75,7 @@ public:
 
   size_t GetNumberOfTypes() const;
   size_t GetNumScoreComponents() const;
+  size_t GetNumTableScores() const; // scores per phrase pair in the table
   void SetAdditionalScoreComponents(size_t number);
 
   LexicalReordering*
@@ -30,7 +30,7 @@ CopyScores(ScoreComponentCollection*  accum,
                                           ? &topt : m_prevOption);
 
   LexicalReordering* producer = m_configuration.GetScoreProducer();
-  Scores const* cached = relevantOpt->GetLexReorderingScores(producer);
+  float const* cached = relevantOpt->GetLexReorderingScores(producer);
 
   // The approach here is bizarre! Why create a whole vector and do
   // vector addition (acumm->PlusEquals) to update a single value? - UG
@@ -42,9 +42,10 @@ CopyScores(ScoreComponentCollection*  accum,
 
   // look up applicable score from vectore of scores
   if(cached) {
-    UTIL_THROW_IF2(off_remote >= cached->size(), "offset out of vector bounds!");
+    UTIL_THROW_IF2(off_remote >= m_configuration.GetNumTableScores(),
+                   "offset out of vector bounds!");
     Scores scores(producer->GetNumScoreComponents(),0);
-    scores[off_local ] = (*cached)[off_remote];
+    scores[off_local ] = cached[off_remote];
     accum->PlusEquals(producer, scores);
   }
 
@@ -67,8 +68,8 @@ LRState::
 ComparePrevScores(const TranslationOption *other) const
 {
   LexicalReordering* producer = m_configuration.GetScoreProducer();
-  const Scores* myScores = m_prevOption->GetLexReorderingScores(producer);
-  const Scores* yrScores = other->GetLexReorderingScores(producer);
+  float const* myScores = m_prevOption->GetLexReorderingScores(producer);
+  float const* yrScores = other->GetLexReorderingScores(producer);
 
   if(myScores == yrScores) return 0;
 
@@ -78,8 +79,8 @@ ComparePrevScores(const TranslationOption *other) const
 
   size_t stop = m_offset + m_configuration.GetNumberOfTypes();
   for(size_t i = m_offset; i < stop; i++) {
-    if((*myScores)[i] < (*yrScores)[i]) return -1;
-    if((*myScores)[i] > (*yrScores)[i]) return  1;
+    if(myScores[i] < yrScores[i]) return -1;
+    if(myScores[i] > yrScores[i]) return  1;
   }
   return 0;
 }
@@ -1,3 +1,4 @@
+#include <map>
 #include <sstream>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/foreach.hpp>
@@ -15,9 +16,12 @@ using namespace boost::algorithm;
 
 namespace Moses
 {
+size_t LexicalReordering::s_numInstances = 0;
+
 LexicalReordering::
 LexicalReordering(const std::string &line)
   : StatefulFeatureFunction(line,false)
+  , m_index(s_numInstances++)
 {
   VERBOSE(1, "Initializing Lexical Reordering Feature.." << std::endl);
 
@@ -134,18 +138,47 @@ IsUseable(const FactorMask &mask) const
 
 void
 LexicalReordering::
-SetCache(TranslationOption& to) const
+GetScores(TranslationOptionList const& tol, std::vector<Scores>& scores) const
 {
-  if (to.GetLexReorderingScores(this)) return;
-  // Scores were were set already (e.g., by sampling phrase table)
-
-  if (m_table) {
-    Phrase const& sphrase = to.GetInputPath().GetPhrase();
-    Phrase const& tphrase = to.GetTargetPhrase();
-    to.CacheLexReorderingScores(*this, this->GetProb(sphrase,tphrase));
-  } else { // e.g. OOV with Mmsapt
-    // Scores vals(GetNumScoreComponents(), 0);
-    // to.CacheLexReorderingScores(*this, vals);
+  scores.clear();
+  scores.resize(tol.size());
+  if (tol.size() == 0) return;
+
+  // options of the same input path share the source phrase, so the table
+  // can look them up together; for confusion network and lattice input,
+  // one list may hold options of several input paths.  Scores set already
+  // (e.g., by sampling phrase table) take precedence
+  typedef std::pair<std::vector<Phrase const*>, std::vector<size_t> > Lookup;
+  std::map<InputPath const*, Lookup> lookups;
+  for (size_t i = 0; i < tol.size(); ++i) {
+    TranslationOption const& topt = *tol.Get(i);
+    TargetPhrase const& tphrase = topt.GetTargetPhrase();
+    Scores const* extra = tphrase.GetExtraScores(this);
+    if (extra) {
+      scores[i] = *extra;
+    } else if (m_table) {
+      Lookup& lookup = lookups[&topt.GetInputPath()];
+      lookup.first.push_back(&tphrase);
+      lookup.second.push_back(i);
+    }
+    // else: e.g. OOV with Mmsapt
+  }
+
+  std::map<InputPath const*, Lookup>::const_iterator l;
+  for (l = lookups.begin(); l != lookups.end(); ++l) {
+    std::vector<size_t> const& pos = l->second.second;
+    std::vector<Scores> found;
+    m_table->GetScores(l->first->GetPhrase(), l->second.first,
+                       Phrase(ARRAY_SIZE_INCR), found);
+    for (size_t i = 0; i < found.size(); ++i)
+      scores[pos[i]].swap(found[i]);
+  }
+
+  size_t const needed = m_configuration->GetNumTableScores();
+  BOOST_FOREACH(Scores const& s, scores) {
+    UTIL_THROW_IF2(s.size() && s.size() < needed,
+                   GetScoreProducerDescription() << ": expected "
+                   << needed << " reordering scores, got " << s.size());
   }
 }
 
@@ -157,14 +190,6 @@ LexicalReordering
 }
 
 
-void
-LexicalReordering::
-SetCache(TranslationOptionList& tol) const
-{
-  BOOST_FOREACH(TranslationOption* to, tol)
-  this->SetCache(*to);
-}
-
 
 }
 
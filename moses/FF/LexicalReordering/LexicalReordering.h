@@ -74,13 +74,19 @@ public:
     return m_defaultScores[i];
   }
 
-  virtual
-  void
-  SetCache(TranslationOption& to) const;
+  //! position among all LexicalReordering features, used to address the
+  //! per-option score slots (see TranslationOption::GetLexReorderingScores)
+  size_t
+  GetIndex() const {
+    return m_index;
+  }
 
-  virtual
+  //! Looks up the scores of all options in tol in one batch. Scores set by
+  //! the phrase table (e.g. Mmsapt) are taken as they are. scores[i] stays
+  //! empty if there is nothing for the i-th option.
   void
-  SetCache(TranslationOptionList& tol) const;
+  GetScores(TranslationOptionList const& tol,
+            std::vector<Scores>& scores) const;
 
 private:
   bool DecodeCondition(std::string s);
@@ -96,6 +102,8 @@ private:
   std::string m_filePath;
   bool m_haveDefaultScores;
   Scores m_defaultScores;
+  size_t m_index;
+  static size_t s_numInstances;
 public:
   LRModel const& GetModel() const;
 };
@@ -52,6 +52,17 @@ public:
   Scores
   GetScore(const Phrase& f, const Phrase& e, const Phrase& c) = 0;
 
+  //! scores for several target phrases of the same source phrase;
+  //! scores[i] is empty if (f, *es[i], c) is not in the table
+  virtual
+  void
+  GetScores(const Phrase& f, const std::vector<const Phrase*>& es,
+            const Phrase& c, std::vector<Scores>& scores) {
+    scores.resize(es.size());
+    for (size_t i = 0; i < es.size(); ++i)
+      scores[i] = GetScore(f, *es[i], c);
+  }
+
   virtual
   void
   InitializeForInput(ttasksptr const& ttask) {
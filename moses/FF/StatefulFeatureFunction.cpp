@@ -1,4 +1,5 @@
 #include "StatefulFeatureFunction.h"
+#include "moses/StaticData.h"
 
 namespace Moses
 {
@@ -19,5 +20,20 @@ StatefulFeatureFunction
   m_statefulFFs.push_back(this);
 }
 
+std::vector<const StatefulFeatureFunction*>
+StatefulFeatureFunction
+::GetBatchedFeatureFunctions()
+{
+  const StaticData &staticData = StaticData::Instance();
+  std::vector<const StatefulFeatureFunction*> ret;
+  for (size_t i = 0; i < m_statefulFFs.size(); ++i) {
+    const StatefulFeatureFunction *ff = m_statefulFFs[i];
+    if (ff->SupportsBatchedEvaluation()
+        && !staticData.IsFeatureFunctionIgnored(*ff)) {
+      ret.push_back(ff);
+    }
+  }
+  return ret;
 }
 
+}
@@ -63,6 +63,34 @@ public:
     return 0; /* FIXME */
   }
 
+  /**
+   * \brief Optional batched evaluation.
+   * If SupportsBatchedEvaluation() returns true, the search hands over all
+   * pending expansions of a stack (phrase-based, normal search), the corner
+   * hypotheses of a bitmap container's cubes (phrase-based, cube pruning)
+   * or the initial hypotheses of a chart cell before EvaluateWhenApplied()
+   * is called on each of them. The syntax decoders (Syntax::Cube) do not
+   * batch.
+   * Features with expensive scoring (e.g. neural LMs) can score the whole
+   * minibatch here in one go and serve the results from
+   * EvaluateWhenApplied() afterwards. Batches never mix threads.
+   */
+  virtual bool SupportsBatchedEvaluation() const {
+    return false;
+  }
+
+  virtual void EvaluateWhenAppliedBatch(
+    const std::vector<Hypothesis*> & /* batch */) const {
+  }
+
+  virtual void EvaluateWhenAppliedBatch(
+    const std::vector<ChartHypothesis*> & /* batch */) const {
+  }
+
+  //! features that want to see batches, see EvaluateWhenAppliedBatch()
+  static std::vector<const StatefulFeatureFunction*>
+  GetBatchedFeatureFunctions();
+
   //! return the state associated with the empty hypothesis for a given sentence
   virtual const FFState* EmptyHypothesisState(const InputType &input) const = 0;
 
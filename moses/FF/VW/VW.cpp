@@ -37,6 +37,7 @@ VW::VW(const std::string &line)
   , TLSTargetSentence(this)
   , m_train(false)
   , m_sentenceStartWord(Word())
+  , m_predictionCacheSize(0)
 {
   ReadParameters();
   Discriminative::ClassifierFactory *classifierFactory = m_train
@@ -49,6 +50,7 @@ VW::VW(const std::string &line)
   m_tlsComputedStateExtensions = new TLSStateExtensions(this);
   m_tlsTranslationOptionFeatures = new TLSFeatureVectorMap(this);
   m_tlsTargetContextFeatures = new TLSFeatureVectorMap(this);
+  m_tlsPredictionCache = new TLSPredictionCache(this);
 
   if (! m_normalizer) {
     VERBOSE(1, "VW :: No loss function specified, assuming logistic loss.\n");
@@ -133,25 +135,24 @@ FFState* VW::EvaluateWhenApplied(
       VERBOSE(3, "VW :: context cache hit\n");
     }
 
-    std::vector<float> losses(topts->size());
+    const Discriminative::FeatureVector &contextVector = contextFeaturesCache[contextHash];
 
+    // all features associated with the translation options
+    // (pre-computed when evaluated with source context)
+    std::vector<Discriminative::FeatureVector> targetFeatureVectors(topts->size());
     for (size_t toptIdx = 0; toptIdx < topts->size(); toptIdx++) {
-      const TranslationOption *topt = topts->Get(toptIdx);
-      const TargetPhrase &targetPhrase = topt->GetTargetPhrase();
-      size_t toptHash = hash_value(*topt);
-
-      // start with pre-computed source-context-only VW scores
-      losses[toptIdx] = m_tlsFutureScores->GetStored()->find(toptHash)->second;
-
-      // add all features associated with this translation option
-      // (pre-computed when evaluated with source context)
-      const Discriminative::FeatureVector &targetFeatureVector =
-        m_tlsTranslationOptionFeatures->GetStored()->find(toptHash)->second;
+      size_t toptHash = hash_value(*topts->Get(toptIdx));
+      targetFeatureVectors[toptIdx] = m_tlsTranslationOptionFeatures->GetStored()->find(toptHash)->second;
+    }
 
-      classifier.AddLabelDependentFeatureVector(targetFeatureVector);
+    // classifier scores with context+target features only
+    std::vector<float> losses;
+    PredictBatch(classifier, contextVector, targetFeatureVectors, losses);
 
-      // add classifier score with context+target features only to the total loss
-      losses[toptIdx] += classifier.Predict(MakeTargetLabel(targetPhrase));
+    // add the pre-computed source-context-only VW scores
+    for (size_t toptIdx = 0; toptIdx < topts->size(); toptIdx++) {
+      size_t toptHash = hash_value(*topts->Get(toptIdx));
+      losses[toptIdx] += m_tlsFutureScores->GetStored()->find(toptHash)->second;
     }
 
     // normalize classifier scores to get a probability distribution
@@ -312,37 +313,48 @@ void VW::EvaluateTranslationOptionListWithSourceContext(const InputType &input
     // predict using a trained classifier, use this in decoding (=at test time)
     //
 
-    std::vector<float> losses(translationOptionList.size());
-
     Discriminative::FeatureVector outFeaturesSourceNamespace;
 
     // extract source side features
     for(size_t i = 0; i < sourceFeatures.size(); ++i)
       (*sourceFeatures[i])(input, sourceRange, classifier, outFeaturesSourceNamespace);
 
+    std::vector<Discriminative::FeatureVector> targetFeatureVectors(translationOptionList.size());
+
     for (size_t toptIdx = 0; toptIdx < translationOptionList.size(); toptIdx++) {
       const TranslationOption *topt = translationOptionList.Get(toptIdx);
       const TargetPhrase &targetPhrase = topt->GetTargetPhrase();
-      Discriminative::FeatureVector outFeaturesTargetNamespace;
+      Discriminative::FeatureVector &outFeaturesTargetNamespace = targetFeatureVectors[toptIdx];
 
-      // extract target-side features for each topt
+      // extract target-side features for each topt; the classifier is only needed for
+      // feature IDs here, all topts are predicted in one batch below
       for(size_t i = 0; i < targetFeatures.size(); ++i)
         (*targetFeatures[i])(input, targetPhrase, classifier, outFeaturesTargetNamespace);
+      classifier.Discard();
 
       // cache the extracted target features (i.e. features associated with given topt)
       // for future use at decoding time
       size_t toptHash = hash_value(*topt);
       m_tlsTranslationOptionFeatures->GetStored()->insert(
         std::make_pair(toptHash, outFeaturesTargetNamespace));
-
-      // get classifier score
-      losses[toptIdx] = classifier.Predict(MakeTargetLabel(targetPhrase));
     }
 
+    // get classifier scores
+    std::vector<float> losses;
+    PredictBatch(classifier, outFeaturesSourceNamespace, targetFeatureVectors, losses);
+
     // normalize classifier scores to get a probability distribution
     std::vector<float> rawLosses = losses;
     (*m_normalizer)(losses);
 
+    // Score contributions of target-only features, needed for partial scores below.
+    std::vector<float> targetOnlyLosses;
+    if (haveTargetContextFeatures) {
+      Discriminative::FeatureVector emptySource;
+      classifier.AddLabelIndependentFeatureVector(emptySource);
+      PredictBatch(classifier, emptySource, targetFeatureVectors, targetOnlyLosses);
+    }
+
     // update scores of topts
     for (size_t toptIdx = 0; toptIdx < translationOptionList.size(); toptIdx++) {
       TranslationOption *topt = *(translationOptionList.begin() + toptIdx);
@@ -362,20 +374,43 @@ void VW::EvaluateTranslationOptionListWithSourceContext(const InputType &input
 
         // Subtract the score contribution of target-only features, otherwise it would
         // be included twice.
-        Discriminative::FeatureVector emptySource;
-        const Discriminative::FeatureVector &targetFeatureVector =
-          m_tlsTranslationOptionFeatures->GetStored()->find(toptHash)->second;
-        classifier.AddLabelIndependentFeatureVector(emptySource);
-        classifier.AddLabelDependentFeatureVector(targetFeatureVector);
-        float targetOnlyLoss = classifier.Predict(VW_DUMMY_LABEL);
-
-        float futureScore = rawLosses[toptIdx] - targetOnlyLoss;
+        float futureScore = rawLosses[toptIdx] - targetOnlyLosses[toptIdx];
         m_tlsFutureScores->GetStored()->insert(std::make_pair(toptHash, futureScore));
       }
     }
   }
 }
 
+void VW::PredictBatch(Discriminative::Classifier &classifier
+                      , const Discriminative::FeatureVector &labelIndependent
+                      , const std::vector<Discriminative::FeatureVector> &labelDependent
+                      , std::vector<float> &losses) const
+{
+  if (m_predictionCacheSize == 0) {
+    classifier.PredictBatch(VW_DUMMY_LABEL, labelDependent, losses);
+    return;
+  }
+
+  VWPredictionCache &cache = *m_tlsPredictionCache->GetStored();
+  size_t key = MakePredictionCacheKey(labelIndependent, labelDependent);
+
+  boost::unordered_map<size_t, std::vector<float> >::const_iterator it = cache.losses.find(key);
+  if (it != cache.losses.end()) {
+    losses = it->second;
+    classifier.Discard(); // the features in the classifier are not needed
+    cache.hits++;
+    VERBOSE(3, "VW :: prediction cache hit\n");
+    return;
+  }
+
+  classifier.PredictBatch(VW_DUMMY_LABEL, labelDependent, losses);
+  cache.misses++;
+  if (cache.losses.size() >= m_predictionCacheSize)
+    cache.losses.clear();
+  cache.losses[key] = losses;
+  VERBOSE(3, "VW :: prediction cache miss\n");
+}
+
 void VW::SetParameter(const std::string& key, const std::string& value)
 {
   if (key == "train") {
@@ -386,6 +421,8 @@ void VW::SetParameter(const std::string& key, const std::string& value)
     m_vwOptions = value;
   } else if (key == "leave-one-out-from") {
     m_leaveOneOut = value;
+  } else if (key == "prediction-cache-size") {
+    m_predictionCacheSize = Scan<size_t>(value);
   } else if (key == "training-loss") {
     // which type of loss to use for training
     if (value == "basic") {
@@ -425,6 +462,19 @@ void VW::InitializeForInput(ttasksptr const& ttask)
   m_tlsTargetContextFeatures->GetStored()->clear();
   m_tlsTranslationOptionFeatures->GetStored()->clear();
 
+  // the prediction cache depends only on features, keep it across sentences
+#ifdef TRACE_ENABLE
+  IFVERBOSE(2) {
+    if (m_predictionCacheSize > 0) {
+      const VWPredictionCache &cache = *m_tlsPredictionCache->GetStored();
+      size_t lookups = cache.hits + cache.misses;
+      TRACE_ERR("VW :: prediction cache: " << cache.losses.size() << " entries, "
+                << cache.hits << "/" << lookups << " hits ("
+                << (lookups ? 100.0 * cache.hits / lookups : 0.0) << "%)\n");
+    }
+  }
+#endif
+
   InputType const& source = *(ttask->GetSource().get());
   // tabbed sentence is assumed only in training
   if (! m_train)
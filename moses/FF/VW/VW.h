@@ -61,6 +61,18 @@ typedef ThreadLocalByFeatureStorage<FloatHashMap> TLSFloatHashMap;
 // thread-specific hash tablei for caching full classifier outputs
 typedef ThreadLocalByFeatureStorage<boost::unordered_map<size_t, FloatHashMap> > TLSStateExtensions;
 
+// classifier losses of whole batches (all translation options of a span), keyed by a hash of
+// the features they were predicted from; kept across sentences, emptied when full
+struct VWPredictionCache {
+  VWPredictionCache() : hits(0), misses(0) {}
+
+  boost::unordered_map<size_t, std::vector<float> > losses;
+  size_t hits, misses;
+};
+
+// thread-specific prediction cache
+typedef ThreadLocalByFeatureStorage<VWPredictionCache> TLSPredictionCache;
+
 /*
  * VW feature function. A discriminative classifier with source and target context features.
  */
@@ -148,6 +160,26 @@ private:
     return key;
   }
 
+  // key of the prediction cache: the label-independent features and the label-dependent features
+  // of each class, i.e. everything the classifier output depends on
+  inline size_t MakePredictionCacheKey(const Discriminative::FeatureVector &labelIndependent
+                                       , const std::vector<Discriminative::FeatureVector> &labelDependent) const {
+    size_t key = boost::hash_range(labelIndependent.begin(), labelIndependent.end());
+    for (size_t i = 0; i < labelDependent.size(); i++) {
+      boost::hash_combine(key, labelDependent[i].size());
+      boost::hash_range(key, labelDependent[i].begin(), labelDependent[i].end());
+    }
+    return key;
+  }
+
+  // Predict the losses of all classes in labelDependent in one batch. The label-independent
+  // features must already be set in the classifier. With a prediction cache, the losses are
+  // looked up first and the classifier is only called on a miss.
+  void PredictBatch(Discriminative::Classifier &classifier
+                    , const Discriminative::FeatureVector &labelIndependent
+                    , const std::vector<Discriminative::FeatureVector> &labelDependent
+                    , std::vector<float> &losses) const;
+
   // used in decoding to transform the global word alignment information into
   // context-phrase internal alignment information (i.e., with target indices correspoding
   // to positions in contextPhrase)
@@ -185,6 +217,10 @@ private:
   // thread-specific classifier instance
   TLSClassifier *m_tlsClassifier;
 
+  // maximum number of batches in the (thread-specific) prediction cache; 0 = no caching
+  size_t m_predictionCacheSize;
+  TLSPredictionCache *m_tlsPredictionCache;
+
   // caches for partial scores and feature vectors
   TLSFloatHashMap *m_tlsFutureScores;
   TLSStateExtensions *m_tlsComputedStateExtensions;
@@ -23,10 +23,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifdef WITH_THREADS
 #include <boost/thread/locks.hpp>
 #endif
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <ostream>
 #include <string>
 #include "FactorCollection.h"
 #include "Util.h"
+#include "util/file.hh"
 #include "util/pool.hh"
 
 using namespace std;
@@ -35,8 +39,54 @@ namespace Moses
 {
 FactorCollection FactorCollection::s_instance;
 
+namespace
+{
+// File written by SaveVocab: the header, then uint64 offsets[size + 1],
+// uint8 nonTerminal[size] and the strings, each padded to 8 bytes.
+const char kVocabMagic[8] = {'m', 'o', 's', 'e', 's', 'F', 'V', '1'};
+
+struct VocabHeader {
+  char magic[8];
+  uint64_t size;
+  uint64_t bytes;
+};
+
+size_t Padded(size_t bytes)
+{
+  return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+void WritePadded(int fd, const void *data, size_t bytes)
+{
+  static const char zeros[8] = {0};
+  if (bytes) util::WriteOrThrow(fd, data, bytes);
+  if (bytes % 8) util::WriteOrThrow(fd, zeros, 8 - bytes % 8);
+}
+
+bool LessById(const Factor *a, const Factor *b)
+{
+  return a->GetId() < b->GetId();
+}
+}
+
+const Factor *FactorCollection::GetFrozen(const StringPiece &factorString, bool isNonTerminal, const std::vector<const Factor*> &table)
+{
+  if (table.empty()) return NULL;
+  const size_t mask = table.size() - 1;
+  for (size_t slot = FrozenHash(factorString, isNonTerminal) & mask; table[slot]; slot = (slot + 1) & mask) {
+    const Factor *factor = table[slot];
+    if ((factor->GetId() < moses_MaxNumNonterminals) == isNonTerminal && factor->GetString() == factorString)
+      return factor;
+  }
+  return NULL;
+}
+
 const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
 {
+  // Frozen entries need no lock at all.
+  const Factor *frozen = GetFrozen(factorString, isNonTerminal, m_frozenTable);
+  if (frozen) return frozen;
+
   FactorFriend to_ins;
   to_ins.in.m_string = factorString;
   to_ins.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
@@ -68,6 +118,9 @@ const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool
 
 const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool isNonTerminal)
 {
+  const Factor *frozen = GetFrozen(factorString, isNonTerminal, m_frozenTable);
+  if (frozen) return frozen;
+
   FactorFriend to_find;
   to_find.in.m_string = factorString;
   to_find.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
@@ -83,6 +136,97 @@ const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool
   return NULL;
 }
 
+void FactorCollection::LoadVocab(const std::string &filePath)
+{
+  UTIL_THROW_IF2(m_frozenMemory.get(), "A factor vocabulary has already been loaded");
+  util::scoped_fd fd(util::OpenReadOrThrow(filePath.c_str()));
+  util::MapRead(util::POPULATE_OR_LAZY, fd.get(), 0, util::SizeOrThrow(fd.get()), m_frozenMemory);
+  const char *base = static_cast<const char*>(m_frozenMemory.get());
+
+  VocabHeader header;
+  UTIL_THROW_IF2(m_frozenMemory.size() < sizeof(header), "Factor vocabulary " << filePath << " is truncated");
+  memcpy(&header, base, sizeof(header));
+  UTIL_THROW_IF2(memcmp(header.magic, kVocabMagic, sizeof(kVocabMagic)),
+                 filePath << " is not a factor vocabulary");
+  const uint64_t *offsets = reinterpret_cast<const uint64_t*>(base + sizeof(header));
+  const uint8_t *nonTerminal = reinterpret_cast<const uint8_t*>(offsets + header.size + 1);
+  const char *strings = reinterpret_cast<const char*>(nonTerminal) + Padded(header.size);
+  UTIL_THROW_IF2(strings + header.bytes > base + m_frozenMemory.size() || offsets[header.size] > header.bytes,
+                 "Factor vocabulary " << filePath << " is truncated");
+
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
+  // otherwise the ids of the file could not be kept
+  UTIL_THROW_IF2(!m_set.empty() || !m_setNonTerminal.empty(),
+                 "Factor vocabulary " << filePath << " must be loaded before any factor is created");
+
+  // at most half full
+  size_t capacity = 8;
+  while (capacity < 2 * header.size) capacity *= 2;
+  std::vector<const Factor*> table(capacity, NULL);
+  m_frozen.resize(header.size);
+  for (uint64_t i = 0; i < header.size; ++i) {
+    const bool isNonTerminal = nonTerminal[i];
+    Factor &factor = m_frozen[i].in;
+    factor.m_string = StringPiece(strings + offsets[i], offsets[i + 1] - offsets[i]);
+    UTIL_THROW_IF2(GetFrozen(factor.m_string, isNonTerminal, table),
+                   "Factor vocabulary " << filePath << " contains " << factor.m_string << " twice");
+    if (isNonTerminal) {
+      factor.m_id = m_factorIdNonTerminal++;
+      UTIL_THROW_IF2(m_factorIdNonTerminal >= moses_MaxNumNonterminals, "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
+    } else {
+      factor.m_id = m_factorId++;
+    }
+    size_t slot = FrozenHash(factor.m_string, isNonTerminal) & (capacity - 1);
+    while (table[slot]) slot = (slot + 1) & (capacity - 1);
+    table[slot] = &factor;
+  }
+  m_frozenTable.swap(table);
+}
+
+void FactorCollection::SaveVocab(const std::string &filePath) const
+{
+  std::vector<const Factor*> factors;
+  {
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
+    factors.reserve(m_frozen.size() + m_set.size() + m_setNonTerminal.size());
+    for (size_t i = 0; i < m_frozen.size(); ++i) factors.push_back(&m_frozen[i].in);
+    for (Set::const_iterator i = m_set.begin(); i != m_set.end(); ++i) factors.push_back(&i->in);
+    for (Set::const_iterator i = m_setNonTerminal.begin(); i != m_setNonTerminal.end(); ++i) factors.push_back(&i->in);
+  }
+  std::sort(factors.begin(), factors.end(), LessById);
+
+  VocabHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kVocabMagic, sizeof(kVocabMagic));
+  header.size = factors.size();
+  std::vector<uint64_t> offsets(1, 0);
+  std::vector<uint8_t> nonTerminal;
+  std::string strings;
+  for (size_t i = 0; i < factors.size(); ++i) {
+    const StringPiece str = factors[i]->GetString();
+    strings.append(str.data(), str.size());
+    offsets.push_back(strings.size());
+    nonTerminal.push_back(factors[i]->GetId() < moses_MaxNumNonterminals);
+  }
+  header.bytes = strings.size();
+
+  // The file may be the one this collection has mapped, so it is replaced
+  // rather than overwritten.
+  const std::string tempPath = filePath + ".tmp";
+  {
+    util::scoped_fd fd(util::CreateOrThrow(tempPath.c_str()));
+    util::WriteOrThrow(fd.get(), &header, sizeof(header));
+    WritePadded(fd.get(), &offsets[0], offsets.size() * sizeof(uint64_t));
+    WritePadded(fd.get(), nonTerminal.empty() ? NULL : &nonTerminal[0], nonTerminal.size());
+    WritePadded(fd.get(), strings.data(), strings.size());
+  }
+  UTIL_THROW_IF(std::rename(tempPath.c_str(), filePath.c_str()), util::ErrnoException,
+                "while renaming " << tempPath << " to " << filePath);
+}
 
 FactorCollection::~FactorCollection() {}
 
@@ -94,6 +238,9 @@ ostream& operator<<(ostream& out, const FactorCollection& factorCollection)
 #ifdef WITH_THREADS
   boost::shared_lock<boost::shared_mutex> lock(factorCollection.m_accessLock);
 #endif
+  for (size_t i = 0; i < factorCollection.m_frozen.size(); ++i) {
+    if (factorCollection.m_frozen[i].in.GetId() < moses_MaxNumNonterminals) out << factorCollection.m_frozen[i].in;
+  }
   for (FactorCollection::Set::const_iterator i = factorCollection.m_set.begin(); i != factorCollection.m_set.end(); ++i) {
     out << i->in;
   }
@@ -36,7 +36,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <functional>
 #include <string>
+#include <vector>
 
+#include "util/mmap.hh"
 #include "util/string_piece.hh"
 #include "util/pool.hh"
 #include "Factor.h"
@@ -44,6 +46,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 namespace Moses
 {
 
+class FactorCollectionTest;
+
 /** We don't want Factor to be copyable by anybody.  But we also want to store
  * it in an STL container.  The solution is that Factor's copy constructor is
  * private and friended to FactorFriend.  The STL containers can delegate
@@ -66,6 +70,7 @@ struct FactorFriend {
 class FactorCollection
 {
   friend std::ostream& operator<<(std::ostream&, const FactorCollection&);
+  friend class FactorCollectionTest;
 
   struct HashFactor : public std::unary_function<const FactorFriend &, std::size_t> {
     std::size_t operator()(const FactorFriend &factor) const {
@@ -83,6 +88,19 @@ class FactorCollection
 
   util::Pool m_string_backing;
 
+  /* Frozen vocabulary from LoadVocab().  It is only written before decoding
+   * starts, so it is searched without taking m_accessLock.  Its factors are
+   * not in m_set/m_setNonTerminal, and their strings point into the mapped
+   * file. */
+  util::scoped_memory m_frozenMemory;
+  std::vector<FactorFriend> m_frozen; /**< in file order */
+  std::vector<const Factor*> m_frozenTable; /**< open addressing, NULL for empty slots */
+
+  static std::size_t FrozenHash(const StringPiece &factorString, bool isNonTerminal) {
+    return util::MurmurHashNative(factorString.data(), factorString.size(), isNonTerminal);
+  }
+  static const Factor *GetFrozen(const StringPiece &factorString, bool isNonTerminal, const std::vector<const Factor*> &table);
+
   static FactorCollection s_instance;
 #ifdef WITH_THREADS
   //reader-writer lock
@@ -116,6 +134,31 @@ public:
 
   const Factor *GetFactor(const StringPiece &factorString, bool isNonTerminal = false);
 
+  /** map a vocabulary written by SaveVocab() and add all of its strings,
+   *  with the ids they had when the file was saved.  Lookups of these
+   *  strings take no lock.  Must be called before any factor is added (it
+   *  throws otherwise), i.e. before models are loaded and before any other
+   *  thread uses the collection.
+   */
+  void LoadVocab(const std::string &filePath);
+
+  //! write all factors, in id order, in the format read by LoadVocab()
+  void SaveVocab(const std::string &filePath) const;
+
+  //! number of strings in the vocabulary given to LoadVocab()
+  size_t GetNumFrozen() const {
+    return m_frozen.size();
+  }
+
+  /** factor of the index-th string in the vocabulary given to LoadVocab().
+   *  Meant for loaders whose binary formats store these indices instead of
+   *  strings; no loader does so yet, so for now the vocabulary only saves
+   *  the locking and the string copies of the words it contains.
+   */
+  const Factor *GetFrozenFactor(size_t index) const {
+    return &m_frozen[index].in;
+  }
+
   // TODO: remove calls to this function, replacing them with the simpler AddFactor(factorString)
   const Factor *AddFactor(FactorDirection /*direction*/, FactorType /*factorType*/, const StringPiece &factorString, bool isNonTerminal = false) {
     return AddFactor(factorString, isNonTerminal);
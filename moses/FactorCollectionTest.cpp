@@ -0,0 +1,138 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2010- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+
+#include "FactorCollection.h"
+#include "util/exception.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+// FactorCollection::Instance() is shared by all tests and already has
+// factors, so the tests use collections of their own.
+class FactorCollectionTest
+{
+public:
+  FactorCollectionTest()
+    : m_file((boost::filesystem::temp_directory_path() /
+              boost::filesystem::unique_path("factor-vocab-%%%%-%%%%")).string()) {}
+
+  ~FactorCollectionTest() {
+    boost::filesystem::remove(m_file);
+  }
+
+  static FactorCollection *Create() {
+    return new FactorCollection();
+  }
+
+  const string &File() const {
+    return m_file;
+  }
+
+private:
+  string m_file;
+};
+
+}
+
+using namespace Moses;
+
+BOOST_AUTO_TEST_SUITE(factor_collection)
+
+BOOST_AUTO_TEST_CASE(vocab_round_trip)
+{
+  FactorCollectionTest test;
+  boost::scoped_ptr<FactorCollection> saved(FactorCollectionTest::Create());
+  const char *terminals[] = {"the", "house", "Haus", "X"};
+  const char *nonTerminals[] = {"X", "S"};
+  for (size_t i = 0; i < 4; ++i) saved->AddFactor(terminals[i]);
+  for (size_t i = 0; i < 2; ++i) saved->AddFactor(nonTerminals[i], true);
+  saved->SaveVocab(test.File());
+
+  boost::scoped_ptr<FactorCollection> loaded(FactorCollectionTest::Create());
+  loaded->LoadVocab(test.File());
+  BOOST_REQUIRE_EQUAL(loaded->GetNumFrozen(), (size_t)6);
+  BOOST_CHECK_EQUAL(loaded->GetNumNonTerminals(), (size_t)2);
+  for (size_t i = 0; i < 4; ++i) {
+    const Factor *factor = loaded->GetFactor(terminals[i]);
+    BOOST_REQUIRE(factor);
+    BOOST_CHECK_EQUAL(factor->GetString(), terminals[i]);
+    BOOST_CHECK_EQUAL(factor->GetId(), saved->GetFactor(terminals[i])->GetId());
+    // no new factor for a string of the vocabulary
+    BOOST_CHECK_EQUAL(loaded->AddFactor(terminals[i]), factor);
+  }
+  for (size_t i = 0; i < 2; ++i) {
+    const Factor *factor = loaded->GetFactor(nonTerminals[i], true);
+    BOOST_REQUIRE(factor);
+    BOOST_CHECK_EQUAL(factor->GetId(), saved->GetFactor(nonTerminals[i], true)->GetId());
+  }
+  // the terminal and the non-terminal X stay apart
+  BOOST_CHECK(loaded->GetFactor("X") != loaded->GetFactor("X", true));
+  // in id order, non-terminals first
+  for (size_t i = 1; i < loaded->GetNumFrozen(); ++i) {
+    BOOST_CHECK_LT(loaded->GetFrozenFactor(i - 1)->GetId(), loaded->GetFrozenFactor(i)->GetId());
+  }
+
+  // new factors get the ids after those of the vocabulary, and are saved
+  // with it, also over the file the collection has mapped
+  BOOST_CHECK(!loaded->GetFactor("garden"));
+  const Factor *garden = loaded->AddFactor("garden");
+  BOOST_CHECK_EQUAL(garden->GetId(), saved->AddFactor("garden")->GetId());
+  loaded->SaveVocab(test.File());
+
+  boost::scoped_ptr<FactorCollection> reloaded(FactorCollectionTest::Create());
+  reloaded->LoadVocab(test.File());
+  BOOST_CHECK_EQUAL(reloaded->GetNumFrozen(), (size_t)7);
+  BOOST_REQUIRE(reloaded->GetFactor("garden"));
+  BOOST_CHECK_EQUAL(reloaded->GetFactor("garden")->GetId(), garden->GetId());
+  BOOST_CHECK_EQUAL(reloaded->GetFactor("S", true)->GetId(), loaded->GetFactor("S", true)->GetId());
+}
+
+BOOST_AUTO_TEST_CASE(vocab_load_errors)
+{
+  FactorCollectionTest test;
+  boost::scoped_ptr<FactorCollection> saved(FactorCollectionTest::Create());
+  saved->AddFactor("the");
+  saved->SaveVocab(test.File());
+
+  // ids of the file could not be kept
+  boost::scoped_ptr<FactorCollection> used(FactorCollectionTest::Create());
+  used->AddFactor("house");
+  BOOST_CHECK_THROW(used->LoadVocab(test.File()), util::Exception);
+
+  boost::scoped_ptr<FactorCollection> twice(FactorCollectionTest::Create());
+  twice->LoadVocab(test.File());
+  BOOST_CHECK_THROW(twice->LoadVocab(test.File()), util::Exception);
+
+  {
+    ofstream out(test.File().c_str());
+    out << "the house\n";
+  }
+  boost::scoped_ptr<FactorCollection> text(FactorCollectionTest::Create());
+  BOOST_CHECK_THROW(text->LoadVocab(test.File()), util::Exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
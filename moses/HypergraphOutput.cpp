@@ -20,6 +20,7 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -27,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/format.hpp>
 #include <boost/iostreams/device/file.hpp>
 #include <boost/iostreams/filter/bzip2.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
@@ -36,6 +38,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "ChartHypothesisCollection.h"
 #include "ChartManager.h"
+#include "FF/FeatureFunction.h"
 #include "HypergraphOutput.h"
 #include "Manager.h"
 
@@ -47,6 +50,61 @@ namespace Moses
 template class HypergraphOutput<Manager>;
 template class HypergraphOutput<ChartManager>;
 
+namespace
+{
+
+// The winning hypothesis, followed by its reachable recombined hypotheses.
+void GetIncomingEdges(const ChartHypothesis* mainHypo,
+                      const map<unsigned, bool> &reachable,
+                      vector<const ChartHypothesis*>& edges)
+{
+  edges.clear();
+  edges.push_back(mainHypo);
+  const ChartArcList *arcList = mainHypo->GetArcList();
+  if (arcList) {
+    ChartArcList::const_iterator iterArc;
+    for (iterArc = arcList->begin(); iterArc != arcList->end(); ++iterArc) {
+      const ChartHypothesis* arc = *iterArc;
+      if (reachable.find(arc->GetId()) != reachable.end()) {
+        edges.push_back(arc);
+      }
+    }
+  }
+}
+
+// Must match the reader in mert/Hypergraph.cpp
+const char kBinaryMagic[8] = {'m', 'o', 's', 'e', 's', 'H', 'G', '1'};
+const boost::uint32_t kBinaryNonTerminal = 0xffffffff;
+
+struct BinaryHeader {
+  char magic[8];
+  boost::uint64_t vertices;
+  boost::uint64_t edges;
+  boost::uint64_t words;
+  boost::uint64_t children;
+  boost::uint64_t features;
+  boost::uint64_t vocab_size;
+  boost::uint64_t vocab_bytes;
+  boost::uint64_t names_size;
+  boost::uint64_t names_bytes;
+};
+
+// every array starts at a multiple of 8 bytes
+void WritePadded(ostream& out, const void* data, size_t bytes)
+{
+  static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  out.write(reinterpret_cast<const char*>(data), bytes);
+  out.write(zeros, ((bytes + 7) & ~size_t(7)) - bytes);
+}
+
+template <class T>
+void WriteArray(ostream& out, const vector<T>& v)
+{
+  WritePadded(out, v.empty() ? NULL : &v[0], v.size() * sizeof(T));
+}
+
+} // namespace
+
 void
 ChartSearchGraphWriterMoses::
 WriteHypos(const ChartHypothesisCollection& hypos,
@@ -99,17 +157,7 @@ WriteHypos(const ChartHypothesisCollection& hypos,
     m_hypoIdToNodeId[mainHypo->GetId()] = m_nodeId;
     ++m_nodeId;
     vector<const ChartHypothesis*> edges;
-    edges.push_back(mainHypo);
-    const ChartArcList *arcList = (*iter)->GetArcList();
-    if (arcList) {
-      ChartArcList::const_iterator iterArc;
-      for (iterArc = arcList->begin(); iterArc != arcList->end(); ++iterArc) {
-        const ChartHypothesis* arc = *iterArc;
-        if (reachable.find(arc->GetId()) != reachable.end()) {
-          edges.push_back(arc);
-        }
-      }
-    }
+    GetIncomingEdges(mainHypo, reachable, edges);
     (*m_out) << edges.size() << endl;
     for (vector<const ChartHypothesis*>::const_iterator ei = edges.begin();
          ei != edges.end(); ++ei) {
@@ -141,6 +189,140 @@ WriteHypos(const ChartHypothesisCollection& hypos,
   }
 }
 
+ChartSearchGraphWriterBinaryHypergraph::
+ChartSearchGraphWriterBinaryHypergraph(AllOptions::ptr const& opts, ostream* out)
+  : ChartSearchGraphWriter(opts), m_out(out)
+{
+  m_vertexEdges.push_back(0);
+  m_edgeWords.push_back(0);
+  m_edgeChildren.push_back(0);
+  m_edgeFeatures.push_back(0);
+}
+
+boost::uint32_t
+ChartSearchGraphWriterBinaryHypergraph::
+Intern(const string& str, StringIds& ids, string& strings)
+{
+  pair<StringIds::iterator, bool> ret = ids.insert(make_pair(str, static_cast<boost::uint32_t>(ids.size())));
+  if (ret.second) {
+    strings.append(str);
+    strings.push_back('\0');
+  }
+  return ret.first->second;
+}
+
+void
+ChartSearchGraphWriterBinaryHypergraph::
+WriteHeader(size_t winners, size_t losers) const
+{
+  m_vertexEdges.reserve(winners + 1);
+  m_sourceCovered.reserve(winners);
+  m_edgeWords.reserve(winners + losers + 1);
+  m_edgeChildren.reserve(winners + losers + 1);
+  m_edgeFeatures.reserve(winners + losers + 1);
+
+  // dense feature names, as written by ScoreComponentCollection::Save()
+  m_denseNames.clear();
+  const vector<FeatureFunction*>& ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    const string& name = ffs[i]->GetScoreProducerDescription();
+    size_t index = ffs[i]->GetIndex();
+    size_t count = ffs[i]->GetNumScoreComponents();
+    for (size_t k = 0; k < count; ++k) {
+      string fullName = count == 1 ? name : str(boost::format("%s_%d") % name % (k + 1));
+      m_denseNames.push_back(make_pair(index + k, Intern(fullName, m_nameIds, m_names)));
+    }
+  }
+}
+
+void
+ChartSearchGraphWriterBinaryHypergraph::
+WriteHypos(const ChartHypothesisCollection& hypos,
+           const map<unsigned, bool> &reachable) const
+{
+  vector<const ChartHypothesis*> edges;
+  ChartHypothesisCollection::const_iterator iter;
+  for (iter = hypos.begin() ; iter != hypos.end() ; ++iter) {
+    const ChartHypothesis* mainHypo = *iter;
+    if (!m_options->output.DontPruneSearchGraph &&
+        reachable.find(mainHypo->GetId()) == reachable.end()) {
+      //Ignore non reachable nodes
+      continue;
+    }
+    m_hypoIdToNodeId[mainHypo->GetId()] = m_sourceCovered.size();
+    m_sourceCovered.push_back(mainHypo->GetCurrSourceRange().GetNumWordsCovered());
+    GetIncomingEdges(mainHypo, reachable, edges);
+    for (vector<const ChartHypothesis*>::const_iterator ei = edges.begin();
+         ei != edges.end(); ++ei) {
+      const ChartHypothesis* hypo = *ei;
+      const TargetPhrase& target = hypo->GetCurrTargetPhrase();
+      size_t ntIndex = 0;
+      for (size_t i = 0; i < target.GetSize(); ++i) {
+        const Word& word = target.GetWord(i);
+        if (word.IsNonTerminal()) {
+          size_t hypoId = hypo->GetPrevHypos()[ntIndex++]->GetId();
+          m_words.push_back(kBinaryNonTerminal);
+          m_children.push_back(m_hypoIdToNodeId[hypoId]);
+        } else {
+          m_words.push_back(Intern(word.GetFactor(0)->GetString().as_string(), m_vocabIds, m_vocab));
+        }
+      }
+      m_edgeWords.push_back(m_words.size());
+      m_edgeChildren.push_back(m_children.size());
+
+      ScoreComponentCollection scores = hypo->GetScoreBreakdown();
+      HypoList::const_iterator hi;
+      for (hi = hypo->GetPrevHypos().begin(); hi != hypo->GetPrevHypos().end(); ++hi) {
+        scores.MinusEquals((*hi)->GetScoreBreakdown());
+      }
+      const FVector& values = scores.GetScoresVector();
+      for (size_t i = 0; i < m_denseNames.size(); ++i) {
+        m_featureNames.push_back(m_denseNames[i].second);
+        m_featureValues.push_back(values[m_denseNames[i].first]);
+      }
+      for (FVector::const_iterator fi = values.cbegin(); fi != values.cend(); ++fi) {
+        m_featureNames.push_back(Intern(fi->first.name(), m_nameIds, m_names));
+        m_featureValues.push_back(fi->second);
+      }
+      m_edgeFeatures.push_back(m_featureNames.size());
+    }
+    m_vertexEdges.push_back(m_edgeWords.size() - 1);
+  }
+}
+
+void
+ChartSearchGraphWriterBinaryHypergraph::
+Flush() const
+{
+  BinaryHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+  header.vertices = m_sourceCovered.size();
+  header.edges = m_edgeWords.size() - 1;
+  header.words = m_words.size();
+  header.children = m_children.size();
+  header.features = m_featureNames.size();
+  header.vocab_size = m_vocabIds.size();
+  header.vocab_bytes = m_vocab.size();
+  header.names_size = m_nameIds.size();
+  header.names_bytes = m_names.size();
+  m_out->write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  WriteArray(*m_out, m_vertexEdges);
+  WriteArray(*m_out, m_edgeWords);
+  WriteArray(*m_out, m_edgeChildren);
+  WriteArray(*m_out, m_sourceCovered);
+  WriteArray(*m_out, m_words);
+  WriteArray(*m_out, m_children);
+
+  WriteArray(*m_out, m_edgeFeatures);
+  WriteArray(*m_out, m_featureNames);
+  WriteArray(*m_out, m_featureValues);
+
+  WritePadded(*m_out, m_vocab.data(), m_vocab.size());
+  WritePadded(*m_out, m_names.data(), m_names.size());
+  m_out->flush();
+}
 
 } //namespace Moses
 
@@ -23,7 +23,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_Hypergraph_Output_h
 #define moses_Hypergraph_Output_h
 
+#include <map>
 #include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+
 #include "moses/parameters/AllOptions.h"
 
 /**
@@ -103,5 +110,45 @@ private:
   mutable std::map<size_t,size_t> m_hypoIdToNodeId;
 };
 
+/**
+ * The same hypergraph in a binary format which mert maps into memory instead
+ * of parsing (see ReadBinaryGraph in mert/Hypergraph.cpp for the layout).
+ * The graph is buffered, and written out by Flush().
+**/
+class ChartSearchGraphWriterBinaryHypergraph : public virtual ChartSearchGraphWriter
+{
+public:
+  ChartSearchGraphWriterBinaryHypergraph(AllOptions::ptr const& opts, std::ostream* out);
+  virtual void WriteHeader(size_t winners, size_t losers) const;
+  virtual void WriteHypos(const ChartHypothesisCollection& hypos,
+                          const std::map<unsigned, bool> &reachable) const;
+  /** Write the graph; call after the last WriteHypos(). */
+  void Flush() const;
+
+private:
+  typedef boost::unordered_map<std::string, boost::uint32_t> StringIds;
+  static boost::uint32_t Intern(const std::string& str, StringIds& ids, std::string& strings);
+
+  std::ostream* m_out;
+  mutable std::map<size_t,size_t> m_hypoIdToNodeId;
+  // dense feature index and name id
+  mutable std::vector<std::pair<size_t, boost::uint32_t> > m_denseNames;
+
+  // topology
+  mutable std::vector<boost::uint64_t> m_vertexEdges;
+  mutable std::vector<boost::uint64_t> m_edgeWords;
+  mutable std::vector<boost::uint64_t> m_edgeChildren;
+  mutable std::vector<boost::uint32_t> m_sourceCovered;
+  mutable std::vector<boost::uint32_t> m_words;
+  mutable std::vector<boost::uint32_t> m_children;
+  // features
+  mutable std::vector<boost::uint64_t> m_edgeFeatures;
+  mutable std::vector<boost::uint32_t> m_featureNames;
+  mutable std::vector<float> m_featureValues;
+  // NUL-terminated strings
+  mutable StringIds m_vocabIds, m_nameIds;
+  mutable std::string m_vocab, m_names;
+};
+
 }
 #endif
@@ -154,9 +154,14 @@ IOWrapper::IOWrapper(AllOptions const& opts)
   } else fmt = boost::filesystem::current_path().string() + "/hypergraph";
   if (*fmt.rbegin() != '/') fmt += "/";
   std::string extension = (p && p->size() > 1 ? p->at(1) : std::string("txt"));
-  UTIL_THROW_IF2(extension != "txt" && extension != "gz" && extension != "bz2",
+  UTIL_THROW_IF2(extension != "txt" && extension != "gz" && extension != "bz2"
+                 && extension != "bin",
                  "Unknown compression type '" << extension
                  << "' for hypergraph output!");
+  // only the chart decoder (ChartManager) writes binary hypergraphs
+  UTIL_THROW_IF2(extension == "bin" && m_options->search.algo != CYKPlus,
+                 "Binary hypergraph output is only implemented for chart "
+                 "decoding (search-algorithm 3)!");
   fmt += string("%d.") + extension;
 
   // input streams for simulated post-editing
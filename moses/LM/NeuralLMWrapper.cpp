@@ -1,6 +1,8 @@
-
 #include "moses/StaticData.h"
 #include "moses/FactorCollection.h"
+#include "moses/Hypothesis.h"
+#include "moses/ChartHypothesis.h"
+#include "moses/ScoreComponentCollection.h"
 #include <boost/functional/hash.hpp>
 #include "NeuralLMWrapper.h"
 #include "neuralLM.h"
@@ -11,6 +13,7 @@ namespace Moses
 {
 NeuralLMWrapper::NeuralLMWrapper(const std::string &line)
   :LanguageModelSingleFactor(line)
+  ,m_batchSize(0)
 {
   ReadParameters();
 }
@@ -22,6 +25,16 @@ NeuralLMWrapper::~NeuralLMWrapper()
 }
 
 
+void NeuralLMWrapper::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "batch-size") {
+    m_batchSize = Scan<size_t>(value);
+  } else {
+    LanguageModelSingleFactor::SetParameter(key, value);
+  }
+}
+
+
 void NeuralLMWrapper::Load(AllOptions::ptr const& opts)
 {
 
@@ -39,34 +52,84 @@ void NeuralLMWrapper::Load(AllOptions::ptr const& opts)
   m_neuralLM_shared->set_cache(1000000);
 
   m_unk = m_neuralLM_shared->lookup_word("<unk>");
+  m_start = m_neuralLM_shared->lookup_word("<s>");
+  m_null = m_neuralLM_shared->lookup_word("<null>");
 
   UTIL_THROW_IF2(m_nGramOrder != m_neuralLM_shared->get_order(),
                  "Wrong order of neuralLM: LM has " << m_neuralLM_shared->get_order() << ", but Moses expects " << m_nGramOrder);
 
+  // resolve the whole vocabulary once, so that lookups don't go through strings
+  const std::vector<std::string> &words = m_neuralLM_shared->get_vocabulary().words();
+  for (size_t i = 0; i < words.size(); ++i) {
+    const Factor *factor = factorCollection.AddFactor(Output, m_factorType, words[i]);
+    if (factor->GetId() >= m_factorToNeuralId.size()) {
+      m_factorToNeuralId.resize(factor->GetId() + 1, -1);
+    }
+    m_factorToNeuralId[factor->GetId()] = m_neuralLM_shared->lookup_word(words[i]);
+  }
 }
 
 
-LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, State* finalState) const
+nplm::neuralLM &NeuralLMWrapper::GetThreadLM() const
 {
-
   if (!m_neuralLM.get()) {
     m_neuralLM.reset(new nplm::neuralLM(*m_neuralLM_shared));
     //TODO: config option?
     m_neuralLM->set_cache(1000000);
   }
+  return *m_neuralLM;
+}
+
+
+NeuralLMWrapper::BatchCache &NeuralLMWrapper::GetBatchCache() const
+{
+  if (!m_batchCache.get()) {
+    m_batchCache.reset(new BatchCache);
+  }
+  return *m_batchCache;
+}
+
+
+int NeuralLMWrapper::GetNeuralId(const Factor *factor) const
+{
+  if (factor->GetId() < m_factorToNeuralId.size()) {
+    int id = m_factorToNeuralId[factor->GetId()];
+    if (id >= 0) return id;
+  }
+  // not a vocabulary word: same string lookup for all of them, which may
+  // still map the word, e.g. through digit normalisation
+  return GetThreadLM().lookup_word(factor->GetString().as_string());
+}
+
+
+LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, State* finalState) const
+{
   size_t hashCode = 0;
 
   vector<int> words(contextFactor.size());
   for (size_t i=0, n=contextFactor.size(); i<n; i++) {
     const Word* word = contextFactor[i];
     const Factor* factor = word->GetFactor(m_factorType);
-    const std::string string = factor->GetString().as_string();
-    int neuralLM_wordID = m_neuralLM->lookup_word(string);
+    int neuralLM_wordID = GetNeuralId(factor);
     words[i] = neuralLM_wordID;
     boost::hash_combine(hashCode, neuralLM_wordID);
   }
 
-  double value = m_neuralLM->lookup_ngram(words);
+  double value;
+  BatchCache *cache = m_batchCache.get();
+  if (cache && cache->recording) {
+    if (cache->scores.insert(std::make_pair(words, 0.0f)).second) {
+      cache->pending.push_back(words);
+    }
+    value = 0;
+  } else {
+    boost::unordered_map<std::vector<int>, float>::const_iterator iter;
+    if (cache && (iter = cache->scores.find(words)) != cache->scores.end()) {
+      value = iter->second;
+    } else {
+      value = GetThreadLM().lookup_ngram(words);
+    }
+  }
 
   // Create a new struct to hold the result
   LMResult ret;
@@ -78,6 +141,94 @@ LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, Sta
   return ret;
 }
 
+
+size_t NeuralLMWrapper::GetStatefulIndex() const
+{
+  const std::vector<const StatefulFeatureFunction*> &ffs
+  = StatefulFeatureFunction::GetStatefulFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    if (ffs[i] == this) return i;
+  }
+  UTIL_THROW2("Feature function " << GetScoreProducerDescription() << " is not registered");
+}
+
+
+// Runs the forward pass over all n-grams collected while recording, in
+// matrix-matrix products of at most m_batchSize columns.
+void NeuralLMWrapper::ScorePendingNGrams() const
+{
+  BatchCache &cache = GetBatchCache();
+  nplm::neuralLM &lm = GetThreadLM();
+  const size_t order = m_nGramOrder;
+
+  for (size_t start = 0; start < cache.pending.size(); start += m_batchSize) {
+    const size_t width = std::min(m_batchSize, cache.pending.size() - start);
+    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> ngrams(order, width);
+    Eigen::Matrix<double, Eigen::Dynamic, 1> logProbs(width);
+
+    for (size_t col = 0; col < width; ++col) {
+      const std::vector<int> &words = cache.pending[start + col];
+      // pad short n-grams the way nplm::neuralLM::lookup_ngram() does
+      const size_t pad = order - words.size();
+      for (size_t row = 0; row < order; ++row) {
+        if (row < pad) {
+          ngrams(row, col) = (words[0] == m_start) ? m_start : m_null;
+        } else {
+          ngrams(row, col) = words[row - pad];
+        }
+      }
+    }
+
+    lm.set_width(width);
+    lm.lookup_ngram(ngrams, logProbs);
+
+    for (size_t col = 0; col < width; ++col) {
+      cache.scores[cache.pending[start + col]] = logProbs(col);
+    }
+  }
+  lm.set_width(1);
+  cache.pending.clear();
+}
+
+
+void NeuralLMWrapper::EvaluateWhenAppliedBatch(const std::vector<Hypothesis*> &batch) const
+{
+  BatchCache &cache = GetBatchCache();
+  cache.scores.clear();
+
+  // dry run of the regular scoring to find out which n-grams are needed
+  const size_t featureID = GetStatefulIndex();
+  ScoreComponentCollection scratch;
+  cache.recording = true;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const Hypothesis &hypo = *batch[i];
+    const Hypothesis *prevHypo = hypo.GetPrevHypo();
+    const FFState *prevState = prevHypo ? prevHypo->GetFFState(featureID) : NULL;
+    delete EvaluateWhenApplied(hypo, prevState, &scratch);
+  }
+  cache.recording = false;
+
+  ScorePendingNGrams();
+}
+
+
+void NeuralLMWrapper::EvaluateWhenAppliedBatch(const std::vector<ChartHypothesis*> &batch) const
+{
+  BatchCache &cache = GetBatchCache();
+  cache.scores.clear();
+
+  const size_t featureID = GetStatefulIndex();
+  ScoreComponentCollection scratch;
+  cache.recording = true;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    delete EvaluateWhenApplied(*batch[i], featureID, &scratch);
+  }
+  cache.recording = false;
+
+  ScorePendingNGrams();
+}
+
 }
 
 
+
@@ -3,6 +3,7 @@
 #include "SingleFactor.h"
 
 #include <boost/thread/tss.hpp>
+#include <boost/unordered_map.hpp>
 
 namespace nplm
 {
@@ -20,6 +21,31 @@ protected:
   // thread-specific nplm for thread-safety
   mutable boost::thread_specific_ptr<nplm::neuralLM> m_neuralLM;
   int m_unk;
+  int m_start;
+  int m_null;
+
+  // nplm word ids of the vocabulary words, indexed by Factor::GetId(); -1
+  // for factors that are not in the vocabulary
+  std::vector<int> m_factorToNeuralId;
+
+  // maximum number of n-grams per forward pass; 0 disables batching
+  size_t m_batchSize;
+
+  // per-thread scores of the current batch. While recording, GetValue()
+  // only collects the n-grams it is asked for.
+  struct BatchCache {
+    bool recording;
+    std::vector<std::vector<int> > pending;
+    boost::unordered_map<std::vector<int>, float> scores;
+    BatchCache() : recording(false) {}
+  };
+  mutable boost::thread_specific_ptr<BatchCache> m_batchCache;
+
+  nplm::neuralLM &GetThreadLM() const;
+  BatchCache &GetBatchCache() const;
+  int GetNeuralId(const Factor *factor) const;
+  size_t GetStatefulIndex() const;
+  void ScorePendingNGrams() const;
 
 public:
   NeuralLMWrapper(const std::string &line);
@@ -29,12 +55,19 @@ public:
 
   virtual void Load(AllOptions::ptr const& opts);
 
-};
+  void SetParameter(const std::string& key, const std::string& value);
 
+  bool SupportsBatchedEvaluation() const {
+    return m_batchSize > 0;
+  }
 
-} // namespace
+  void EvaluateWhenAppliedBatch(const std::vector<Hypothesis*> &batch) const;
+  void EvaluateWhenAppliedBatch(const std::vector<ChartHypothesis*> &batch) const;
 
+};
 
 
+} // namespace
+
 
 
@@ -9,16 +9,129 @@
 
 #include "LatticeMBR.h"
 #include "moses/StaticData.h"
+#include "util/murmur_hash.hh"
 #include <algorithm>
 #include <set>
+#include <boost/functional/hash.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
 
 using namespace std;
 
 namespace Moses
 {
 
-size_t bleu_order = 4;
+const size_t bleu_order = 4;
 float UNKNGRAMLOGPROB = -20;
+
+namespace
+{
+
+/** An n-gram ending in an edge, with one path of edges that it spans.  The
+ * path is only kept as what scoring needs: the tail of its first edge and the
+ * sum of its edge scores.
+ */
+struct NgramPath {
+  NgramHash hash;
+  uint64_t pathHash; //< hash of the edge ids on the path
+  uint64_t words[bleu_order]; //< word hashes
+  size_t order;
+  size_t tail;
+  float score;
+  size_t count;
+
+  bool operator<(const NgramPath &other) const {
+    return hash < other.hash || (hash == other.hash && pathHash < other.pathHash);
+  }
+};
+
+/** Buffers reused by each sentence a thread decodes */
+struct LatticeMBRScratch {
+  MBRLattice lattice;
+  NgramTable ngramScores;
+  NgramTable vertexNgrams;
+  std::vector<float> forwardScore;
+  std::vector<uint64_t> wordHashes;
+  std::vector<size_t> wordBegin; //< per edge, into wordHashes
+  std::vector<NgramPath> paths;
+  std::vector<size_t> pathBegin; //< per edge, into paths
+  std::vector<NgramTable::Entry> vertexScores;
+  std::vector<size_t> vertexBegin; //< per vertex, into vertexScores
+  ForwardBackwardSearchGraph searchGraph;
+  std::vector<NgramCount> counts;
+};
+
+#ifdef WITH_THREADS
+boost::thread_specific_ptr<LatticeMBRScratch> s_scratch;
+#else
+boost::scoped_ptr<LatticeMBRScratch> s_scratch;
+#endif
+
+LatticeMBRScratch &GetScratch()
+{
+  if (!s_scratch.get()) {
+    s_scratch.reset(new LatticeMBRScratch);
+  }
+  return *s_scratch;
+}
+
+inline NgramHash HashNgram(const uint64_t *wordHashes, size_t order)
+{
+  NgramHash ret = util::MurmurHashNative(wordHashes, order * sizeof(uint64_t), order);
+  return ret ? ret : 1;
+}
+
+inline uint64_t HashPath(uint64_t pathHash, size_t edge)
+{
+  size_t seed = pathHash;
+  boost::hash_combine(seed, edge);
+  return seed;
+}
+
+struct NgramCountCmp {
+  bool operator()(const NgramCount &a, const NgramCount &b) const {
+    return a.hash < b.hash;
+  }
+};
+
+struct NgramPathHashCmp {
+  bool operator()(const NgramPath &a, NgramHash b) const {
+    return a.hash < b;
+  }
+};
+
+/** Orders indices of hyps by their estimated score */
+struct IndexScoreCmp {
+  explicit IndexScoreCmp(const vector<float> &scores) : m_scores(scores) {}
+  bool operator()(size_t a, size_t b) const {
+    return m_scores[a] < m_scores[b];
+  }
+  const vector<float> &m_scores;
+};
+
+/** Orders indices of hyps by source word coverage */
+struct IndexCoverageCmp {
+  explicit IndexCoverageCmp(const Lattice &hyps) : m_hyps(hyps) {}
+  bool operator()(size_t a, size_t b) const {
+    return ascendingCoverageCmp(m_hyps[a], m_hyps[b]);
+  }
+  const Lattice &m_hyps;
+};
+
+struct PrunedEdge {
+  PrunedEdge(size_t tail, size_t head, float score, const Phrase &words)
+    : tail(tail), head(head), score(score), words(&words) {}
+  size_t tail;
+  size_t head;
+  float score;
+  const Phrase *words;
+};
+
+}
+
 void GetOutputWords(const TrellisPath &path, vector <Word> &translation)
 {
   const std::vector<const Hypothesis *> &edges = path.GetEdges();
@@ -35,45 +148,126 @@ void GetOutputWords(const TrellisPath &path, vector <Word> &translation)
 }
 
 
-void extract_ngrams(const vector<Word >& sentence, map < Phrase, int >  & allngrams)
+void extract_ngrams(const vector<Word >& sentence, vector<NgramCount>& allngrams)
 {
-  for (int k = 0; k < (int)bleu_order; k++) {
-    for(int i =0; i < max((int)sentence.size()-k,0); i++) {
-      Phrase ngram( k+1);
-      for ( int j = i; j<= i+k; j++) {
-        ngram.AddWord(sentence[j]);
-      }
-      ++allngrams[ngram];
+  vector<uint64_t> words(sentence.size());
+  for (size_t i = 0; i < sentence.size(); ++i) {
+    words[i] = sentence[i].hash();
+  }
+  allngrams.clear();
+  for (size_t k = 0; k < bleu_order; k++) {
+    for (size_t i = 0; i + k < sentence.size(); i++) {
+      NgramCount ngram;
+      ngram.hash = HashNgram(&words[i], k + 1);
+      ngram.order = k + 1;
+      ngram.count = 1;
+      allngrams.push_back(ngram);
+    }
+  }
+
+  // sort by hash and merge repeated n-grams
+  std::sort(allngrams.begin(), allngrams.end(), NgramCountCmp());
+  size_t out = 0;
+  for (size_t i = 0; i < allngrams.size(); ++i) {
+    if (out && allngrams[out - 1].hash == allngrams[i].hash) {
+      ++allngrams[out - 1].count;
+    } else {
+      allngrams[out++] = allngrams[i];
     }
   }
+  allngrams.resize(out);
 }
 
+void NgramTable::Clear()
+{
+  for (vector<size_t>::const_iterator i = m_used.begin(); i != m_used.end(); ++i) {
+    m_buckets[*i].hash = 0;
+  }
+  m_used.clear();
+}
 
+void NgramTable::Grow()
+{
+  vector<Entry> old;
+  old.swap(m_buckets);
+  Entry empty;
+  empty.hash = 0;
+  m_buckets.resize(old.empty() ? 64 : 2 * old.size(), empty);
+  m_mask = m_buckets.size() - 1;
+  for (vector<size_t>::iterator i = m_used.begin(); i != m_used.end(); ++i) {
+    const Entry &entry = old[*i];
+    size_t bucket = entry.hash & m_mask;
+    while (m_buckets[bucket].hash) {
+      bucket = (bucket + 1) & m_mask;
+    }
+    m_buckets[bucket] = entry;
+    *i = bucket;
+  }
+}
 
-void NgramScores::addScore(const Hypothesis* node, const Phrase& ngram, float score)
+void NgramTable::AddScore(NgramHash hash, size_t order, float score)
 {
-  set<Phrase>::const_iterator ngramIter = m_ngrams.find(ngram);
-  if (ngramIter == m_ngrams.end()) {
-    ngramIter = m_ngrams.insert(ngram).first;
-  }
-  map<const Phrase*,float>& ngramScores = m_scores[node];
-  map<const Phrase*,float>::iterator scoreIter = ngramScores.find(&(*ngramIter));
-  if (scoreIter == ngramScores.end()) {
-    ngramScores[&(*ngramIter)] = score;
-  } else {
-    ngramScores[&(*ngramIter)] = log_sum(score,scoreIter->second);
+  if (2 * (m_used.size() + 1) > m_buckets.size()) {
+    Grow();
+  }
+  size_t bucket = hash & m_mask;
+  for (; m_buckets[bucket].hash; bucket = (bucket + 1) & m_mask) {
+    if (m_buckets[bucket].hash == hash) {
+      m_buckets[bucket].score = log_sum(score, m_buckets[bucket].score);
+      return;
+    }
   }
+  Entry &entry = m_buckets[bucket];
+  entry.hash = hash;
+  entry.score = score;
+  entry.order = order;
+  m_used.push_back(bucket);
 }
 
-NgramScores::NodeScoreIterator NgramScores::nodeBegin(const Hypothesis* node)
+const NgramTable::Entry *NgramTable::Find(NgramHash hash) const
 {
-  return m_scores[node].begin();
+  if (m_buckets.empty()) return NULL;
+  for (size_t bucket = hash & m_mask; m_buckets[bucket].hash; bucket = (bucket + 1) & m_mask) {
+    if (m_buckets[bucket].hash == hash) return &m_buckets[bucket];
+  }
+  return NULL;
 }
 
+void MBRLattice::Clear()
+{
+  m_final.clear();
+  m_inBegin.clear();
+  m_edges.clear();
+  m_heads.clear();
+}
 
-NgramScores::NodeScoreIterator NgramScores::nodeEnd(const Hypothesis* node)
+void MBRLattice::AddEdge(size_t tail, size_t head, float score, const Phrase &words)
 {
-  return m_scores[node].end();
+  Edge edge;
+  edge.tail = tail;
+  edge.score = score;
+  edge.words = &words;
+  m_edges.push_back(edge);
+  m_heads.push_back(head);
+}
+
+void MBRLattice::Finish()
+{
+  // counting sort of the edges by head, keeping the order within each head
+  m_inBegin.assign(m_final.size() + 1, 0);
+  for (size_t i = 0; i < m_heads.size(); ++i) {
+    ++m_inBegin[m_heads[i] + 1];
+  }
+  for (size_t v = 0; v < m_final.size(); ++v) {
+    m_inBegin[v + 1] += m_inBegin[v];
+  }
+  vector<size_t> next(m_inBegin.begin(), m_inBegin.end() - 1);
+  vector<Edge> sorted(m_edges.size());
+  for (size_t i = 0; i < m_edges.size(); ++i) {
+    sorted[next[m_heads[i]]++] = m_edges[i];
+  }
+  m_edges.swap(sorted);
+  m_heads.clear();
 }
 
 LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
@@ -97,25 +291,25 @@ LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
 }
 
 
-void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const vector<float>& thetas, float mapWeight)
+void LatticeMBRSolution::CalcScore(const NgramTable& finalNgramScores, const vector<float>& thetas, float mapWeight)
 {
   m_ngramScores.assign(thetas.size()-1, -10000);
 
-  map < Phrase, int > counts;
+  vector<NgramCount> &counts = GetScratch().counts;
   extract_ngrams(m_words,counts);
 
   //Now score this translation
   m_score = thetas[0] * m_words.size();
 
   //Calculate the ngramScores, working in log space at first
-  for (map < Phrase, int >::iterator ngrams = counts.begin(); ngrams != counts.end(); ++ngrams) {
+  for (vector<NgramCount>::const_iterator ngrams = counts.begin(); ngrams != counts.end(); ++ngrams) {
     float ngramPosterior = UNKNGRAMLOGPROB;
-    map<Phrase,float>::const_iterator ngramPosteriorIt = finalNgramScores.find(ngrams->first);
-    if (ngramPosteriorIt != finalNgramScores.end()) {
-      ngramPosterior = ngramPosteriorIt->second;
+    const NgramTable::Entry *ngramPosteriorIt = finalNgramScores.Find(ngrams->hash);
+    if (ngramPosteriorIt) {
+      ngramPosterior = ngramPosteriorIt->score;
     }
-    size_t ngramSize = ngrams->first.GetSize();
-    m_ngramScores[ngramSize-1] = log_sum(log((float)ngrams->second) + ngramPosterior,m_ngramScores[ngramSize-1]);
+    size_t ngramSize = ngrams->order;
+    m_ngramScores[ngramSize-1] = log_sum(log((float)ngrams->count) + ngramPosterior,m_ngramScores[ngramSize-1]);
   }
 
   //convert from log to probability and create weighted sum
@@ -130,45 +324,32 @@ void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const v
 }
 
 
-void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const Hypothesis* > > & outgoingHyps, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                    const vector< float> & estimatedScores, const Hypothesis* bestHypo, size_t edgeDensity, float scale)
+void pruneLatticeFB(const ForwardBackwardSearchGraph &graph, MBRLattice& lattice,
+                    const Hypothesis* bestHypo, size_t edgeDensity, float scale)
 {
-
-  //Need hyp 0 in connectedHyp - Find empty hypothesis
   VERBOSE(2,"Pruning lattice to edge density " << edgeDensity << endl);
-  const Hypothesis* emptyHyp = connectedHyp.at(0);
-  while (emptyHyp->GetId() != 0) {
-    emptyHyp = emptyHyp->GetPrevHypo();
-  }
-  connectedHyp.push_back(emptyHyp); //Add it to list of hyps
-
-  //Need hyp 0's outgoing Hyps
-  for (size_t i = 0; i < connectedHyp.size(); ++i) {
-    if (connectedHyp[i]->GetId() > 0 && connectedHyp[i]->GetPrevHypo()->GetId() == 0)
-      outgoingHyps[emptyHyp].insert(connectedHyp[i]);
-  }
-
-  //sort hyps based on estimated scores - do so by copying to multimap
-  multimap<float, const Hypothesis*> sortHypsByVal;
-  for (size_t i =0; i < estimatedScores.size(); ++i) {
-    sortHypsByVal.insert(make_pair(estimatedScores[i], connectedHyp[i]));
-  }
-
-  multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end();
-  float bestScore = it->first;
-  //store best score as score of hyp 0
-  sortHypsByVal.insert(make_pair(bestScore, emptyHyp));
-
+  const Lattice &connectedHyp = graph.hyps;
+  const size_t numHyps = connectedHyp.size();
+  const vector<size_t> &outBegin = graph.outBegin;
+  const vector<size_t> &outSucc = graph.outSucc;
+
+  //sort hyps based on estimated scores, hyp 0 gets the best score.  Ties are
+  //visited last added first.
+  const vector<float> &scores = graph.estimatedScores;
+  vector<size_t> order(numHyps);
+  for (size_t i = 0; i < numHyps; ++i) order[i] = i;
+  stable_sort(order.begin(), order.end(), IndexScoreCmp(scores));
 
   IFVERBOSE(3) {
-    for (multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end(); it != --sortHypsByVal.begin(); --it) {
-      const Hypothesis* currHyp =  it->second;
-      cerr << "Hyp " << currHyp->GetId() << ", estimated score: " << it->first << endl;
+    for (size_t k = numHyps; k-- > 0;) {
+      const Hypothesis* currHyp =  connectedHyp[order[k]];
+      cerr << "Hyp " << currHyp->GetId() << ", estimated score: " << scores[order[k]] << endl;
     }
   }
 
 
-  set <const Hypothesis*> survivingHyps; //store hyps that make the cut in this
+  vector<bool> survivingHyps(numHyps, false); //store hyps that make the cut in this
+  vector<PrunedEdge> edges;
 
   VERBOSE(2, "BEST HYPO TARGET LENGTH : " << bestHypo->GetSize() << endl)
   size_t numEdgesTotal = edgeDensity * bestHypo->GetSize(); //as per Shankar, aim for (density * target length of MAP solution) arcs
@@ -177,25 +358,25 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
 
   float prevScore = -999999;
 
-  //now iterate over multimap
-  for (multimap<float, const Hypothesis*>::const_iterator it = --sortHypsByVal.end(); it != --sortHypsByVal.begin(); --it) {
-    float currEstimatedScore = it->first;
-    const Hypothesis* currHyp =  it->second;
+  //now iterate over hyps from best to worst
+  for (size_t k = numHyps; k-- > 0;) {
+    const size_t curr = order[k];
+    float currEstimatedScore = scores[curr];
+    const Hypothesis* currHyp =  connectedHyp[curr];
 
     if (numEdgesCreated >= numEdgesTotal && prevScore > currEstimatedScore) //if this hyp has equal estimated score to previous, include its edges too
       break;
 
     prevScore = currEstimatedScore;
     VERBOSE(3, "Num edges created : "<< numEdgesCreated << ", numEdges wanted " << numEdgesTotal << endl)
-    VERBOSE(3, "Considering hyp " << currHyp->GetId() << ", estimated score: " << it->first << endl)
+    VERBOSE(3, "Considering hyp " << currHyp->GetId() << ", estimated score: " << currEstimatedScore << endl)
 
-    survivingHyps.insert(currHyp); //CurrHyp made the cut
+    survivingHyps[curr] = true; //CurrHyp made the cut
 
     // is its best predecessor already included ?
-    if (survivingHyps.find(currHyp->GetPrevHypo()) != survivingHyps.end()) { //yes, then add an edge
-      vector <Edge>& edges = incomingEdges[currHyp];
-      Edge winningEdge(currHyp->GetPrevHypo(),currHyp,scale*(currHyp->GetScore() - currHyp->GetPrevHypo()->GetScore()),currHyp->GetCurrTargetPhrase());
-      edges.push_back(winningEdge);
+    size_t prev = graph.GetDenseId(currHyp->GetPrevHypo());
+    if (prev != NOT_FOUND && survivingHyps[prev]) { //yes, then add an edge
+      edges.push_back(PrunedEdge(prev, curr, scale*(currHyp->GetScore() - currHyp->GetPrevHypo()->GetScore()), currHyp->GetCurrTargetPhrase()));
       ++numEdgesCreated;
     }
 
@@ -206,68 +387,69 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
       for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
         const Hypothesis *loserHypo = *iterArcList;
         const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
-        if (survivingHyps.find(loserPrevHypo) != survivingHyps.end()) { //found it, add edge
+        size_t loserPrev = graph.GetDenseId(loserPrevHypo);
+        if (loserPrev != NOT_FOUND && survivingHyps[loserPrev]) { //found it, add edge
           double arcScore = loserHypo->GetScore() - loserPrevHypo->GetScore();
-          Edge losingEdge(loserPrevHypo, currHyp, arcScore*scale, loserHypo->GetCurrTargetPhrase());
-          vector <Edge>& edges = incomingEdges[currHyp];
-          edges.push_back(losingEdge);
+          edges.push_back(PrunedEdge(loserPrev, curr, arcScore*scale, loserHypo->GetCurrTargetPhrase()));
           ++numEdgesCreated;
         }
       }
     }
 
     //Now if a successor node has already been visited, add an edge connecting the two
-    map < const Hypothesis*, set < const Hypothesis* > >::const_iterator outgoingIt = outgoingHyps.find(currHyp);
-
-    if (outgoingIt != outgoingHyps.end()) {//currHyp does have successors
-      const set<const Hypothesis*> & outHyps = outgoingIt->second; //the successors
-      for (set<const Hypothesis*>::const_iterator outHypIts = outHyps.begin(); outHypIts != outHyps.end(); ++outHypIts) {
-        const Hypothesis* succHyp = *outHypIts;
-
-        if (survivingHyps.find(succHyp) == survivingHyps.end()) //Have we encountered the successor yet?
-          continue; //No, move on to next
-
-        //Curr Hyp can be : a) the best predecessor  of succ b) or an arc attached to succ
-        if (succHyp->GetPrevHypo() == currHyp) { //best predecessor
-          vector <Edge>& succEdges = incomingEdges[succHyp];
-          Edge succWinningEdge(currHyp, succHyp, scale*(succHyp->GetScore() - currHyp->GetScore()), succHyp->GetCurrTargetPhrase());
-          succEdges.push_back(succWinningEdge);
-          survivingHyps.insert(succHyp);
-          ++numEdgesCreated;
-        }
+    for (size_t o = outBegin[curr]; o < outBegin[curr + 1]; ++o) {
+      const size_t succ = outSucc[o];
+      if (!survivingHyps[succ]) //Have we encountered the successor yet?
+        continue; //No, move on to next
+      const Hypothesis* succHyp = connectedHyp[succ];
+
+      //Curr Hyp can be : a) the best predecessor  of succ b) or an arc attached to succ
+      if (succHyp->GetPrevHypo() == currHyp) { //best predecessor
+        edges.push_back(PrunedEdge(curr, succ, scale*(succHyp->GetScore() - currHyp->GetScore()), succHyp->GetCurrTargetPhrase()));
+        ++numEdgesCreated;
+      }
 
-        //now, let's find an arc
-        const ArcList *arcList = succHyp->GetArcList();
-        if (arcList != NULL) {
-          ArcList::const_iterator iterArcList;
-          //QUESTION: What happens if there's more than one loserPrevHypo?
-          for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
-            const Hypothesis *loserHypo = *iterArcList;
-            const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
-            if (loserPrevHypo == currHyp) { //found it
-              vector <Edge>& succEdges = incomingEdges[succHyp];
-              double arcScore = loserHypo->GetScore() - currHyp->GetScore();
-              Edge losingEdge(currHyp, succHyp,scale* arcScore, loserHypo->GetCurrTargetPhrase());
-              succEdges.push_back(losingEdge);
-              ++numEdgesCreated;
-            }
+      //now, let's find an arc
+      const ArcList *arcList = succHyp->GetArcList();
+      if (arcList != NULL) {
+        ArcList::const_iterator iterArcList;
+        //QUESTION: What happens if there's more than one loserPrevHypo?
+        for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
+          const Hypothesis *loserHypo = *iterArcList;
+          const Hypothesis* loserPrevHypo = loserHypo->GetPrevHypo();
+          if (loserPrevHypo == currHyp) { //found it
+            double arcScore = loserHypo->GetScore() - currHyp->GetScore();
+            edges.push_back(PrunedEdge(curr, succ, scale* arcScore, loserHypo->GetCurrTargetPhrase()));
+            ++numEdgesCreated;
           }
         }
       }
     }
   }
+  //number the surviving hyps by increasing source word coverage
+  vector<size_t> survivors;
+  for (size_t i = 0; i < numHyps; ++i) {
+    if (survivingHyps[i]) survivors.push_back(i);
+  }
+  stable_sort(survivors.begin(), survivors.end(), IndexCoverageCmp(connectedHyp));
 
-  connectedHyp.clear();
-  for (set <const Hypothesis*>::iterator it =  survivingHyps.begin(); it != survivingHyps.end(); ++it) {
-    connectedHyp.push_back(*it);
+  lattice.Clear();
+  vector<size_t> vertex(numHyps, NOT_FOUND);
+  for (size_t i = 0; i < survivors.size(); ++i) {
+    const Hypothesis *hyp = connectedHyp[survivors[i]];
+    vertex[survivors[i]] = lattice.AddVertex(hyp->GetWordsBitmap().IsComplete());
+  }
+  for (vector<PrunedEdge>::const_iterator edge = edges.begin(); edge != edges.end(); ++edge) {
+    lattice.AddEdge(vertex[edge->tail], vertex[edge->head], edge->score, *edge->words);
   }
+  lattice.Finish();
 
   VERBOSE(2, "Done! Num edges created : "<< numEdgesCreated << ", numEdges wanted " << numEdgesTotal << endl)
 
   IFVERBOSE(3) {
     cerr << "Surviving hyps: " ;
-    for (set <const Hypothesis*>::iterator it =  survivingHyps.begin(); it != survivingHyps.end(); ++it) {
-      cerr << (*it)->GetId() << " ";
+    for (size_t i = 0; i < survivors.size(); ++i) {
+      cerr << connectedHyp[survivors[i]]->GetId() << " ";
     }
     cerr << endl;
   }
@@ -275,226 +457,172 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
 
 }
 
-void calcNgramExpectations(Lattice & connectedHyp, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                           map<Phrase, float>& finalNgramScores, bool posteriors)
+void calcNgramExpectations(const MBRLattice& lattice, NgramTable& finalNgramScores, bool posteriors)
 {
+  LatticeMBRScratch &scratch = GetScratch();
+  const size_t numVertices = lattice.GetSize();
+  const size_t numEdges = lattice.GetNumEdges();
+
+  //the word hashes of each edge
+  vector<uint64_t> &wordHashes = scratch.wordHashes;
+  vector<size_t> &wordBegin = scratch.wordBegin;
+  wordHashes.clear();
+  wordBegin.assign(1, 0);
+  for (size_t e = 0; e < numEdges; ++e) {
+    const Phrase &words = *lattice.GetEdge(e).words;
+    for (size_t pos = 0; pos < words.GetSize(); ++pos) {
+      wordHashes.push_back(words.GetWord(pos).hash());
+    }
+    wordBegin.push_back(wordHashes.size());
+  }
 
-  sort(connectedHyp.begin(),connectedHyp.end(),ascendingCoverageCmp); //sort by increasing source word cov
-
-  /*cerr << "Lattice:" << endl;
-  for (Lattice::const_iterator i = connectedHyp.begin(); i != connectedHyp.end(); ++i) {
-      const Hypothesis* h = *i;
-      cerr << *h << endl;
-      const vector<Edge>& edges = incomingEdges[h];
-      for (size_t e = 0; e < edges.size(); ++e) {
-          cerr << edges[e];
-      }
-  }*/
+  //forward score of hyp 0 is 1 (or 0 in logprob space), as is that of any hyp
+  //left without incoming edges by pruning
+  vector<float> &forwardScore = scratch.forwardScore;
+  forwardScore.assign(numVertices, 0.0f);
 
-  map<const Hypothesis*, float> forwardScore;
-  forwardScore[connectedHyp[0]] = 0.0f; //forward score of hyp 0 is 1 (or 0 in logprob space)
-  set< const Hypothesis *> finalHyps; //store completed hyps
+  //ngrams ending in each edge with the paths they span, sorted by hash
+  vector<NgramPath> &paths = scratch.paths;
+  vector<size_t> &pathBegin = scratch.pathBegin;
+  paths.clear();
+  pathBegin.assign(1, 0);
 
-  NgramScores ngramScores;//ngram scores for each hyp
+  //ngram scores for each hyp
+  NgramTable &vertexNgrams = scratch.vertexNgrams;
+  vector<NgramTable::Entry> &vertexScores = scratch.vertexScores;
+  vector<size_t> &vertexBegin = scratch.vertexBegin;
+  vertexScores.clear();
+  vertexBegin.assign(1, 0);
 
-  for (size_t i = 1; i < connectedHyp.size(); ++i) {
-    const Hypothesis* currHyp = connectedHyp[i];
-    if (currHyp->GetWordsBitmap().IsComplete()) {
-      finalHyps.insert(currHyp);
-    }
+  float Z = 9999999; //the total score of the lattice
+  finalNgramScores.Clear();
 
-    VERBOSE(3, "Processing hyp: " << currHyp->GetId() << ", num words cov= " << currHyp->GetWordsBitmap().GetNumWordsCovered() <<  endl)
+  //edges are grouped by head, so visiting the vertices in order visits the
+  //edges in order too
+  for (size_t v = 0; v < numVertices; ++v) {
+    VERBOSE(3, "Processing vertex: " << v << endl)
 
-    vector <Edge> & edges = incomingEdges[currHyp];
-    for (size_t e = 0; e < edges.size(); ++e) {
-      const Edge& edge = edges[e];
-      if (forwardScore.find(currHyp) == forwardScore.end()) {
-        forwardScore[currHyp] = forwardScore[edge.GetTailNode()] + edge.GetScore();
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] = fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
+    for (size_t e = lattice.InBegin(v); e < lattice.InEnd(v); ++e) {
+      const MBRLattice::Edge &edge = lattice.GetEdge(e);
+      if (e == lattice.InBegin(v)) {
+        forwardScore[v] = forwardScore[edge.tail] + edge.score;
       } else {
-        forwardScore[currHyp] = log_sum(forwardScore[currHyp], forwardScore[edge.GetTailNode()] + edge.GetScore());
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] += fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
+        forwardScore[v] = log_sum(forwardScore[v], forwardScore[edge.tail] + edge.score);
       }
+      VERBOSE(3, "Fwd score["<<v<<"] += fwdScore["<<edge.tail << "] + edge Score: " << edge.score << endl)
     }
 
-    //Process ngrams now
-    for (size_t j =0 ; j < edges.size(); ++j) {
-      Edge& edge = edges[j];
-      const NgramHistory & incomingPhrases = edge.GetNgrams(incomingEdges);
+    vertexNgrams.Clear();
+    for (size_t e = lattice.InBegin(v); e < lattice.InEnd(v); ++e) {
+      const MBRLattice::Edge &edge = lattice.GetEdge(e);
+      const uint64_t *words = &wordHashes[0] + wordBegin[e];
+      const size_t numWords = wordBegin[e + 1] - wordBegin[e];
+      const uint64_t edgePath = HashPath(0, e);
+
+      //Extract the n-grams local to this edge
+      for (size_t start = 0; start < numWords; ++start) {
+        for (size_t end = start; end < start + bleu_order && end < numWords; ++end) {
+          NgramPath path;
+          path.order = end - start + 1;
+          copy(words + start, words + end + 1, path.words);
+          path.hash = HashNgram(path.words, path.order);
+          path.pathHash = edgePath;
+          path.tail = edge.tail;
+          path.score = edge.score;
+          path.count = 1;
+          paths.push_back(path);
+        }
+      }
 
-      //let's first score ngrams introduced by this edge
-      for (NgramHistory::const_iterator it = incomingPhrases.begin(); it != incomingPhrases.end(); ++it) {
-        const Phrase& ngram = it->first;
-        const PathCounts& pathCounts = it->second;
-        VERBOSE(4, "Calculating score for: " << it->first << endl)
-
-        for (PathCounts::const_iterator pathCountIt = pathCounts.begin(); pathCountIt != pathCounts.end(); ++pathCountIt) {
-          //Score of an n-gram is forward score of head node of leftmost edge + all edge scores
-          const Path&  path = pathCountIt->first;
-          //cerr << "path count for " << ngram << " is " << pathCountIt->second << endl;
-          float score = forwardScore[path[0]->GetTailNode()];
-          for (size_t i = 0; i < path.size(); ++i) {
-            score += path[i]->GetScore();
+      //add the ngrams straddling prev and curr edge
+      for (size_t in = lattice.InBegin(edge.tail); in < lattice.InEnd(edge.tail); ++in) {
+        const uint64_t *inWords = &wordHashes[0] + wordBegin[in];
+        const size_t numInWords = wordBegin[in + 1] - wordBegin[in];
+        for (size_t p = pathBegin[in]; p < pathBegin[in + 1]; ++p) {
+          const NgramPath incoming = paths[p];
+          //only extend ngrams that match the end of the previous edge
+          size_t back = min(incoming.order, numInWords);
+          if (!equal(incoming.words + incoming.order - back, incoming.words + incoming.order,
+                     inWords + numInWords - back)) {
+            continue;
           }
-          //if we're doing expectations, then the number of times the ngram
-          //appears on the path is relevant.
-          size_t count = posteriors ? 1 : pathCountIt->second;
-          for (size_t k = 0; k < count; ++k) {
-            ngramScores.addScore(currHyp,ngram,score);
+          NgramPath path = incoming;
+          path.pathHash = HashPath(incoming.pathHash, e);
+          path.score += edge.score;
+          for (size_t i = 0; i < numWords && i + incoming.order < bleu_order; ++i) {
+            path.words[path.order++] = words[i];
+            path.hash = HashNgram(path.words, path.order);
+            paths.push_back(path);
           }
         }
       }
 
-      //Now score ngrams that are just being propagated from the history
-      for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(edge.GetTailNode());
-           it != ngramScores.nodeEnd(edge.GetTailNode()); ++it) {
-        const Phrase & currNgram = *(it->first);
-        float currNgramScore = it->second;
-        VERBOSE(4, "Calculating score for: " << currNgram << endl)
-
-        // For posteriors, don't double count ngrams
-        if (!posteriors || incomingPhrases.find(currNgram) == incomingPhrases.end()) {
-          float score = edge.GetScore() + currNgramScore;
-          ngramScores.addScore(currHyp,currNgram,score);
+      //merge repeats of an ngram along the same path
+      vector<NgramPath>::iterator begin = paths.begin() + pathBegin[e];
+      sort(begin, paths.end());
+      vector<NgramPath>::iterator out = begin;
+      for (vector<NgramPath>::iterator it = begin; it != paths.end(); ++it) {
+        if (out != begin && (out - 1)->hash == it->hash && (out - 1)->pathHash == it->pathHash) {
+          (out - 1)->count += it->count;
+        } else {
+          *out++ = *it;
         }
       }
+      paths.erase(out, paths.end());
+      pathBegin.push_back(paths.size());
 
-    }
-  }
-
-  float Z = 9999999; //the total score of the lattice
-
-  //Done - Print out ngram posteriors for final hyps
-  for (set< const Hypothesis *>::iterator finalHyp = finalHyps.begin(); finalHyp != finalHyps.end(); ++finalHyp) {
-    const Hypothesis* hyp = *finalHyp;
-
-    for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(hyp); it != ngramScores.nodeEnd(hyp); ++it) {
-      const Phrase& ngram = *(it->first);
-      if (finalNgramScores.find(ngram) == finalNgramScores.end()) {
-        finalNgramScores[ngram] = it->second;
-      } else {
-        finalNgramScores[ngram] = log_sum(it->second,  finalNgramScores[ngram]);
+      //let's first score ngrams introduced by this edge
+      //Score of an n-gram is forward score of head node of leftmost edge + all edge scores
+      for (size_t p = pathBegin[e]; p < pathBegin[e + 1]; ++p) {
+        const NgramPath &path = paths[p];
+        float score = forwardScore[path.tail] + path.score;
+        //if we're doing expectations, then the number of times the ngram
+        //appears on the path is relevant.
+        size_t count = posteriors ? 1 : path.count;
+        for (size_t k = 0; k < count; ++k) {
+          vertexNgrams.AddScore(path.hash, path.order, score);
+        }
       }
-    }
 
-    if (Z == 9999999) {
-      Z = forwardScore[hyp];
-    } else {
-      Z = log_sum(Z, forwardScore[hyp]);
+      //Now score ngrams that are just being propagated from the history
+      vector<NgramPath>::const_iterator edgeBegin = paths.begin() + pathBegin[e];
+      vector<NgramPath>::const_iterator edgeEnd = paths.end();
+      for (size_t n = vertexBegin[edge.tail]; n < vertexBegin[edge.tail + 1]; ++n) {
+        const NgramTable::Entry &ngram = vertexScores[n];
+        // For posteriors, don't double count ngrams
+        if (posteriors) {
+          vector<NgramPath>::const_iterator found = lower_bound(edgeBegin, edgeEnd, ngram.hash, NgramPathHashCmp());
+          if (found != edgeEnd && found->hash == ngram.hash) continue;
+        }
+        vertexNgrams.AddScore(ngram.hash, ngram.order, edge.score + ngram.score);
+      }
     }
-  }
 
-  //Z *= scale;  //scale the score
-
-  for (map<Phrase, float>::iterator finalScoresIt = finalNgramScores.begin();  finalScoresIt != finalNgramScores.end(); ++finalScoresIt) {
-    finalScoresIt->second =  finalScoresIt->second - Z;
-    IFVERBOSE(2) {
-      VERBOSE(2,finalScoresIt->first << " [" << finalScoresIt->second << "]" << endl);
+    for (NgramTable::const_iterator it = vertexNgrams.begin(); it != vertexNgrams.end(); ++it) {
+      vertexScores.push_back(vertexNgrams.GetEntry(it));
     }
-  }
+    vertexBegin.push_back(vertexScores.size());
 
-}
-
-const NgramHistory& Edge::GetNgrams(map<const Hypothesis*, vector<Edge> > & incomingEdges)
-{
-
-  if (m_ngrams.size() > 0)
-    return m_ngrams;
-
-  const Phrase& currPhrase = GetWords();
-  //Extract the n-grams local to this edge
-  for (size_t start = 0; start < currPhrase.GetSize(); ++start) {
-    for (size_t end = start; end < start + bleu_order; ++end) {
-      if (end < currPhrase.GetSize()) {
-        Phrase edgeNgram(end-start+1);
-        for (size_t index = start; index <= end; ++index) {
-          edgeNgram.AddWord(currPhrase.GetWord(index));
-        }
-        //cout << "Inserting Phrase : " << edgeNgram << endl;
-        vector<const Edge*> edgeHistory;
-        edgeHistory.push_back(this);
-        storeNgramHistory(edgeNgram, edgeHistory);
+    if (v > 0 && lattice.IsFinal(v)) {
+      for (size_t n = vertexBegin[v]; n < vertexBegin[v + 1]; ++n) {
+        const NgramTable::Entry &ngram = vertexScores[n];
+        finalNgramScores.AddScore(ngram.hash, ngram.order, ngram.score);
+      }
+      if (Z == 9999999) {
+        Z = forwardScore[v];
       } else {
-        break;
+        Z = log_sum(Z, forwardScore[v]);
       }
     }
   }
 
-  map<const Hypothesis*, vector<Edge> >::iterator it = incomingEdges.find(m_tailNode);
-  if (it != incomingEdges.end()) { //node has incoming edges
-    vector<Edge> & inEdges = it->second;
-
-    for (vector<Edge>::iterator edge = inEdges.begin(); edge != inEdges.end(); ++edge) {//add the ngrams straddling prev and curr edge
-      const NgramHistory & edgeIncomingNgrams = edge->GetNgrams(incomingEdges);
-      for (NgramHistory::const_iterator edgeInNgramHist = edgeIncomingNgrams.begin(); edgeInNgramHist != edgeIncomingNgrams.end(); ++edgeInNgramHist) {
-        const Phrase& edgeIncomingNgram = edgeInNgramHist->first;
-        const PathCounts &  edgeIncomingNgramPaths = edgeInNgramHist->second;
-        size_t back = min(edgeIncomingNgram.GetSize(), edge->GetWordsSize());
-        const Phrase&  edgeWords = edge->GetWords();
-        IFVERBOSE(3) {
-          cerr << "Edge: "<< *edge <<endl;
-          cerr << "edgeWords: " << edgeWords << endl;
-          cerr << "edgeInNgram: " << edgeIncomingNgram << endl;
-        }
-
-        Phrase edgeSuffix(ARRAY_SIZE_INCR);
-        Phrase ngramSuffix(ARRAY_SIZE_INCR);
-        GetPhraseSuffix(edgeWords,back,edgeSuffix);
-        GetPhraseSuffix(edgeIncomingNgram,back,ngramSuffix);
-
-        if (ngramSuffix == edgeSuffix) { //we've got the suffix of previous edge
-          size_t  edgeInNgramSize =  edgeIncomingNgram.GetSize();
-
-          for (size_t i = 0; i < GetWordsSize() && i + edgeInNgramSize < bleu_order ; ++i) {
-            Phrase newNgram(edgeIncomingNgram);
-            for (size_t j = 0; j <= i ; ++j) {
-              newNgram.AddWord(GetWords().GetWord(j));
-            }
-            VERBOSE(3, "Inserting New Phrase : " << newNgram << endl)
-
-            for (PathCounts::const_iterator pathIt = edgeIncomingNgramPaths.begin(); pathIt !=  edgeIncomingNgramPaths.end(); ++pathIt) {
-              Path newNgramPath = pathIt->first;
-              newNgramPath.push_back(this);
-              storeNgramHistory(newNgram, newNgramPath, pathIt->second);
-            }
-          }
-        }
-      }
-    }
-  }
-  return m_ngrams;
-}
+  //Z *= scale;  //scale the score
 
-//Add the last lastN words of origPhrase to targetPhrase
-void Edge::GetPhraseSuffix(const Phrase&  origPhrase, size_t lastN, Phrase& targetPhrase) const
-{
-  size_t origSize = origPhrase.GetSize();
-  size_t startIndex = origSize - lastN;
-  for (size_t index = startIndex; index < origPhrase.GetSize(); ++index) {
-    targetPhrase.AddWord(origPhrase.GetWord(index));
+  for (NgramTable::const_iterator it = finalNgramScores.begin(); it != finalNgramScores.end(); ++it) {
+    finalNgramScores.GetEntry(it).score -= Z;
   }
-}
-
-bool Edge::operator< (const Edge& compare ) const
-{
-  if (m_headNode->GetId() < compare.m_headNode->GetId())
-    return true;
-  if (compare.m_headNode->GetId() < m_headNode->GetId())
-    return false;
-  if (m_tailNode->GetId() < compare.m_tailNode->GetId())
-    return true;
-  if (compare.m_tailNode->GetId() < m_tailNode->GetId())
-    return false;
-  return GetScore() <  compare.GetScore();
-}
-
-ostream& operator<< (ostream& out, const Edge& edge)
-{
-  out << "Head: " << edge.m_headNode->GetId()
-      << ", Tail: " << edge.m_tailNode->GetId()
-      << ", Score: " << edge.m_score
-      << ", Phrase: " << edge.m_targetPhrase << endl;
-  return out;
+  VERBOSE(2, "Lattice has " << numVertices << " vertices, " << numEdges << " edges and "
+          << finalNgramScores.GetSize() << " ngrams" << endl);
 }
 
 bool ascendingCoverageCmp(const Hypothesis* a, const Hypothesis* b)
@@ -507,19 +635,14 @@ bool ascendingCoverageCmp(const Hypothesis* a, const Hypothesis* b)
 void getLatticeMBRNBest(const Manager& manager, const TrellisPathList& nBestList,
                         vector<LatticeMBRSolution>& solutions, size_t n)
 {
-  std::map < int, bool > connected;
-  std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramPosteriors;
-  std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
-  map<const Hypothesis*, vector<Edge> > incomingEdges;
-  vector< float> estimatedScores;
-  manager.GetForwardBackwardSearchGraph(&connected, &connectedList,
-                                        &outgoingHyps, &estimatedScores);
   LMBR_Options const& lmbr = manager.options()->lmbr;
   MBR_Options  const& mbr  = manager.options()->mbr;
-  pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores,
+  LatticeMBRScratch &scratch = GetScratch();
+  manager.GetForwardBackwardSearchGraph(scratch.searchGraph);
+  pruneLatticeFB(scratch.searchGraph, scratch.lattice,
                  manager.GetBestHypothesis(), lmbr.pruning_factor, mbr.scale);
-  calcNgramExpectations(connectedList, incomingEdges, ngramPosteriors,true);
+  NgramTable &ngramPosteriors = scratch.ngramScores;
+  calcNgramExpectations(scratch.lattice, ngramPosteriors, true);
 
   vector<float> mbrThetas = lmbr.theta;
   float p = lmbr.precision;
@@ -569,30 +692,22 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
   static const float SMOOTH = 1;
 
   //calculate the ngram expectations
-  const StaticData& staticData = StaticData::Instance();
-  std::map < int, bool > connected;
-  std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramExpectations;
-  std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
-  map<const Hypothesis*, vector<Edge> > incomingEdges;
-  vector< float> estimatedScores;
-  manager.GetForwardBackwardSearchGraph(&connected, &connectedList, &outgoingHyps, &estimatedScores);
   LMBR_Options const& lmbr = manager.options()->lmbr;
   MBR_Options  const&  mbr = manager.options()->mbr;
-  pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores,
+  LatticeMBRScratch &scratch = GetScratch();
+  manager.GetForwardBackwardSearchGraph(scratch.searchGraph);
+  pruneLatticeFB(scratch.searchGraph, scratch.lattice,
                  manager.GetBestHypothesis(), lmbr.pruning_factor, mbr.scale);
-  calcNgramExpectations(connectedList, incomingEdges, ngramExpectations,false);
+  NgramTable &ngramExpectations = scratch.ngramScores;
+  calcNgramExpectations(scratch.lattice, ngramExpectations, false);
 
   //expected length is sum of expected unigram counts
-  //cerr << "Thread " << pthread_self() <<  " Ngram expectations size: " << ngramExpectations.size() << endl;
   float ref_length = 0.0f;
-  for (map<Phrase,float>::const_iterator ref_iter = ngramExpectations.begin();
+  for (NgramTable::const_iterator ref_iter = ngramExpectations.begin();
        ref_iter != ngramExpectations.end(); ++ref_iter) {
-    //cerr << "Ngram: " << ref_iter->first << " score: " <<
-    //    ref_iter->second << endl;
-    if (ref_iter->first.GetSize() == 1) {
-      ref_length += exp(ref_iter->second);
-      //    cerr << "Expected for " << ref_iter->first << " is " << exp(ref_iter->second) << endl;
+    const NgramTable::Entry &ref = ngramExpectations.GetEntry(ref_iter);
+    if (ref.order == 1) {
+      ref_length += exp(ref.score);
     }
   }
 
@@ -606,7 +721,7 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
   for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
     const TrellisPath &path = **iter;
     vector<Word> words;
-    map<Phrase,int> ngrams;
+    vector<NgramCount> &ngrams = scratch.counts;
     GetOutputWords(path,words);
     /*for (size_t i = 0; i < words.size(); ++i) {
         cerr << words[i].GetFactor(0)->GetString() << " ";
@@ -624,11 +739,11 @@ const TrellisPath doConsensusDecoding(const Manager& manager, const TrellisPathL
       comps[2*i+1] = max(hyp_length-i,0);
     }
 
-    for (map<Phrase,int>::const_iterator hyp_iter = ngrams.begin();
+    for (vector<NgramCount>::const_iterator hyp_iter = ngrams.begin();
          hyp_iter != ngrams.end(); ++hyp_iter) {
-      map<Phrase,float>::const_iterator ref_iter = ngramExpectations.find(hyp_iter->first);
-      if (ref_iter != ngramExpectations.end()) {
-        comps[2*(hyp_iter->first.GetSize()-1)] += min(exp(ref_iter->second), (float)(hyp_iter->second));
+      const NgramTable::Entry *ref = ngramExpectations.Find(hyp_iter->hash);
+      if (ref) {
+        comps[2*(hyp_iter->order-1)] += min(exp(ref->score), (float)(hyp_iter->count));
       }
 
     }
@@ -13,6 +13,7 @@
 #include <map>
 #include <vector>
 #include <set>
+#include <stdint.h>
 #include "moses/Hypothesis.h"
 #include "moses/Manager.h"
 #include "moses/TrellisPathList.h"
@@ -22,82 +23,116 @@
 namespace Moses
 {
 
-class Edge;
-
 typedef std::vector< const Moses::Hypothesis *> Lattice;
-typedef std::vector<const Edge*> Path;
-typedef std::map<Path, size_t> PathCounts;
-typedef std::map<Moses::Phrase, PathCounts > NgramHistory;
 
-class Edge
-{
-  const Moses::Hypothesis* m_tailNode;
-  const Moses::Hypothesis* m_headNode;
-  float m_score;
-  Moses::TargetPhrase m_targetPhrase;
-  NgramHistory m_ngrams;
+/** 64-bit hash of the factors of the words of an n-gram, which stands for
+ * the n-gram itself.  Never 0.
+ */
+typedef uint64_t NgramHash;
 
+/**
+* Open-addressing table of n-gram log scores keyed by NgramHash.  Clear() only
+* touches the buckets in use, so one table can be reused for every sentence.
+*/
+class NgramTable
+{
 public:
-  Edge(const Moses::Hypothesis* from, const Moses::Hypothesis* to, float score, const Moses::TargetPhrase& targetPhrase) : m_tailNode(from), m_headNode(to), m_score(score), m_targetPhrase(targetPhrase) {
-    //cout << "Creating new edge from Node " << from->GetId() << ", to Node : " << to->GetId() << ", score: " << score << " phrase: " << targetPhrase << endl;
-  }
+  struct Entry {
+    NgramHash hash;
+    float score;
+    size_t order;
+  };
+  typedef std::vector<size_t>::const_iterator const_iterator;
 
-  const Moses::Hypothesis* GetHeadNode() const {
-    return m_headNode;
-  }
+  NgramTable() : m_mask(0) {}
 
-  const Moses::Hypothesis* GetTailNode() const {
-    return m_tailNode;
-  }
+  void Clear();
 
-  float GetScore() const {
-    return m_score;
-  }
+  /** logsum this score to the existing score */
+  void AddScore(NgramHash hash, size_t order, float score);
 
-  size_t GetWordsSize() const {
-    return m_targetPhrase.GetSize();
-  }
+  /** NULL if the n-gram is not in the table */
+  const Entry *Find(NgramHash hash) const;
 
-  const Moses::Phrase& GetWords() const {
-    return m_targetPhrase;
+  size_t GetSize() const {
+    return m_used.size();
   }
 
-  friend std::ostream& operator<< (std::ostream& out, const Edge& edge);
-
-  const NgramHistory&  GetNgrams(  std::map<const Moses::Hypothesis*, std::vector<Edge> > & incomingEdges) ;
-
-  bool operator < (const Edge & compare) const;
-
-  void GetPhraseSuffix(const Moses::Phrase& origPhrase, size_t lastN, Moses::Phrase& targetPhrase) const;
-
-  void storeNgramHistory(const Moses::Phrase& phrase, Path & path, size_t count = 1) {
-    m_ngrams[phrase][path]+= count;
+  /** Iterate over the buckets in use, in insertion order */
+  const_iterator begin() const {
+    return m_used.begin();
+  }
+  const_iterator end() const {
+    return m_used.end();
+  }
+  Entry &GetEntry(const_iterator it) {
+    return m_buckets[*it];
+  }
+  const Entry &GetEntry(const_iterator it) const {
+    return m_buckets[*it];
   }
 
+private:
+  void Grow();
+
+  std::vector<Entry> m_buckets;
+  std::vector<size_t> m_used;
+  size_t m_mask;
 };
 
 /**
-* Data structure to hold the ngram scores as we traverse the lattice. Maps (hypo,ngram) to score
+* Pruned search graph with dense vertex ids.  Vertices are numbered in order
+* of source coverage, which is a topological order with the empty hypothesis
+* as vertex 0, and the incoming edges of each vertex are contiguous (CSR).
 */
-class NgramScores
+class MBRLattice
 {
 public:
-  NgramScores() {}
+  struct Edge {
+    size_t tail;
+    float score;
+    const Moses::Phrase *words;
+  };
+
+  void Clear();
+
+  /** Vertices must be added in topological order */
+  size_t AddVertex(bool isFinal) {
+    m_final.push_back(isFinal);
+    return m_final.size() - 1;
+  }
 
-  /** logsum this score to the existing score */
-  void addScore(const Moses::Hypothesis* node, const Moses::Phrase& ngram, float score);
+  /** Edges may be added in any order, then Finish() groups them by head */
+  void AddEdge(size_t tail, size_t head, float score, const Moses::Phrase &words);
+  void Finish();
 
-  /** Iterate through ngrams for selected node */
-  typedef std::map<const Moses::Phrase*, float>::const_iterator NodeScoreIterator;
-  NodeScoreIterator nodeBegin(const Moses::Hypothesis* node);
-  NodeScoreIterator nodeEnd(const Moses::Hypothesis* node);
+  size_t GetSize() const {
+    return m_final.size();
+  }
+  bool IsFinal(size_t vertex) const {
+    return m_final[vertex];
+  }
+  size_t GetNumEdges() const {
+    return m_edges.size();
+  }
+  /** incoming edges of vertex are [InBegin(vertex), InEnd(vertex)) */
+  size_t InBegin(size_t vertex) const {
+    return m_inBegin[vertex];
+  }
+  size_t InEnd(size_t vertex) const {
+    return m_inBegin[vertex + 1];
+  }
+  const Edge &GetEdge(size_t edge) const {
+    return m_edges[edge];
+  }
 
 private:
-  std::set<Moses::Phrase> m_ngrams;
-  std::map<const Moses::Hypothesis*, std::map<const Moses::Phrase*, float> > m_scores;
+  std::vector<bool> m_final;
+  std::vector<size_t> m_inBegin;
+  std::vector<Edge> m_edges;
+  std::vector<size_t> m_heads; //< head of each edge until Finish()
 };
 
-
 /** Holds a lattice mbr solution, and its scores */
 class LatticeMBRSolution
 {
@@ -118,7 +153,7 @@ public:
   }
 
   /** Initialise ngram scores */
-  void CalcScore(std::map<Moses::Phrase, float>& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
+  void CalcScore(const NgramTable& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
 
 private:
   std::vector<Moses::Word> m_words;
@@ -133,16 +168,23 @@ struct LatticeMBRSolutionComparator {
   }
 };
 
-void pruneLatticeFB(Lattice & connectedHyp, std::map < const Moses::Hypothesis*, std::set <const Moses::Hypothesis* > > & outgoingHyps, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges,
-                    const std::vector< float> & estimatedScores, const Moses::Hypothesis*, size_t edgeDensity,float scale);
+/** An n-gram of a sentence and the number of times it occurs */
+struct NgramCount {
+  NgramHash hash;
+  size_t order;
+  size_t count;
+};
+
+//Prune to edgeDensity edges per word of the MAP translation, keeping the edges of the best (fwd-bwd) hyps
+void pruneLatticeFB(const Moses::ForwardBackwardSearchGraph &graph, MBRLattice& lattice,
+                    const Moses::Hypothesis*, size_t edgeDensity,float scale);
 
 //Use the ngram scores to rerank the nbest list, return at most n solutions
 void getLatticeMBRNBest(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList, std::vector<LatticeMBRSolution>& solutions, size_t n);
 //calculate expectated ngram counts, clipping at 1 (ie calculating posteriors) if posteriors==true.
-void calcNgramExpectations(Lattice & connectedHyp, std::map<const Moses::Hypothesis*, std::vector<Edge> >& incomingEdges, std::map<Moses::Phrase,
-                           float>& finalNgramScores, bool posteriors);
+void calcNgramExpectations(const MBRLattice& lattice, NgramTable& finalNgramScores, bool posteriors);
 void GetOutputFactors(const Moses::TrellisPath &path, std::vector <Moses::Word> &translation);
-void extract_ngrams(const std::vector<Moses::Word >& sentence, std::map < Moses::Phrase, int >  & allngrams);
+void extract_ngrams(const std::vector<Moses::Word >& sentence, std::vector<NgramCount>& allngrams);
 bool ascendingCoverageCmp(const Moses::Hypothesis* a, const Moses::Hypothesis* b);
 std::vector<Moses::Word> doLatticeMBR(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList);
 const Moses::TrellisPath doConsensusDecoding(const Moses::Manager& manager, const Moses::TrellisPathList& nBestList);
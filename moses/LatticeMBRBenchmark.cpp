@@ -0,0 +1,264 @@
+// Time the n-gram expectation step of lattice MBR and consensus decoding
+// (calcNgramExpectations) on synthetic lattices, against a reference that
+// keeps the n-gram histories in maps keyed by Phrase and edge paths, as the
+// lattice MBR code did before MBRLattice.  Both must find the same n-grams
+// with the same scores.
+//
+// usage: lattice_mbr_benchmark [lattices [vertices [max-in-degree]]]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "moses/FactorCollection.h"
+#include "moses/LatticeMBR.h"
+#include "moses/Util.h"
+
+using namespace std;
+using namespace Moses;
+
+namespace
+{
+
+const size_t kOrder = 4;
+
+double Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Vertices in topological order; each one has 1..maxInDegree incoming edges
+// from the few vertices before it, with a phrase of 1-3 words.
+void MakeLattice(size_t numVertices, size_t maxInDegree,
+                 const vector<Word> &vocab, deque<Phrase> &phrases,
+                 MBRLattice &lattice)
+{
+  lattice.Clear();
+  lattice.AddVertex(false);
+  for (size_t v = 1; v < numVertices; ++v) {
+    lattice.AddVertex(v + 5 >= numVertices);
+    size_t inDegree = 1 + rand() % maxInDegree;
+    for (size_t e = 0; e < inDegree; ++e) {
+      size_t back = 1 + rand() % min<size_t>(v, 6);
+      phrases.push_back(Phrase(3));
+      size_t length = 1 + rand() % 3;
+      for (size_t w = 0; w < length; ++w) {
+        phrases.back().AddWord(vocab[rand() % vocab.size()]);
+      }
+      float score = -2.0f * rand() / RAND_MAX;
+      lattice.AddEdge(v - back, v, score, phrases.back());
+    }
+  }
+  lattice.Finish();
+}
+
+// The reference: n-gram histories per edge in maps of paths of edge ids
+typedef vector<size_t> Path;
+typedef map<Path, size_t> PathCounts;
+typedef map<Phrase, PathCounts> NgramHistory;
+
+class Reference
+{
+public:
+  explicit Reference(const MBRLattice &lattice)
+    : m_lattice(lattice), m_histories(lattice.GetNumEdges()), m_done(lattice.GetNumEdges(), false) {}
+
+  void CalcExpectations(map<Phrase, float> &finalNgramScores, bool posteriors);
+
+private:
+  const NgramHistory &GetNgrams(size_t edge);
+  void AddScore(size_t vertex, const Phrase &ngram, float score);
+
+  const MBRLattice &m_lattice;
+  vector<NgramHistory> m_histories;
+  vector<bool> m_done;
+  set<Phrase> m_ngrams;
+  map<size_t, map<const Phrase*, float> > m_scores;
+};
+
+void Reference::AddScore(size_t vertex, const Phrase &ngram, float score)
+{
+  const Phrase *key = &*m_ngrams.insert(ngram).first;
+  map<const Phrase*, float> &scores = m_scores[vertex];
+  map<const Phrase*, float>::iterator it = scores.find(key);
+  if (it == scores.end()) {
+    scores[key] = score;
+  } else {
+    it->second = log_sum(score, it->second);
+  }
+}
+
+const NgramHistory &Reference::GetNgrams(size_t e)
+{
+  NgramHistory &ngrams = m_histories[e];
+  if (m_done[e]) return ngrams;
+  m_done[e] = true;
+
+  const MBRLattice::Edge &edge = m_lattice.GetEdge(e);
+  const Phrase &words = *edge.words;
+  for (size_t start = 0; start < words.GetSize(); ++start) {
+    for (size_t end = start; end < start + kOrder && end < words.GetSize(); ++end) {
+      Phrase ngram(end - start + 1);
+      for (size_t i = start; i <= end; ++i) ngram.AddWord(words.GetWord(i));
+      ngrams[ngram][Path(1, e)] += 1;
+    }
+  }
+
+  for (size_t in = m_lattice.InBegin(edge.tail); in < m_lattice.InEnd(edge.tail); ++in) {
+    const NgramHistory &incoming = GetNgrams(in);
+    const Phrase &inWords = *m_lattice.GetEdge(in).words;
+    for (NgramHistory::const_iterator it = incoming.begin(); it != incoming.end(); ++it) {
+      const Phrase &inNgram = it->first;
+      // only n-grams that end the incoming edge can be extended
+      size_t back = min(inNgram.GetSize(), inWords.GetSize());
+      bool isSuffix = true;
+      for (size_t i = 1; i <= back && isSuffix; ++i) {
+        isSuffix = inNgram.GetWord(inNgram.GetSize() - i) == inWords.GetWord(inWords.GetSize() - i);
+      }
+      if (!isSuffix) continue;
+      for (size_t i = 0; i < words.GetSize() && i + inNgram.GetSize() < kOrder; ++i) {
+        Phrase ngram(inNgram);
+        for (size_t j = 0; j <= i; ++j) ngram.AddWord(words.GetWord(j));
+        for (PathCounts::const_iterator path = it->second.begin(); path != it->second.end(); ++path) {
+          Path extended(path->first);
+          extended.push_back(e);
+          ngrams[ngram][extended] += path->second;
+        }
+      }
+    }
+  }
+  return ngrams;
+}
+
+void Reference::CalcExpectations(map<Phrase, float> &finalNgramScores, bool posteriors)
+{
+  const size_t numVertices = m_lattice.GetSize();
+  vector<float> forwardScore(numVertices, 0.0f);
+  float Z = 0;
+  bool haveZ = false;
+
+  for (size_t v = 1; v < numVertices; ++v) {
+    for (size_t e = m_lattice.InBegin(v); e < m_lattice.InEnd(v); ++e) {
+      const MBRLattice::Edge &edge = m_lattice.GetEdge(e);
+      float score = forwardScore[edge.tail] + edge.score;
+      forwardScore[v] = e == m_lattice.InBegin(v) ? score : log_sum(forwardScore[v], score);
+    }
+
+    for (size_t e = m_lattice.InBegin(v); e < m_lattice.InEnd(v); ++e) {
+      const MBRLattice::Edge &edge = m_lattice.GetEdge(e);
+      const NgramHistory &ngrams = GetNgrams(e);
+      for (NgramHistory::const_iterator it = ngrams.begin(); it != ngrams.end(); ++it) {
+        for (PathCounts::const_iterator path = it->second.begin(); path != it->second.end(); ++path) {
+          float score = forwardScore[m_lattice.GetEdge(path->first[0]).tail];
+          for (size_t i = 0; i < path->first.size(); ++i) {
+            score += m_lattice.GetEdge(path->first[i]).score;
+          }
+          size_t count = posteriors ? 1 : path->second;
+          for (size_t k = 0; k < count; ++k) AddScore(v, it->first, score);
+        }
+      }
+      const map<const Phrase*, float> &tailScores = m_scores[edge.tail];
+      for (map<const Phrase*, float>::const_iterator it = tailScores.begin(); it != tailScores.end(); ++it) {
+        if (!posteriors || ngrams.find(*it->first) == ngrams.end()) {
+          AddScore(v, *it->first, edge.score + it->second);
+        }
+      }
+    }
+
+    if (m_lattice.IsFinal(v)) {
+      map<const Phrase*, float> &scores = m_scores[v];
+      for (map<const Phrase*, float>::const_iterator it = scores.begin(); it != scores.end(); ++it) {
+        map<Phrase, float>::iterator found = finalNgramScores.find(*it->first);
+        if (found == finalNgramScores.end()) {
+          finalNgramScores[*it->first] = it->second;
+        } else {
+          found->second = log_sum(it->second, found->second);
+        }
+      }
+      Z = haveZ ? log_sum(Z, forwardScore[v]) : forwardScore[v];
+      haveZ = true;
+    }
+  }
+
+  for (map<Phrase, float>::iterator it = finalNgramScores.begin(); it != finalNgramScores.end(); ++it) {
+    it->second -= Z;
+  }
+}
+
+// The n-grams are keyed differently, so compare the sorted (order, score)
+// pairs
+bool SameScores(const map<Phrase, float> &reference, const NgramTable &table)
+{
+  vector<pair<size_t, float> > a, b;
+  for (map<Phrase, float>::const_iterator it = reference.begin(); it != reference.end(); ++it) {
+    a.push_back(make_pair(it->first.GetSize(), it->second));
+  }
+  for (NgramTable::const_iterator it = table.begin(); it != table.end(); ++it) {
+    b.push_back(make_pair(table.GetEntry(it).order, table.GetEntry(it).score));
+  }
+  if (a.size() != b.size()) return false;
+  sort(a.begin(), a.end());
+  sort(b.begin(), b.end());
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].first != b[i].first || fabs(a[i].second - b[i].second) > 1e-3) return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t numLattices = argc > 1 ? atol(argv[1]) : 20;
+  size_t numVertices = argc > 2 ? atol(argv[2]) : 150;
+  size_t maxInDegree = argc > 3 ? atol(argv[3]) : 3;
+
+  vector<Word> vocab;
+  for (size_t i = 0; i < 50; ++i) {
+    ostringstream str;
+    str << "w" << i;
+    Word word;
+    word.SetFactor(0, FactorCollection::Instance().AddFactor(str.str()));
+    vocab.push_back(word);
+  }
+
+  srand(1234);
+  double referenceTime = 0, csrTime = 0;
+  for (size_t l = 0; l < numLattices; ++l) {
+    deque<Phrase> phrases;
+    MBRLattice lattice;
+    MakeLattice(numVertices, maxInDegree, vocab, phrases, lattice);
+
+    for (int posteriors = 0; posteriors < 2; ++posteriors) {
+      map<Phrase, float> expected;
+      double start = Now();
+      Reference(lattice).CalcExpectations(expected, posteriors);
+      referenceTime += Now() - start;
+
+      NgramTable table;
+      start = Now();
+      calcNgramExpectations(lattice, table, posteriors);
+      csrTime += Now() - start;
+
+      if (!SameScores(expected, table)) {
+        cerr << "n-gram " << (posteriors ? "posteriors" : "expectations")
+             << " of lattice " << l << " differ from the reference" << endl;
+        return 1;
+      }
+    }
+  }
+  cout << numLattices << " lattices of " << numVertices << " vertices, posteriors and expectations" << endl;
+  cout << "maps of paths: " << referenceTime << " s" << endl;
+  cout << "MBRLattice: " << csrTime << " s, " << referenceTime / csrTime << "x" << endl;
+  return 0;
+}
@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TargetPhrase.h"
 #include "TrellisPath.h"
 #include "TrellisPathCollection.h"
+#include "TrellisPathEnumerator.h"
 #include "TranslationOption.h"
 #include "TranslationOptionCollection.h"
 #include "Timer.h"
@@ -247,7 +248,7 @@ printThisHypothesis(long translationId, const Hypothesis* hypo,
 /**
  * After decoding, the hypotheses in the stacks and additional arcs
  * form a search graph that can be mined for n-best lists.
- * The heavy lifting is done in the TrellisPath and TrellisPathCollection
+ * The heavy lifting is done in the TrellisPath and TrellisPathEnumerator
  * this function controls this for one sentence.
  *
  * \param count the number of n-best translations to produce
@@ -265,17 +266,12 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret, bool onlyDistinct) c
   if (sortedPureHypo.size() == 0)
     return;
 
-  TrellisPathCollection contenders;
+  // all pure paths, then their deviations lazily
+  TrellisPathEnumerator contenders(sortedPureHypo);
 
-  set<Phrase> distinctHyps;
-
-  // add all pure paths
-  vector<const Hypothesis*>::const_iterator iterBestHypo;
-  for (iterBestHypo = sortedPureHypo.begin()
-                      ; iterBestHypo != sortedPureHypo.end()
-       ; ++iterBestHypo) {
-    contenders.Add(new TrellisPath(*iterBestHypo));
-  }
+  // surface hashes of the distinct paths kept so far
+  typedef boost::unordered_multimap<size_t, const TrellisPath*> DistinctHyps;
+  DistinctHyps distinctHyps;
 
   // factor defines stopping point for distinct n-best list if too
   // many candidates identical
@@ -283,32 +279,26 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret, bool onlyDistinct) c
   if (nBestFactor < 1) nBestFactor = 1000; // 0 = unlimited
 
   // MAIN loop
-  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
+  for (size_t iteration = 0 ; ret.GetSize() < count && !contenders.Empty() && (iteration < count * nBestFactor) ; iteration++) {
     // get next best from list of contenders
-    TrellisPath *path = contenders.pop();
-    UTIL_THROW_IF2(path == NULL, "path is NULL");
-    // create deviations from current best
-    path->CreateDeviantPaths(contenders);
+    TrellisPath *path = contenders.Next();
     if(onlyDistinct) {
-      Phrase tgtPhrase = path->GetSurfacePhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
-        ret.Add(path);
-      } else {
+      const size_t hash = path->GetSurfaceHash();
+      std::pair<DistinctHyps::const_iterator, DistinctHyps::const_iterator> same = distinctHyps.equal_range(hash);
+      bool isNew = true;
+      if (same.first != same.second) {
+        const Phrase tgtPhrase = path->GetSurfacePhrase();
+        for (DistinctHyps::const_iterator i = same.first; i != same.second && isNew; ++i) {
+          isNew = !(i->second->GetSurfacePhrase() == tgtPhrase);
+        }
+      }
+      if (!isNew) {
         delete path;
-        path = NULL;
+        continue;
       }
-    } else {
-      ret.Add(path);
-    }
-
-
-    if(onlyDistinct) {
-      const size_t nBestFactor = options()->nbest.factor;
-      if (nBestFactor > 0)
-        contenders.Prune(count * nBestFactor);
-    } else {
-      contenders.Prune(count);
+      distinctHyps.insert(std::make_pair(hash, path));
     }
+    ret.Add(path);
   }
 }
 
@@ -1347,88 +1337,113 @@ OutputSearchGraph(long translationId, std::ostream &out) const
   }
 }
 
+size_t ForwardBackwardSearchGraph::GetDenseId(const Hypothesis *hypo) const
+{
+  if (hypo == NULL || (size_t)hypo->GetId() >= denseId.size()) return NOT_FOUND;
+  return denseId[hypo->GetId()];
+}
+
 void
 Manager::
-GetForwardBackwardSearchGraph
-( std::map< int, bool >* pConnected,
-  std::vector<Hypothesis const* >* pConnectedList,
-  std::map<Hypothesis const*, set<Hypothesis const*> >* pOutgoingHyps,
-  vector< float>* pFwdBwdScores) const
+GetForwardBackwardSearchGraph(ForwardBackwardSearchGraph &graph) const
 {
-  std::map < int, bool > &connected = *pConnected;
-  std::vector< const Hypothesis *>& connectedList = *pConnectedList;
-  std::map < int, int > forward;
-  std::map < int, double > forwardScore;
+  std::vector<const Hypothesis*> &hyps = graph.hyps;
+  std::vector<size_t> &denseId = graph.denseId;
+  hyps.clear();
+  denseId.assign(m_hypoId, NOT_FOUND);
 
-  std::map < const Hypothesis*, set <const Hypothesis*> > & outgoingHyps
-  = *pOutgoingHyps;
-  vector< float> & estimatedScores = *pFwdBwdScores;
-
-  // *** find connected hypotheses ***
-  GetWinnerConnectedGraph(&connected, &connectedList);
-
-  // ** compute best forward path for each hypothesis *** //
-
-  // forward cost of hypotheses on final stack is 0
+  // *** find connected hypotheses, starting with the final stack ***
   const std::vector < HypothesisStack* > &hypoStackColl
   = m_search->GetHypothesisStacks();
   const HypothesisStack &finalStack = *hypoStackColl.back();
   HypothesisStack::const_iterator iterHypo;
   for (iterHypo = finalStack.begin() ; iterHypo != finalStack.end() ; ++iterHypo) {
     const Hypothesis *hypo = *iterHypo;
-    forwardScore[ hypo->GetId() ] = 0.0f;
-    forward[ hypo->GetId() ] = -1;
+    denseId[hypo->GetId()] = hyps.size();
+    hyps.push_back(hypo);
+  }
+
+  // move back from known connected hypotheses; the empty hypothesis is added
+  // last
+  const Hypothesis *emptyHypo = NULL;
+  for (size_t i = 0; i < hyps.size(); ++i) {
+    const Hypothesis *hypo = hyps[i];
+    const ArcList *arcList = hypo->GetArcList();
+    size_t numPrev = 1 + (arcList ? arcList->size() : 0);
+    for (size_t a = 0; a < numPrev; ++a) {
+      const Hypothesis *prevHypo = a == 0 ? hypo->GetPrevHypo() : (*arcList)[a - 1]->GetPrevHypo();
+      if (prevHypo->GetId() == 0) {
+        emptyHypo = prevHypo;
+      } else if (denseId[prevHypo->GetId()] == NOT_FOUND) {
+        denseId[prevHypo->GetId()] = hyps.size();
+        hyps.push_back(prevHypo);
+      }
+    }
+  }
+  UTIL_THROW_IF2(emptyHypo == NULL, "No path from the final stack to the empty hypothesis");
+  denseId[0] = hyps.size();
+  hyps.push_back(emptyHypo);
+  const size_t numHyps = hyps.size();
+
+  // ** compute best forward path for each hypothesis, and its edges *** //
+
+  // forward cost of hypotheses on final stack is 0
+  std::vector<double> forwardScore(numHyps, 0.0);
+  std::vector<bool> hasForwardScore(numHyps, false);
+  for (size_t i = 0; i < finalStack.size(); ++i) {
+    hasForwardScore[i] = true;
   }
+  std::vector<std::pair<size_t, size_t> > edges;
 
   // compete for best forward score of previous hypothesis
   std::vector < HypothesisStack* >::const_iterator iterStack;
   for (iterStack = --hypoStackColl.end() ; iterStack != hypoStackColl.begin() ; --iterStack) {
     const HypothesisStack &stack = **iterStack;
-    HypothesisStack::const_iterator iterHypo;
     for (iterHypo = stack.begin() ; iterHypo != stack.end() ; ++iterHypo) {
       const Hypothesis *hypo = *iterHypo;
-      if (connected.find( hypo->GetId() ) != connected.end()) {
-        // make a play for previous hypothesis
-        const Hypothesis *prevHypo = hypo->GetPrevHypo();
-        double fscore = forwardScore[ hypo->GetId() ] +
-                        hypo->GetScore() - prevHypo->GetScore();
-        if (forwardScore.find( prevHypo->GetId() ) == forwardScore.end()
-            || forwardScore.find( prevHypo->GetId() )->second < fscore) {
-          forwardScore[ prevHypo->GetId() ] = fscore;
-          forward[ prevHypo->GetId() ] = hypo->GetId();
+      const size_t curr = denseId[hypo->GetId()];
+      if (curr == NOT_FOUND) continue;
+
+      // the best previous hypothesis and all arcs make a play
+      const ArcList *arcList = hypo->GetArcList();
+      size_t numPrev = 1 + (arcList ? arcList->size() : 0);
+      for (size_t a = 0; a < numPrev; ++a) {
+        const Hypothesis *edgeHypo = a == 0 ? hypo : (*arcList)[a - 1];
+        const Hypothesis *prevHypo = edgeHypo->GetPrevHypo();
+        const size_t prev = denseId[prevHypo->GetId()];
+        double fscore = forwardScore[curr] +
+                        edgeHypo->GetScore() - prevHypo->GetScore();
+        if (!hasForwardScore[prev] || forwardScore[prev] < fscore) {
+          forwardScore[prev] = fscore;
+          hasForwardScore[prev] = true;
         }
         //store outgoing info
-        outgoingHyps[prevHypo].insert(hypo);
-
-        // all arcs also make a play
-        const ArcList *arcList = hypo->GetArcList();
-        if (arcList != NULL) {
-          ArcList::const_iterator iterArcList;
-          for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
-            const Hypothesis *loserHypo = *iterArcList;
-            // make a play
-            const Hypothesis *loserPrevHypo = loserHypo->GetPrevHypo();
-            double fscore = forwardScore[ hypo->GetId() ] +
-                            loserHypo->GetScore() - loserPrevHypo->GetScore();
-            if (forwardScore.find( loserPrevHypo->GetId() ) == forwardScore.end()
-                || forwardScore.find( loserPrevHypo->GetId() )->second < fscore) {
-              forwardScore[ loserPrevHypo->GetId() ] = fscore;
-              forward[ loserPrevHypo->GetId() ] = loserHypo->GetId();
-            }
-            //store outgoing info
-            outgoingHyps[loserPrevHypo].insert(hypo);
-
-
-          } // end for arc list
-        } // end if arc list empty
-      } // end if hypo connected
+        edges.push_back(std::make_pair(prev, curr));
+      }
     } // end for hypo
   } // end for stack
 
-  for (std::vector< const Hypothesis *>::iterator it = connectedList.begin(); it != connectedList.end(); ++it) {
-    float estimatedScore = (*it)->GetScore() + forwardScore[(*it)->GetId()];
-    estimatedScores.push_back(estimatedScore);
+  // successors in CSR form, without duplicates
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  graph.outBegin.assign(numHyps + 1, 0);
+  graph.outSucc.clear();
+  for (size_t e = 0; e < edges.size(); ++e) {
+    ++graph.outBegin[edges[e].first + 1];
+    graph.outSucc.push_back(edges[e].second);
+  }
+  for (size_t i = 0; i < numHyps; ++i) {
+    graph.outBegin[i + 1] += graph.outBegin[i];
+  }
+
+  graph.estimatedScores.clear();
+  float bestScore = -std::numeric_limits<float>::infinity();
+  for (size_t i = 0; i + 1 < numHyps; ++i) {
+    float estimatedScore = hyps[i]->GetScore() + forwardScore[i];
+    graph.estimatedScores.push_back(estimatedScore);
+    bestScore = std::max(bestScore, estimatedScore);
   }
+  graph.estimatedScores.push_back(bestScore);
 }
 
 
@@ -64,6 +64,25 @@ struct SearchGraphNode {
 
 };
 
+/** The part of the search graph that is connected to the final stack, as used
+ * by lattice MBR.  Hypotheses are numbered densely by their index in hyps,
+ * with the empty hypothesis last, and the successors of each hypothesis are
+ * contiguous (CSR).
+ */
+struct ForwardBackwardSearchGraph {
+  std::vector<const Hypothesis*> hyps;
+  //! index in hyps by Hypothesis::GetId(), NOT_FOUND if not connected
+  std::vector<size_t> denseId;
+  //! score of the best path through each hypothesis; the empty hypothesis
+  //! gets the best score of all
+  std::vector<float> estimatedScores;
+  //! successors of hyps[i] are outSucc[outBegin[i]] .. outSucc[outBegin[i+1]-1]
+  std::vector<size_t> outBegin;
+  std::vector<size_t> outSucc;
+
+  size_t GetDenseId(const Hypothesis *hypo) const;
+};
+
 /** The Manager class implements a stack decoding algorithm for phrase-based decoding
  * Hypotheses are organized in stacks. One stack contains all hypothesis that have
  * the same number of foreign words translated.  The data structure for hypothesis
@@ -192,12 +211,7 @@ public:
   /***
    *For Lattice MBR
   */
-  void
-  GetForwardBackwardSearchGraph
-  ( std::map< int, bool >* pConnected,
-    std::vector< const Hypothesis* >* pConnectedList,
-    std::map < const Hypothesis*, std::set < const Hypothesis* > >* pOutgoingHyps,
-    std::vector< float>* pFwdBwdScores) const;
+  void GetForwardBackwardSearchGraph(ForwardBackwardSearchGraph &graph) const;
 
   // outputs
   void OutputBest(OutputCollector *collector)  const;
@@ -68,6 +68,8 @@ Parameter::Parameter()
   // one should be able to specify different factor delimiters for intput and output
   AddParam(factor_opts,"mapping", "description of decoding steps"); // whatever that means ...
   AddParam(factor_opts,"placeholder-factor", "Which source factor to use to store the original text for placeholders. The factor must not be used by a translation or gen model");
+  AddParam(factor_opts,"factor-vocab", "load a vocabulary saved with -save-factor-vocab before the models. Lookups of its words take no lock");
+  AddParam(factor_opts,"save-factor-vocab", "after loading the models, save all factor strings for -factor-vocab");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // general search options
@@ -109,6 +111,7 @@ Parameter::Parameter()
   AddParam(search_opts,"disable-discarding", "dd", "disable hypothesis discarding"); // ??? memory management? UG
   AddParam(search_opts,"phrase-drop-allowed", "da", "if present, allow dropping of source words"); //da = drop any (word); see -du for comparison
   AddParam(search_opts,"threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam(search_opts,"load-threads", "number of threads to use for loading feature functions and phrase tables (defaults to 1)");
 
   // distortion options
   po::options_description disto_opts("Distortion options");
@@ -122,6 +125,7 @@ Parameter::Parameter()
   AddParam(cube_opts,"cube-pruning-pop-limit", "cbp", "How many hypotheses should be popped for each stack. (default = 1000)");
   AddParam(cube_opts,"cube-pruning-diversity", "cbd", "How many hypotheses should be created for each coverage. (default = 0)");
   AddParam(cube_opts,"cube-pruning-lazy-scoring", "cbls", "Don't fully score a hypothesis until it is popped");
+  AddParam(cube_opts,"cube-pruning-lazy-gate", "cblg", "With lazy scoring, how many popped hyperedges the syntax decoders may score before returning the best of them (default = 8)");
   AddParam(cube_opts,"cube-pruning-deterministic-search", "cbds", "Break ties deterministically during search");
 
   ///////////////////////////////////////////////////////////////////////////////////////
@@ -198,7 +202,7 @@ Parameter::Parameter()
 #ifdef HAVE_PROTOBUF
   AddParam(osg_opts,"output-search-graph-pb", "pb", "Write phrase lattice to protocol buffer objects in the specified path.");
 #endif
-  AddParam(osg_opts,"output-search-graph-hypergraph", "DEPRECATED! Output connected hypotheses of search into specified directory, one file per sentence, in a hypergraph format (see Kenneth Heafield's lazy hypergraph decoder). This flag is followed by 3 values: 'true (gz|txt|bz) directory-name'");
+  AddParam(osg_opts,"output-search-graph-hypergraph", "DEPRECATED! Output connected hypotheses of search into specified directory, one file per sentence, in a hypergraph format (see Kenneth Heafield's lazy hypergraph decoder). This flag is followed by 3 values: 'true (gz|txt|bz|bin) directory-name'. 'bin' is a binary format that mert reads by memory mapping");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // nbest-options
@@ -51,6 +51,22 @@ RuleCube::RuleCube(const ChartTranslationOptions &transOpt,
   m_queue.push(item);
 }
 
+RuleCube::RuleCube(const ChartTranslationOptions &transOpt,
+                   const ChartCellCollection &allChartCells,
+                   ChartManager &manager,
+                   std::vector<ChartHypothesis*> &batch,
+                   std::vector<RuleCubeItem*> &items)
+  : m_transOpt(transOpt)
+{
+  RuleCubeItem *item = new RuleCubeItem(transOpt, allChartCells);
+  m_covered.insert(item);
+  batch.push_back(item->CreateUnscoredHypothesis(transOpt, manager));
+  items.push_back(item);
+  // a queue with a single element needs no ordering, so the item can go in
+  // before it has a score
+  m_queue.push(item);
+}
+
 RuleCube::~RuleCube()
 {
   RemoveAllInColl(m_covered);
@@ -89,6 +89,13 @@ public:
   RuleCube(const ChartTranslationOptions &, const ChartCellCollection &,
            ChartManager &);
 
+  // Creates the top-left corner item without scoring it. Its hypothesis is
+  // appended to batch and the item to items; the caller must call
+  // RuleCubeItem::EvaluateHypothesis() on it before using the cube.
+  RuleCube(const ChartTranslationOptions &, const ChartCellCollection &,
+           ChartManager &, std::vector<ChartHypothesis*> &batch,
+           std::vector<RuleCubeItem*> &items);
+
   ~RuleCube();
 
   float GetTopScore() const {
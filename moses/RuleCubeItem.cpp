@@ -77,8 +77,20 @@ void RuleCubeItem::EstimateScore()
 
 void RuleCubeItem::CreateHypothesis(const ChartTranslationOptions &transOpt,
                                     ChartManager &manager)
+{
+  CreateUnscoredHypothesis(transOpt, manager);
+  EvaluateHypothesis();
+}
+
+ChartHypothesis *RuleCubeItem::CreateUnscoredHypothesis(
+  const ChartTranslationOptions &transOpt, ChartManager &manager)
 {
   m_hypothesis = new ChartHypothesis(transOpt, *this, manager);
+  return m_hypothesis;
+}
+
+void RuleCubeItem::EvaluateHypothesis()
+{
   m_hypothesis->EvaluateWhenApplied();
   m_score = m_hypothesis->GetFutureScore();
 }
@@ -133,6 +133,13 @@ public:
 
   void CreateHypothesis(const ChartTranslationOptions &, ChartManager &);
 
+  // Like CreateHypothesis() but leaves the feature evaluation to a later
+  // call to EvaluateHypothesis(), so that hypotheses can be scored in batches.
+  ChartHypothesis *CreateUnscoredHypothesis(const ChartTranslationOptions &,
+      ChartManager &);
+
+  void EvaluateHypothesis();
+
   ChartHypothesis *ReleaseHypothesis();
 
   bool operator<(const RuleCubeItem &) const;
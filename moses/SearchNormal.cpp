@@ -2,6 +2,7 @@
 #include "Timer.h"
 #include "SearchNormal.h"
 #include "SentenceStats.h"
+#include "FF/StatefulFeatureFunction.h"
 
 #include <boost/foreach.hpp>
 
@@ -20,6 +21,7 @@ SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl)
   : Search(manager)
   , m_hypoStackColl(manager.GetSource().GetSize() + 1)
   , m_transOptColl(transOptColl)
+  , m_batchedFFs(StatefulFeatureFunction::GetBatchedFeatureFunctions())
 {
   VERBOSE(1, "Translating: " << m_source << endl);
 
@@ -36,6 +38,7 @@ SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl)
 
 SearchNormal::~SearchNormal()
 {
+  RemoveAllInColl(m_pendingHypos);
   RemoveAllInColl(m_hypoStackColl);
 }
 
@@ -62,6 +65,7 @@ ProcessOneStack(HypothesisStack* hstack)
   HypothesisStackNormal::const_iterator h;
   for (h = sourceHypoColl.begin(); h != sourceHypoColl.end(); ++h)
     ProcessOneHypothesis(**h);
+  EvaluatePendingHypotheses();
   return true;
 }
 
@@ -294,6 +298,13 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
     }
     if (newHypo==NULL) return;
 
+    if (!m_batchedFFs.empty()) {
+      // scored together with all other expansions of the current stack
+      m_pendingHypos.push_back(newHypo);
+      m_pendingEstimatedScores.push_back(estimatedScore);
+      return;
+    }
+
     IFVERBOSE(2) {
       m_manager.GetSentenceStats().StartTimeOtherScore();
     }
@@ -356,12 +367,47 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
 
   }
 
+  AddToStack(newHypo);
+}
+
+/**
+ * Score the expansions collected by ExpandHypothesis() in one batch and add
+ * them to their stacks. Batched features see the whole minibatch first, then
+ * every hypothesis is evaluated as usual.
+ */
+void SearchNormal::EvaluatePendingHypotheses()
+{
+  if (m_pendingHypos.empty()) return;
+
+  IFVERBOSE(2) {
+    m_manager.GetSentenceStats().StartTimeOtherScore();
+  }
+  for (size_t i = 0; i < m_batchedFFs.size(); ++i) {
+    m_batchedFFs[i]->EvaluateWhenAppliedBatch(m_pendingHypos);
+  }
+  for (size_t i = 0; i < m_pendingHypos.size(); ++i) {
+    m_pendingHypos[i]->EvaluateWhenApplied(m_pendingEstimatedScores[i]);
+  }
+  IFVERBOSE(2) {
+    m_manager.GetSentenceStats().StopTimeOtherScore();
+  }
+
+  for (size_t i = 0; i < m_pendingHypos.size(); ++i) {
+    AddToStack(m_pendingHypos[i]);
+  }
+  m_pendingHypos.clear();
+  m_pendingEstimatedScores.clear();
+}
+
+void SearchNormal::AddToStack(Hypothesis *newHypo)
+{
   // logging for the curious
   IFVERBOSE(3) {
     newHypo->PrintHypothesis();
   }
 
   // add to hypothesis stack
+  SentenceStats &stats = m_manager.GetSentenceStats();
   size_t wordsTranslated = newHypo->GetWordsBitmap().GetNumWordsCovered();
   IFVERBOSE(2) {
     stats.StartTimeStack();
@@ -30,6 +30,12 @@ protected:
   /** pre-computed list of translation options for the phrases in this sentence */
   const TranslationOptionCollection &m_transOptColl;
 
+  /** stateful features that score expansions in batches; if there are any,
+   *  expansions of a stack are collected and scored together */
+  std::vector<const StatefulFeatureFunction*> m_batchedFFs;
+  std::vector<Hypothesis*> m_pendingHypos;
+  std::vector<float> m_pendingEstimatedScores;
+
   // functions for creating hypotheses
 
   virtual bool
@@ -48,6 +54,12 @@ protected:
                    float estimatedScore,
                    const Bitmap &bitmap);
 
+  virtual void
+  EvaluatePendingHypotheses();
+
+  void
+  AddToStack(Hypothesis *hypo);
+
 public:
   SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl);
   ~SearchNormal();
@@ -47,6 +47,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TranslationModel/PhraseDictionary.h"
 #include "TranslationModel/PhraseDictionaryTreeAdaptor.h"
 
+#include "ThreadPool.h"
+#include "util/usage.hh"
+
 #ifdef WITH_THREADS
 #include <boost/thread.hpp>
 #endif
@@ -171,6 +174,19 @@ StaticData
 #endif
     }
   }
+
+  m_parameter->SetParameter<size_t>(m_loadThreadCount, "load-threads", 1);
+  if (m_loadThreadCount < 1) {
+    std::cerr << "Specify at least one load thread.";
+    return false;
+  }
+#ifndef WITH_THREADS
+  if (m_loadThreadCount > 1) {
+    std::cerr << "Error: Load thread count of " << m_loadThreadCount
+              << " but moses not built with thread support";
+    return false;
+  }
+#endif
   return true;
 }
 
@@ -180,6 +196,15 @@ bool StaticData::LoadData(Parameter *parameter)
 
   const PARAM_VEC *params;
 
+  // before anything adds factors, so that ids match the saved vocabulary
+  string factorVocab;
+  m_parameter->SetParameter<string>(factorVocab, "factor-vocab", "");
+  if (!factorVocab.empty()) {
+    FactorCollection::Instance().LoadVocab(factorVocab);
+    VERBOSE(1, "Loaded " << FactorCollection::Instance().GetNumFrozen()
+            << " factors from " << factorVocab << endl);
+  }
+
   m_options->init(*parameter);
   if (is_syntax(m_options->search.algo))
     m_options->syntax.LoadNonTerminals(*parameter, FactorCollection::Instance());
@@ -247,6 +272,12 @@ bool StaticData::LoadData(Parameter *parameter)
   if (params && params->size() && !LoadAlternateWeightSettings())
     return false;
 
+  string saveFactorVocab;
+  m_parameter->SetParameter<string>(saveFactorVocab, "save-factor-vocab", "");
+  if (!saveFactorVocab.empty()) {
+    FactorCollection::Instance().SaveVocab(saveFactorVocab);
+  }
+
   return true;
 }
 
@@ -592,36 +623,133 @@ CleanUpAfterSentenceProcessing(ttasksptr const& ttask) const
   }
 }
 
+namespace
+{
+void LoadFeatureFunction(FeatureFunction &ff, AllOptions::ptr const& opts)
+{
+  VERBOSE(1, "Loading " << ff.GetScoreProducerDescription() << endl);
+#ifdef TRACE_ENABLE
+  const double start = util::WallTime();
+#endif
+  ff.Load(opts);
+  // Peak RSS is for the whole process, so with -load-threads it also
+  // covers the features being loaded at the same time.
+  VERBOSE(1, "Loaded " << ff.GetScoreProducerDescription() << " in "
+          << (util::WallTime() - start) << " seconds, peak RSS "
+          << (util::RSSMax() >> 20) << " MB" << endl);
+}
+
+#ifdef WITH_THREADS
+class LoadFeatureFunctionTask : public Task
+{
+public:
+  LoadFeatureFunctionTask(FeatureFunction &ff, AllOptions::ptr const& opts)
+    : m_ff(ff), m_options(opts) {}
+
+  void Run() {
+    try {
+      LoadFeatureFunction(m_ff, m_options);
+    } catch (const std::exception &e) {
+      m_error = e.what();
+    }
+  }
+
+  const std::string &GetError() const {
+    return m_error;
+  }
+
+private:
+  FeatureFunction &m_ff;
+  AllOptions::ptr m_options;
+  std::string m_error;
+};
+#endif
+}
+
 void StaticData::LoadFeatureFunctions()
 {
-  const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+#ifdef TRACE_ENABLE
+  const double start = util::WallTime();
+#endif
+
+  // All other features before the phrase tables: in-memory tables run the
+  // stateless features on each rule as they load.
+  std::vector<FeatureFunction*> ffs;
+  const std::vector<FeatureFunction*> &all = FeatureFunction::GetFeatureFunctions();
   std::vector<FeatureFunction*>::const_iterator iter;
-  for (iter = ffs.begin(); iter != ffs.end(); ++iter) {
+  for (iter = all.begin(); iter != all.end(); ++iter) {
     FeatureFunction *ff = *iter;
-    bool doLoad = true;
 
     if (ff->RequireSortingAfterSourceContext()) {
       m_requireSortingAfterSourceContext = true;
     }
 
-    if (dynamic_cast<PhraseDictionary*>(ff)) {
-      doLoad = false;
+    if (!dynamic_cast<PhraseDictionary*>(ff)) {
+      ffs.push_back(ff);
     }
+  }
+  LoadFeatureFunctions(ffs);
 
-    if (doLoad) {
-      VERBOSE(1, "Loading " << ff->GetScoreProducerDescription() << endl);
-      ff->Load(options());
+  const std::vector<PhraseDictionary*> &pts = PhraseDictionary::GetColl();
+  LoadFeatureFunctions(std::vector<FeatureFunction*>(pts.begin(), pts.end()));
+
+  VERBOSE(1, "Loaded all feature functions in " << (util::WallTime() - start)
+          << " seconds, peak RSS " << (util::RSSMax() >> 20) << " MB" << endl);
+
+  CheckLEGACYPT();
+}
+
+void StaticData::LoadFeatureFunctions(const std::vector<FeatureFunction*> &ffs)
+{
+  if (m_loadThreadCount <= 1) {
+    for (size_t i = 0; i < ffs.size(); ++i) {
+      LoadFeatureFunction(*ffs[i], options());
     }
+    return;
   }
 
-  const std::vector<PhraseDictionary*> &pts = PhraseDictionary::GetColl();
-  for (size_t i = 0; i < pts.size(); ++i) {
-    PhraseDictionary *pt = pts[i];
-    VERBOSE(1, "Loading " << pt->GetScoreProducerDescription() << endl);
-    pt->Load(options());
+#ifdef WITH_THREADS
+  // Load in waves: each wave is every feature whose dependencies among ffs
+  // have finished loading.
+  std::set<std::string> pending;
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    pending.insert(ffs[i]->GetScoreProducerDescription());
   }
 
-  CheckLEGACYPT();
+  std::vector<FeatureFunction*> remaining(ffs), ready, blocked;
+  while (!remaining.empty()) {
+    ready.clear();
+    blocked.clear();
+    for (size_t i = 0; i < remaining.size(); ++i) {
+      const std::vector<std::string> deps = remaining[i]->GetLoadDependencies();
+      bool isReady = true;
+      for (size_t j = 0; j < deps.size() && isReady; ++j) {
+        isReady = !pending.count(deps[j]);
+      }
+      (isReady ? ready : blocked).push_back(remaining[i]);
+    }
+    UTIL_THROW_IF2(ready.empty(), "Circular load dependencies involving "
+                   << blocked[0]->GetScoreProducerDescription());
+
+    std::vector<boost::shared_ptr<LoadFeatureFunctionTask> > tasks;
+    {
+      ThreadPool pool(std::min(m_loadThreadCount, ready.size()));
+      for (size_t i = 0; i < ready.size(); ++i) {
+        tasks.push_back(boost::shared_ptr<LoadFeatureFunctionTask>(
+                          new LoadFeatureFunctionTask(*ready[i], options())));
+        pool.Submit(tasks.back());
+      }
+      pool.Stop(true);
+    }
+    for (size_t i = 0; i < ready.size(); ++i) {
+      UTIL_THROW_IF2(!tasks[i]->GetError().empty(), "Error loading "
+                     << ready[i]->GetScoreProducerDescription() << ": "
+                     << tasks[i]->GetError());
+      pending.erase(ready[i]->GetScoreProducerDescription());
+    }
+    remaining.swap(blocked);
+  }
+#endif
 }
 
 bool StaticData::CheckWeights() const
@@ -111,6 +111,7 @@ protected:
   UnknownLHSList m_unknownLHS;
 
   int m_threadCount;
+  size_t m_loadThreadCount; //! threads for loading feature functions
   // long m_startTranslationId;
 
   // alternate weight settings
@@ -347,6 +348,7 @@ public:
   void CleanUpAfterSentenceProcessing(ttasksptr const& ttask) const;
 
   void LoadFeatureFunctions();
+  void LoadFeatureFunctions(const std::vector<FeatureFunction*> &ffs);
   bool CheckWeights() const;
   void LoadSparseWeightsFromConfig();
   bool LoadWeightSettings();
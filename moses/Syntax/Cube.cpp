@@ -13,30 +13,32 @@ namespace Moses
 namespace Syntax
 {
 
-Cube::Cube(const SHyperedgeBundle &bundle)
+Cube::Context::Context(SArena &a, bool l)
+  : arena(a)
+  , lazy(l)
+{
+}
+
+Cube::Cube(const SHyperedgeBundle &bundle, Context &context)
   : m_bundle(bundle)
+  , m_context(context)
+  , m_numPopped(0)
 {
   // Create the SHyperedge for the 'corner' of the cube.
   std::vector<int> coordinates(bundle.stacks.size()+1, 0);
-  SHyperedge *hyperedge = CreateHyperedge(coordinates);
-  // Add its coordinates to the set of visited coordinates.
-  std::pair<CoordinateSet::iterator, bool> p = m_visited.insert(coordinates);
-  const std::vector<int> &storedCoordinates = *p.first;
-  // Add the SHyperedge to the queue along with its coordinates (which will be
-  // needed for creating its neighbours).
-  m_queue.push(QueueItem(hyperedge, &storedCoordinates));
+  CreateNeighbour(coordinates);
 }
 
 Cube::~Cube()
 {
-  // Delete the SHyperedges belonging to any unpopped items.  Note that the
-  // coordinate vectors are not deleted here since they are owned by m_visited
-  // (and so will be deleted by its destructor).
+  // Return the SHyperedges belonging to any unpopped items to the arena.
+  // Note that the coordinate vectors are not deleted here since they are
+  // owned by m_visited (and so will be deleted by its destructor).
   while (!m_queue.empty()) {
     QueueItem item = m_queue.top();
     m_queue.pop();
-    // Delete hyperedge and its head (head deletes hyperedge).
-    delete item.first->head;  // TODO shared ownership of head vertex?
+    // Free hyperedge and its head (head frees hyperedge).
+    m_context.arena.FreeVertex(item.first->head);
   }
 }
 
@@ -44,6 +46,10 @@ SHyperedge *Cube::Pop()
 {
   QueueItem item = m_queue.top();
   m_queue.pop();
+  ++m_numPopped;
+  if (m_context.lazy) {
+    Evaluate(*item.first);
+  }
   CreateNeighbours(*item.second);
   return item.first;
 }
@@ -82,15 +88,21 @@ void Cube::CreateNeighbour(const std::vector<int> &coordinates)
     return;
   }
   SHyperedge *hyperedge = CreateHyperedge(coordinates);
+  // Lazy cubes score the hyperedge when it is popped.
+  if (m_context.lazy) {
+    Estimate(*hyperedge);
+  } else {
+    Evaluate(*hyperedge);
+  }
   const std::vector<int> &storedCoordinates = *p.first;
   m_queue.push(QueueItem(hyperedge, &storedCoordinates));
 }
 
 SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
 {
-  SHyperedge *hyperedge = new SHyperedge();
+  SHyperedge *hyperedge = m_context.arena.NewHyperedge();
 
-  SVertex *head = new SVertex();
+  SVertex *head = m_context.arena.NewVertex();
   head->best = hyperedge;
   head->pvertex = 0;  // FIXME???
   head->states.resize(
@@ -99,8 +111,7 @@ SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
 
   hyperedge->tail.resize(coordinates.size()-1);
   for (std::size_t i = 0; i < coordinates.size()-1; ++i) {
-    boost::shared_ptr<SVertex> pred = (*m_bundle.stacks[i])[coordinates[i]];
-    hyperedge->tail[i] = pred.get();
+    hyperedge->tail[i] = (*m_bundle.stacks[i])[coordinates[i]];
   }
 
   hyperedge->label.inputWeight = m_bundle.inputWeight;
@@ -108,6 +119,29 @@ SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
   hyperedge->label.translation =
     *(m_bundle.translations->begin()+coordinates.back());
 
+  ++m_context.stats.created;
+
+  return hyperedge;
+}
+
+void Cube::Estimate(SHyperedge &hyperedge) const
+{
+  // The same estimate as SHyperedgeBundleScorer uses, but for any corner.
+  hyperedge.label.futureScore = hyperedge.label.translation->GetFutureScore();
+
+  for (std::vector<SVertex*>::const_iterator p = hyperedge.tail.begin();
+       p != hyperedge.tail.end(); ++p) {
+    const SVertex *pred = *p;
+    if (pred->best) {
+      hyperedge.label.futureScore += pred->best->label.futureScore;
+    }
+  }
+}
+
+void Cube::Evaluate(SHyperedge &hyperedge)
+{
+  ++m_context.stats.evaluations;
+
   // Calculate feature deltas.
 
   const StaticData &staticData = StaticData::Instance();
@@ -118,7 +152,7 @@ SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
     StatelessFeatureFunction::GetStatelessFeatureFunctions();
   for (unsigned i = 0; i < sfs.size(); ++i) {
     if (!staticData.IsFeatureFunctionIgnored(*sfs[i])) {
-      sfs[i]->EvaluateWhenApplied(*hyperedge, &hyperedge->label.deltas);
+      sfs[i]->EvaluateWhenApplied(hyperedge, &hyperedge.label.deltas);
     }
   }
 
@@ -126,27 +160,25 @@ SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
     StatefulFeatureFunction::GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i) {
     if (!staticData.IsFeatureFunctionIgnored(*ffs[i])) {
-      head->states[i] =
-        ffs[i]->EvaluateWhenApplied(*hyperedge, i, &hyperedge->label.deltas);
+      hyperedge.head->states[i] =
+        ffs[i]->EvaluateWhenApplied(hyperedge, i, &hyperedge.label.deltas);
     }
   }
 
   // Calculate future score.
 
-  hyperedge->label.futureScore =
-    hyperedge->label.translation->GetScoreBreakdown().GetWeightedScore();
+  hyperedge.label.futureScore =
+    hyperedge.label.translation->GetScoreBreakdown().GetWeightedScore();
 
-  hyperedge->label.futureScore += hyperedge->label.deltas.GetWeightedScore();
+  hyperedge.label.futureScore += hyperedge.label.deltas.GetWeightedScore();
 
-  for (std::vector<SVertex*>::const_iterator p = hyperedge->tail.begin();
-       p != hyperedge->tail.end(); ++p) {
+  for (std::vector<SVertex*>::const_iterator p = hyperedge.tail.begin();
+       p != hyperedge.tail.end(); ++p) {
     const SVertex *pred = *p;
     if (pred->best) {
-      hyperedge->label.futureScore += pred->best->label.futureScore;
+      hyperedge.label.futureScore += pred->best->label.futureScore;
     }
   }
-
-  return hyperedge;
 }
 
 }  // Syntax
@@ -6,6 +6,7 @@
 
 #include <boost/unordered_set.hpp>
 
+#include "SArena.h"
 #include "SHyperedge.h"
 #include "SHyperedgeBundle.h"
 
@@ -14,17 +15,53 @@ namespace Moses
 namespace Syntax
 {
 
+// Counts kept by a CubeQueue and reported by Syntax::Manager.  Hyperedges
+// that are created but never popped are discards.
+struct CubeStats {
+  CubeStats() : created(0), evaluations(0), pops(0) {}
+
+  CubeStats &operator+=(const CubeStats &other) {
+    created += other.created;
+    evaluations += other.evaluations;
+    pops += other.pops;
+    return *this;
+  }
+
+  std::size_t created;      // hyperedges created by the cubes
+  std::size_t evaluations;  // hyperedges scored with the feature functions
+  std::size_t pops;         // hyperedges returned by CubeQueue::Pop()
+};
+
 // A cube -- in the cube pruning sense (see Chiang (2007)) -- that lazily
 // produces SHyperedge objects from a SHyperedgeBundle in approximately
-// best-first order.
+// best-first order.  The SHyperedge objects (and their head SVertex objects)
+// are allocated from a SArena.
+//
+// If the cube is lazy then hyperedges are queued with an estimated score: the
+// rule's future score (which includes the language model estimate computed in
+// isolation) plus the scores of the best tail vertices.  Only popped
+// hyperedges are scored with the feature functions.  Otherwise new
+// neighbours are scored as they are created.
 class Cube
 {
 public:
-  Cube(const SHyperedgeBundle &);
+  // State shared by all the cubes of a CubeQueue.
+  struct Context {
+    Context(SArena &a, bool l);
+
+    SArena &arena;
+    bool lazy;
+    CubeStats stats;
+  };
+
+  Cube(const SHyperedgeBundle &, Context &);
   ~Cube();
 
+  // Remove the best hyperedge.  It is always fully scored.
   SHyperedge *Pop();
 
+  // The best hyperedge, which only carries an estimated score if the cube
+  // is lazy.
   SHyperedge *Top() const {
     return m_queue.top().first;
   }
@@ -33,6 +70,10 @@ public:
     return m_queue.empty();
   }
 
+  std::size_t NumPopped() const {
+    return m_numPopped;
+  }
+
 private:
   typedef boost::unordered_set<std::vector<int> > CoordinateSet;
 
@@ -52,10 +93,14 @@ private:
   SHyperedge *CreateHyperedge(const std::vector<int> &);
   void CreateNeighbour(const std::vector<int> &);
   void CreateNeighbours(const std::vector<int> &);
+  void Estimate(SHyperedge &) const;
+  void Evaluate(SHyperedge &);
 
   const SHyperedgeBundle &m_bundle;
+  Context &m_context;
   CoordinateSet m_visited;
   Queue m_queue;
+  std::size_t m_numPopped;
 };
 
 }  // Syntax
@@ -1,5 +1,7 @@
 #include "CubeQueue.h"
 
+#include "moses/Util.h"
+
 namespace Moses
 {
 namespace Syntax
@@ -7,26 +9,109 @@ namespace Syntax
 
 CubeQueue::~CubeQueue()
 {
-  while (!m_queue.empty()) {
-    Cube *cube = m_queue.top();
-    m_queue.pop();
-    delete cube;
+  RemoveAllInColl(m_queue);
+  RemoveAllInColl(m_diverse);
+  // Hyperedges still held in the gate have been popped from their cubes,
+  // so they (and their heads) are returned to the arena here.
+  for (std::vector<SHyperedge*>::iterator p = m_gate.begin();
+       p != m_gate.end(); ++p) {
+    m_context.arena.FreeVertex((*p)->head);
   }
 }
 
 SHyperedge *CubeQueue::Pop()
+{
+  SHyperedge *hyperedge = NULL;
+  if (m_context.stats.pops < m_popLimit) {
+    hyperedge = m_context.lazy ? PopGated() : PopBest();
+  } else if (!m_gate.empty()) {
+    // already scored, so hand them out before topping up the cubes
+    hyperedge = PopGate();
+  } else if (m_diversity > 0) {
+    if (!m_diversityStarted) {
+      StartDiversity();
+    }
+    hyperedge = PopDiverse();
+  }
+  if (hyperedge) {
+    ++m_context.stats.pops;
+  }
+  return hyperedge;
+}
+
+SHyperedge *CubeQueue::PopBest()
+{
+  return m_queue.empty() ? NULL : PopTopCube();
+}
+
+SHyperedge *CubeQueue::PopGated()
+{
+  // Score hyperedges in order of their estimates until the best scored one
+  // is at least as good as the best remaining estimate or the gate is full.
+  HyperedgeOrderer orderer;
+  while (!m_queue.empty() && m_gate.size() < m_gateSize &&
+         (m_gate.empty() ||
+          m_gate.front()->label.futureScore <
+          m_queue.front()->Top()->label.futureScore)) {
+    m_gate.push_back(PopTopCube());
+    std::push_heap(m_gate.begin(), m_gate.end(), orderer);
+  }
+  return m_gate.empty() ? NULL : PopGate();
+}
+
+SHyperedge *CubeQueue::PopGate()
+{
+  std::pop_heap(m_gate.begin(), m_gate.end(), HyperedgeOrderer());
+  SHyperedge *hyperedge = m_gate.back();
+  m_gate.pop_back();
+  return hyperedge;
+}
+
+// Give every remaining cube that has contributed fewer than m_diversity
+// hyperedges the chance to make up the difference.  As in phrase-based cube
+// pruning, this does not stop them being pruned later.
+void CubeQueue::StartDiversity()
+{
+  m_diversityStarted = true;
+  for (std::vector<Cube*>::iterator p = m_queue.begin(); p != m_queue.end();
+       ++p) {
+    if ((*p)->NumPopped() < m_diversity) {
+      m_diverse.push_back(*p);
+    } else {
+      delete *p;
+    }
+  }
+  m_queue.clear();
+}
+
+SHyperedge *CubeQueue::PopDiverse()
+{
+  while (!m_diverse.empty()) {
+    Cube *cube = m_diverse.back();
+    if (!cube->IsEmpty() && cube->NumPopped() < m_diversity) {
+      return cube->Pop();
+    }
+    delete cube;
+    m_diverse.pop_back();
+  }
+  return NULL;
+}
+
+SHyperedge *CubeQueue::PopTopCube()
 {
   // pop the most promising cube
-  Cube *cube = m_queue.top();
-  m_queue.pop();
+  CubeOrderer orderer;
+  std::pop_heap(m_queue.begin(), m_queue.end(), orderer);
+  Cube *cube = m_queue.back();
 
   // pop the most promising hyperedge from the cube
   SHyperedge *hyperedge = cube->Pop();
 
   // if the cube contains more items then push it back onto the queue
   if (!cube->IsEmpty()) {
-    m_queue.push(cube);
+    std::push_heap(m_queue.begin(), m_queue.end(), orderer);
   } else {
+    m_queue.pop_back();
     delete cube;
   }
 
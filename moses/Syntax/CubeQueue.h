@@ -1,9 +1,12 @@
 #pragma once
 
-#include <queue>
+#include <algorithm>
 #include <vector>
 
+#include "moses/parameters/CubePruningOptions.h"
+
 #include "Cube.h"
+#include "SArena.h"
 #include "SHyperedge.h"
 #include "SHyperedgeBundle.h"
 
@@ -12,18 +15,33 @@ namespace Moses
 namespace Syntax
 {
 
+// Cube pruning over a set of SHyperedgeBundles, one Cube per bundle.  Pop()
+// returns hyperedges in approximately best-first order until the pop limit is
+// reached, then (if cube-pruning-diversity is set) tops up every cube that has
+// contributed fewer than that many hyperedges.
+//
+// With cube-pruning-lazy-scoring the cubes are ordered by estimated scores and
+// only popped hyperedges are fully scored.  Since a hyperedge's real score
+// can be lower than its estimate, the scored hyperedges are held back in a
+// gate: the best of them is only returned once it beats the best remaining
+// estimate, or once cube-pruning-lazy-gate hyperedges are waiting.  The
+// hyperedges still in the gate when the pop limit is reached are returned
+// before the cubes are topped up.
 class CubeQueue
 {
 public:
+  // The cubes allocate their SHyperedges from arena.
   template<typename InputIterator>
-  CubeQueue(InputIterator, InputIterator);
+  CubeQueue(InputIterator, InputIterator, const CubePruningOptions &,
+            SArena &arena);
 
   ~CubeQueue();
 
+  // Return the next hyperedge, or NULL when there are no more to return.
   SHyperedge *Pop();
 
-  bool IsEmpty() const {
-    return m_queue.empty();
+  const CubeStats &GetStats() const {
+    return m_context.stats;
   }
 
 private:
@@ -35,17 +53,44 @@ private:
     }
   };
 
-  typedef std::priority_queue<Cube*, std::vector<Cube*>, CubeOrderer> Queue;
+  class HyperedgeOrderer
+  {
+  public:
+    bool operator()(const SHyperedge *p, const SHyperedge *q) const {
+      return p->label.futureScore < q->label.futureScore;
+    }
+  };
+
+  SHyperedge *PopBest();
+  SHyperedge *PopGated();
+  SHyperedge *PopGate();
+  SHyperedge *PopDiverse();
+  SHyperedge *PopTopCube();
+  void StartDiversity();
 
-  Queue m_queue;
+  Cube::Context m_context;
+  const std::size_t m_popLimit;
+  const std::size_t m_diversity;
+  const std::size_t m_gateSize;
+  std::vector<Cube*> m_queue;  // heap ordered by CubeOrderer
+  std::vector<SHyperedge*> m_gate;  // heap ordered by HyperedgeOrderer
+  std::vector<Cube*> m_diverse;
+  bool m_diversityStarted;
 };
 
 template<typename InputIterator>
-CubeQueue::CubeQueue(InputIterator first, InputIterator last)
+CubeQueue::CubeQueue(InputIterator first, InputIterator last,
+                     const CubePruningOptions &options, SArena &arena)
+  : m_context(arena, options.lazy_scoring)
+  , m_popLimit(options.pop_limit)
+  , m_diversity(options.diversity)
+  , m_gateSize(std::max<std::size_t>(options.lazy_gate, 1))
+  , m_diversityStarted(false)
 {
   while (first != last) {
-    m_queue.push(new Cube(*first++));
+    m_queue.push_back(new Cube(*first++, m_context));
   }
+  std::make_heap(m_queue.begin(), m_queue.end(), CubeOrderer());
 }
 
 }  // Syntax
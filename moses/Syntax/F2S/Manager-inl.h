@@ -58,7 +58,6 @@ template<typename RuleMatcher>
 void Manager<RuleMatcher>::Decode()
 {
   // Get various pruning-related constants.
-  const std::size_t popLimit = options()->cube.pop_limit;
   const std::size_t ruleLimit = options()->syntax.rule_limit;
   const std::size_t stackLimit = options()->search.stack_size;
 
@@ -122,18 +121,17 @@ void Manager<RuleMatcher>::Decode()
 
     // Use cube pruning to extract SHyperedges from SHyperedgeBundles and
     // collect the SHyperedges in a buffer.
-    CubeQueue cubeQueue(bundles.Begin(), bundles.End());
-    std::size_t count = 0;
+    CubeQueue cubeQueue(bundles.Begin(), bundles.End(), options()->cube,
+                        m_arena);
     std::vector<SHyperedge*> buffer;
-    while (count < popLimit && !cubeQueue.IsEmpty()) {
-      SHyperedge *hyperedge = cubeQueue.Pop();
+    while (SHyperedge *hyperedge = cubeQueue.Pop()) {
       // FIXME See corresponding code in S2T::Manager
       // BEGIN{HACK}
       hyperedge->head->pvertex = &(vertex.pvertex);
       // END{HACK}
       buffer.push_back(hyperedge);
-      ++count;
     }
+    m_cubeStats += cubeQueue.GetStats();
 
     // Recombine SVertices and sort into a stack.
     SVertexStack &stack = m_stackMap[&(vertex.pvertex)];
@@ -141,6 +139,9 @@ void Manager<RuleMatcher>::Decode()
 
     // Prune stack.
     if (stackLimit > 0 && stack.size() > stackLimit) {
+      for (std::size_t i = stackLimit; i < stack.size(); ++i) {
+        m_arena.FreeVertex(stack[i]);
+      }
       stack.resize(stackLimit);
     }
   }
@@ -188,7 +189,7 @@ void Manager<RuleMatcher>::InitializeStacks()
 
     // For terminals only, add a single SVertex.
     if (vertex.incoming.empty()) {
-      boost::shared_ptr<SVertex> v(new SVertex());
+      SVertex *v = m_arena.NewVertex();
       v->best = 0;
       v->pvertex = &(vertex.pvertex);
       stack.push_back(v);
@@ -282,7 +283,7 @@ void Manager<RuleMatcher>::RecombineAndSort(
   // Step 1: Create a map containing a single instance of each distinct vertex
   // (where distinctness is defined by the state value).  The hyperedges'
   // head pointers are updated to point to the vertex instances in the map and
-  // any 'duplicate' vertices are deleted.
+  // any 'duplicate' vertices are returned to the arena.
 // TODO Set?
   typedef boost::unordered_map<SVertex *, SVertex *,
           SVertexRecombinationHasher,
@@ -310,7 +311,7 @@ void Manager<RuleMatcher>::RecombineAndSort(
       storedVertex->recombined.push_back(h);
     }
     h->head->best = 0;
-    delete h->head;
+    m_arena.FreeVertex(h->head);
     h->head = storedVertex;
   }
 
@@ -318,7 +319,7 @@ void Manager<RuleMatcher>::RecombineAndSort(
   stack.clear();
   stack.reserve(map.size());
   for (Map::const_iterator p = map.begin(); p != map.end(); ++p) {
-    stack.push_back(boost::shared_ptr<SVertex>(p->first));
+    stack.push_back(p->first);
   }
 
   // Step 3: Sort the vertices in the stack.
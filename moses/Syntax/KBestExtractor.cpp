@@ -3,7 +3,7 @@
 #include "moses/ScoreComponentCollection.h"
 #include "moses/StaticData.h"
 
-#include <boost/scoped_ptr.hpp>
+#include "SArena.h"
 
 #include <vector>
 
@@ -14,7 +14,7 @@ namespace Syntax
 
 // Extract the k-best list from the search graph.
 void KBestExtractor::Extract(
-  const std::vector<boost::shared_ptr<SVertex> > &topLevelVertices,
+  const std::vector<SVertex*> &topLevelVertices,
   std::size_t k, KBestVec &kBestList)
 {
   kBestList.clear();
@@ -24,13 +24,14 @@ void KBestExtractor::Extract(
 
   // Create a new SVertex, supremeVertex, that has the best top-level SVertex as
   // its predecessor and has the same score.
-  std::vector<boost::shared_ptr<SVertex> >::const_iterator p =
-    topLevelVertices.begin();
+  // It and its hyperedges only live as long as this function.
+  std::vector<SVertex*>::const_iterator p = topLevelVertices.begin();
   SVertex &bestTopLevelVertex = **p;
-  boost::scoped_ptr<SVertex> supremeVertex(new SVertex());
+  SArena arena;
+  SVertex *supremeVertex = arena.NewVertex();
   supremeVertex->pvertex = 0;
-  supremeVertex->best = new SHyperedge();
-  supremeVertex->best->head = supremeVertex.get();
+  supremeVertex->best = arena.NewHyperedge();
+  supremeVertex->best->head = supremeVertex;
   supremeVertex->best->tail.push_back(&bestTopLevelVertex);
   supremeVertex->best->label.futureScore =
     bestTopLevelVertex.best->label.futureScore;
@@ -44,11 +45,9 @@ void KBestExtractor::Extract(
     UTIL_THROW_IF2((*p)->best->label.futureScore >
                    bestTopLevelVertex.best->label.futureScore,
                    "top-level SVertices are not correctly sorted");
-    // Note: there's no need for a smart pointer here: supremeVertex will take
-    // ownership of altEdge.
-    SHyperedge *altEdge = new SHyperedge();
-    altEdge->head = supremeVertex.get();
-    altEdge->tail.push_back((*p).get());
+    SHyperedge *altEdge = arena.NewHyperedge();
+    altEdge->head = supremeVertex;
+    altEdge->tail.push_back(*p);
     altEdge->label.futureScore = (*p)->best->label.futureScore;
     altEdge->label.deltas = (*p)->best->label.deltas;
     altEdge->label.translation = 0;
@@ -76,7 +76,7 @@ public:
 
   // Extract the k-best list from the search hypergraph given the full, sorted
   // list of top-level SVertices.
-  void Extract(const std::vector<boost::shared_ptr<SVertex> > &, std::size_t,
+  void Extract(const std::vector<SVertex*> &, std::size_t,
                KBestVec &);
 
   static Phrase GetOutputPhrase(const Derivation &);
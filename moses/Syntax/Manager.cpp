@@ -13,6 +13,14 @@ Manager::Manager(ttasksptr const& ttask)
   : Moses::BaseManager(ttask)
 { }
 
+void Manager::CalcDecoderStatistics() const
+{
+  VERBOSE(2, "Cube pruning: " << m_cubeStats.pops << " pops, "
+          << m_cubeStats.evaluations << " evaluations, "
+          << m_cubeStats.created - m_cubeStats.pops << " discards"
+          << std::endl);
+}
+
 void Manager::OutputBest(OutputCollector *collector) const
 {
   if (!collector) {
@@ -4,7 +4,9 @@
 #include "moses/InputType.h"
 #include "moses/BaseManager.h"
 
+#include "Cube.h"
 #include "KBestExtractor.h"
+#include "SArena.h"
 
 namespace Moses
 {
@@ -22,6 +24,7 @@ public:
   void OutputBest(OutputCollector *collector) const;
   void OutputNBest(OutputCollector *collector) const;
   void OutputUnknowns(OutputCollector *collector) const;
+  void CalcDecoderStatistics() const;
 
   // Virtual functions from Moses::BaseManager that are no-ops for all Syntax
   // managers.
@@ -41,7 +44,6 @@ public:
   void OutputWordGraph(OutputCollector *collector) const {}
   void OutputDetailedTranslationReport(OutputCollector *collector) const {}
 
-  void CalcDecoderStatistics() const {}
 
   // Syntax-specific virtual functions that derived classes must implement.
   virtual void ExtractKBest(
@@ -53,6 +55,13 @@ public:
 protected:
   boost::unordered_set<Word> m_oovs;
 
+  // Owns every SVertex and SHyperedge of the search hypergraph, which is
+  // released in one go with the manager.
+  SArena m_arena;
+
+  // Totals over all of the sentence's cube pruning runs.
+  CubeStats m_cubeStats;
+
 private:
   // Syntax-specific helper functions used to implement OutputNBest.
   void OutputNBestList(OutputCollector *collector,
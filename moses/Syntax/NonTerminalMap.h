@@ -1,38 +1,39 @@
 #pragma once
 
+#include <deque>
+#include <utility>
 #include <vector>
 
-#include <boost/unordered_map.hpp>
-
 #include "moses/FactorCollection.h"
 #include "moses/Word.h"
 
-#include "SymbolEqualityPred.h"
-#include "SymbolHasher.h"
-
 namespace Moses
 {
 namespace Syntax
 {
 
-// Hybrid map/vector-based container for key-value pairs where the key is a
-// non-terminal Word.  The interface is like a (stripped-down) map type, with
-// the main differences being that:
-//   1. Find() is implemented using vector indexing to make it fast.
+// Vector-indexed container for key-value pairs where the key is a non-terminal
+// Word.  The interface is like a (stripped-down) map type, with the main
+// differences being that:
+//   1. Find() is implemented using vector indexing (by the id of the label's
+//      first factor) to make it fast.
 //   2. Once a value has been inserted it can be modified but can't be removed.
+//   3. Iteration is in insertion order over a deque, so it doesn't chase hash
+//      buckets, and references to values remain valid after insertions.
 template<typename T>
 class NonTerminalMap
 {
 private:
-  typedef boost::unordered_map<Word, T, SymbolHasher, SymbolEqualityPred> Map;
-  typedef std::vector<T*> Vec;
+  typedef std::deque<std::pair<Word, T> > Map;
+  // Position in m_map plus one, or zero if the label has no value.
+  typedef std::vector<std::size_t> Vec;
 
 public:
   typedef typename Map::iterator Iterator;
   typedef typename Map::const_iterator ConstIterator;
 
   NonTerminalMap()
-    : m_vec(FactorCollection::Instance().GetNumNonTerminals(), NULL) {}
+    : m_vec(FactorCollection::Instance().GetNumNonTerminals(), 0) {}
 
   Iterator Begin() {
     return m_map.begin();
@@ -59,7 +60,8 @@ public:
   std::pair<Iterator, bool> Insert(const Word &, const T &);
 
   T *Find(const Word &w) const {
-    return m_vec[w[0]->GetId()];
+    const std::size_t i = m_vec[w[0]->GetId()];
+    return i ? const_cast<T*>(&m_map[i-1].second) : NULL;
   }
 
 private:
@@ -71,14 +73,13 @@ template<typename T>
 std::pair<typename NonTerminalMap<T>::Iterator, bool> NonTerminalMap<T>::Insert(
   const Word &key, const T &value)
 {
-  std::pair<typename Map::iterator, bool> result =
-    m_map.insert(typename Map::value_type(key, value));
-  if (result.second) {
-    T *p = &(result.first->second);
-    std::size_t i = key[0]->GetId();
-    m_vec[i] = p;
+  std::size_t &i = m_vec[key[0]->GetId()];
+  if (i) {
+    return std::make_pair(m_map.begin() + (i-1), false);
   }
-  return result;
+  m_map.push_back(typename Map::value_type(key, value));
+  i = m_map.size();
+  return std::make_pair(m_map.end() - 1, true);
 }
 
 }  // namespace Syntax
@@ -50,7 +50,7 @@ void Manager<Parser>::InitializeCharts()
     PVertex &pvertex = m_pchart.AddVertex(tmp);
 
     // SVertex
-    boost::shared_ptr<SVertex> v(new SVertex());
+    SVertex *v = m_arena.NewVertex();
     v->best = 0;
     v->pvertex = &pvertex;
     SChart::Cell &scell = m_schart.GetCell(i,i);
@@ -161,7 +161,6 @@ template<typename Parser>
 void Manager<Parser>::Decode()
 {
   // Get various pruning-related constants.
-  const std::size_t popLimit = options()->cube.pop_limit;
   const std::size_t ruleLimit = options()->syntax.rule_limit;
   const std::size_t stackLimit = options()->search.stack_size;
 
@@ -200,13 +199,12 @@ void Manager<Parser>::Decode()
 
       // Use cube pruning to extract SHyperedges from SHyperedgeBundles.
       // Collect the SHyperedges into buffers, one for each category.
-      CubeQueue cubeQueue(bundles.Begin(), bundles.End());
-      std::size_t count = 0;
+      CubeQueue cubeQueue(bundles.Begin(), bundles.End(), options()->cube,
+                          m_arena);
       typedef boost::unordered_map<Word, std::vector<SHyperedge*>,
               SymbolHasher, SymbolEqualityPred > BufferMap;
       BufferMap buffers;
-      while (count < popLimit && !cubeQueue.IsEmpty()) {
-        SHyperedge *hyperedge = cubeQueue.Pop();
+      while (SHyperedge *hyperedge = cubeQueue.Pop()) {
         // BEGIN{HACK}
         // The way things currently work, the LHS of each hyperedge is not
         // determined until just before the point of its creation, when a
@@ -218,8 +216,8 @@ void Manager<Parser>::Decode()
         hyperedge->head->pvertex = &m_pchart.AddVertex(PVertex(range, lhs));
         // END{HACK}
         buffers[lhs].push_back(hyperedge);
-        ++count;
       }
+      m_cubeStats += cubeQueue.GetStats();
 
       // Recombine SVertices and sort into stacks.
       for (BufferMap::const_iterator p = buffers.begin(); p != buffers.end();
@@ -239,6 +237,9 @@ void Manager<Parser>::Decode()
              p != scell.nonTerminalStacks.End(); ++p) {
           SVertexStack &stack = p->second;
           if (stack.size() > stackLimit) {
+            for (std::size_t i = stackLimit; i < stack.size(); ++i) {
+              m_arena.FreeVertex(stack[i]);
+            }
             stack.resize(stackLimit);
           }
         }
@@ -261,7 +262,7 @@ const SHyperedge *Manager<Parser>::GetBestSHyperedge() const
     return 0;
   }
   assert(stacks.Size() == 1);
-  const std::vector<boost::shared_ptr<SVertex> > &stack = stacks.Begin()->second;
+  const SVertexStack &stack = stacks.Begin()->second;
   // TODO Throw exception if stack is empty?  Or return 0?
   return stack[0]->best;
 }
@@ -284,7 +285,7 @@ void Manager<Parser>::ExtractKBest(
     return;
   }
   assert(stacks.Size() == 1);
-  const std::vector<boost::shared_ptr<SVertex> > &stack = stacks.Begin()->second;
+  const SVertexStack &stack = stacks.Begin()->second;
   // TODO Throw exception if stack is empty?  Or return 0?
 
   KBestExtractor extractor;
@@ -346,7 +347,7 @@ void Manager<Parser>::RecombineAndSort(const std::vector<SHyperedge*> &buffer,
   // Step 1: Create a map containing a single instance of each distinct vertex
   // (where distinctness is defined by the state value).  The hyperedges'
   // head pointers are updated to point to the vertex instances in the map and
-  // any 'duplicate' vertices are deleted.
+  // any 'duplicate' vertices are returned to the arena.
 // TODO Set?
   typedef boost::unordered_map<SVertex *, SVertex *,
           SVertexRecombinationHasher,
@@ -374,7 +375,7 @@ void Manager<Parser>::RecombineAndSort(const std::vector<SHyperedge*> &buffer,
       storedVertex->recombined.push_back(h);
     }
     h->head->best = 0;
-    delete h->head;
+    m_arena.FreeVertex(h->head);
     h->head = storedVertex;
   }
 
@@ -382,7 +383,7 @@ void Manager<Parser>::RecombineAndSort(const std::vector<SHyperedge*> &buffer,
   stack.clear();
   stack.reserve(map.size());
   for (Map::const_iterator p = map.begin(); p != map.end(); ++p) {
-    stack.push_back(boost::shared_ptr<SVertex>(p->first));
+    stack.push_back(p->first);
   }
 
   // Step 3: Sort the vertices in the stack.
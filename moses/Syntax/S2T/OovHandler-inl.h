@@ -39,6 +39,9 @@ boost::shared_ptr<RuleTrie> OovHandler<RuleTrie>::SynthesizeRuleTrie(
     }
   }
 
+  // No pruning, but the parser needs the trie's child indices.
+  SortAndPrune(*trie, 0);
+
   return trie;
 }
 
@@ -55,23 +55,21 @@ void RecursiveCYKPlusParser<Callback>::GetNonTerminalExtensions(
   std::size_t maxEnd)
 {
   // Non-terminal labels in node's outgoing edge set.
-  const RuleTrie::Node::SymbolMap &nonTermMap = node.GetNonTerminalMap();
+  const RuleTrie::Node::ChildIndex &nonTerms = node.GetNonTerminalIndex();
 
   // Compressed matrix from PChart.
   const PChart::CompressedMatrix &matrix =
     Base::m_chart.GetCompressedMatrix(start);
 
   // Loop over possible expansions of the rule.
-  RuleTrie::Node::SymbolMap::const_iterator p;
-  RuleTrie::Node::SymbolMap::const_iterator p_end = nonTermMap.end();
-  for (p = nonTermMap.begin(); p != p_end; ++p) {
-    const Word &nonTerm = p->first;
-    const std::vector<PChart::CompressedItem> &items =
-      matrix[nonTerm[0]->GetId()];
+  RuleTrie::Node::ChildIndex::ConstIterator p;
+  RuleTrie::Node::ChildIndex::ConstIterator p_end = nonTerms.End();
+  for (p = nonTerms.Begin(); p != p_end; ++p) {
+    const std::vector<PChart::CompressedItem> &items = matrix[p->id];
     for (std::vector<PChart::CompressedItem>::const_iterator q = items.begin();
          q != items.end(); ++q) {
       if (q->end >= minEnd && q->end <= maxEnd) {
-        const RuleTrie::Node &child = p->second;
+        const RuleTrie::Node &child = *p->value;
         AddAndExtend(child, q->end, *(q->vertex));
       }
     }
@@ -93,29 +91,15 @@ void RecursiveCYKPlusParser<Callback>::GetTerminalExtension(
     return;
   }
 
-  const RuleTrie::Node::SymbolMap &terminals = node.GetTerminalMap();
+  const RuleTrie::Node::ChildIndex &terminals = node.GetTerminalIndex();
 
   for (PChart::Cell::TMap::const_iterator p = vertexMap.begin();
        p != vertexMap.end(); ++p) {
     const Word &terminal = p->first;
     const PVertex &vertex = p->second;
-
-    // if node has small number of terminal edges, test word equality for each.
-    if (terminals.size() < 5) {
-      for (RuleTrie::Node::SymbolMap::const_iterator iter = terminals.begin();
-           iter != terminals.end(); ++iter) {
-        const Word &word = iter->first;
-        if (word == terminal) {
-          const RuleTrie::Node *child = & iter->second;
-          AddAndExtend(*child, end, vertex);
-          break;
-        }
-      }
-    } else { // else, do hash lookup
-      const RuleTrie::Node *child = node.GetChild(terminal);
-      if (child != NULL) {
-        AddAndExtend(*child, end, vertex);
-      }
+    const RuleTrie::Node *child = terminals.Find(terminal);
+    if (child != NULL) {
+      AddAndExtend(*child, end, vertex);
     }
   }
 }
@@ -141,12 +125,12 @@ void RecursiveCYKPlusParser<Callback>::AddAndExtend(
   // Get all further extensions of rule (until reaching end of sentence or
   // max-chart-span).
   if (end < m_maxEnd) {
-    if (!node.GetTerminalMap().empty()) {
+    if (!node.GetTerminalIndex().IsEmpty()) {
       for (std::size_t newEndPos = end+1; newEndPos <= m_maxEnd; newEndPos++) {
         GetTerminalExtension(node, end+1, newEndPos);
       }
     }
-    if (!node.GetNonTerminalMap().empty()) {
+    if (!node.GetNonTerminalIndex().IsEmpty()) {
       GetNonTerminalExtensions(node, end+1, end+1, m_maxEnd);
     }
   }
@@ -137,7 +137,7 @@ void Scope3Parser<Callback>::FillSentenceMap(SentenceMap &sentMap)
       for (Cell::TMap::const_iterator p = map.begin(); p != map.end(); ++p) {
         const Word &terminal = p->first;
         const PVertex &v = p->second;
-        sentMap[terminal].push_back(&v);
+        sentMap[terminal[0]->GetId()].push_back(&v);
       }
     }
   }
@@ -137,27 +137,25 @@ void PatternApplicationTrie::Extend(const RuleTrieScope3::Node &node,
                                     int minPos, const SentenceMap &sentMap,
                                     bool followsGap)
 {
-  const RuleTrieScope3::Node::TerminalMap &termMap = node.GetTerminalMap();
-  for (RuleTrieScope3::Node::TerminalMap::const_iterator p = termMap.begin();
-       p != termMap.end(); ++p) {
-    const Word &word = p->first;
-    const RuleTrieScope3::Node &child = p->second;
-    SentenceMap::const_iterator q = sentMap.find(word);
-    if (q == sentMap.end()) {
-      continue;
+  // Match the node's terminal edges against the sentence's terminals, looking
+  // up each member of the smaller set in the larger one.  Near the root the
+  // trie has an edge for most of the grammar's source vocabulary.
+  typedef RuleTrieScope3::Node::TerminalIndex TerminalIndex;
+  const TerminalIndex &terminals = node.GetTerminalIndex();
+  if (terminals.Size() <= sentMap.size()) {
+    for (TerminalIndex::ConstIterator p = terminals.Begin();
+         p != terminals.End(); ++p) {
+      SentenceMap::const_iterator q = sentMap.find(p->id);
+      if (q != sentMap.end()) {
+        ExtendWithTerminal(*p->value, q->second, minPos, sentMap, followsGap);
+      }
     }
-    for (std::vector<const PVertex *>::const_iterator r = q->second.begin();
-         r != q->second.end(); ++r) {
-      const PVertex *v = *r;
-      std::size_t start = v->span.GetStartPos();
-      std::size_t end = v->span.GetEndPos();
-      if (start == (std::size_t)minPos ||
-          (followsGap && start > (std::size_t)minPos) ||
-          minPos == -1) {
-        PatternApplicationTrie *subTrie =
-          new PatternApplicationTrie(start, end, child, v, this);
-        subTrie->Extend(child, end+1, sentMap, false);
-        m_children.push_back(subTrie);
+  } else {
+    for (SentenceMap::const_iterator q = sentMap.begin(); q != sentMap.end();
+         ++q) {
+      const RuleTrieScope3::Node *child = terminals.Find(q->first);
+      if (child) {
+        ExtendWithTerminal(*child, q->second, minPos, sentMap, followsGap);
       }
     }
   }
@@ -174,6 +172,27 @@ void PatternApplicationTrie::Extend(const RuleTrieScope3::Node &node,
   m_children.push_back(subTrie);
 }
 
+void PatternApplicationTrie::ExtendWithTerminal(
+  const RuleTrieScope3::Node &child,
+  const std::vector<const PVertex *> &vertices, int minPos,
+  const SentenceMap &sentMap, bool followsGap)
+{
+  for (std::vector<const PVertex *>::const_iterator r = vertices.begin();
+       r != vertices.end(); ++r) {
+    const PVertex *v = *r;
+    std::size_t start = v->span.GetStartPos();
+    std::size_t end = v->span.GetEndPos();
+    if (start == (std::size_t)minPos ||
+        (followsGap && start > (std::size_t)minPos) ||
+        minPos == -1) {
+      PatternApplicationTrie *subTrie =
+        new PatternApplicationTrie(start, end, child, v, this);
+      subTrie->Extend(child, end+1, sentMap, false);
+      m_children.push_back(subTrie);
+    }
+  }
+}
+
 void PatternApplicationTrie::ReadOffPatternApplicationKey(
   PatternApplicationKey &key) const
 {
@@ -52,6 +52,11 @@ public:
   void Extend(const RuleTrieScope3::Node &node, int minPos,
               const SentenceMap &sentMap, bool followsGap);
 
+  void ExtendWithTerminal(const RuleTrieScope3::Node &child,
+                          const std::vector<const PVertex *> &vertices,
+                          int minPos, const SentenceMap &sentMap,
+                          bool followsGap);
+
   void ReadOffPatternApplicationKey(PatternApplicationKey &) const;
 
   int m_start;
@@ -4,9 +4,6 @@
 
 #include <boost/unordered_map.hpp>
 
-#include "moses/Syntax/SymbolEqualityPred.h"
-#include "moses/Syntax/SymbolHasher.h"
-#include "moses/Word.h"
 
 namespace Moses
 {
@@ -18,9 +15,10 @@ struct PVertex;
 namespace S2T
 {
 
-// FIXME Check SymbolHasher does the right thing here
-typedef boost::unordered_map<Word, std::vector<const PVertex *>, SymbolHasher,
-        SymbolEqualityPred> SentenceMap;
+// Map from the id of a terminal's first factor to the vertices for that
+// terminal.  Ids are the same as those used by RuleTrieScope3's TerminalIndex.
+typedef boost::unordered_map<std::size_t, std::vector<const PVertex *> >
+SentenceMap;
 
 } // namespace S2T
 } // namespace Syntax
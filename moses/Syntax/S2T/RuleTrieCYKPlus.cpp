@@ -52,6 +52,21 @@ void RuleTrieCYKPlus::Node::Sort(std::size_t tableLimit)
   m_targetPhraseCollection->Sort(true, tableLimit);
 }
 
+void RuleTrieCYKPlus::Node::BuildIndex()
+{
+  for (SymbolMap::iterator p = m_sourceTermMap.begin();
+       p != m_sourceTermMap.end(); ++p) {
+    p->second.BuildIndex();
+  }
+  for (SymbolMap::iterator p = m_nonTermMap.begin();
+       p != m_nonTermMap.end(); ++p) {
+    p->second.BuildIndex();
+  }
+
+  m_sourceTermIndex.Assign(m_sourceTermMap);
+  m_nonTermIndex.Assign(m_nonTermMap);
+}
+
 RuleTrieCYKPlus::Node *RuleTrieCYKPlus::Node::GetOrCreateChild(
   const Word &sourceTerm)
 {
@@ -132,6 +147,7 @@ void RuleTrieCYKPlus::SortAndPrune(std::size_t tableLimit)
   if (tableLimit) {
     m_root.Sort(tableLimit);
   }
+  m_root.BuildIndex();
 }
 
 bool RuleTrieCYKPlus::HasPreterminalRule(const Word &w) const
@@ -9,6 +9,7 @@
 
 #include "moses/Syntax/SymbolEqualityPred.h"
 #include "moses/Syntax/SymbolHasher.h"
+#include "moses/Syntax/SymbolIndex.h"
 #include "moses/TargetPhrase.h"
 #include "moses/TargetPhraseCollection.h"
 #include "moses/Terminal.h"
@@ -33,6 +34,8 @@ public:
     typedef boost::unordered_map<Word, Node, SymbolHasher,
             SymbolEqualityPred> SymbolMap;
 
+    typedef SymbolIndex<Node> ChildIndex;
+
     bool IsLeaf() const {
       return m_sourceTermMap.empty() && m_nonTermMap.empty();
     }
@@ -44,6 +47,9 @@ public:
     void Prune(std::size_t tableLimit);
     void Sort(std::size_t tableLimit);
 
+    // (Re)build the child indices of this node and its descendants.
+    void BuildIndex();
+
     Node *GetOrCreateChild(const Word &sourceTerm);
     Node *GetOrCreateNonTerminalChild(const Word &targetNonTerm);
 
@@ -68,11 +74,24 @@ public:
       return m_nonTermMap;
     }
 
+    // Terminal and non-terminal children, sorted by symbol id.  These are
+    // only valid once the trie has been finished by SortAndPrune and are what
+    // the parsers search.
+    const ChildIndex &GetTerminalIndex() const {
+      return m_sourceTermIndex;
+    }
+
+    const ChildIndex &GetNonTerminalIndex() const {
+      return m_nonTermIndex;
+    }
+
     Node() : m_targetPhraseCollection(new TargetPhraseCollection) {}
 
   private:
     SymbolMap m_sourceTermMap;
     SymbolMap m_nonTermMap;
+    ChildIndex m_sourceTermIndex;
+    ChildIndex m_nonTermIndex;
     TargetPhraseCollection::shared_ptr m_targetPhraseCollection;
   };
 
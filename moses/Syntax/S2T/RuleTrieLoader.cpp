@@ -139,10 +139,9 @@ bool RuleTrieLoader::Load(Moses::AllOptions const& opts,
     count++;
   }
 
-  // sort and prune each target phrase collection
-  if (ff.GetTableLimit()) {
-    SortAndPrune(trie, ff.GetTableLimit());
-  }
+  // sort and prune each target phrase collection and index the trie's
+  // children for the parser (which must be done even without a table limit)
+  SortAndPrune(trie, ff.GetTableLimit());
 
   return true;
 }
@@ -54,6 +54,19 @@ void RuleTrieScope3::Node::Sort(std::size_t tableLimit)
   }
 }
 
+void RuleTrieScope3::Node::BuildIndex()
+{
+  for (TerminalMap::iterator p = m_terminalMap.begin();
+       p != m_terminalMap.end(); ++p) {
+    p->second.BuildIndex();
+  }
+  if (m_gapNode) {
+    m_gapNode->BuildIndex();
+  }
+
+  m_terminalIndex.Assign(m_terminalMap);
+}
+
 RuleTrieScope3::Node *RuleTrieScope3::Node::GetOrCreateTerminalChild(
   const Word &sourceTerm)
 {
@@ -144,6 +157,7 @@ void RuleTrieScope3::SortAndPrune(std::size_t tableLimit)
   if (tableLimit) {
     m_root.Sort(tableLimit);
   }
+  m_root.BuildIndex();
 }
 
 bool RuleTrieScope3::HasPreterminalRule(const Word &w) const
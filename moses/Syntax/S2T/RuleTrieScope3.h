@@ -9,6 +9,7 @@
 
 #include "moses/Syntax/SymbolEqualityPred.h"
 #include "moses/Syntax/SymbolHasher.h"
+#include "moses/Syntax/SymbolIndex.h"
 #include "moses/TargetPhrase.h"
 #include "moses/TargetPhraseCollection.h"
 #include "moses/Util.h"
@@ -34,6 +35,8 @@ public:
     typedef boost::unordered_map<Word, Node, SymbolHasher,
             SymbolEqualityPred> TerminalMap;
 
+    typedef SymbolIndex<Node> TerminalIndex;
+
     typedef boost::unordered_map<std::vector<int>,
             TargetPhraseCollection::shared_ptr> LabelMap;
 
@@ -53,6 +56,12 @@ public:
       return m_terminalMap;
     }
 
+    // Terminal children, sorted by symbol id.  Only valid once the trie has
+    // been finished by SortAndPrune.
+    const TerminalIndex &GetTerminalIndex() const {
+      return m_terminalIndex;
+    }
+
     const Node *GetNonTerminalChild() const {
       return m_gapNode;
     }
@@ -75,6 +84,9 @@ public:
     void Prune(std::size_t tableLimit);
     void Sort(std::size_t tableLimit);
 
+    // (Re)build the terminal indices of this node and its descendants.
+    void BuildIndex();
+
   private:
     friend class RuleTrieScope3;
 
@@ -94,6 +106,7 @@ public:
     LabelTable m_labelTable;
     LabelMap m_labelMap;
     TerminalMap m_terminalMap;
+    TerminalIndex m_terminalIndex;
     Node *m_gapNode;
   };
 
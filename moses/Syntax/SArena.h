@@ -0,0 +1,58 @@
+#pragma once
+
+#include <new>
+
+#include "moses/ObjectPool.h"
+
+#include "SHyperedge.h"
+#include "SVertex.h"
+
+namespace Moses
+{
+namespace Syntax
+{
+
+// Per-sentence storage for the SVertex and SHyperedge objects of a search
+// hypergraph.  Vertices and hyperedges refer to each other with plain
+// pointers and are all destroyed together with the arena, so there is no
+// per-object allocation or reference counting during search.  Objects that
+// are discarded before then (recombined duplicates, pruned vertices, unused
+// cube items) can be handed back for reuse.
+class SArena
+{
+public:
+  SArena()
+    : m_vertices("SVertex", 1024)
+    , m_hyperedges("SHyperedge", 1024) {}
+
+  SVertex *NewVertex() {
+    return new (m_vertices.getPtr()) SVertex();
+  }
+
+  SHyperedge *NewHyperedge() {
+    return new (m_hyperedges.getPtr()) SHyperedge();
+  }
+
+  // Return v and its incoming hyperedges for reuse.  The caller must make sure
+  // that nothing else points to them.
+  void FreeVertex(SVertex *v) {
+    if (v->best) {
+      m_hyperedges.freeObject(v->best);
+    }
+    for (std::vector<SHyperedge*>::const_iterator p = v->recombined.begin();
+         p != v->recombined.end(); ++p) {
+      m_hyperedges.freeObject(*p);
+    }
+    m_vertices.freeObject(v);
+  }
+
+private:
+  SArena(const SArena &);  // Not implemented
+  SArena &operator=(const SArena &);  // Not implemented
+
+  ObjectPool<SVertex> m_vertices;
+  ObjectPool<SHyperedge> m_hyperedges;
+};
+
+}  // Syntax
+}  // Moses
@@ -15,8 +15,9 @@ struct SHyperedge;
 
 // A vertex in the search hypergraph.
 //
-// Important: a SVertex owns its incoming SHyperedge objects and its FFState
-// objects and will delete them on destruction.
+// Important: a SVertex owns its FFState objects and will delete them on
+// destruction.  SVertex and SHyperedge objects themselves are owned by a
+// SArena.
 struct SVertex {
   ~SVertex();
 
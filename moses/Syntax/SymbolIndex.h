@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "moses/Factor.h"
+#include "moses/Word.h"
+
+namespace Moses
+{
+namespace Syntax
+{
+
+// Read-only index from symbols to values, held as a vector of (id, value)
+// pairs sorted by the id of the symbol's first factor.  It is built from a
+// Word-keyed map once the map is complete (e.g. when a rule trie has been
+// loaded) and is cheaper to search and iterate than the map: lookup is a
+// binary search over integers and iteration walks contiguous memory.  Like
+// SymbolHasher, it assumes that only the first factor is relevant.
+template<typename T>
+class SymbolIndex
+{
+public:
+  struct Entry {
+    std::size_t id;
+    const T *value;
+    bool operator<(const Entry &other) const {
+      return id < other.id;
+    }
+  };
+
+  typedef typename std::vector<Entry>::const_iterator ConstIterator;
+
+  // Replace the contents with pointers to the values of map, which must
+  // outlive the index and must not be modified while it is in use.
+  template<typename Map>
+  void Assign(const Map &map) {
+    m_entries.clear();
+    m_entries.reserve(map.size());
+    for (typename Map::const_iterator p = map.begin(); p != map.end(); ++p) {
+      Entry entry;
+      entry.id = p->first[0]->GetId();
+      entry.value = &p->second;
+      m_entries.push_back(entry);
+    }
+    std::sort(m_entries.begin(), m_entries.end());
+  }
+
+  ConstIterator Begin() const {
+    return m_entries.begin();
+  }
+  ConstIterator End() const {
+    return m_entries.end();
+  }
+
+  std::size_t Size() const {
+    return m_entries.size();
+  }
+
+  bool IsEmpty() const {
+    return m_entries.empty();
+  }
+
+  const T *Find(std::size_t id) const {
+    Entry key;
+    key.id = id;
+    ConstIterator p = std::lower_bound(m_entries.begin(), m_entries.end(), key);
+    return (p == m_entries.end() || p->id != id) ? NULL : p->value;
+  }
+
+  const T *Find(const Word &w) const {
+    return Find(w[0]->GetId());
+  }
+
+private:
+  std::vector<Entry> m_entries;
+};
+
+}  // namespace Syntax
+}  // namespace Moses
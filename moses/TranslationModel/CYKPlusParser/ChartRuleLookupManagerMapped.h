@@ -0,0 +1,99 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2011 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "ChartRuleLookupManagerCYKPlus.h"
+#include "CompletedRuleCollection.h"
+#include "moses/StackVec.h"
+#include "moses/TranslationModel/RuleTable/PhraseDictionaryMapped.h"
+
+namespace Moses
+{
+
+class ChartParserCallback;
+class Range;
+
+//! Implementation of ChartRuleLookupManager for mapped binary rule tables.
+//! The search is that of ChartRuleLookupManagerMemory, over the trie nodes
+//! of the mapped file.
+class ChartRuleLookupManagerMapped : public ChartRuleLookupManagerCYKPlus
+{
+public:
+  typedef std::vector<ChartCellCache> CompressedColumn;
+  typedef std::vector<CompressedColumn> CompressedMatrix;
+
+  ChartRuleLookupManagerMapped(const ChartParser &parser,
+                               const ChartCellCollectionBase &cellColl,
+                               const PhraseDictionaryMapped &ruleTable);
+
+  ~ChartRuleLookupManagerMapped() {};
+
+  virtual void GetChartRuleCollection(
+    const InputPath &inputPath,
+    size_t lastPos, // last position to consider if using lookahead
+    ChartParserCallback &outColl);
+
+private:
+  typedef BinaryRuleTable::Id Id;
+
+  void GetTerminalExtension(Id node, size_t pos);
+
+  void GetNonTerminalExtension(Id node, size_t startPos);
+
+  void AddAndExtend(Id node, size_t endPos);
+
+  void UpdateCompressedMatrix(size_t startPos,
+                              size_t endPos,
+                              size_t lastPos);
+
+  // vocab id of the source word at pos, kNone if the table does not have it
+  Id GetSourceId(size_t pos);
+
+  const PhraseDictionaryMapped &m_ruleTable;
+  const BinaryRuleTable &m_table;
+
+  // permissible soft nonterminal matches (target side)
+  bool m_isSoftMatching;
+  const std::vector<std::vector<Word> >& m_softMatchingMap;
+
+  // temporary storage of completed rules (one collection per end position; all rules collected consecutively start from the same position)
+  std::vector<CompletedRuleCollection> m_completedRules;
+
+  size_t m_lastPos;
+  size_t m_unaryPos;
+
+  StackVec m_stackVec;
+  std::vector<float> m_stackScores;
+  ChartParserCallback* m_outColl;
+
+  std::vector<CompressedMatrix> m_compressedMatrixVec;
+
+  std::vector<Id> m_sourceIds;
+  std::vector<bool> m_sourceIdsDone;
+
+  // keeps the target phrase collections of the completed rules alive for
+  // the sentence, whether or not the table caches them
+  std::map<Id, TargetPhraseCollection::shared_ptr> m_cache;
+};
+
+}  // namespace Moses
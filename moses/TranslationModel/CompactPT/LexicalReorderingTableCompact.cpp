@@ -94,6 +94,40 @@ GetScore(const Phrase& f, const Phrase& e, const Phrase& c)
   return Scores();
 }
 
+void
+LexicalReorderingTableCompact::
+GetScores(const Phrase& f, const std::vector<const Phrase*>& es,
+          const Phrase& c, std::vector<Scores>& scores)
+{
+  if(c.GetSize()) {
+    LexicalReorderingTable::GetScores(f, es, c, scores);
+    return;
+  }
+
+  // the source side of the key is the same for all target phrases
+  std::string fKey = Trim(f.GetStringRep(m_FactorsF));
+  std::string cKey;
+
+  scores.clear();
+  scores.resize(es.size());
+  for(size_t j = 0; j < es.size(); ++j) {
+    std::string key = MakeKey(fKey, Trim(es[j]->GetStringRep(m_FactorsE)), cKey);
+    size_t index = m_hash[key];
+    if(m_hash.GetSize() == index) continue;
+
+    std::string scoresString;
+    if(m_inMemory)
+      scoresString = m_scoresMemory[index].str();
+    else
+      scoresString = m_scoresMapped[index].str();
+
+    BitWrapper<> bitStream(scoresString);
+    scores[j].reserve(m_numScoreComponent);
+    for(size_t i = 0; i < m_numScoreComponent; i++)
+      scores[j].push_back(m_scoreTrees[m_multipleScoreTrees ? i : 0]->Read(bitStream));
+  }
+}
+
 std::string
 LexicalReorderingTableCompact::
 MakeKey(const Phrase& f,
@@ -74,6 +74,11 @@ public:
   std::vector<float>
   GetScore(const Phrase& f, const Phrase& e, const Phrase& c);
 
+  virtual
+  void
+  GetScores(const Phrase& f, const std::vector<const Phrase*>& es,
+            const Phrase& c, std::vector<Scores>& scores);
+
   static
   LexicalReorderingTable*
   CheckAndLoad(const std::string& filePath,
@@ -48,6 +48,7 @@ PhraseDictionaryDynamicCacheBased::PhraseDictionaryDynamicCacheBased(const std::
   m_entries = 0;
   m_name = "default";
   m_constant = false;
+  m_cacheTM.reset(new CacheVersion);
   ReadParameters();
 
   UTIL_THROW_IF2(s_instance_map.find(m_name) != s_instance_map.end(), "Only 1 PhraseDictionaryDynamicCacheBased feature named " + m_name + " is allowed");
@@ -57,7 +58,6 @@ PhraseDictionaryDynamicCacheBased::PhraseDictionaryDynamicCacheBased(const std::
 
 PhraseDictionaryDynamicCacheBased::~PhraseDictionaryDynamicCacheBased()
 {
-  Clear();
 }
 
 void PhraseDictionaryDynamicCacheBased::Load(AllOptions::ptr const& opts)
@@ -77,18 +77,24 @@ void PhraseDictionaryDynamicCacheBased::Load(const std::string filestr)
   VERBOSE(2,"PhraseDictionaryDynamicCacheBased::Load(const std::string filestr)" << std::endl);
 //  std::vector<std::string> files = Tokenize(m_initfiles, "||");
   std::vector<std::string> files = Tokenize(filestr, "||");
-  Load_Multiple_Files(files);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+  CacheUpdate update;
+  BeginUpdate(update);
+  Load_Multiple_Files(update, files);
+  Publish(update);
 }
 
-void PhraseDictionaryDynamicCacheBased::Load_Multiple_Files(std::vector<std::string> files)
+void PhraseDictionaryDynamicCacheBased::Load_Multiple_Files(CacheUpdate &update, std::vector<std::string> files)
 {
   VERBOSE(2,"PhraseDictionaryDynamicCacheBased::Load_Multiple_Files(std::vector<std::string> files)" << std::endl);
   for(size_t j = 0; j < files.size(); ++j) {
-    Load_Single_File(files[j]);
+    Load_Single_File(update, files[j]);
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::Load_Single_File(const std::string file)
+void PhraseDictionaryDynamicCacheBased::Load_Single_File(CacheUpdate &update, const std::string file)
 {
   VERBOSE(2,"PhraseDictionaryDynamicCacheBased::Load_Single_File(const std::string file)" << std::endl);
   //file format
@@ -118,12 +124,11 @@ void PhraseDictionaryDynamicCacheBased::Load_Single_File(const std::string file)
     if (vecStr.size() >= 2) {
       std::string ageString = vecStr[0];
       vecStr.erase(vecStr.begin());
-      Update(vecStr,ageString);
+      Update(update, vecStr, ageString);
     } else {
       UTIL_THROW_IF2(false, "The format of the loaded file is wrong: " << line);
     }
   }
-  IFVERBOSE(2) Print();
 }
 
 
@@ -153,19 +158,26 @@ void PhraseDictionaryDynamicCacheBased::InitializeForInput(ttasksptr const& ttas
 
 TargetPhraseCollection::shared_ptr PhraseDictionaryDynamicCacheBased::GetTargetPhraseCollection(const Phrase &source) const
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
+  // the snapshot keeps the entry alive while it is copied, even if an update
+  // replaces or removes it in the meantime
+  CacheMapPtr cache = GetCache();
   TargetPhraseCollection::shared_ptr tpc;
-  cacheMap::const_iterator it = m_cacheTM.find(source);
-  if(it != m_cacheTM.end()) {
-    tpc.reset(new TargetPhraseCollection(*(it->second).first));
-
-    std::vector<const TargetPhrase*>::const_iterator it2 = tpc->begin();
-
-    while (it2 != tpc->end()) {
-      ((TargetPhrase*) *it2)->EvaluateInIsolation(source, GetFeaturesToApply());
-      it2++;
+  cacheMap::const_iterator it = cache->entries.find(source);
+  if(it != cache->entries.end()) {
+    // the target phrases are copied anyway, so they are scored with their
+    // current age here
+    const CacheEntry &entry = *it->second;
+    tpc.reset(new TargetPhraseCollection);
+    for (size_t tp_pos = 0; tp_pos < entry.tpc->GetSize(); tp_pos++) {
+      const Age &age = entry.ages[tp_pos];
+      if (IsExpired(*cache, age)) continue;
+      TargetPhrase *tp_ptr = new TargetPhrase(*entry.tpc->GetTargetPhrase(tp_pos));
+      tp_ptr->GetScoreBreakdown().Assign(this, GetPreComputedScores(CurrentAge(*cache, age)));
+      tp_ptr->EvaluateInIsolation(source, GetFeaturesToApply());
+      tpc->Add(tp_ptr);
+    }
+    if (tpc->IsEmpty()) {
+      tpc.reset();
     }
   }
   if (tpc)  {
@@ -194,9 +206,6 @@ ChartRuleLookupManager* PhraseDictionaryDynamicCacheBased::CreateRuleLookupManag
 
 void PhraseDictionaryDynamicCacheBased::SetScoreType(size_t type)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
 
   m_score_type = type;
   if ( m_score_type != CBTM_SCORE_TYPE_HYPERBOLA
@@ -216,9 +225,6 @@ void PhraseDictionaryDynamicCacheBased::SetScoreType(size_t type)
 
 void PhraseDictionaryDynamicCacheBased::SetMaxAge(unsigned int age)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
   m_maxAge = age;
   VERBOSE(2, "PhraseDictionaryCache MaxAge:  " << m_maxAge << std::endl);
 }
@@ -264,9 +270,6 @@ float PhraseDictionaryDynamicCacheBased::decaying_score(const int age)
 void PhraseDictionaryDynamicCacheBased::SetPreComputedScores(const unsigned int numScoreComponent)
 {
   VERBOSE(2, "PhraseDictionaryDynamicCacheBased SetPreComputedScores:  " << m_maxAge << std::endl);
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   float sc;
   for (size_t i=0; i<=m_maxAge; i++) {
     if (i==m_maxAge) {
@@ -291,7 +294,7 @@ void PhraseDictionaryDynamicCacheBased::SetPreComputedScores(const unsigned int
   VERBOSE(3, "SetPreComputedScores(const unsigned int): lower_age:|" << m_maxAge << "| lower_score:|" << m_lower_score << "|" << std::endl);
 }
 
-Scores PhraseDictionaryDynamicCacheBased::GetPreComputedScores(const unsigned int age)
+Scores PhraseDictionaryDynamicCacheBased::GetPreComputedScores(const unsigned int age) const
 {
   if (age < m_maxAge) {
     return precomputedScores.at(age);
@@ -300,17 +303,58 @@ Scores PhraseDictionaryDynamicCacheBased::GetPreComputedScores(const unsigned in
   }
 }
 
+PhraseDictionaryDynamicCacheBased::CacheMapPtr PhraseDictionaryDynamicCacheBased::GetCache() const
+{
+  return boost::atomic_load(&m_cacheTM);
+}
+
+void PhraseDictionaryDynamicCacheBased::BeginUpdate(CacheUpdate &update) const
+{
+  // entries are shared with the current version until they are modified
+  update.cache.reset(new CacheVersion(*GetCache()));
+  update.owned.clear();
+}
+
+void PhraseDictionaryDynamicCacheBased::Publish(CacheUpdate &update)
+{
+  CacheMapPtr next = update.cache;
+  boost::atomic_store(&m_cacheTM, next);
+  update.cache.reset();
+  update.owned.clear();
+  IFVERBOSE(3) Print();
+}
+
+PhraseDictionaryDynamicCacheBased::CacheEntry *PhraseDictionaryDynamicCacheBased::Modify(CacheUpdate &update, cacheMap::iterator it) const
+{
+  CacheEntryPtr &entry = it->second;
+  if (update.owned.find(entry.get()) == update.owned.end()) {
+    // the entry may be visible to readers: replace it by a deep copy
+    CacheEntryPtr copy(new CacheEntry);
+    copy->tpc.reset(new TargetPhraseCollection(*entry->tpc));
+    copy->ages = entry->ages;
+    entry = copy;
+    update.owned.insert(entry.get());
+  }
+  return entry.get();
+}
+
 void PhraseDictionaryDynamicCacheBased::ClearEntries(std::string &entries)
 {
   if (entries != "") {
     VERBOSE(3,"entries:|" << entries << "|" << std::endl);
     std::vector<std::string> elements = TokenizeMultiCharSeparator(entries, "||||");
     VERBOSE(3,"elements.size() after:|" << elements.size() << "|" << std::endl);
-    ClearEntries(elements);
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+    CacheUpdate update;
+    BeginUpdate(update);
+    ClearEntries(update, elements);
+    Publish(update);
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearEntries(std::vector<std::string> entries)
+void PhraseDictionaryDynamicCacheBased::ClearEntries(CacheUpdate &update, std::vector<std::string> entries)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::ClearEntries(std::vector<std::string> entries)" << std::endl);
   std::vector<std::string> pp;
@@ -322,11 +366,11 @@ void PhraseDictionaryDynamicCacheBased::ClearEntries(std::vector<std::string> en
     VERBOSE(3,"pp[0]:|" << pp[0] << "|" << std::endl);
     VERBOSE(3,"pp[1]:|" << pp[1] << "|" << std::endl);
 
-    ClearEntries(pp[0], pp[1]);
+    ClearEntries(update, pp[0], pp[1]);
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearEntries(std::string sourcePhraseString, std::string targetPhraseString)
+void PhraseDictionaryDynamicCacheBased::ClearEntries(CacheUpdate &update, std::string sourcePhraseString, std::string targetPhraseString)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::ClearEntries(std::string sourcePhraseString, std::string targetPhraseString)" << std::endl);
   const StaticData &staticData = StaticData::Instance();
@@ -347,37 +391,28 @@ void PhraseDictionaryDynamicCacheBased::ClearEntries(std::string sourcePhraseStr
   sourcePhrase.CreateFromString(Input, staticData.options()->input.factor_order,
                                 sourcePhraseString, /*factorDelimiter,*/ NULL);
   VERBOSE(3, "sourcePhrase:|" << sourcePhrase << "|" << std::endl);
-  ClearEntries(sourcePhrase, targetPhrase);
+  ClearEntries(update, sourcePhrase, targetPhrase);
 
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearEntries(Phrase sp, Phrase tp)
+void PhraseDictionaryDynamicCacheBased::ClearEntries(CacheUpdate &update, Phrase sp, Phrase tp)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::ClearEntries(Phrase sp, Phrase tp)" << std::endl);
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   VERBOSE(3, "PhraseDictionaryCache deleting sp:|" << sp << "| tp:|" << tp << "|" << std::endl);
 
-  cacheMap::const_iterator it = m_cacheTM.find(sp);
+  cacheMap &cache = update.cache->entries;
+  cacheMap::iterator it = cache.find(sp);
   VERBOSE(3,"sp:|" << sp << "|" << std::endl);
-  if(it!=m_cacheTM.end()) {
+  if(it!=cache.end()) {
     VERBOSE(3,"sp:|" << sp << "| FOUND" << std::endl);
     // sp is found
     // here we have to remove the target phrase from targetphrasecollection and from the TargetAgeMap
-    // and then add new entry
 
-    TargetCollectionAgePair TgtCollAgePair = it->second;
-    TargetPhraseCollection::shared_ptr  tpc = TgtCollAgePair.first;
-    AgeCollection* ac = TgtCollAgePair.second;
-    const Phrase* p_ptr = NULL;
-    TargetPhrase* tp_ptr = NULL;
+    const TargetPhraseCollection &tpc = *it->second->tpc;
     bool found = false;
     size_t tp_pos=0;
-    while (!found && tp_pos < tpc->GetSize()) {
-      tp_ptr = (TargetPhrase*) tpc->GetTargetPhrase(tp_pos);
-      p_ptr = (const Phrase*) tp_ptr;
-      if (tp == *p_ptr) {
+    while (!found && tp_pos < tpc.GetSize()) {
+      if (tp == *(const Phrase*) tpc.GetTargetPhrase(tp_pos)) {
         found = true;
         continue;
       }
@@ -386,22 +421,23 @@ void PhraseDictionaryDynamicCacheBased::ClearEntries(Phrase sp, Phrase tp)
     if (!found) {
       VERBOSE(3,"tp:|" << tp << "| NOT FOUND" << std::endl);
       //do nothing
-    } else {
-      VERBOSE(3,"tp:|" << tp << "| FOUND" << std::endl);
-
-      tpc->Remove(tp_pos); //delete entry in the Target Phrase Collection
-      ac->erase(ac->begin() + tp_pos); //delete entry in the Age Collection
-      m_entries--;
-      VERBOSE(3,"tpc size:|" << tpc->GetSize() << "|" << std::endl);
-      VERBOSE(3,"ac size:|" << ac->size() << "|" << std::endl);
-      VERBOSE(3,"tp:|" << tp << "| DELETED" << std::endl);
+      return;
     }
-    if (tpc->GetSize() == 0) {
-      // delete the entry from m_cacheTM in case it points to an empty TargetPhraseCollection and AgeCollection
-      ac->clear();
-      tpc.reset();
-      delete ac;
-      m_cacheTM.erase(sp);
+    VERBOSE(3,"tp:|" << tp << "| FOUND" << std::endl);
+
+    CacheEntry *entry = Modify(update, it);
+    delete entry->tpc->GetTargetPhrase(tp_pos);
+    entry->tpc->Remove(tp_pos); //delete entry in the Target Phrase Collection
+    entry->ages.erase(entry->ages.begin() + tp_pos); //delete entry in the Age Collection
+    m_entries--;
+    VERBOSE(3,"tpc size:|" << entry->tpc->GetSize() << "|" << std::endl);
+    VERBOSE(3,"ac size:|" << entry->ages.size() << "|" << std::endl);
+    VERBOSE(3,"tp:|" << tp << "| DELETED" << std::endl);
+
+    if (entry->tpc->GetSize() == 0) {
+      // delete the entry from the cache in case it points to an empty TargetPhraseCollection and AgeCollection
+      update.owned.erase(entry);
+      cache.erase(it);
     }
 
   } else {
@@ -419,11 +455,17 @@ void PhraseDictionaryDynamicCacheBased::ClearSource(std::string &entries)
     VERBOSE(3,"entries:|" << entries << "|" << std::endl);
     std::vector<std::string> elements = TokenizeMultiCharSeparator(entries, "||||");
     VERBOSE(3,"elements.size() after:|" << elements.size() << "|" << std::endl);
-    ClearEntries(elements);
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+    CacheUpdate update;
+    BeginUpdate(update);
+    ClearSource(update, elements);
+    Publish(update);
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearSource(std::vector<std::string> entries)
+void PhraseDictionaryDynamicCacheBased::ClearSource(CacheUpdate &update, std::vector<std::string> entries)
 {
   VERBOSE(3,"entries.size():|" << entries.size() << "|" << std::endl);
   const StaticData &staticData = StaticData::Instance();
@@ -438,31 +480,24 @@ void PhraseDictionaryDynamicCacheBased::ClearSource(std::vector<std::string> ent
                                   *it, /*factorDelimiter,*/ NULL);
     VERBOSE(3, "sourcePhrase:|" << sourcePhrase << "|" << std::endl);
 
-    ClearSource(sourcePhrase);
+    ClearSource(update, sourcePhrase);
   }
-
-  IFVERBOSE(2) Print();
 }
 
-void PhraseDictionaryDynamicCacheBased::ClearSource(Phrase sp)
+void PhraseDictionaryDynamicCacheBased::ClearSource(CacheUpdate &update, Phrase sp)
 {
   VERBOSE(3,"void PhraseDictionaryDynamicCacheBased::ClearSource(Phrase sp) sp:|" << sp << "|" << std::endl);
-  cacheMap::const_iterator it = m_cacheTM.find(sp);
-  if (it != m_cacheTM.end()) {
+  cacheMap &cache = update.cache->entries;
+  cacheMap::iterator it = cache.find(sp);
+  if (it != cache.end()) {
     VERBOSE(3,"found:|" << sp << "|" << std::endl);
     //sp is found
 
-    TargetCollectionAgePair TgtCollAgePair = it->second;
-    TargetPhraseCollection::shared_ptr  tpc = TgtCollAgePair.first;
-    AgeCollection* ac = TgtCollAgePair.second;
-
-    m_entries-=tpc->GetSize(); //reduce the total amount of entries of the cache
+    m_entries-=it->second->tpc->GetSize(); //reduce the total amount of entries of the cache
 
-    // delete the entry from m_cacheTM in case it points to an empty TargetPhraseCollection and AgeCollection
-    ac->clear();
-    tpc.reset();
-    delete ac;
-    m_cacheTM.erase(sp);
+    // readers of older versions still hold the entry; it is freed with them
+    update.owned.erase(it->second.get());
+    cache.erase(it);
   } else {
     //do nothing
   }
@@ -481,15 +516,22 @@ void PhraseDictionaryDynamicCacheBased::Insert(std::string &entries)
 void PhraseDictionaryDynamicCacheBased::Insert(std::vector<std::string> entries)
 {
   VERBOSE(3,"entries.size():|" << entries.size() << "|" << std::endl);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_updateLock);
+#endif
+  // decay and insertion are published together, so that no reader sees the
+  // aged cache without the new entries
+  CacheUpdate update;
+  BeginUpdate(update);
   if (m_constant == false) {
-    Decay();
+    Decay(update);
   }
-  Update(entries, "1");
-  IFVERBOSE(3) Print();
+  Update(update, entries, "1");
+  Publish(update);
 }
 
 
-void PhraseDictionaryDynamicCacheBased::Update(std::vector<std::string> entries, std::string ageString)
+void PhraseDictionaryDynamicCacheBased::Update(CacheUpdate &update, std::vector<std::string> entries, std::string ageString)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::Update(std::vector<std::string> entries, std::string ageString)" << std::endl);
   std::vector<std::string> pp;
@@ -504,14 +546,14 @@ void PhraseDictionaryDynamicCacheBased::Update(std::vector<std::string> entries,
 
     if (pp.size() > 2) {
       VERBOSE(3,"pp[2]:|" << pp[2] << "|" << std::endl);
-      Update(pp[0], pp[1], ageString, pp[2]);
+      Update(update, pp[0], pp[1], ageString, pp[2]);
     } else {
-      Update(pp[0], pp[1], ageString);
+      Update(update, pp[0], pp[1], ageString);
     }
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::Update(std::string sourcePhraseString, std::string targetPhraseString, std::string ageString, std::string waString)
+void PhraseDictionaryDynamicCacheBased::Update(CacheUpdate &update, std::string sourcePhraseString, std::string targetPhraseString, std::string ageString, std::string waString)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::Update(std::string sourcePhraseString, std::string targetPhraseString, std::string ageString, std::string waString)" << std::endl);
   const StaticData &staticData = StaticData::Instance();
@@ -540,37 +582,36 @@ void PhraseDictionaryDynamicCacheBased::Update(std::string sourcePhraseString, s
 
   if (!waString.empty()) VERBOSE(3, "waString:|" << waString << "|" << std::endl);
 
-  Update(sourcePhrase, targetPhrase, age, waString);
+  Update(update, sourcePhrase, targetPhrase, age, waString);
 }
 
-void PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int age, std::string waString)
+void PhraseDictionaryDynamicCacheBased::Update(CacheUpdate &update, Phrase sp, TargetPhrase tp, int age, std::string waString)
 {
   VERBOSE(3,"PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int age, std::string waString)" << std::endl);
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   VERBOSE(3, "PhraseDictionaryCache inserting sp:|" << sp << "| tp:|" << tp << "| age:|" << age << "| word-alignment |" << waString << "|" << std::endl);
 
-  cacheMap::const_iterator it = m_cacheTM.find(sp);
+  // the target phrase is scored with its age when it is looked up
+  Age newAge;
+  newAge.age = age;
+  newAge.clock = update.cache->clock;
+
+  cacheMap &cache = update.cache->entries;
+  cacheMap::iterator it = cache.find(sp);
   VERBOSE(3,"sp:|" << sp << "|" << std::endl);
-  if(it!=m_cacheTM.end()) {
+  if(it!=cache.end()) {
     VERBOSE(3,"sp:|" << sp << "| FOUND" << std::endl);
     // sp is found
-    // here we have to remove the target phrase from targetphrasecollection and from the TargetAgeMap
-    // and then add new entry
+    // here we have to update the target phrase in the targetphrasecollection and in the TargetAgeMap,
+    // or add a new entry
 
-    TargetCollectionAgePair TgtCollAgePair = it->second;
-    TargetPhraseCollection::shared_ptr  tpc = TgtCollAgePair.first;
-    AgeCollection* ac = TgtCollAgePair.second;
-//    const TargetPhrase* p_ptr = NULL;
-    const Phrase* p_ptr = NULL;
+    CacheEntry *entry = Modify(update, it);
+    TargetPhraseCollection &tpc = *entry->tpc;
     TargetPhrase* tp_ptr = NULL;
     bool found = false;
     size_t tp_pos=0;
-    while (!found && tp_pos < tpc->GetSize()) {
-      tp_ptr = (TargetPhrase*) tpc->GetTargetPhrase(tp_pos);
-      p_ptr = (const TargetPhrase*) tp_ptr;
-      if ((Phrase) tp == *p_ptr) {
+    while (!found && tp_pos < tpc.GetSize()) {
+      tp_ptr = (TargetPhrase*) tpc.GetTargetPhrase(tp_pos);
+      if ((Phrase) tp == *(const Phrase*) tp_ptr) {
         found = true;
         continue;
       }
@@ -580,19 +621,16 @@ void PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int a
       VERBOSE(3,"tp:|" << tp << "| NOT FOUND" << std::endl);
       std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(tp));
 
-      targetPhrase->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
       if (!waString.empty()) targetPhrase->SetAlignmentInfo(waString);
 
-      tpc->Add(targetPhrase.release());
+      tpc.Add(targetPhrase.release());
 
-      tp_pos = tpc->GetSize()-1;
-      ac->push_back(age);
+      entry->ages.push_back(newAge);
       m_entries++;
       VERBOSE(3,"sp:|" << sp << "tp:|" << tp << "| INSERTED" << std::endl);
     } else {
-      tp_ptr->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
       if (!waString.empty()) tp_ptr->SetAlignmentInfo(waString);
-      ac->at(tp_pos) = age;
+      entry->ages.at(tp_pos) = newAge;
       VERBOSE(3,"sp:|" << sp << "tp:|" << tp << "| UPDATED" << std::endl);
     }
   } else {
@@ -601,77 +639,84 @@ void PhraseDictionaryDynamicCacheBased::Update(Phrase sp, TargetPhrase tp, int a
     // create target collection
     // we have to create new target collection age pair and add new entry to target collection age pair
 
-    TargetPhraseCollection::shared_ptr tpc(new TargetPhraseCollection);
-    AgeCollection* ac = new AgeCollection();
-    m_cacheTM.insert(make_pair(sp,make_pair(tpc,ac)));
+    CacheEntryPtr entry(new CacheEntry);
+    entry->tpc.reset(new TargetPhraseCollection);
+    cache.insert(make_pair(sp, entry));
+    update.owned.insert(entry.get());
 
     //tp is not found
     std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(tp));
-    targetPhrase->GetScoreBreakdown().Assign(this, GetPreComputedScores(age));
     if (!waString.empty()) targetPhrase->SetAlignmentInfo(waString);
 
-    tpc->Add(targetPhrase.release());
-    ac->push_back(age);
+    entry->tpc->Add(targetPhrase.release());
+    entry->ages.push_back(newAge);
     m_entries++;
     VERBOSE(3,"sp:|" << sp << "| tp:|" << tp << "| INSERTED" << std::endl);
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::Decay()
+void PhraseDictionaryDynamicCacheBased::Decay(CacheUpdate &update)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
-  cacheMap::iterator it;
-  for(it = m_cacheTM.begin(); it!=m_cacheTM.end(); it++) {
-    Decay((*it).first);
+  VERBOSE(3,"void PhraseDictionaryDynamicCacheBased::Decay()" << std::endl);
+  // ages are relative to the clock, so this ages every entry
+  ++update.cache->clock;
+  // a target phrase expires at most m_maxAge insertions after it was
+  // inserted, so sweeping at that interval bounds the expired ones kept
+  if (update.cache->clock % std::max(m_maxAge, 1U) == 0) {
+    RemoveExpired(update);
   }
 }
 
-void PhraseDictionaryDynamicCacheBased::Decay(Phrase sp)
+void PhraseDictionaryDynamicCacheBased::RemoveExpired(CacheUpdate &update)
 {
-  VERBOSE(3,"void PhraseDictionaryDynamicCacheBased::Decay(Phrase sp) sp:|" << sp << "|" << std::endl);
-  cacheMap::iterator it = m_cacheTM.find(sp);
-  if (it != m_cacheTM.end()) {
-    VERBOSE(3,"found:|" << sp << "|" << std::endl);
-    //sp is found
-
-    TargetCollectionAgePair TgtCollAgePair = it->second;
-    TargetPhraseCollection::shared_ptr  tpc = TgtCollAgePair.first;
-    AgeCollection* ac = TgtCollAgePair.second;
-
-    //loop in inverted order to allow a correct deletion of std::vectors tpc and ac
-    for (int tp_pos = tpc->GetSize() - 1 ; tp_pos >= 0; tp_pos--) {
-      unsigned int tp_age = ac->at(tp_pos); //increase the age by 1
-      tp_age++; //increase the age by 1
-      VERBOSE(3,"sp:|" << sp << "| " << " new tp_age:|" << tp_age << "|" << std::endl);
-
-      TargetPhrase* tp_ptr = (TargetPhrase*) tpc->GetTargetPhrase(tp_pos);
-
-      if (tp_age > m_maxAge) {
-        VERBOSE(3,"tp_age:|" << tp_age << "| TOO BIG" << std::endl);
-        tpc->Remove(tp_pos); //delete entry in the Target Phrase Collection
-        ac->erase(ac->begin() + tp_pos); //delete entry in the Age Collection
-        m_entries--;
+  VERBOSE(3,"void PhraseDictionaryDynamicCacheBased::RemoveExpired()" << std::endl);
+  const CacheVersion &version = *update.cache;
+  cacheMap &cache = update.cache->entries;
+  cacheMap::iterator it = cache.begin();
+  while (it != cache.end()) {
+    const AgeCollection &ages = it->second->ages;
+    size_t expired = 0;
+    for (size_t tp_pos = 0; tp_pos < ages.size(); tp_pos++) {
+      if (IsExpired(version, ages[tp_pos])) expired++;
+    }
+    if (expired == 0) {
+      // still shared with the older versions
+      ++it;
+      continue;
+    }
+    m_entries -= expired;
+    if (expired == ages.size()) {
+      // delete the entry from the cache in case it points to an empty TargetPhraseCollection and AgeCollection
+      update.owned.erase(it->second.get());
+      it = cache.erase(it);
+      continue;
+    }
+    CacheEntry *entry = Modify(update, it);
+    size_t tp_pos = 0;
+    while (tp_pos < entry->ages.size()) {
+      if (IsExpired(version, entry->ages[tp_pos])) {
+        VERBOSE(3,"sp:|" << it->first << "| tp_age:|" << CurrentAge(version, entry->ages[tp_pos]) << "| TOO BIG" << std::endl);
+        delete entry->tpc->GetTargetPhrase(tp_pos);
+        entry->tpc->Remove(tp_pos);
+        entry->ages.erase(entry->ages.begin() + tp_pos);
       } else {
-        VERBOSE(3,"tp_age:|" << tp_age << "| STILL GOOD" << std::endl);
-        tp_ptr->GetScoreBreakdown().Assign(this, GetPreComputedScores(tp_age));
-        ac->at(tp_pos) = tp_age;
+        tp_pos++;
       }
     }
-    if (tpc->GetSize() == 0) {
-      // delete the entry from m_cacheTM in case it points to an empty TargetPhraseCollection and AgeCollection
-      (((*it).second).second)->clear();
-      delete ((*it).second).second;
-      ((*it).second).first.reset();
-      m_cacheTM.erase(sp);
-    }
-  } else {
-    //do nothing
-    VERBOSE(3,"sp:|" << sp << "| NOT FOUND" << std::endl);
+    ++it;
   }
+}
+
+unsigned int PhraseDictionaryDynamicCacheBased::CurrentAge(const CacheVersion &cache, const Age &age) const
+{
+  return age.age + (cache.clock - age.clock);
+}
 
-  //put here the removal of entries with age greater than m_maxAge
+bool PhraseDictionaryDynamicCacheBased::IsExpired(const CacheVersion &cache, const Age &age) const
+{
+  // a target phrase given an age above m_maxAge is only dropped once it
+  // ages, as when every insertion rebuilt the cache with the new ages
+  return cache.clock != age.clock && CurrentAge(cache, age) > m_maxAge;
 }
 
 void PhraseDictionaryDynamicCacheBased::Execute(std::string command)
@@ -703,15 +748,10 @@ void PhraseDictionaryDynamicCacheBased::Execute_Single_Command(std::string comma
 void PhraseDictionaryDynamicCacheBased::Clear()
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::mutex::scoped_lock lock(m_updateLock);
 #endif
-  cacheMap::iterator it;
-  for(it = m_cacheTM.begin(); it!=m_cacheTM.end(); it++) {
-    (((*it).second).second)->clear();
-    delete ((*it).second).second;
-    ((*it).second).first.reset();
-  }
-  m_cacheTM.clear();
+  CacheMapPtr empty(new CacheVersion);
+  boost::atomic_store(&m_cacheTM, empty);
   m_entries = 0;
 }
 
@@ -742,16 +782,14 @@ void PhraseDictionaryDynamicCacheBased::ExecuteDlt(std::map<std::string, std::st
 void PhraseDictionaryDynamicCacheBased::Print() const
 {
   VERBOSE(2,"PhraseDictionaryDynamicCacheBased::Print()" << std::endl);
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
+  CacheMapPtr cache = GetCache();
   cacheMap::const_iterator it;
-  for(it = m_cacheTM.begin(); it!=m_cacheTM.end(); it++) {
+  for(it = cache->entries.begin(); it!=cache->entries.end(); it++) {
     std::string source = (it->first).ToString();
-    TargetPhraseCollection::shared_ptr  tpc = (it->second).first;
-    TargetPhraseCollection::iterator itr;
-    for(itr = tpc->begin(); itr != tpc->end(); itr++) {
-      std::string target = (*itr)->ToString();
+    const TargetPhraseCollection &tpc = *it->second->tpc;
+    for(size_t tp_pos = 0; tp_pos < tpc.GetSize(); tp_pos++) {
+      if (IsExpired(*cache, it->second->ages[tp_pos])) continue;
+      std::string target = tpc.GetTargetPhrase(tp_pos)->ToString();
       std::cout << source << " ||| " << target << std::endl;
     }
     source.clear();
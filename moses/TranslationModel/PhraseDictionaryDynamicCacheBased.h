@@ -25,9 +25,12 @@
 #include "moses/TypeDef.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
-#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 #endif
 
 #define CBTM_SCORE_TYPE_UNDEFINED (-1)
@@ -48,16 +51,56 @@ class ChartCellCollectionBase;
 class ChartRuleLookupManager;
 
 /** Implementation of a Cache-based phrase table.
+ *
+ * The cache is kept in immutable, hashed versions.  Lookups take a reference
+ * to the current version and never block, while every update (insertion,
+ * removal, loading) copies the version, applies its changes to the copy and
+ * publishes the result atomically.  Entries that an update doesn't touch are
+ * shared between versions; the others are cloned on first change.  Updates
+ * are serialized by a mutex that lookups never take.
+ *
+ * Decay doesn't touch the entries: each version has a clock that every
+ * insertion advances, each target phrase remembers its age and the clock
+ * when it got that age, and lookups score target phrases with their current
+ * age.  Target phrases too old to be scored are skipped by lookups and
+ * removed by a sweep every cbtm-max-age insertions.
  */
 class PhraseDictionaryDynamicCacheBased : public PhraseDictionary
 {
 
-  typedef std::vector<unsigned int> AgeCollection;
-  typedef std::pair<TargetPhraseCollection::shared_ptr , AgeCollection*> TargetCollectionAgePair;
-  typedef std::map<Phrase, TargetCollectionAgePair> cacheMap;
+  // a target phrase had age when the clock of the cache was at clock
+  struct Age {
+    unsigned int age;
+    uint64_t clock;
+  };
+  typedef std::vector<Age> AgeCollection;
+
+  // target phrases of one source phrase and their ages, in the same order
+  struct CacheEntry {
+    TargetPhraseCollection::shared_ptr tpc;
+    AgeCollection ages;
+  };
+  typedef boost::shared_ptr<CacheEntry> CacheEntryPtr;
+  typedef boost::unordered_map<Phrase, CacheEntryPtr> cacheMap;
+
+  // a version of the cache; clock counts the insertions that aged it
+  struct CacheVersion {
+    CacheVersion() : clock(0) {}
+    cacheMap entries;
+    uint64_t clock;
+  };
+  typedef boost::shared_ptr<const CacheVersion> CacheMapPtr;
+
+  // a version of the cache under construction; owned holds the entries that
+  // were created for it and so can still be modified in place
+  struct CacheUpdate {
+    boost::shared_ptr<CacheVersion> cache;
+    boost::unordered_set<const CacheEntry*> owned;
+  };
 
-  // data structure for the cache
-  cacheMap m_cacheTM;
+  // data structure for the cache; only accessed with boost::atomic_load and
+  // boost::atomic_store
+  CacheMapPtr m_cacheTM;
   std::vector<Scores> precomputedScores;
   unsigned int m_maxAge;
   size_t m_score_type; //scoring type of the match
@@ -68,8 +111,8 @@ class PhraseDictionaryDynamicCacheBased : public PhraseDictionary
   std::string m_name; // internal name to identify this instance of the Cache-based phrase table
 
 #ifdef WITH_THREADS
-  //multiple readers - single writer lock
-  mutable boost::shared_mutex m_cacheLock;
+  //serializes the updates; readers don't take it
+  boost::mutex m_updateLock;
 #endif
 
   friend std::ostream& operator<<(std::ostream&, const PhraseDictionaryDynamicCacheBased&);
@@ -153,28 +196,35 @@ protected:
   float decaying_score(const int age);  // calculates the decay score given the age
   void Insert(std::vector<std::string> entries);
 
-  void Decay();   // traverse through the cache and decay each entry
-  void Decay(Phrase p);   // traverse through the cache and decay each entry for a given Phrase
-  void Update(std::vector<std::string> entries, std::string ageString);
-  void Update(std::string sourceString, std::string targetString, std::string ageString, std::string waString="");
-  void Update(Phrase p, TargetPhrase tp, int age, std::string waString="");
+  CacheMapPtr GetCache() const;
+  void BeginUpdate(CacheUpdate &update) const;
+  void Publish(CacheUpdate &update);
+  CacheEntry *Modify(CacheUpdate &update, cacheMap::iterator it) const;
+
+  void Decay(CacheUpdate &update);   // age every entry by one
+  void RemoveExpired(CacheUpdate &update);   // drop the target phrases too old to be scored
+  unsigned int CurrentAge(const CacheVersion &cache, const Age &age) const;
+  bool IsExpired(const CacheVersion &cache, const Age &age) const;
+  void Update(CacheUpdate &update, std::vector<std::string> entries, std::string ageString);
+  void Update(CacheUpdate &update, std::string sourceString, std::string targetString, std::string ageString, std::string waString="");
+  void Update(CacheUpdate &update, Phrase p, TargetPhrase tp, int age, std::string waString="");
 
-  void ClearEntries(std::vector<std::string> entries);
-  void ClearEntries(std::string sourceString, std::string targetString);
-  void ClearEntries(Phrase p, Phrase tp);
+  void ClearEntries(CacheUpdate &update, std::vector<std::string> entries);
+  void ClearEntries(CacheUpdate &update, std::string sourceString, std::string targetString);
+  void ClearEntries(CacheUpdate &update, Phrase p, Phrase tp);
 
-  void ClearSource(std::vector<std::string> entries);
-  void ClearSource(Phrase sp);
+  void ClearSource(CacheUpdate &update, std::vector<std::string> entries);
+  void ClearSource(CacheUpdate &update, Phrase sp);
 
   void Execute(std::vector<std::string> commands);
   void Execute_Single_Command(std::string command);
 
 
   void SetPreComputedScores(const unsigned int numScoreComponent);
-  Scores GetPreComputedScores(const unsigned int age);
+  Scores GetPreComputedScores(const unsigned int age) const;
 
-  void Load_Multiple_Files(std::vector<std::string> files);
-  void Load_Single_File(const std::string file);
+  void Load_Multiple_Files(CacheUpdate &update, std::vector<std::string> files);
+  void Load_Single_File(CacheUpdate &update, const std::string file);
 
   TargetPhrase *CreateTargetPhrase(const Phrase &sourcePhrase) const;
 };
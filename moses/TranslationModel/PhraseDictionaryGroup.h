@@ -64,6 +64,9 @@ class PhraseDictionaryGroup: public PhraseDictionary
 public:
   PhraseDictionaryGroup(const std::string& line);
   void Load(AllOptions::ptr const& opts);
+  std::vector<std::string> GetLoadDependencies() const {
+    return m_memberPDStrs;
+  }
   TargetPhraseCollection::shared_ptr
   CreateTargetPhraseCollection(const ttasksptr& ttask,
                                const Phrase& src) const;
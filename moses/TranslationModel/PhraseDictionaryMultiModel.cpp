@@ -97,21 +97,33 @@ void PhraseDictionaryMultiModel::Load(AllOptions::ptr const& opts)
 TargetPhraseCollection::shared_ptr
 PhraseDictionaryMultiModel::
 GetTargetPhraseCollectionLEGACY(const Phrase& src) const
+{
+  PhraseCache &cache = GetPhraseCache();
+  PhraseCache::const_iterator found = cache.find(src);
+  if (found != cache.end())
+    return found->second;
+
+  TargetPhraseCollection::shared_ptr ret
+  = GetTargetPhraseCollectionNonCacheLEGACY(src);
+  cache[src] = ret;
+  return ret;
+}
+
+TargetPhraseCollection::shared_ptr
+PhraseDictionaryMultiModel::
+GetTargetPhraseCollectionNonCacheLEGACY(const Phrase& src) const
 {
 
   std::vector<std::vector<float> > multimodelweights;
   multimodelweights = getWeights(m_numScoreComponents, true);
   TargetPhraseCollection::shared_ptr ret;
 
-  std::map<std::string, multiModelStats*>* allStats;
-  allStats = new(std::map<std::string,multiModelStats*>);
-  CollectSufficientStatistics(src, allStats);
-  ret = CreateTargetPhraseCollectionLinearInterpolation(src, allStats, multimodelweights);
-  RemoveAllInMap(*allStats);
-  delete allStats; // ??? Why the detour through malloc? UG
+  multiModelStatsMap allStats;
+  CollectSufficientStatistics(src, &allStats);
+  ret = CreateTargetPhraseCollectionLinearInterpolation(src, &allStats, multimodelweights);
+  RemoveAllInMap(allStats);
 
   ret->NthElement(m_tableLimit); // sort the phrases for pruning later
-  const_cast<PhraseDictionaryMultiModel*>(this)->CacheForCleanup(ret);
 
   return ret;
 }
@@ -119,7 +131,7 @@ GetTargetPhraseCollectionLEGACY(const Phrase& src) const
 void
 PhraseDictionaryMultiModel::
 CollectSufficientStatistics
-(const Phrase& src, std::map<std::string, multiModelStats*>* allStats) const
+(const Phrase& src, multiModelStatsMap* allStats) const
 {
   for(size_t i = 0; i < m_numModels; ++i) {
     const PhraseDictionary &pd = *m_pd[i];
@@ -139,10 +151,10 @@ CollectSufficientStatistics
         const TargetPhrase * targetPhrase = *iterTargetPhrase;
         std::vector<float> raw_scores = targetPhrase->GetScoreBreakdown().GetScoresForProducer(&pd);
 
-        std::string targetString = targetPhrase->GetStringRep(m_output);
-        if (allStats->find(targetString) == allStats->end()) {
+        multiModelStats *&statistics = (*allStats)[MakeMultiModelKey(*targetPhrase, m_output)];
+        if (statistics == NULL) {
 
-          multiModelStats * statistics = new multiModelStats;
+          statistics = new multiModelStats;
           statistics->targetPhrase = new TargetPhrase(*targetPhrase); //make a copy so that we don't overwrite the original phrase table info
           statistics->p.resize(m_numScoreComponents);
           for(size_t j = 0; j < m_numScoreComponents; ++j) {
@@ -158,16 +170,11 @@ CollectSufficientStatistics
           // zero out scores from original phrase table
           statistics->targetPhrase->GetScoreBreakdown().ZeroDenseFeatures(&pd);
 
-          (*allStats)[targetString] = statistics;
-
         }
-        multiModelStats * statistics = (*allStats)[targetString];
 
         for(size_t j = 0; j < m_numScoreComponents; ++j) {
           statistics->p[j][i] = UntransformScore(raw_scores[j]);
         }
-
-        (*allStats)[targetString] = statistics;
       }
     }
   }
@@ -177,11 +184,11 @@ TargetPhraseCollection::shared_ptr
 PhraseDictionaryMultiModel::
 CreateTargetPhraseCollectionLinearInterpolation
 ( const Phrase& src,
-  std::map<std::string,multiModelStats*>* allStats,
+  multiModelStatsMap* allStats,
   std::vector<std::vector<float> > &multimodelweights) const
 {
   TargetPhraseCollection::shared_ptr ret(new TargetPhraseCollection);
-  for ( std::map< std::string, multiModelStats*>::const_iterator iter = allStats->begin(); iter != allStats->end(); ++iter ) {
+  for ( multiModelStatsMap::const_iterator iter = allStats->begin(); iter != allStats->end(); ++iter ) {
 
     multiModelStats * statistics = iter->second;
 
@@ -204,7 +211,6 @@ CreateTargetPhraseCollectionLinearInterpolation
   return ret;
 }
 
-//TODO: is it worth caching the results as long as weights don't change?
 std::vector<std::vector<float> >
 PhraseDictionaryMultiModel::
 getWeights(size_t numWeights, bool normalize) const
@@ -278,15 +284,6 @@ CreateRuleLookupManager(const ChartParser &, const ChartCellCollectionBase&,
 }
 
 
-//copied from PhraseDictionaryCompact; free memory allocated to TargetPhraseCollection (and each TargetPhrase) at end of sentence
-void
-PhraseDictionaryMultiModel::
-CacheForCleanup(TargetPhraseCollection::shared_ptr tpc)
-{
-  GetPhraseCache().push_back(tpc);
-}
-
-
 void
 PhraseDictionaryMultiModel::
 CleanUpAfterSentenceProcessing(const InputType &source)
@@ -320,28 +317,23 @@ const std::vector<float>*
 PhraseDictionaryMultiModel::
 GetTemporaryMultiModelWeightsVector() const
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_lock_weights);
-  if (m_multimodelweights_tmp.find(boost::this_thread::get_id()) != m_multimodelweights_tmp.end()) {
-    return &m_multimodelweights_tmp.find(boost::this_thread::get_id())->second;
-  } else {
-    return NULL;
-  }
-#else
-  return &m_multimodelweights_tmp;
-#endif
+  return m_multimodelweights_tmp.get();
 }
 
 void
 PhraseDictionaryMultiModel::
 SetTemporaryMultiModelWeightsVector(std::vector<float> weights)
 {
-#ifdef WITH_THREADS
-  boost::unique_lock<boost::shared_mutex> lock(m_lock_weights);
-  m_multimodelweights_tmp[boost::this_thread::get_id()] = weights;
-#else
-  m_multimodelweights_tmp = weights;
-#endif
+  std::vector<float> *current = m_multimodelweights_tmp.get();
+  if (current == NULL) {
+    current = new std::vector<float>;
+    m_multimodelweights_tmp.reset(current);
+  }
+  if (*current != weights) {
+    // collections in this thread's cache were combined with other weights
+    GetPhraseCache().clear();
+    current->swap(weights);
+  }
 }
 
 #ifdef WITH_DLIB
@@ -365,28 +357,29 @@ MinimizePerplexity(vector<pair<string, string> > &phrase_pair_vector)
     string target_string = phrase_pair.second;
 
     vector<float> fs(m_numModels);
-    map<string,multiModelStats*>* allStats = new(map<string,multiModelStats*>);
+    multiModelStatsMap allStats;
 
     Phrase sourcePhrase(0);
     sourcePhrase.CreateFromString(Input, m_input, source_string, NULL);
+    Phrase targetPhrase(0);
+    targetPhrase.CreateFromString(Output, m_output, target_string, NULL);
 
-    CollectSufficientStatistics(sourcePhrase, allStats); //optimization potential: only call this once per source phrase
+    CollectSufficientStatistics(sourcePhrase, &allStats); //optimization potential: only call this once per source phrase
 
     //phrase pair not found; leave cache empty
-    if (allStats->find(target_string) == allStats->end()) {
-      RemoveAllInMap(*allStats);
-      delete allStats;
+    multiModelStatsMap::const_iterator found = allStats.find(MakeMultiModelKey(targetPhrase, m_output));
+    if (found == allStats.end()) {
+      RemoveAllInMap(allStats);
       continue;
     }
 
     multiModelStatsOptimization* targetStatistics = new multiModelStatsOptimization();
-    targetStatistics->targetPhrase = new TargetPhrase(*(*allStats)[target_string]->targetPhrase);
-    targetStatistics->p = (*allStats)[target_string]->p;
+    targetStatistics->targetPhrase = new TargetPhrase(*found->second->targetPhrase);
+    targetStatistics->p = found->second->p;
     targetStatistics->f = iter->second;
     optimizerStats.push_back(targetStatistics);
 
-    RemoveAllInMap(*allStats);
-    delete allStats;
+    RemoveAllInMap(allStats);
   }
 
   Sentence sentence;
@@ -498,4 +491,17 @@ PhraseDictionary *FindPhraseDictionary(const string &ptName)
   return pt;
 }
 
+multiModelKey MakeMultiModelKey(const Phrase &phrase, const std::vector<FactorType> &factors)
+{
+  multiModelKey key;
+  key.reserve(phrase.GetSize() * factors.size());
+  for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+    const Word &word = phrase.GetWord(pos);
+    for (size_t i = 0; i < factors.size(); ++i) {
+      key.push_back(word[factors[i]]);
+    }
+  }
+  return key;
+}
+
 } //namespace
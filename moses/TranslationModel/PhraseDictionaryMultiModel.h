@@ -24,7 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 
 #include <boost/unordered_map.hpp>
-#include <boost/thread/shared_mutex.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/tss.hpp>
 #include "moses/StaticData.h"
 #include "moses/TargetPhrase.h"
 #include "moses/Util.h"
@@ -44,6 +45,13 @@ struct multiModelStats {
   };
 };
 
+/** Identifies a target phrase while component tables are combined: the
+ * factors of its output factor types, word by word.  Factors are interned,
+ * so the pointers can be compared and hashed like ids, without building the
+ * string representation of each phrase. */
+typedef std::vector<const Factor*> multiModelKey;
+typedef boost::unordered_map<multiModelKey, multiModelStats*> multiModelStatsMap;
+
 struct multiModelStatsOptimization: multiModelStats {
   size_t f;
 };
@@ -59,6 +67,12 @@ struct multiModelPhrase {
 };
 
 /** Implementation of a virtual phrase table constructed from multiple component phrase tables.
+ *
+ * Combined collections are kept in a per-thread map until the end of the
+ * sentence, or until the thread's combination weights change, and are
+ * shared rather than copied as in the cache of PhraseDictionary.  They are
+ * not kept across sentences because component tables may change between
+ * sentences (e.g. cache-based or Mmsapt tables updated at run time).
  */
 class PhraseDictionaryMultiModel: public PhraseDictionary
 {
@@ -71,15 +85,18 @@ public:
   PhraseDictionaryMultiModel(int type, const std::string &line);
   ~PhraseDictionaryMultiModel();
   void Load(AllOptions::ptr const& opts);
+  std::vector<std::string> GetLoadDependencies() const {
+    return m_pdStr;
+  }
 
   virtual void
   CollectSufficientStatistics
-  (const Phrase& src, std::map<std::string,multiModelStats*>* allStats)
+  (const Phrase& src, multiModelStatsMap* allStats)
   const;
 
   virtual TargetPhraseCollection::shared_ptr
   CreateTargetPhraseCollectionLinearInterpolation
-  (const Phrase& src, std::map<std::string,multiModelStats*>* allStats,
+  (const Phrase& src, multiModelStatsMap* allStats,
    std::vector<std::vector<float> > &multimodelweights) const;
 
   std::vector<std::vector<float> >
@@ -88,9 +105,6 @@ public:
   std::vector<float>
   normalizeWeights(std::vector<float> &weights) const;
 
-  void
-  CacheForCleanup(TargetPhraseCollection::shared_ptr tpc);
-
   void
   CleanUpAfterSentenceProcessing(const InputType &source);
 
@@ -102,14 +116,21 @@ public:
   std::vector<float> Optimize(OptimizationObjective * ObjectiveFunction, size_t numModels);
 #endif
 
-  // functions below required by base class
+  using PhraseDictionary::GetTargetPhraseCollectionLEGACY;
+
   virtual TargetPhraseCollection::shared_ptr
   GetTargetPhraseCollectionLEGACY(const Phrase& src) const;
 
+  // functions below required by base class
+  virtual TargetPhraseCollection::shared_ptr
+  GetTargetPhraseCollectionNonCacheLEGACY(const Phrase& src) const;
+
   virtual void
   InitializeForInput(ttasksptr const& ttask) {
     // Don't do anything source specific here as this object is shared
-    // between threads.
+    // between threads.  The cache is per thread; combined collections
+    // may be stale once the component tables have changed.
+    GetPhraseCache().clear();
   }
 
   ChartRuleLookupManager*
@@ -132,37 +153,25 @@ protected:
   size_t m_numModels;
   std::vector<float> m_multimodelweights;
 
-  typedef std::vector<TargetPhraseCollection::shared_ptr> PhraseCache;
+  typedef boost::unordered_map<Phrase, TargetPhraseCollection::shared_ptr> PhraseCache;
 #ifdef WITH_THREADS
-  boost::shared_mutex m_lock_cache;
-  typedef std::map<boost::thread::id, PhraseCache> SentenceCache;
+  typedef boost::thread_specific_ptr<PhraseCache> SentenceCache;
+  typedef boost::thread_specific_ptr<std::vector<float> > WeightsVector;
 #else
-  typedef PhraseCache SentenceCache;
+  typedef boost::scoped_ptr<PhraseCache> SentenceCache;
+  typedef boost::scoped_ptr<std::vector<float> > WeightsVector;
 #endif
-  SentenceCache m_sentenceCache;
+  mutable SentenceCache m_sentenceCache;
 
-  PhraseCache& GetPhraseCache() {
-#ifdef WITH_THREADS
-    {
-      // first try read-only lock
-      boost::shared_lock<boost::shared_mutex> read_lock(m_lock_cache);
-      SentenceCache::iterator i = m_sentenceCache.find(boost::this_thread::get_id());
-      if (i != m_sentenceCache.end()) return i->second;
+  PhraseCache& GetPhraseCache() const {
+    if (!m_sentenceCache.get()) {
+      m_sentenceCache.reset(new PhraseCache());
     }
-    boost::unique_lock<boost::shared_mutex> lock(m_lock_cache);
-    return m_sentenceCache[boost::this_thread::get_id()];
-#else
-    return m_sentenceCache;
-#endif
+    return *m_sentenceCache;
   }
 
-#ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_lock_weights;
-  std::map<boost::thread::id, std::vector<float> > m_multimodelweights_tmp;
-#else
-  std::vector<float> m_multimodelweights_tmp;
-#endif
+  // weights passed in for the current sentence, per thread
+  WeightsVector m_multimodelweights_tmp;
 };
 
 #ifdef WITH_DLIB
@@ -198,6 +207,8 @@ protected:
 
 PhraseDictionary *FindPhraseDictionary(const std::string &ptName);
 
+multiModelKey MakeMultiModelKey(const Phrase &phrase, const std::vector<FactorType> &factors);
+
 } // end namespace
 
 #endif
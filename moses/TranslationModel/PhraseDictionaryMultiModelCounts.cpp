@@ -121,7 +121,7 @@ void PhraseDictionaryMultiModelCounts::Load(AllOptions::ptr const& opts)
 }
 
 
-TargetPhraseCollection::shared_ptr PhraseDictionaryMultiModelCounts::GetTargetPhraseCollectionLEGACY(const Phrase& src) const
+TargetPhraseCollection::shared_ptr PhraseDictionaryMultiModelCounts::GetTargetPhraseCollectionNonCacheLEGACY(const Phrase& src) const
 {
   vector<vector<float> > multimodelweights;
   bool normalize;
@@ -139,7 +139,6 @@ TargetPhraseCollection::shared_ptr PhraseDictionaryMultiModelCounts::GetTargetPh
   = CreateTargetPhraseCollectionCounts(src, fs, allStats, multimodelweights);
 
   ret->NthElement(m_tableLimit); // sort the phrases for pruning later
-  const_cast<PhraseDictionaryMultiModelCounts*>(this)->CacheForCleanup(ret);
   return ret;
 }
 
@@ -80,6 +80,11 @@ public:
   PhraseDictionaryMultiModelCounts(const std::string &line);
   ~PhraseDictionaryMultiModelCounts();
   void Load(AllOptions::ptr const& opts);
+  std::vector<std::string> GetLoadDependencies() const {
+    std::vector<std::string> ret(m_pdStr);
+    ret.insert(ret.end(), m_targetTable.begin(), m_targetTable.end());
+    return ret;
+  }
   TargetPhraseCollection::shared_ptr  CreateTargetPhraseCollectionCounts(const Phrase &src, std::vector<float> &fs, std::map<std::string,multiModelCountsStats*>* allStats, std::vector<std::vector<float> > &multimodelweights) const;
   void CollectSufficientStats(const Phrase &src, std::vector<float> &fs, std::map<std::string,multiModelCountsStats*>* allStats) const;
   float GetTargetCount(const Phrase& target, size_t modelIndex) const;
@@ -91,13 +96,14 @@ public:
   void FillLexicalCountsJoint(Word &wordS, Word &wordT, std::vector<float> &count, const std::vector<lexicalTable*> &tables) const;
   void FillLexicalCountsMarginal(Word &wordS, std::vector<float> &count, const std::vector<lexicalTable*> &tables) const;
   void LoadLexicalTable( std::string &fileName, lexicalTable* ltable);
-  TargetPhraseCollection::shared_ptr  GetTargetPhraseCollectionLEGACY(const Phrase& src) const;
+  TargetPhraseCollection::shared_ptr  GetTargetPhraseCollectionNonCacheLEGACY(const Phrase& src) const;
 #ifdef WITH_DLIB
   std::vector<float> MinimizePerplexity(std::vector<std::pair<std::string, std::string> > &phrase_pair_vector);
 #endif
   // functions below required by base class
   virtual void InitializeForInput(ttasksptr const& ttask) {
     /* Don't do anything source specific here as this object is shared between threads.*/
+    GetPhraseCache().clear(); // see PhraseDictionaryMultiModel::InitializeForInput()
   }
 
   void SetParameter(const std::string& key, const std::string& value);
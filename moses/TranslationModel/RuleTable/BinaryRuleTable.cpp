@@ -0,0 +1,567 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "BinaryRuleTable.h"
+
+#include "moses/AlignmentInfoCollection.h"
+#include "moses/Phrase.h"
+#include "moses/TargetPhrase.h"
+#include "moses/Util.h"
+#include "moses/TranslationModel/PhraseDictionary.h"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/tokenize_piece.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+
+using namespace std;
+
+namespace Moses
+{
+
+const char BinaryRuleTable::kMagic[8] = {'m', 'o', 's', 'e', 's', 'R', 'T', '1'};
+
+namespace
+{
+
+typedef BinaryRuleTable::Id Id;
+
+// Carves the arrays described in BinaryRuleTable.h out of the mapped file.
+class Blocks
+{
+public:
+  Blocks(const char *begin, std::size_t size)
+    : m_cur(begin + sizeof(BinaryRuleTableHeader)), m_end(begin + size) {}
+
+  template <class T> const T *Take(boost::uint64_t count) {
+    std::size_t bytes = count * sizeof(T);
+    std::size_t padded = (bytes + 7) & ~static_cast<std::size_t>(7);
+    UTIL_THROW_IF2(padded > static_cast<std::size_t>(m_end - m_cur),
+                   "Binary rule table is truncated");
+    const T *ret = reinterpret_cast<const T*>(m_cur);
+    m_cur += padded;
+    return ret;
+  }
+
+private:
+  const char *m_cur;
+  const char *m_end;
+};
+
+// Orders vocab ids by string, then terminals first.
+class VocabCompare
+{
+public:
+  VocabCompare(const boost::uint64_t *begin, const boost::uint8_t *nonTerm, const char *strings)
+    : m_begin(begin), m_nonTerm(nonTerm), m_strings(strings) {}
+
+  bool operator()(Id a, Id b) const {
+    int cmp = Get(a).compare(Get(b));
+    return cmp ? cmp < 0 : m_nonTerm[a] < m_nonTerm[b];
+  }
+
+  // For finding a terminal
+  bool operator()(Id a, const StringPiece &b) const {
+    int cmp = Get(a).compare(b);
+    return cmp ? cmp < 0 : false;
+  }
+
+private:
+  StringPiece Get(Id id) const {
+    return StringPiece(m_strings + m_begin[id], m_begin[id + 1] - m_begin[id]);
+  }
+
+  const boost::uint64_t *m_begin;
+  const boost::uint8_t *m_nonTerm;
+  const char *m_strings;
+};
+
+template <class T> void WriteArray(int fd, const vector<T> &array)
+{
+  static const char kZeros[8] = {0};
+  size_t bytes = array.size() * sizeof(T);
+  if (bytes) util::WriteOrThrow(fd, &array[0], bytes);
+  if (bytes % 8) util::WriteOrThrow(fd, kZeros, 8 - bytes % 8);
+}
+
+bool IsNonTerm(const StringPiece &word)
+{
+  return word.size() >= 2 && word[0] == '[' && word[word.size() - 1] == ']';
+}
+
+StringPiece Trim(StringPiece str)
+{
+  while (!str.empty() && (str[0] == ' ' || str[0] == '\t')) str.remove_prefix(1);
+  while (!str.empty() && (str[str.size() - 1] == ' ' || str[str.size() - 1] == '\t')) str.remove_suffix(1);
+  return str;
+}
+
+Id ParseId(const StringPiece &str, size_t lineNum)
+{
+  char *end;
+  string copy(str.data(), str.size());
+  unsigned long ret = strtoul(copy.c_str(), &end, 10);
+  UTIL_THROW_IF2(copy.empty() || *end, "Bad alignment point " << str << " on line " << lineNum);
+  return static_cast<Id>(ret);
+}
+
+const boost::uint64_t kNonTermKey = static_cast<boost::uint64_t>(1) << 63;
+
+} // namespace
+
+bool BinaryRuleTable::IsBinary(const std::string &path)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(path.c_str()));
+  char magic[sizeof(kMagic)];
+  std::size_t got = 0, ret;
+  while (got < sizeof(magic) && (ret = util::ReadOrEOF(fd.get(), magic + got, sizeof(magic) - got))) {
+    got += ret;
+  }
+  return got == sizeof(magic) && !std::memcmp(magic, kMagic, sizeof(magic));
+}
+
+BinaryRuleTable::BinaryRuleTable(const std::string &path, util::LoadMethod method)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(path.c_str()));
+  util::MapRead(method, fd.get(), 0, util::SizeOrThrow(fd.get()), m_mem);
+  const char *base = static_cast<const char*>(m_mem.get());
+
+  UTIL_THROW_IF2(m_mem.size() < sizeof(BinaryRuleTableHeader),
+                 "Binary rule table " << path << " is truncated");
+  std::memcpy(&m_header, base, sizeof(m_header));
+  UTIL_THROW_IF2(std::memcmp(m_header.magic, kMagic, sizeof(kMagic)),
+                 path << " is not a binary rule table");
+
+  Blocks blocks(base, m_mem.size());
+  m_vocabBegin = blocks.Take<boost::uint64_t>(m_header.vocab_size + 1);
+  m_vocabNonTerm = blocks.Take<boost::uint8_t>(m_header.vocab_size);
+  m_vocabSorted = blocks.Take<Id>(m_header.vocab_size);
+  m_nonTerms = blocks.Take<Id>(m_header.nonterms);
+  m_alignBegin = blocks.Take<boost::uint64_t>(m_header.align_sets + 1);
+  m_alignPoints = blocks.Take<Id>(2 * m_header.align_points);
+  m_sourceBegin = blocks.Take<boost::uint64_t>(m_header.rules + 1);
+  m_targetBegin = blocks.Take<boost::uint64_t>(m_header.rules + 1);
+  m_extraBegin = blocks.Take<boost::uint64_t>(2 * m_header.rules + 1);
+  m_sourceWords = blocks.Take<Id>(m_header.source_words);
+  m_targetWords = blocks.Take<Id>(m_header.target_words);
+  m_ruleLhs = blocks.Take<Id>(2 * m_header.rules);
+  m_ruleAlign = blocks.Take<Id>(2 * m_header.rules);
+  m_scores = blocks.Take<float>(m_header.rules * m_header.scores);
+  m_nodeTerm = blocks.Take<boost::uint64_t>(m_header.nodes + 1);
+  m_nodeNonTerm = blocks.Take<boost::uint64_t>(m_header.nodes + 1);
+  m_nodeRules = blocks.Take<boost::uint64_t>(m_header.nodes + 1);
+  m_termWord = blocks.Take<Id>(m_header.term_edges);
+  m_termChild = blocks.Take<Id>(m_header.term_edges);
+  m_nonTermLabel = blocks.Take<Id>(2 * m_header.nonterm_edges);
+  m_nonTermChild = blocks.Take<Id>(m_header.nonterm_edges);
+  m_ruleOrder = blocks.Take<Id>(m_header.rules);
+  m_vocabStrings = blocks.Take<char>(m_header.vocab_bytes);
+  m_extraStrings = blocks.Take<char>(m_header.extra_bytes);
+
+  UTIL_THROW_IF2(m_vocabBegin[m_header.vocab_size] > m_header.vocab_bytes
+                 || m_alignBegin[m_header.align_sets] > m_header.align_points
+                 || m_sourceBegin[m_header.rules] > m_header.source_words
+                 || m_targetBegin[m_header.rules] > m_header.target_words
+                 || m_extraBegin[2 * m_header.rules] > m_header.extra_bytes
+                 || !m_header.nodes
+                 || m_nodeTerm[m_header.nodes] > m_header.term_edges
+                 || m_nodeNonTerm[m_header.nodes] > m_header.nonterm_edges
+                 || m_nodeRules[m_header.nodes] > m_header.rules,
+                 "Binary rule table " << path << " is corrupt");
+}
+
+BinaryRuleTable::Id BinaryRuleTable::FindTerminal(const StringPiece &str) const
+{
+  const Id *end = m_vocabSorted + m_header.vocab_size;
+  const Id *found = std::lower_bound(m_vocabSorted, end, str,
+                                     VocabCompare(m_vocabBegin, m_vocabNonTerm, m_vocabStrings));
+  // terminals sort before the non-terminal with the same string
+  if (found == end || m_vocabNonTerm[*found] || GetString(*found) != str) return kNone;
+  return *found;
+}
+
+BinaryRuleTable::Id BinaryRuleTable::FindTerminalChild(Id node, Id word) const
+{
+  const Id *begin = m_termWord + m_nodeTerm[node];
+  const Id *end = m_termWord + m_nodeTerm[node + 1];
+  const Id *found = std::lower_bound(begin, end, word);
+  if (found == end || *found != word) return kNone;
+  return m_termChild[found - m_termWord];
+}
+
+void BinaryRuleTable::GetAlignmentSets(std::vector<const AlignmentInfo*> &out) const
+{
+  out.resize(m_header.align_sets);
+  AlignmentInfo::CollType coll;
+  for (boost::uint64_t i = 0; i < m_header.align_sets; ++i) {
+    coll.clear();
+    for (boost::uint64_t j = m_alignBegin[i]; j < m_alignBegin[i + 1]; ++j) {
+      coll.insert(std::pair<size_t, size_t>(m_alignPoints[2 * j], m_alignPoints[2 * j + 1]));
+    }
+    out[i] = AlignmentInfoCollection::Instance().Add(coll);
+  }
+}
+
+void BinaryRuleTable::CreateSourcePhrase(boost::uint64_t rule, BinaryRuleTableVocab &sourceVocab, Phrase &out) const
+{
+  out.Clear();
+  for (const Id *word = SourceBegin(rule); word != SourceEnd(rule); ++word) {
+    out.AddWord(sourceVocab.Get(*word));
+  }
+}
+
+TargetPhrase *BinaryRuleTable::CreateTargetPhrase(boost::uint64_t rule, BinaryRuleTableVocab &targetVocab,
+    const std::vector<const AlignmentInfo*> &alignmentSets,
+    const PhraseDictionary &pt) const
+{
+  TargetPhrase *targetPhrase = new TargetPhrase(&pt);
+  for (const Id *word = TargetBegin(rule); word != TargetEnd(rule); ++word) {
+    targetPhrase->AddWord(targetVocab.Get(*word));
+  }
+  const Id targetLhs = GetTargetLHS(rule);
+  targetPhrase->SetTargetLHS(targetLhs == kNone ? NULL : new Word(targetVocab.Get(targetLhs)));
+  UTIL_THROW_IF2(m_ruleAlign[2 * rule] >= alignmentSets.size() || m_ruleAlign[2 * rule + 1] >= alignmentSets.size(),
+                 "Bad alignment set for rule " << rule);
+  targetPhrase->SetAlignTerm(alignmentSets[m_ruleAlign[2 * rule]]);
+  targetPhrase->SetAlignNonTerm(alignmentSets[m_ruleAlign[2 * rule + 1]]);
+
+  StringPiece sparse(m_extraStrings + m_extraBegin[2 * rule], m_extraBegin[2 * rule + 1] - m_extraBegin[2 * rule]);
+  if (!sparse.empty()) {
+    targetPhrase->SetSparseScore(&pt, sparse);
+  }
+  StringPiece properties(m_extraStrings + m_extraBegin[2 * rule + 1], m_extraBegin[2 * rule + 2] - m_extraBegin[2 * rule + 1]);
+  if (!properties.empty()) {
+    targetPhrase->SetProperties(properties);
+  }
+
+  const float *scores = m_scores + rule * m_header.scores;
+  targetPhrase->GetScoreBreakdown().Assign(&pt, std::vector<float>(scores, scores + m_header.scores));
+  return targetPhrase;
+}
+
+BinaryRuleTableVocab::BinaryRuleTableVocab(const BinaryRuleTable &table, FactorDirection direction,
+    const std::vector<FactorType> &factors, bool cache)
+  : m_table(table), m_direction(direction), m_factors(factors)
+{
+  if (cache) {
+    m_words.resize(table.GetHeader().vocab_size);
+    m_made.resize(table.GetHeader().vocab_size, false);
+  }
+}
+
+const Word &BinaryRuleTableVocab::Get(BinaryRuleTable::Id id)
+{
+  UTIL_THROW_IF2(id >= m_table.GetHeader().vocab_size, "Bad vocabulary id " << id);
+  if (m_words.empty()) {
+    m_scratch = Word();
+    m_scratch.CreateFromString(m_direction, m_factors, m_table.GetString(id), m_table.IsNonTerminal(id));
+    return m_scratch;
+  }
+  if (!m_made[id]) {
+    m_words[id].CreateFromString(m_direction, m_factors, m_table.GetString(id), m_table.IsNonTerminal(id));
+    m_made[id] = true;
+  }
+  return m_words[id];
+}
+
+// Orders rules by their path in the trie, rules of a node before those of
+// its children and terminal edges before non-terminal edges.
+class BinaryRuleTableWriter::PathCompare
+{
+public:
+  explicit PathCompare(const BinaryRuleTableWriter &writer) : m_writer(writer) {}
+
+  bool operator()(Id a, Id b) const {
+    const boost::uint64_t *keys = m_writer.m_pathKeys.empty() ? NULL : &m_writer.m_pathKeys[0];
+    const vector<boost::uint64_t> &begin = m_writer.m_sourceBegin;
+    return std::lexicographical_compare(keys + begin[a], keys + begin[a + 1],
+                                        keys + begin[b], keys + begin[b + 1]);
+  }
+
+private:
+  const BinaryRuleTableWriter &m_writer;
+};
+
+BinaryRuleTableWriter::BinaryRuleTableWriter()
+  : m_scores(0), m_converter(double_conversion::StringToDoubleConverter::NO_FLAGS, NAN, NAN, "inf", "nan")
+{
+  m_vocabBegin.push_back(0);
+  m_alignBegin.push_back(0);
+  m_sourceBegin.push_back(0);
+  m_targetBegin.push_back(0);
+  m_extraBegin.push_back(0);
+}
+
+void BinaryRuleTableWriter::Add(const StringPiece &line, size_t lineNum)
+{
+  util::TokenIter<util::MultiCharacter> pipes(line, StringPiece("|||"));
+  StringPiece source(*pipes);
+  StringPiece target(*++pipes);
+  StringPiece scores(*++pipes);
+  StringPiece align;
+  if (++pipes) align = *pipes;
+
+  UTIL_THROW_IF2(Rules() >= BinaryRuleTable::kNone, "Too many rules on line " << lineNum);
+  const size_t sourceStart = m_sourceWords.size();
+  const size_t targetStart = m_targetWords.size();
+  Id sourceLhs, targetLhs;
+  vector<bool> targetNonTerm;
+  AddPhrase(source, true, m_sourceWords, sourceLhs, NULL);
+  AddPhrase(target, false, m_targetWords, targetLhs, &targetNonTerm);
+  m_sourceBegin.push_back(m_sourceWords.size());
+  m_targetBegin.push_back(m_targetWords.size());
+  m_ruleLhs.push_back(sourceLhs);
+  m_ruleLhs.push_back(targetLhs);
+
+  AlignmentSet term, nonTerm;
+  for (util::TokenIter<util::AnyCharacter, true> token(align, " \t"); token; ++token) {
+    util::TokenIter<util::SingleCharacter, false> dash(*token, '-');
+    Id sourcePos = ParseId(*dash, lineNum);
+    UTIL_THROW_IF2(!++dash, "Bad alignment point " << *token << " on line " << lineNum);
+    Id targetPos = ParseId(*dash, lineNum);
+    UTIL_THROW_IF2(targetPos >= targetNonTerm.size(),
+                   "Alignment point " << *token << " is outside the target on line " << lineNum);
+    (targetNonTerm[targetPos] ? nonTerm : term).push_back(make_pair(sourcePos, targetPos));
+  }
+  m_ruleAlign.push_back(InternAlignment(term));
+  m_ruleAlign.push_back(InternAlignment(nonTerm));
+
+  // as PhraseDictionaryMemory::GetOrCreateNode, a source non-terminal is
+  // keyed by its label and the label of the target non-terminal it is
+  // aligned to
+  AlignmentSet::const_iterator iterAlign = nonTerm.begin();
+  for (size_t pos = sourceStart; pos < m_sourceWords.size(); ++pos) {
+    const Id word = m_sourceWords[pos];
+    if (!m_vocabNonTerm[word]) {
+      m_pathKeys.push_back(word);
+      continue;
+    }
+    UTIL_THROW_IF2(iterAlign == nonTerm.end() || iterAlign->first != pos - sourceStart,
+                   "No alignment for non-term at position " << pos - sourceStart << " on line " << lineNum);
+    const Id targetWord = m_targetWords[targetStart + iterAlign->second];
+    ++iterAlign;
+    m_pathKeys.push_back(kNonTermKey | (static_cast<boost::uint64_t>(m_nonTermIndex[word]) << 32) | m_nonTermIndex[targetWord]);
+  }
+
+  size_t count = 0;
+  for (util::TokenIter<util::AnyCharacter, true> s(scores, " \t"); s; ++s, ++count) {
+    int processed;
+    float score = m_converter.StringToFloat(s->data(), s->length(), &processed);
+    UTIL_THROW_IF2(std::isnan(score), "Bad score " << *s << " on line " << lineNum);
+    m_scoreValues.push_back(FloorScore(TransformScore(score)));
+  }
+  if (m_sourceBegin.size() == 2) m_scores = count;
+  UTIL_THROW_IF2(count != m_scores, "Expected " << m_scores << " scores but found "
+                 << count << " on line " << lineNum);
+
+  // skip over counts field
+  ++pipes;
+  AddExtra(++pipes ? Trim(*pipes) : StringPiece());
+  AddExtra(++pipes ? Trim(*pipes) : StringPiece());
+}
+
+void BinaryRuleTableWriter::Write(int fd)
+{
+  m_vocabSorted.resize(m_vocabNonTerm.size());
+  for (Id i = 0; i < m_vocabSorted.size(); ++i) m_vocabSorted[i] = i;
+  if (!m_vocabStrings.empty()) {
+    std::sort(m_vocabSorted.begin(), m_vocabSorted.end(),
+              VocabCompare(&m_vocabBegin[0], &m_vocabNonTerm[0], &m_vocabStrings[0]));
+  }
+  BuildTrie();
+
+  BinaryRuleTableHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BinaryRuleTable::kMagic, sizeof(header.magic));
+  header.scores = m_scores;
+  header.vocab_size = m_vocabNonTerm.size();
+  header.vocab_bytes = m_vocabStrings.size();
+  header.nonterms = m_nonTerms.size();
+  header.align_sets = m_alignBegin.size() - 1;
+  header.align_points = m_alignPoints.size() / 2;
+  header.rules = m_sourceBegin.size() - 1;
+  header.source_words = m_sourceWords.size();
+  header.target_words = m_targetWords.size();
+  header.extra_bytes = m_extraStrings.size();
+  header.nodes = m_nodeRules.size() - 1;
+  header.term_edges = m_termWord.size();
+  header.nonterm_edges = m_nonTermChild.size();
+  util::WriteOrThrow(fd, &header, sizeof(header));
+
+  WriteArray(fd, m_vocabBegin);
+  WriteArray(fd, m_vocabNonTerm);
+  WriteArray(fd, m_vocabSorted);
+  WriteArray(fd, m_nonTerms);
+  WriteArray(fd, m_alignBegin);
+  WriteArray(fd, m_alignPoints);
+  WriteArray(fd, m_sourceBegin);
+  WriteArray(fd, m_targetBegin);
+  WriteArray(fd, m_extraBegin);
+  WriteArray(fd, m_sourceWords);
+  WriteArray(fd, m_targetWords);
+  WriteArray(fd, m_ruleLhs);
+  WriteArray(fd, m_ruleAlign);
+  WriteArray(fd, m_scoreValues);
+  WriteArray(fd, m_nodeTerm);
+  WriteArray(fd, m_nodeNonTerm);
+  WriteArray(fd, m_nodeRules);
+  WriteArray(fd, m_termWord);
+  WriteArray(fd, m_termChild);
+  WriteArray(fd, m_nonTermLabel);
+  WriteArray(fd, m_nonTermChild);
+  WriteArray(fd, m_ruleOrder);
+  WriteArray(fd, m_vocabStrings);
+  WriteArray(fd, m_extraStrings);
+}
+
+// Same split as Phrase::CreateFromString: a bracketed last word is the
+// LHS and each [source][target] non-terminal keeps the label of its side.
+void BinaryRuleTableWriter::AddPhrase(const StringPiece &phrase, bool isSource, vector<Id> &words, Id &lhs, vector<bool> *nonTerm)
+{
+  m_tokens.clear();
+  for (util::TokenIter<util::AnyCharacter, true> it(phrase, "\t "); it; ++it) {
+    m_tokens.push_back(*it);
+  }
+  size_t numWords = m_tokens.size();
+  lhs = BinaryRuleTable::kNone;
+  if (numWords && IsNonTerm(m_tokens.back())) {
+    --numWords;
+    const StringPiece &label = m_tokens.back();
+    lhs = Intern(label.substr(1, label.size() - 2), true);
+  }
+  for (size_t i = 0; i < numWords; ++i) {
+    StringPiece word(m_tokens[i]);
+    bool isNonTerm = IsNonTerm(word);
+    if (isNonTerm) {
+      size_t nextPos = word.find('[', 1);
+      UTIL_THROW_IF2(nextPos == StringPiece::npos,
+                     "Incorrect formatting of non-terminal. Should have 2 non-terms, eg. [X][X]. "
+                     << "Current string: " << word);
+      word = isSource ? word.substr(1, nextPos - 2) : word.substr(nextPos + 1, word.size() - nextPos - 2);
+    }
+    words.push_back(Intern(word, isNonTerm));
+    if (nonTerm) nonTerm->push_back(isNonTerm);
+  }
+}
+
+BinaryRuleTableWriter::Id BinaryRuleTableWriter::Intern(const StringPiece &word, bool isNonTerm)
+{
+  pair<string, bool> key(string(word.data(), word.size()), isNonTerm);
+  boost::unordered_map<pair<string, bool>, Id>::const_iterator found = m_vocab.find(key);
+  if (found != m_vocab.end()) return found->second;
+  Id id = m_vocabNonTerm.size();
+  UTIL_THROW_IF2(id == BinaryRuleTable::kNone, "Too many words in the rule table");
+  m_vocab[key] = id;
+  m_vocabStrings.insert(m_vocabStrings.end(), word.data(), word.data() + word.size());
+  m_vocabBegin.push_back(m_vocabStrings.size());
+  m_vocabNonTerm.push_back(isNonTerm);
+  m_nonTermIndex.push_back(isNonTerm ? m_nonTerms.size() : BinaryRuleTable::kNone);
+  if (isNonTerm) m_nonTerms.push_back(id);
+  return id;
+}
+
+BinaryRuleTableWriter::Id BinaryRuleTableWriter::InternAlignment(AlignmentSet &set)
+{
+  sort(set.begin(), set.end());
+  set.erase(unique(set.begin(), set.end()), set.end());
+  map<AlignmentSet, Id>::const_iterator found = m_alignments.find(set);
+  if (found != m_alignments.end()) return found->second;
+  Id id = m_alignBegin.size() - 1;
+  m_alignments[set] = id;
+  for (AlignmentSet::const_iterator i = set.begin(); i != set.end(); ++i) {
+    m_alignPoints.push_back(i->first);
+    m_alignPoints.push_back(i->second);
+  }
+  m_alignBegin.push_back(m_alignPoints.size() / 2);
+  return id;
+}
+
+void BinaryRuleTableWriter::AddExtra(const StringPiece &str)
+{
+  m_extraStrings.insert(m_extraStrings.end(), str.data(), str.data() + str.size());
+  m_extraBegin.push_back(m_extraStrings.size());
+}
+
+// Number the nodes breadth first so that the edges and rules of each node
+// are contiguous.
+void BinaryRuleTableWriter::BuildTrie()
+{
+  const Id rules = Rules();
+  vector<Id> order(rules);
+  for (Id i = 0; i < rules; ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), PathCompare(*this));
+
+  struct Pending {
+    Id node;
+    size_t begin, end, depth;
+  };
+  std::deque<Pending> queue;
+  Pending root = {0, 0, order.size(), 0};
+  queue.push_back(root);
+  Id nodes = 1;
+
+  m_nodeTerm.assign(1, 0);
+  m_nodeNonTerm.assign(1, 0);
+  m_nodeRules.assign(1, 0);
+  m_termWord.clear();
+  m_termChild.clear();
+  m_nonTermLabel.clear();
+  m_nonTermChild.clear();
+  m_ruleOrder.clear();
+  m_ruleOrder.reserve(rules);
+
+  while (!queue.empty()) {
+    const Pending pending = queue.front();
+    queue.pop_front();
+
+    size_t i = pending.begin;
+    for (; i < pending.end && m_sourceBegin[order[i] + 1] - m_sourceBegin[order[i]] == pending.depth; ++i) {
+      m_ruleOrder.push_back(order[i]);
+    }
+    while (i < pending.end) {
+      const boost::uint64_t key = m_pathKeys[m_sourceBegin[order[i]] + pending.depth];
+      size_t j = i + 1;
+      while (j < pending.end && m_pathKeys[m_sourceBegin[order[j]] + pending.depth] == key) ++j;
+
+      UTIL_THROW_IF2(nodes == BinaryRuleTable::kNone, "Too many trie nodes");
+      const Id child = nodes++;
+      if (key & kNonTermKey) {
+        m_nonTermLabel.push_back(static_cast<Id>((key & ~kNonTermKey) >> 32));
+        m_nonTermLabel.push_back(static_cast<Id>(key));
+        m_nonTermChild.push_back(child);
+      } else {
+        m_termWord.push_back(static_cast<Id>(key));
+        m_termChild.push_back(child);
+      }
+      Pending next = {child, i, j, pending.depth + 1};
+      queue.push_back(next);
+      i = j;
+    }
+
+    m_nodeTerm.push_back(m_termWord.size());
+    m_nodeNonTerm.push_back(m_nonTermChild.size());
+    m_nodeRules.push_back(m_ruleOrder.size());
+  }
+}
+
+}  // namespace Moses
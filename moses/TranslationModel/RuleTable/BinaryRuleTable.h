@@ -0,0 +1,305 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include "moses/AlignmentInfo.h"
+#include "moses/TypeDef.h"
+#include "moses/Word.h"
+#include "util/double-conversion/double-conversion.h"
+#include "util/mmap.hh"
+#include "util/string_piece.hh"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Moses
+{
+class BinaryRuleTableVocab;
+class Phrase;
+class PhraseDictionary;
+class TargetPhrase;
+
+/** Binary snapshot of a text rule table, written by BinaryRuleTableWriter
+ * (see misc/CreateBinaryRuleTable).
+ *
+ * The file starts with BinaryRuleTableHeader and is followed by flat arrays,
+ * each padded to a multiple of 8 bytes:
+ *
+ *   uint64 vocab_begin[vocab_size + 1]     offsets into vocab strings
+ *   uint8  vocab_nonterm[vocab_size]
+ *   uint32 vocab_sorted[vocab_size]        ids by string, then non-terminal
+ *   uint32 nonterms[nonterms]              vocab ids of the non-terminals
+ *   uint64 align_begin[align_sets + 1]     offsets into align_points (pairs)
+ *   uint32 align_points[2 * align_points]  source, target
+ *   uint64 source_begin[rules + 1]         offsets into source_words
+ *   uint64 target_begin[rules + 1]         offsets into target_words
+ *   uint64 extra_begin[2 * rules + 1]      sparse, properties per rule
+ *   uint32 source_words[]                  vocab ids
+ *   uint32 target_words[]                  vocab ids
+ *   uint32 rule_lhs[2 * rules]             source, target LHS (or kNone)
+ *   uint32 rule_align[2 * rules]           terminal, non-terminal set
+ *   float  scores[rules * scores]          log scores, floored
+ *   uint64 node_term[nodes + 1]            offsets into the terminal edges
+ *   uint64 node_nonterm[nodes + 1]         offsets into the non-terminal edges
+ *   uint64 node_rules[nodes + 1]           offsets into rule_order
+ *   uint32 term_word[term_edges]           vocab id, ascending per node
+ *   uint32 term_child[term_edges]
+ *   uint32 nonterm_label[2 * nonterm_edges]  source, target non-terminal index
+ *   uint32 nonterm_child[nonterm_edges]
+ *   uint32 rule_order[rules]               rules by trie node
+ *   char   vocab strings, extra strings
+ *
+ * The nodes form the source side trie of PhraseDictionaryMemory: a terminal
+ * edge per source word and a non-terminal edge per pair of source and
+ * aligned target labels, node 0 being the root.  Words are interned once per
+ * table, alignment sets once per distinct set and the dense scores are stored
+ * after TransformScore and FloorScore, so reading a rule does no tokenizing
+ * or number parsing.
+ */
+struct BinaryRuleTableHeader {
+  char magic[8];
+  boost::uint64_t scores;
+  boost::uint64_t vocab_size, vocab_bytes, nonterms;
+  boost::uint64_t align_sets, align_points;
+  boost::uint64_t rules, source_words, target_words;
+  boost::uint64_t extra_bytes;
+  boost::uint64_t nodes, term_edges, nonterm_edges;
+};
+
+/** Read-only view of a binary rule table, mapped from disk.  The mapped
+ * pages are shared by all the processes that read the same file.
+ */
+class BinaryRuleTable : boost::noncopyable
+{
+public:
+  typedef boost::uint32_t Id;
+
+  static const char kMagic[8];
+  static const Id kNone = 0xffffffff;
+
+  // Whether the file at path starts with kMagic.
+  static bool IsBinary(const std::string &path);
+
+  // LAZY maps pages in as the rules are read; POPULATE_OR_LAZY reads the
+  // whole file ahead.
+  BinaryRuleTable(const std::string &path, util::LoadMethod method);
+
+  const BinaryRuleTableHeader &GetHeader() const {
+    return m_header;
+  }
+
+  // Vocabulary
+  StringPiece GetString(Id word) const {
+    return StringPiece(m_vocabStrings + m_vocabBegin[word], m_vocabBegin[word + 1] - m_vocabBegin[word]);
+  }
+  bool IsNonTerminal(Id word) const {
+    return m_vocabNonTerm[word];
+  }
+  // kNone if str is not a terminal of the table.
+  Id FindTerminal(const StringPiece &str) const;
+  // Vocab id of non-terminal index
+  Id GetNonTerminal(Id index) const {
+    return m_nonTerms[index];
+  }
+
+  // Rules
+  const Id *SourceBegin(boost::uint64_t rule) const {
+    return m_sourceWords + m_sourceBegin[rule];
+  }
+  const Id *SourceEnd(boost::uint64_t rule) const {
+    return m_sourceWords + m_sourceBegin[rule + 1];
+  }
+  const Id *TargetBegin(boost::uint64_t rule) const {
+    return m_targetWords + m_targetBegin[rule];
+  }
+  const Id *TargetEnd(boost::uint64_t rule) const {
+    return m_targetWords + m_targetBegin[rule + 1];
+  }
+  Id GetSourceLHS(boost::uint64_t rule) const {
+    return m_ruleLhs[2 * rule];
+  }
+  Id GetTargetLHS(boost::uint64_t rule) const {
+    return m_ruleLhs[2 * rule + 1];
+  }
+
+  // Trie
+  // kNone if node has no terminal edge for word.
+  Id FindTerminalChild(Id node, Id word) const;
+  bool HasTerminalChildren(Id node) const {
+    return m_nodeTerm[node] != m_nodeTerm[node + 1];
+  }
+  // Non-terminal edges of node are [NonTerminalBegin(node), NonTerminalEnd(node))
+  boost::uint64_t NonTerminalBegin(Id node) const {
+    return m_nodeNonTerm[node];
+  }
+  boost::uint64_t NonTerminalEnd(Id node) const {
+    return m_nodeNonTerm[node + 1];
+  }
+  // Non-terminal indices of the source and target label of an edge
+  Id GetEdgeSourceLabel(boost::uint64_t edge) const {
+    return m_nonTermLabel[2 * edge];
+  }
+  Id GetEdgeTargetLabel(boost::uint64_t edge) const {
+    return m_nonTermLabel[2 * edge + 1];
+  }
+  Id GetEdgeChild(boost::uint64_t edge) const {
+    return m_nonTermChild[edge];
+  }
+  // Terminal edges, for walking the whole trie
+  boost::uint64_t TerminalBegin(Id node) const {
+    return m_nodeTerm[node];
+  }
+  boost::uint64_t TerminalEnd(Id node) const {
+    return m_nodeTerm[node + 1];
+  }
+  Id GetTerminalWord(boost::uint64_t edge) const {
+    return m_termWord[edge];
+  }
+  Id GetTerminalChild(boost::uint64_t edge) const {
+    return m_termChild[edge];
+  }
+  // Rules whose source side ends at node
+  const Id *RulesBegin(Id node) const {
+    return m_ruleOrder + m_nodeRules[node];
+  }
+  const Id *RulesEnd(Id node) const {
+    return m_ruleOrder + m_nodeRules[node + 1];
+  }
+
+  // Intern each alignment set of the table, indexed by set id.
+  void GetAlignmentSets(std::vector<const AlignmentInfo*> &out) const;
+
+  // The source side of rule, with the source labels of the non-terminals
+  void CreateSourcePhrase(boost::uint64_t rule, BinaryRuleTableVocab &sourceVocab, Phrase &out) const;
+
+  // The target phrase of rule with its scores, before EvaluateInIsolation
+  TargetPhrase *CreateTargetPhrase(boost::uint64_t rule, BinaryRuleTableVocab &targetVocab,
+                                   const std::vector<const AlignmentInfo*> &alignmentSets,
+                                   const PhraseDictionary &pt) const;
+
+private:
+  util::scoped_memory m_mem;
+  BinaryRuleTableHeader m_header;
+
+  const boost::uint64_t *m_vocabBegin;
+  const boost::uint8_t *m_vocabNonTerm;
+  const Id *m_vocabSorted;
+  const Id *m_nonTerms;
+  const boost::uint64_t *m_alignBegin;
+  const Id *m_alignPoints;
+  const boost::uint64_t *m_sourceBegin, *m_targetBegin, *m_extraBegin;
+  const Id *m_sourceWords, *m_targetWords;
+  const Id *m_ruleLhs, *m_ruleAlign;
+  const float *m_scores;
+  const boost::uint64_t *m_nodeTerm, *m_nodeNonTerm, *m_nodeRules;
+  const Id *m_termWord, *m_termChild;
+  const Id *m_nonTermLabel, *m_nonTermChild;
+  const Id *m_ruleOrder;
+  const char *m_vocabStrings, *m_extraStrings;
+};
+
+/** Makes the Words of a binary rule table for one side of the rules.  With
+ * cache set, each word is made once and kept; otherwise the word is made
+ * again on every call and only valid until the next one.
+ */
+class BinaryRuleTableVocab
+{
+public:
+  BinaryRuleTableVocab(const BinaryRuleTable &table, FactorDirection direction,
+                       const std::vector<FactorType> &factors, bool cache);
+
+  const Word &Get(BinaryRuleTable::Id id);
+
+private:
+  const BinaryRuleTable &m_table;
+  FactorDirection m_direction;
+  const std::vector<FactorType> &m_factors;
+  std::vector<Word> m_words;
+  std::vector<bool> m_made;
+  Word m_scratch;
+};
+
+/** Compiles a Moses-format text rule table, one line at a time, into the
+ * format described at BinaryRuleTableHeader.
+ */
+class BinaryRuleTableWriter
+{
+public:
+  typedef BinaryRuleTable::Id Id;
+
+  BinaryRuleTableWriter();
+
+  void Add(const StringPiece &line, size_t lineNum);
+
+  void Write(int fd);
+
+  size_t Rules() const {
+    return m_sourceBegin.size() - 1;
+  }
+
+private:
+  typedef std::vector<std::pair<Id, Id> > AlignmentSet;
+
+  class PathCompare;
+
+  void AddPhrase(const StringPiece &phrase, bool isSource, std::vector<Id> &words, Id &lhs, std::vector<bool> *nonTerm);
+  Id Intern(const StringPiece &word, bool isNonTerm);
+  Id InternAlignment(AlignmentSet &set);
+  void AddExtra(const StringPiece &str);
+  void BuildTrie();
+
+  boost::uint64_t m_scores;
+  double_conversion::StringToDoubleConverter m_converter;
+  std::vector<StringPiece> m_tokens;
+
+  boost::unordered_map<std::pair<std::string, bool>, Id> m_vocab;
+  std::map<AlignmentSet, Id> m_alignments;
+  std::vector<Id> m_nonTermIndex;
+
+  std::vector<boost::uint64_t> m_vocabBegin;
+  std::vector<boost::uint8_t> m_vocabNonTerm;
+  std::vector<Id> m_vocabSorted;
+  std::vector<Id> m_nonTerms;
+  std::vector<char> m_vocabStrings;
+  std::vector<boost::uint64_t> m_alignBegin;
+  std::vector<Id> m_alignPoints;
+  std::vector<boost::uint64_t> m_sourceBegin, m_targetBegin, m_extraBegin;
+  std::vector<Id> m_sourceWords, m_targetWords;
+  std::vector<Id> m_ruleLhs, m_ruleAlign;
+  std::vector<float> m_scoreValues;
+  std::vector<char> m_extraStrings;
+
+  // Trie key of each source word: the vocab id of a terminal, or the
+  // non-terminal indices of the source and target label with the top bit set
+  std::vector<boost::uint64_t> m_pathKeys;
+  std::vector<boost::uint64_t> m_nodeTerm, m_nodeNonTerm, m_nodeRules;
+  std::vector<Id> m_termWord, m_termChild;
+  std::vector<Id> m_nonTermLabel, m_nonTermChild;
+  std::vector<Id> m_ruleOrder;
+};
+
+}  // namespace Moses
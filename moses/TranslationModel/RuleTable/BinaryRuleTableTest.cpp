@@ -0,0 +1,188 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2014- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "moses/StaticData.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TargetPhraseCollection.h"
+#include "moses/TranslationModel/PhraseDictionaryMemory.h"
+#include "moses/TranslationModel/RuleTable/BinaryRuleTable.h"
+#include "moses/TranslationModel/RuleTable/PhraseDictionaryMapped.h"
+#include "util/file.hh"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(binary_rule_table)
+
+namespace
+{
+
+const char *kRules[] = {
+  "das Haus [X] ||| the house [X] ||| 0.5 0.25 ||| 0-0 1-1 ||| 1 1 1",
+  "das [X][NP] [X] ||| the [X][NP] [S] ||| 0.4 0.1 ||| 0-0 1-1 |||",
+  "das [X][NP] [X] ||| that [X][NP] [X] ||| 0.3 0.2 ||| 0-0 1-1",
+  "das [X][X] [X] ||| the [X][X] [X] ||| 0.3 0.2 ||| 0-0 1-1",
+  "[X][NP] Haus [X] ||| [X][NP] house [X] ||| 0.2 0.3 ||| 0-0 1-1",
+  "[X][X] [X][NP] [X] ||| [X][NP] [X][X] [X] ||| 0.1 0.6 ||| 0-1 1-0",
+  "Haus [X] ||| house [X] ||| 0.8 0.7 ||| 0-0",
+  "Haus [X] ||| home [X] ||| 0.6 0.5 |||",
+  "klein [X][ADJ] Haus [NP] ||| small [X][ADJ] house [NP] ||| 1 0.01 ||| 0-0 1-1 2-2"
+};
+
+// Other suites leave their mock features registered after they are gone,
+// and a phrase dictionary applies every registered feature when it loads.
+class RegisteredFeatures : public FeatureFunction
+{
+public:
+  static vector<FeatureFunction*> &Get() {
+    return s_staticColl;
+  }
+};
+
+struct RuleTableFiles {
+  RuleTableFiles() {
+    RegisteredFeatures::Get().swap(m_savedFeatures);
+    m_savedWeights = StaticData::Instance().GetAllWeights();
+
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path();
+    text = (dir / boost::filesystem::unique_path("rule-table-%%%%-%%%%")).string();
+    binary = text + ".bin";
+
+    ofstream out(text.c_str());
+    BinaryRuleTableWriter writer;
+    for (size_t i = 0; i < sizeof(kRules) / sizeof(kRules[0]); ++i) {
+      out << kRules[i] << "\n";
+      writer.Add(kRules[i], i + 1);
+    }
+    util::scoped_fd fd(util::CreateOrThrow(binary.c_str()));
+    writer.Write(fd.get());
+  }
+
+  ~RuleTableFiles() {
+    boost::filesystem::remove(text);
+    boost::filesystem::remove(binary);
+    RegisteredFeatures::Get().swap(m_savedFeatures);
+    StaticData::InstanceNonConst().SetAllWeights(m_savedWeights);
+  }
+
+  string text, binary;
+  vector<FeatureFunction*> m_savedFeatures;
+  ScoreComponentCollection m_savedWeights;
+};
+
+string Line(const string &name, const string &path)
+{
+  return "PhraseDictionary name=" + name + " num-features=2 input-factor=0 output-factor=0 path=" + path;
+}
+
+void AddRules(const string &path, const TargetPhraseCollection &tpc,
+              const PhraseDictionary &pt, vector<string> &out)
+{
+  const vector<FactorType> &factors = pt.GetOutput();
+  for (TargetPhraseCollection::const_iterator it = tpc.begin(); it != tpc.end(); ++it) {
+    const TargetPhrase &target = **it;
+    ostringstream rule;
+    rule << path << "||| " << target.GetStringRep(factors) << " ||| "
+         << target.GetTargetLHS().GetString(factors, false) << " |||";
+    vector<float> scores = target.GetScoreBreakdown().GetScoresForProducer(&pt);
+    for (size_t i = 0; i < scores.size(); ++i) rule << " " << scores[i];
+    rule << " ||| " << target.GetAlignTerm() << " ||| " << target.GetAlignNonTerm();
+    out.push_back(rule.str());
+  }
+}
+
+void Walk(const PhraseDictionaryNodeMemory &node, const string &path,
+          const PhraseDictionary &pt, vector<string> &out)
+{
+  AddRules(path, *node.GetTargetPhraseCollection(), pt, out);
+  const vector<FactorType> &factors = pt.GetInput();
+  typedef PhraseDictionaryNodeMemory::TerminalMap TermMap;
+  typedef PhraseDictionaryNodeMemory::NonTerminalMap NonTermMap;
+  for (TermMap::const_iterator p = node.GetTerminalMap().begin(); p != node.GetTerminalMap().end(); ++p) {
+    Walk(p->second, path + p->first.GetString(factors, false) + " ", pt, out);
+  }
+  for (NonTermMap::const_iterator p = node.GetNonTerminalMap().begin(); p != node.GetNonTerminalMap().end(); ++p) {
+    Walk(p->second, path + "[" + p->first.first.GetString(factors, false) + "]["
+         + p->first.second.GetString(pt.GetOutput(), false) + "] ", pt, out);
+  }
+}
+
+void Walk(const PhraseDictionaryMapped &pt, BinaryRuleTable::Id node, const string &path, vector<string> &out)
+{
+  const BinaryRuleTable &table = pt.GetTable();
+  AddRules(path, *pt.GetTargetPhraseCollection(node), pt, out);
+  for (boost::uint64_t edge = table.TerminalBegin(node); edge != table.TerminalEnd(node); ++edge) {
+    Walk(pt, table.GetTerminalChild(edge), path + table.GetString(table.GetTerminalWord(edge)).as_string() + " ", out);
+  }
+  for (boost::uint64_t edge = table.NonTerminalBegin(node); edge != table.NonTerminalEnd(node); ++edge) {
+    const StringPiece source = table.GetString(table.GetNonTerminal(table.GetEdgeSourceLabel(edge)));
+    const StringPiece target = table.GetString(table.GetNonTerminal(table.GetEdgeTargetLabel(edge)));
+    Walk(pt, table.GetEdgeChild(edge), path + "[" + source.as_string() + "][" + target.as_string() + "] ", out);
+  }
+}
+
+} // namespace
+
+// The rules of a text table, of its binary snapshot loaded into the memory
+// trie and of the snapshot served by PhraseDictionaryMapped must be the same.
+BOOST_FIXTURE_TEST_CASE(binary_round_trip, RuleTableFiles)
+{
+  BOOST_CHECK(BinaryRuleTable::IsBinary(binary));
+  BOOST_CHECK(!BinaryRuleTable::IsBinary(text));
+
+  AllOptions::ptr opts = StaticData::Instance().options();
+  PhraseDictionaryMemory fromText(Line("FromText", text));
+  PhraseDictionaryMemory fromBinary(Line("FromBinary", binary));
+  PhraseDictionaryMapped mapped(Line("Mapped", binary));
+  FeatureFunction::Register(&fromText);
+  FeatureFunction::Register(&fromBinary);
+  FeatureFunction::Register(&mapped);
+  ScoreComponentCollection weights;
+  weights.Assign(&fromText, vector<float>(2, 1.0f));
+  weights.Assign(&fromBinary, vector<float>(2, 1.0f));
+  weights.Assign(&mapped, vector<float>(2, 1.0f));
+  StaticData::InstanceNonConst().SetAllWeights(weights);
+
+  fromText.Load(opts);
+  fromBinary.Load(opts);
+  mapped.Load(opts);
+
+  vector<string> expected, loaded, served;
+  Walk(fromText.GetRootNode(), "", fromText, expected);
+  Walk(fromBinary.GetRootNode(), "", fromBinary, loaded);
+  Walk(mapped, 0, "", served);
+  sort(expected.begin(), expected.end());
+  sort(loaded.begin(), loaded.end());
+  sort(served.begin(), served.end());
+
+  BOOST_CHECK_EQUAL(expected.size(), sizeof(kRules) / sizeof(kRules[0]));
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), loaded.begin(), loaded.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), served.begin(), served.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
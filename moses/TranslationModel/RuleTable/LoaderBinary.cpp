@@ -0,0 +1,82 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "LoaderBinary.h"
+
+#include "moses/TargetPhrase.h"
+#include "moses/Timer.h"
+#include "BinaryRuleTable.h"
+#include "Trie.h"
+
+#include <iostream>
+
+namespace Moses
+{
+
+bool RuleTableLoaderBinary::Load(AllOptions const& opts,
+                                 const std::vector<FactorType> &input,
+                                 const std::vector<FactorType> &output,
+                                 const std::string &inFile,
+                                 size_t /* tableLimit */,
+                                 RuleTableTrie &ruleTable)
+{
+  PrintUserTime("Start loading binary rule table");
+
+  BinaryRuleTable table(inFile, util::POPULATE_OR_LAZY);
+  const BinaryRuleTableHeader &header = table.GetHeader();
+  if (header.scores != ruleTable.GetNumScoreComponents()) {
+    std::cerr << "Binary rule table " << inFile << " has " << header.scores
+              << " scores per rule but " << ruleTable.GetNumScoreComponents()
+              << " are configured" << std::endl;
+    return false;
+  }
+
+  BinaryRuleTableVocab sourceVocab(table, Input, input, true);
+  BinaryRuleTableVocab targetVocab(table, Output, output, true);
+
+  // Alignment sets are shared by many rules, so intern each one once.
+  std::vector<const AlignmentInfo *> alignmentSets;
+  table.GetAlignmentSets(alignmentSets);
+
+  Phrase sourcePhrase;
+  for (boost::uint64_t i = 0; i < header.rules; ++i) {
+    const BinaryRuleTable::Id sourceLhsId = table.GetSourceLHS(i);
+    if (table.SourceBegin(i) == table.SourceEnd(i) && sourceLhsId == BinaryRuleTable::kNone
+        && !opts.unk.word_deletion_enabled) {
+      continue;
+    }
+
+    table.CreateSourcePhrase(i, sourceVocab, sourcePhrase);
+    TargetPhrase *targetPhrase = table.CreateTargetPhrase(i, targetVocab, alignmentSets, ruleTable);
+    targetPhrase->EvaluateInIsolation(sourcePhrase, ruleTable.GetFeaturesToApply());
+
+    const Word *sourceLHS = sourceLhsId == BinaryRuleTable::kNone ? NULL : &sourceVocab.Get(sourceLhsId);
+    TargetPhraseCollection::shared_ptr phraseColl
+    = GetOrCreateTargetPhraseCollection(ruleTable, sourcePhrase,
+                                        *targetPhrase, sourceLHS);
+    phraseColl->Add(targetPhrase);
+  }
+
+  // sort and prune each target phrase collection
+  SortAndPrune(ruleTable);
+
+  return true;
+}
+
+}  // namespace Moses
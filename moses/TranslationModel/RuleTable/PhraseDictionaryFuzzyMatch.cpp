@@ -83,6 +83,7 @@ namespace Moses
 PhraseDictionaryFuzzyMatch::PhraseDictionaryFuzzyMatch(const std::string &line)
   :PhraseDictionary(line, true)
   ,m_config(3)
+  ,m_matchThreads(1)
   ,m_FuzzyMatchWrapper(NULL)
 {
   ReadParameters();
@@ -98,7 +99,7 @@ void PhraseDictionaryFuzzyMatch::Load(AllOptions::ptr const& opts)
   m_options = opts;
   SetFeaturesToApply();
 
-  m_FuzzyMatchWrapper = new tmmt::FuzzyMatchWrapper(m_config[0], m_config[1], m_config[2]);
+  m_FuzzyMatchWrapper = new tmmt::FuzzyMatchWrapper(m_config[0], m_config[1], m_config[2], m_matchThreads);
 }
 
 ChartRuleLookupManager *PhraseDictionaryFuzzyMatch::CreateRuleLookupManager(
@@ -119,6 +120,8 @@ SetParameter(const std::string& key, const std::string& value)
     m_config[1] = value;
   } else if (key == "alignment") {
     m_config[2] = value;
+  } else if (key == "match-threads") {
+    m_matchThreads = Scan<size_t>(value);
   } else {
     PhraseDictionary::SetParameter(key, value);
   }
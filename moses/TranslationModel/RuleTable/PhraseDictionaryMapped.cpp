@@ -0,0 +1,131 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "PhraseDictionaryMapped.h"
+
+#include "moses/Phrase.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TargetPhraseCollection.h"
+#include "moses/Timer.h"
+#include "moses/TranslationModel/CYKPlusParser/ChartRuleLookupManagerMapped.h"
+#include "util/exception.hh"
+
+#include <ctime>
+
+using namespace std;
+
+namespace Moses
+{
+
+PhraseDictionaryMapped::PhraseDictionaryMapped(const std::string &line)
+  : PhraseDictionary(line, true)
+{
+  ReadParameters();
+}
+
+void PhraseDictionaryMapped::Load(AllOptions::ptr const& opts)
+{
+  m_options = opts;
+  SetFeaturesToApply();
+
+  PrintUserTime("Start mapping binary rule table");
+  m_table.reset(new BinaryRuleTable(m_filePath, util::LAZY));
+  UTIL_THROW_IF2(m_table->GetHeader().scores != m_numScoreComponents,
+                 "Binary rule table " << m_filePath << " has " << m_table->GetHeader().scores
+                 << " scores per rule. The ini file specified " << m_numScoreComponents << " scores");
+
+  m_table->GetAlignmentSets(m_alignmentSets);
+
+  // the target labels of the non-terminal edges, as the memory trie keys them
+  m_targetNonTerms.resize(m_table->GetHeader().nonterms);
+  for (BinaryRuleTable::Id i = 0; i < m_targetNonTerms.size(); ++i) {
+    const BinaryRuleTable::Id word = m_table->GetNonTerminal(i);
+    m_targetNonTerms[i].CreateFromString(Output, m_output, m_table->GetString(word), true);
+  }
+}
+
+ChartRuleLookupManager *PhraseDictionaryMapped::CreateRuleLookupManager(
+  const ChartParser &parser,
+  const ChartCellCollectionBase &cellCollection,
+  std::size_t /*maxChartSpan*/)
+{
+  return new ChartRuleLookupManagerMapped(parser, cellCollection, *this);
+}
+
+void PhraseDictionaryMapped::InitializeForInput(ttasksptr const& ttask)
+{
+  if (m_maxCacheSize) {
+    ReduceCache();
+  }
+}
+
+void PhraseDictionaryMapped::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
+{
+  UTIL_THROW2("PhraseDictionaryMapped is only supported in chart decoding");
+}
+
+TargetPhraseCollection::shared_ptr
+PhraseDictionaryMapped::
+GetTargetPhraseCollection(BinaryRuleTable::Id node) const
+{
+  if (!m_maxCacheSize) {
+    return GetTargetPhraseCollectionNonCache(node);
+  }
+
+  CacheColl &cache = GetCache();
+  CacheColl::iterator iter = cache.find(node);
+  if (iter == cache.end()) {
+    TargetPhraseCollection::shared_ptr ret = GetTargetPhraseCollectionNonCache(node);
+    cache[node] = CacheCollEntry(ret, clock());
+    return ret;
+  }
+  iter->second.second = clock();
+  return iter->second.first;
+}
+
+TargetPhraseCollection::shared_ptr
+PhraseDictionaryMapped::
+GetTargetPhraseCollectionNonCache(BinaryRuleTable::Id node) const
+{
+  const BinaryRuleTable &table = *m_table;
+  TargetPhraseCollection::shared_ptr ret(new TargetPhraseCollection);
+
+  // words are made as the rules are read, so nothing is kept per table
+  BinaryRuleTableVocab sourceVocab(table, Input, m_input, false);
+  BinaryRuleTableVocab targetVocab(table, Output, m_output, false);
+  Phrase sourcePhrase;
+  for (const BinaryRuleTable::Id *rule = table.RulesBegin(node); rule != table.RulesEnd(node); ++rule) {
+    if (table.SourceBegin(*rule) == table.SourceEnd(*rule)
+        && table.GetSourceLHS(*rule) == BinaryRuleTable::kNone
+        && !m_options->unk.word_deletion_enabled) {
+      continue;
+    }
+    table.CreateSourcePhrase(*rule, sourceVocab, sourcePhrase);
+    TargetPhrase *targetPhrase = table.CreateTargetPhrase(*rule, targetVocab, m_alignmentSets, *this);
+    targetPhrase->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
+    ret->Add(targetPhrase);
+  }
+
+  if (m_tableLimit) {
+    ret->Sort(true, m_tableLimit);
+  }
+  return ret;
+}
+
+}  // namespace Moses
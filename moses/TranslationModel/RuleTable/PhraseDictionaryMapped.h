@@ -0,0 +1,79 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include "moses/TranslationModel/PhraseDictionary.h"
+#include "BinaryRuleTable.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+namespace Moses
+{
+class ChartParser;
+
+/** SCFG rule table served from a binary rule table (see BinaryRuleTable.h)
+ * without loading it.  The trie is walked in the mapped file and the target
+ * phrases of a node are only made when a sentence reaches that node, then
+ * kept in the per-thread cache (cache-size) like PhraseDictionaryOnDisk.
+ * The mapped pages are shared by every decoder on the host that serves the
+ * same file.
+ */
+class PhraseDictionaryMapped : public PhraseDictionary
+{
+public:
+  PhraseDictionaryMapped(const std::string &line);
+
+  void Load(AllOptions::ptr const& opts);
+
+  const BinaryRuleTable &GetTable() const {
+    return *m_table;
+  }
+
+  // Target labels of the non-terminal edges, by non-terminal index
+  const Word &GetTargetNonTerminal(BinaryRuleTable::Id index) const {
+    return m_targetNonTerms[index];
+  }
+
+  ChartRuleLookupManager *CreateRuleLookupManager(
+    const ChartParser &,
+    const ChartCellCollectionBase &,
+    std::size_t);
+
+  void InitializeForInput(ttasksptr const& ttask);
+
+  void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
+
+  // Rules whose source side ends at node, sorted and pruned to table-limit
+  TargetPhraseCollection::shared_ptr
+  GetTargetPhraseCollection(BinaryRuleTable::Id node) const;
+
+  TargetPhraseCollection::shared_ptr
+  GetTargetPhraseCollectionNonCache(BinaryRuleTable::Id node) const;
+
+private:
+  boost::scoped_ptr<BinaryRuleTable> m_table;
+  std::vector<const AlignmentInfo*> m_alignmentSets;
+  std::vector<Word> m_targetNonTerms;
+};
+
+}  // namespace Moses
@@ -0,0 +1,264 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+// Folds the journal of sentence pairs added to an Mmsapt phrase table at
+// run time (parameter journal=...) into its memory-mapped base bitext and
+// empties the journal, so that decoders don't have to replay it at
+// start-up any more.
+//
+// Vocabularies, token tracks, suffix arrays, word alignment and document
+// map are rebuilt with the journal's sentence pairs appended to the base
+// corpus; existing token ids are kept. The lexical table (.lex) is not
+// updated; rerun mmlex-build for that.
+
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tpt_pickler.h"
+#include "tpt_tokenindex.h"
+#include "ug_bitext_journal.h"
+#include "ug_corpus_token.h"
+#include "ug_im_tsa.h"
+#include "ug_mm_ttrack.h"
+#include "util/exception.hh"
+#include "util/file.hh"
+
+using namespace std;
+using namespace sapt;
+namespace po = boost::program_options;
+
+typedef L2R_Token<SimpleWordId> Token;
+
+string bname, L1, L2, jprefix, oname, docname;
+bool quiet = false;
+
+void interpret_args(int ac, char* av[]);
+
+// Appends the tokenized sentences to the base track T. The lengths of the
+// new sentences go to len.
+void
+write_track(mmTtrack<Token> const& T, TokenIndex& V,
+            vector<string> const& snt, string const& fname,
+            vector<size_t>& len)
+{
+  ofstream out(fname.c_str());
+  T.write_blank_file_header(out);
+  vector<id_type> idx;
+  idx.reserve(T.size() + snt.size() + 1);
+  id_type total = 0;
+  for (size_t sid = 0; sid < T.size(); ++sid)
+    {
+      idx.push_back(total);
+      total += T.sntLen(sid);
+    }
+  if (T.size()) T.copySentences(out, 0, T.size());
+  string w;
+  for (size_t i = 0; i < snt.size(); ++i)
+    {
+      idx.push_back(total);
+      istringstream buf(snt[i]);
+      size_t n = 0;
+      for (; buf >> w; ++n) tpt::numwrite(out, V[w]);
+      total += n;
+      len.push_back(n);
+    }
+  idx.push_back(total);
+  T.write_index_and_finalize(out, idx, total);
+  out.close();
+  UTIL_THROW_IF(!out, util::ErrnoException, "while writing " << fname);
+}
+
+// Appends the word alignments (in symal format) to the base alignment Tx.
+void
+write_alignment(mmTtrack<char> const& Tx, vector<string> const& aln,
+                vector<size_t> const& len1, vector<size_t> const& len2,
+                string const& fname)
+{
+  ofstream out(fname.c_str());
+  Tx.write_blank_file_header(out);
+  vector<id_type> idx;
+  idx.reserve(Tx.size() + aln.size() + 1);
+  id_type offset = 0;
+  if (Tx.size())
+    {
+      char const* start = Tx.sntStart(0);
+      for (size_t sid = 0; sid < Tx.size(); ++sid)
+        idx.push_back(Tx.sntStart(sid) - start);
+      offset = Tx.sntEnd(Tx.size() - 1) - start;
+      out.write(start, offset);
+    }
+  for (size_t i = 0; i < aln.size(); ++i)
+    {
+      idx.push_back(offset);
+      istringstream ibuf(aln[i]);
+      ostringstream obuf;
+      uint32_t row, col; char c;
+      while (ibuf >> row >> c >> col)
+        {
+          UTIL_THROW_IF(c != '-' || row >= len1[i] || col >= len2[i],
+                        util::Exception, "Bad alignment in journal record "
+                        << i << ": " << aln[i]);
+          tpt::binwrite(obuf, row);
+          tpt::binwrite(obuf, col);
+        }
+      string const x = obuf.str();
+      out.write(x.data(), x.size());
+      offset += x.size();
+    }
+  idx.push_back(offset);
+  Tx.write_index_and_finalize(out, idx, 0);
+  out.close();
+  UTIL_THROW_IF(!out, util::ErrnoException, "while writing " << fname);
+}
+
+void
+build_sfa(string const& mct, string const& fname)
+{
+  boost::shared_ptr<mmTtrack<Token> > T(new mmTtrack<Token>(mct));
+  bdBitset filter;
+  filter.resize(T->size(), true);
+  imTSA<Token> S(T, &filter, (quiet ? NULL : &cerr));
+  S.save_as_mm_tsa(fname);
+}
+
+// The journal's sentence pairs become one more document.
+void
+write_docmap(string const& base, size_t const n, string const& fname)
+{
+  ifstream in(base.c_str());
+  ostringstream buf;
+  buf << in.rdbuf();
+  string map = buf.str();
+  if (map.size() && map[map.size() - 1] != '\n') map += '\n';
+  ofstream out(fname.c_str());
+  out << map << docname << " " << n << endl;
+  out.close();
+  UTIL_THROW_IF(!out, util::ErrnoException, "while writing " << fname);
+}
+
+int
+main(int argc, char* argv[])
+{
+  interpret_args(argc, argv);
+
+  string const jname = journal_name(jprefix, L1, L2);
+  UTIL_THROW_IF(access(jname.c_str(), F_OK), util::Exception,
+                "Journal " << jname << " does not exist.");
+  util::scoped_fd journal(open_journal(jname));
+  vector<string> s1, s2, aln;
+  read_journal(journal.get(), jname, s1, s2, aln);
+  if (s1.empty())
+    {
+      if (!quiet) cerr << "Journal " << jname << " is empty." << endl;
+      return 0;
+    }
+
+  mmTtrack<Token> T1(bname + L1 + ".mct");
+  mmTtrack<Token> T2(bname + L2 + ".mct");
+  mmTtrack<char>  Tx(bname + L1 + "-" + L2 + ".mam");
+  UTIL_THROW_IF(T1.size() != T2.size() || T1.size() != Tx.size(),
+                util::Exception, "Base bitext " << bname << " is inconsistent.");
+  TokenIndex V1, V2;
+  V1.open(bname + L1 + ".tdx", "UNK", true);
+  V2.open(bname + L2 + ".tdx", "UNK", true);
+
+  // everything is written to temporary files first and only renamed once
+  // it is complete
+  vector<string> files;
+  files.push_back(L1 + ".tdx");
+  files.push_back(L2 + ".tdx");
+  files.push_back(L1 + ".mct");
+  files.push_back(L2 + ".mct");
+  files.push_back(L1 + ".sfa");
+  files.push_back(L2 + ".sfa");
+  files.push_back(L1 + "-" + L2 + ".mam");
+  string const tmp = ".merge_";
+
+  if (!quiet) cerr << "Merging " << s1.size() << " sentence pairs from "
+                   << jname << " into " << T1.size() << " sentence pairs of "
+                   << bname << endl;
+  vector<size_t> len1, len2;
+  write_track(T1, V1, s1, oname + files[2] + tmp, len1);
+  write_track(T2, V2, s2, oname + files[3] + tmp, len2);
+  V1.write(oname + files[0] + tmp);
+  V2.write(oname + files[1] + tmp);
+  build_sfa(oname + files[2] + tmp, oname + files[4] + tmp);
+  build_sfa(oname + files[3] + tmp, oname + files[5] + tmp);
+  write_alignment(Tx, aln, len1, len2, oname + files[6] + tmp);
+  if (!access((bname + "dmp").c_str(), F_OK))
+    {
+      write_docmap(bname + "dmp", s1.size(), oname + "dmp" + tmp);
+      files.push_back("dmp");
+    }
+
+  for (size_t i = 0; i < files.size(); ++i)
+    {
+      string const fname = oname + files[i];
+      UTIL_THROW_IF(rename((fname + tmp).c_str(), fname.c_str()),
+                    util::ErrnoException, "while renaming " << fname + tmp);
+    }
+
+  if (oname == bname)
+    {
+      util::ResizeOrThrow(journal.get(), 0);
+      util::FSyncOrThrow(journal.get());
+      if (!quiet) cerr << "Emptied " << jname << endl;
+    }
+  else if (!quiet)
+    cerr << "Journal " << jname << " was kept; it must be removed before "
+         << "the merged bitext is used with it." << endl;
+  if (!quiet)
+    cerr << "Rerun mmlex-build to update " << oname << L1 << "-" << L2
+         << ".lex." << endl;
+}
+
+void
+interpret_args(int ac, char* av[])
+{
+  po::variables_map vm;
+  po::options_description o("Options");
+  o.add_options()
+    ("help,h",  "print this message")
+    ("quiet,q", po::bool_switch(&quiet), "don't print progress information")
+    ("output,o", po::value<string>(&oname),
+     "base name of the merged bitext (default: replace the base bitext "
+     "and empty the journal)")
+    ("docname,d", po::value<string>(&docname)->default_value("journal"),
+     "document name of the journal's sentence pairs in the document map")
+    ;
+
+  po::options_description h("Hidden Options");
+  h.add_options()
+    ("bname", po::value<string>(&bname), "base name of the bitext")
+    ("L1", po::value<string>(&L1), "L1 tag")
+    ("L2", po::value<string>(&L2), "L2 tag")
+    ("journal", po::value<string>(&jprefix), "journal prefix")
+    ;
+  po::positional_options_description a;
+  a.add("bname",1);
+  a.add("L1",1);
+  a.add("L2",1);
+  a.add("journal",1);
+
+  po::store(po::command_line_parser(ac,av)
+            .options(h.add(o))
+            .positional(a)
+            .run(),vm);
+  po::notify(vm);
+  if (vm.count("help") || jprefix.empty())
+    {
+      cout << "\nusage:\n\t" << av[0]
+           << " [options] <base> <L1> <L2> <journal prefix>\n\n"
+           << "The arguments are those of the Mmsapt parameters base=, L1=,\n"
+           << "L2= and journal=. No decoder may be using the journal.\n"
+           << endl;
+      cout << o << endl;
+      exit(0);
+    }
+  if (oname.empty()) oname = bname;
+}
@@ -0,0 +1,86 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "ug_bitext_journal.h"
+#include "util/exception.hh"
+#include "util/file.hh"
+
+namespace sapt
+{
+  std::string
+  journal_name(std::string const& prefix,
+               std::string const& L1, std::string const& L2)
+  {
+    return prefix + L1 + "-" + L2 + ".journal";
+  }
+
+  int
+  open_journal(std::string const& fname)
+  {
+    int fd = open(fname.c_str(), O_CREAT | O_RDWR,
+                  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    UTIL_THROW_IF(fd == -1, util::ErrnoException,
+                  "while opening journal " << fname);
+    if (flock(fd, LOCK_EX | LOCK_NB))
+      {
+        util::scoped_fd closer(fd);
+        UTIL_THROW(util::Exception, "Journal " << fname
+                   << " is in use by another process");
+      }
+    return fd;
+  }
+
+  uint64_t
+  read_journal(int fd, std::string const& fname,
+               std::vector<std::string>& s1,
+               std::vector<std::string>& s2,
+               std::vector<std::string>& aln)
+  {
+    std::string data(util::SizeOrThrow(fd), '\0');
+    if (data.size())
+      {
+        util::SeekOrThrow(fd, 0);
+        util::ReadOrThrow(fd, &data[0], data.size());
+      }
+
+    size_t committed = 0;
+    while (committed < data.size())
+      {
+        size_t eol = data.find('\n', committed);
+        if (eol == std::string::npos) break;
+        std::istringstream header(data.substr(committed, eol - committed));
+        size_t len1, len2, lena;
+        if (!(header >> len1 >> len2 >> lena)) break;
+        size_t start = eol + 1;
+        size_t end = start + len1 + len2 + lena;
+        if (end >= data.size() || data[end] != '\n') break;
+        s1.push_back(data.substr(start, len1));
+        s2.push_back(data.substr(start + len1, len2));
+        aln.push_back(data.substr(start + len1 + len2, lena));
+        committed = end + 1;
+      }
+    if (committed < data.size())
+      {
+        std::cerr << "Warning: dropping incomplete last record of journal "
+                  << fname << " (" << data.size() - committed << " bytes)"
+                  << std::endl;
+        util::ResizeOrThrow(fd, committed);
+      }
+    return committed;
+  }
+
+  std::string
+  journal_records(std::vector<std::string> const& s1,
+                  std::vector<std::string> const& s2,
+                  std::vector<std::string> const& aln)
+  {
+    std::ostringstream buf;
+    for (size_t i = 0; i < s1.size(); ++i)
+      buf << s1[i].size() << " " << s2[i].size() << " " << aln[i].size()
+          << "\n" << s1[i] << s2[i] << aln[i] << "\n";
+    return buf.str();
+  }
+}
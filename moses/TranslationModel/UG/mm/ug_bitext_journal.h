@@ -0,0 +1,43 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+// Journal of the sentence pairs added to a dynamic bitext at run time.
+//
+// The journal is a single file of records
+//   <length of s1> <length of s2> <length of alignment>\n<s1><s2><alignment>\n
+// A record is committed once it has been written in full, so a crash in
+// the middle of an append leaves at most one incomplete record at the end
+// of the file, which read_journal() cuts off.
+//
+// A process that appends to the journal holds an exclusive lock on it for
+// as long as it keeps it open (see open_journal()), so that the journal is
+// never folded into the base bitext (mtt-merge-journal) while in use.
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace sapt
+{
+  // <prefix><L1>-<L2>.journal
+  std::string
+  journal_name(std::string const& prefix,
+               std::string const& L1, std::string const& L2);
+
+  // Opens the journal for reading and appending, creating it if necessary,
+  // and locks it. Throws if another process holds the lock.
+  int open_journal(std::string const& fname);
+
+  // Reads all committed records and truncates the file after the last one.
+  // Returns the length of the committed part.
+  uint64_t
+  read_journal(int fd, std::string const& fname,
+               std::vector<std::string>& s1,
+               std::vector<std::string>& s2,
+               std::vector<std::string>& aln);
+
+  // Serializes the sentence pairs as journal records.
+  std::string
+  journal_records(std::vector<std::string> const& s1,
+                  std::vector<std::string> const& s2,
+                  std::vector<std::string> const& aln);
+}
@@ -26,6 +26,7 @@ namespace sapt
   jstats(jstats const& other)
   {
     my_rcnt = other.rcnt();
+    my_cnt2 = other.cnt2();
     my_wcnt = other.wcnt();
     my_bcnt = other.bcnt();
     my_aln  = other.aln();
@@ -84,6 +85,16 @@ namespace sapt
     return my_rcnt;
   }
   
+  void
+  jstats::
+  rebias(uint32_t const rcnt, float const wcnt, float const bcnt)
+  {
+    boost::lock_guard<boost::mutex> lk(this->lock);
+    my_rcnt = rcnt;
+    my_wcnt = wcnt;
+    my_bcnt = bcnt;
+  }
+
   std::vector<std::pair<size_t, std::vector<unsigned char> > > const&
   jstats::
   aln() const
@@ -43,6 +43,9 @@ namespace sapt
     add(float w, float b, std::vector<unsigned char> const& a, uint32_t const cnt2, 
 	uint32_t fwd_orient, uint32_t bwd_orient, int const docid);
 
+    // overwrite counts with bias-weighted ones (see pstats::rebias)
+    void rebias(uint32_t const rcnt, float const wcnt, float const bcnt);
+
     void invalidate();
     void validate();
     bool valid();
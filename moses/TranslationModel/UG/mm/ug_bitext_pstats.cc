@@ -91,5 +91,70 @@ namespace sapt
       this->ready.wait(lock);
   }
 
+  SPTR<pstats>
+  pstats::
+  rebias(pstats const& raw, std::map<id_type, float> const& docbias,
+         float const floor)
+  {
+    raw.wait();
+    SPTR<pstats> ret(new pstats);
+    ret->raw_cnt    = raw.raw_cnt;
+    ret->sample_cnt = raw.sample_cnt;
+    ret->good       = raw.good;
+    ret->sum_pairs  = raw.sum_pairs;
+    ret->indoc      = raw.indoc;
+    for (int i = 0; i <= LRModel::NONE; ++i)
+      {
+        ret->ofwd[i] = raw.ofwd[i];
+        ret->obwd[i] = raw.obwd[i];
+      }
+
+    // normalize so that the sample as a whole keeps its size
+    double total = 0, weighted = 0;
+    for (indoc_map_t::const_iterator d = raw.indoc.begin();
+         d != raw.indoc.end(); ++d)
+      {
+        std::map<id_type, float>::const_iterator b = docbias.find(d->first);
+        total    += d->second;
+        weighted += d->second * (b != docbias.end() ? b->second : floor);
+      }
+    double const norm = weighted > 0 ? total / weighted : 1;
+
+    for (trg_map_t::const_iterator t = raw.trg.begin(); t != raw.trg.end(); ++t)
+      {
+        jstats const& js = t->second;
+        double bsum = 0;
+        for (std::map<uint32_t,uint32_t>::const_iterator d = js.indoc.begin();
+             d != js.indoc.end(); ++d)
+          {
+            std::map<id_type, float>::const_iterator b = docbias.find(d->first);
+            bsum += d->second * (b != docbias.end() ? b->second : floor);
+          }
+        double const factor = js.rcnt() ? bsum * norm / js.rcnt() : 0;
+        uint32_t rcnt = uint32_t(js.rcnt() * factor + .5);
+        rcnt = std::min(std::max(rcnt, uint32_t(js.rcnt() ? 1 : 0)),
+                        uint32_t(ret->good));
+        jstats& entry = ret->trg.insert(*t).first->second;
+        entry.rebias(rcnt, js.wcnt() * factor, bsum);
+      }
+    return ret;
+  }
+
+  size_t
+  pstats::
+  footprint() const
+  {
+    boost::lock_guard<boost::mutex> guard(this->lock);
+    size_t ret = sizeof(pstats) + indoc.size() * 32;
+    for (trg_map_t::const_iterator t = trg.begin(); t != trg.end(); ++t)
+      {
+        ret += sizeof(trg_map_t::value_type) + 16; // node overhead
+        ret += t->second.indoc.size() * 40;
+        for (size_t i = 0; i < t->second.aln().size(); ++i)
+          ret += sizeof(t->second.aln()[i]) + t->second.aln()[i].second.capacity();
+      }
+    return ret;
+  }
+
 } // end of namespace sapt
 
@@ -1,6 +1,7 @@
 // -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
 #pragma once
 
+#include <map>
 #include <boost/thread.hpp>
 #include <boost/unordered_map.hpp>
 
@@ -57,6 +58,17 @@ namespace sapt
 		 int const po_fwd,       // fwd phrase orientation
 		 int const po_bwd);      // bwd phrase orientation
     void wait() const;
+
+    // Bias-specific statistics derived from unbiased ones: joint counts are
+    // reweighted by the per-document breakdown of the samples, as an
+    // importance-weighted approximation of biased sampling. Documents
+    // without a bias weight get weight floor. Waits for raw to be complete.
+    static SPTR<pstats>
+    rebias(pstats const& raw, std::map<id_type, float> const& docbias,
+           float const floor);
+
+    // rough memory footprint in bytes (for cache accounting)
+    size_t footprint() const;
   };
 
 }
@@ -0,0 +1,116 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+#include <iostream>
+#include "ug_bitext_pstats_cache.h"
+
+namespace sapt
+{
+  PstatsCache::
+  PstatsCache(size_t const max_bytes)
+    : m_max_bytes(max_bytes), m_bytes(0), m_clock(0)
+    , m_hits(0), m_misses(0), m_evictions(0)
+  { }
+
+  void
+  PstatsCache::
+  touch(uint64_t const key, Entry& e)
+  {
+    // CALLER MUST LOCK!
+    m_queue.erase(std::make_pair(e.priority, key));
+    if (!e.measured && e.stats->in_progress == 0)
+      { // replace the initial estimate by the real footprint
+        m_bytes -= e.bytes;
+        e.bytes = e.stats->footprint();
+        e.measured = true;
+        m_bytes += e.bytes;
+      }
+    e.priority = m_clock + e.cost / std::max(e.bytes, size_t(1));
+    m_queue.insert(std::make_pair(e.priority, key));
+  }
+
+  void
+  PstatsCache::
+  evict()
+  {
+    // CALLER MUST LOCK!
+    while (m_bytes > m_max_bytes && m_queue.size() > 1)
+      {
+        std::pair<double, uint64_t> victim = *m_queue.begin();
+        m_queue.erase(m_queue.begin());
+        map_t::iterator m = m_entries.find(victim.second);
+        m_clock = victim.first;
+        m_bytes -= m->second.bytes;
+        m_entries.erase(m);
+        ++m_evictions;
+      }
+  }
+
+  SPTR<pstats>
+  PstatsCache::
+  get(uint64_t const key)
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    map_t::iterator m = m_entries.find(key);
+    if (m == m_entries.end())
+      {
+        ++m_misses;
+        return SPTR<pstats>();
+      }
+    ++m_hits;
+    SPTR<pstats> ret = m->second.stats;
+    touch(key, m->second);
+    evict();
+    return ret;
+  }
+
+  void
+  PstatsCache::
+  set(uint64_t const key, SPTR<pstats> const& stats, double const cost)
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    std::pair<map_t::iterator, bool> r = m_entries.insert(std::make_pair(key, Entry()));
+    Entry& e = r.first->second;
+    if (!r.second)
+      {
+        m_queue.erase(std::make_pair(e.priority, key));
+        m_bytes -= e.bytes;
+      }
+    e.stats = stats;
+    e.cost = cost;
+    e.priority = 0;
+    // stats are usually still being collected; estimate their size from
+    // the expected number of samples until they are complete
+    e.bytes = sizeof(pstats) + size_t(cost) * 64;
+    e.measured = false;
+    m_bytes += e.bytes;
+    m_queue.insert(std::make_pair(e.priority, key));
+    touch(key, e);
+    evict();
+  }
+
+  size_t
+  PstatsCache::
+  size() const
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    return m_entries.size();
+  }
+
+  size_t
+  PstatsCache::
+  bytes() const
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    return m_bytes;
+  }
+
+  void
+  PstatsCache::
+  report(std::ostream& out) const
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    out << "pstats cache: " << m_entries.size() << " entries, "
+        << m_bytes << " of " << m_max_bytes << " bytes, "
+        << m_hits << " hits, " << m_misses << " misses, "
+        << m_evictions << " evictions" << std::endl;
+  }
+}
@@ -0,0 +1,60 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+// Memory-bounded, thread-safe cache of bias-independent phrase statistics.
+// Entries are shared by all translation requests; bias-specific statistics
+// are derived from them on demand (see pstats::rebias).
+//
+// Eviction is cost-aware (GreedyDual-Size): each entry has the priority
+// clock + cost/bytes, where cost is the work needed to recompute it. The
+// entry with the lowest priority is evicted first and the clock advances
+// to its priority, so that entries that are not used any more age out even
+// if they were expensive.
+#pragma once
+
+#include <set>
+#include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "ug_typedefs.h"
+#include "ug_bitext_pstats.h"
+
+namespace sapt
+{
+  class
+  PstatsCache
+  {
+    struct Entry
+    {
+      SPTR<pstats> stats;
+      double cost;     // cost of recomputing the entry
+      double priority; // see above
+      size_t bytes;    // estimated memory footprint
+      bool measured;   // bytes measured on the complete stats yet?
+    };
+    typedef boost::unordered_map<uint64_t, Entry> map_t;
+    typedef std::set<std::pair<double, uint64_t> > queue_t;
+
+    mutable boost::mutex m_lock;
+    map_t   m_entries;
+    queue_t m_queue;   // (priority, key), lowest priority first
+    size_t  m_max_bytes;
+    size_t  m_bytes;
+    double  m_clock;
+    size_t  m_hits, m_misses, m_evictions;
+
+    void touch(uint64_t const key, Entry& e);
+    void evict(); // CALLER MUST LOCK
+
+  public:
+    PstatsCache(size_t const max_bytes);
+
+    // NULL if not cached; the returned stats may still be in progress
+    SPTR<pstats> get(uint64_t const key);
+
+    // cost: work needed to recompute the stats (e.g. number of samples)
+    void set(uint64_t const key, SPTR<pstats> const& stats, double const cost);
+
+    size_t size() const;
+    size_t bytes() const;
+    void report(std::ostream& out) const;
+  };
+}
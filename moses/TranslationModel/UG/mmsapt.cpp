@@ -7,6 +7,7 @@
 #include <boost/tokenizer.hpp>
 #include <boost/thread/locks.hpp>
 #include <algorithm>
+#include "util/file.hh"
 #include "util/exception.hh"
 #include <set>
 #include "util/usage.hh"
@@ -61,6 +62,7 @@ namespace Moses
   Mmsapt(string const& line)
     : PhraseDictionary(line, false)
     , btfix(new mmbitext)
+    , m_journal_size(0)
     , m_bias_log(NULL)
     , m_bias_loglevel(0)
 #ifndef NO_MOSES
@@ -201,6 +203,13 @@ namespace Moses
     m_cache_size = max(10000,atoi(param.insert(dflt).first->second.c_str()));
 
     m_cache.reset(new TPCollCache(m_cache_size));
+
+    // size limit in MB of the shared cache of unbiased sampling results
+    // (0: off; biased requests then sample with their own bias)
+    dflt = pair<string,string>("raw-cache","0");
+    size_t raw_cache_mb = atoi(param.insert(dflt).first->second.c_str());
+    if (raw_cache_mb)
+      m_raw_cache.reset(new sapt::PstatsCache(raw_cache_mb << 20));
     // m_history.reserve(hsize);
     // in plain language: cache size is at least 1000, and 10,000 by default
     // this cache keeps track of the most frequently used target
@@ -253,6 +262,13 @@ namespace Moses
     if ((m = param.find("extra")) != param.end())
       m_extra_data = m->second;
 
+    // sentence pairs added at run time are appended to the journal
+    // <journal><L1>-<L2>.journal and reloaded at start-up. The journal is
+    // replayed in full; fold it into the base bitext with mtt-merge-journal
+    // when it gets large.
+    if ((m = param.find("journal")) != param.end())
+      m_journal = m->second;
+
     if ((m = param.find("method")) != param.end())
       {
         if (m->second == "random")
@@ -292,6 +308,7 @@ namespace Moses
     known_parameters.push_back("config");
     known_parameters.push_back("cumb");
     known_parameters.push_back("extra");
+    known_parameters.push_back("journal");
     known_parameters.push_back("feature-sets");
     known_parameters.push_back("input-factor");
     known_parameters.push_back("lenrat");
@@ -309,6 +326,7 @@ namespace Moses
     known_parameters.push_back("pfwd");
     known_parameters.push_back("prov");
     known_parameters.push_back("rare");
+    known_parameters.push_back("raw-cache");
     known_parameters.push_back("sample");
     known_parameters.push_back("min-sample");
     known_parameters.push_back("smooth");
@@ -362,6 +380,44 @@ namespace Moses
     cerr << "Loaded " << btdyn->T1->size() << " sentence pairs" << endl;
   }
 
+  void
+  Mmsapt::
+  load_journal()
+  {
+    string fname = journal_name(m_journal, L1, L2);
+    m_journal_fd.reset(open_journal(fname));
+    vector<string> text1,text2,symal;
+    m_journal_size = read_journal(m_journal_fd.get(), fname, text1, text2, symal);
+    if (text1.empty()) return;
+    btdyn = btdyn->add(text1,text2,symal);
+    assert(btdyn);
+    cerr << "Loaded " << text1.size() << " sentence pairs from journal "
+         << fname << endl;
+  }
+
+  void
+  Mmsapt::
+  write_journal(vector<string> const& s1, vector<string> const& s2,
+                vector<string> const& a)
+  {
+    string const records = journal_records(s1, s2, a);
+    int fd = m_journal_fd.get();
+    try
+      {
+        util::SeekOrThrow(fd, m_journal_size);
+        util::WriteOrThrow(fd, records.data(), records.size());
+        util::FSyncOrThrow(fd);
+      }
+    catch (util::Exception const& e)
+      {
+        // don't leave a partial record for later appends to follow
+        try { util::ResizeOrThrow(fd, m_journal_size); }
+        catch (util::Exception const&) {}
+        throw;
+      }
+    m_journal_size += records.size();
+  }
+
   template<typename fftype>
   void
   Mmsapt::
@@ -509,6 +565,9 @@ namespace Moses
     if (m_extra_data.size())
       load_extra_data(m_extra_data, false);
 
+    if (m_journal.size())
+      load_journal();
+
 #if 0
     // currently not used
     LexicalPhraseScorer2<Token>::table_t & COOC = calc_lex.scorer.COOC;
@@ -527,11 +586,38 @@ namespace Moses
   Mmsapt::
   add(string const& s1, string const& s2, string const& a)
   {
-    vector<string> S1(1,s1);
-    vector<string> S2(1,s2);
-    vector<string> ALN(1,a);
+    {
+      boost::lock_guard<boost::mutex> guard(m_queue_lock);
+      m_queue1.push_back(s1);
+      m_queue2.push_back(s2);
+      m_queueA.push_back(a);
+    }
+
+    boost::lock_guard<boost::mutex> update_guard(m_update_lock);
+    vector<string> S1, S2, ALN;
+    {
+      boost::lock_guard<boost::mutex> guard(m_queue_lock);
+      S1.swap(m_queue1);
+      S2.swap(m_queue2);
+      ALN.swap(m_queueA);
+    }
+    if (S1.empty()) return; // added as part of a concurrent call's batch
+
+    // Extend a copy of the current dynamic bitext without blocking
+    // lookups; readers keep using the old version until the swap below.
+    SPTR<imbitext> dyn;
+    {
+      boost::shared_lock<boost::shared_mutex> guard(m_lock);
+      dyn = btdyn;
+    }
+    dyn = dyn->add(S1,S2,ALN);
+
+    // Only pairs that were added successfully are logged, and they are
+    // logged before they become visible.
+    if (m_journal.size())
+      write_journal(S1, S2, ALN);
     boost::unique_lock<boost::shared_mutex> guard(m_lock);
-    btdyn = btdyn->add(S1,S2,ALN);
+    btdyn = dyn;
   }
 
 
@@ -724,7 +810,16 @@ namespace Moses
       {
         SPTR<ContextForQuery> context = scope->get<ContextForQuery>(btfix.get());
         SPTR<pstats> const* foo = context->cache1->get(mfix.getPid());
+        DocumentBias const* docbias 
+          = dynamic_cast<DocumentBias const*>(context->bias.get());
         if (foo) { sfix = *foo; sfix->wait(); }
+        else if (m_raw_cache && docbias)
+          {
+            // reweight the shared unbiased counts for this request only
+            sfix = pstats::rebias(*get_raw_pstats(mfix),
+                                  docbias->GetDocumentBiasMap(), .01);
+            context->cache1->set(mfix.getPid(), sfix);
+          }
         else 
           {
             BitextSampler<Token> s(btfix, mfix, context->bias, 
@@ -784,6 +879,23 @@ namespace Moses
     return ret;
   }
 
+  SPTR<pstats>
+  Mmsapt::
+  get_raw_pstats(tsa::tree_iterator const& m) const
+  {
+    uint64_t const pid = m.getPid();
+    SPTR<pstats> ret = m_raw_cache->get(pid);
+    if (ret) return ret;
+    BitextSampler<Token> s(btfix, m, SPTR<SamplingBias>(),
+                           m_min_sample_size, m_default_sample_size,
+                           m_sampling_method);
+    s();
+    ret = s.stats();
+    // recomputing costs roughly one unit per sample considered
+    m_raw_cache->set(pid, ret, ret->sample_cnt + 1);
+    return ret;
+  }
+
   size_t
   Mmsapt::
   SetTableLimit(size_t limit)
@@ -914,7 +1026,19 @@ namespace Moses
       {
         SPTR<ContextForQuery> context = scope->get<ContextForQuery>(btfix.get(), true);
         uint64_t pid = mfix.getPid();
-        if (!context->cache1->get(pid))
+        if (m_raw_cache && dynamic_cast<DocumentBias const*>(context->bias.get()))
+          {
+            // sample unbiased in the background; the bias is applied on lookup
+            if (!m_raw_cache->get(pid))
+              {
+                BitextSampler<Token> s(btfix, mfix, SPTR<SamplingBias>(),
+                                       m_min_sample_size, m_default_sample_size,
+                                       m_sampling_method);
+                m_raw_cache->set(pid, s.stats(), std::min(size_t(mfix.approxOccurrenceCount()), m_default_sample_size) + 1);
+                m_thread_pool->add(s);
+              }
+          }
+        else if (!context->cache1->get(pid))
           {
             BitextSampler<Token> s(btfix, mfix, context->bias, 
                                    m_min_sample_size, m_default_sample_size, 
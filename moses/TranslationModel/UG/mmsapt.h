@@ -22,6 +22,8 @@
 #include "moses/TranslationModel/UG/mm/tpt_pickler.h"
 #include "moses/TranslationModel/UG/mm/ug_bitext.h"
 #include "moses/TranslationModel/UG/mm/ug_bitext_sampler.h"
+#include "moses/TranslationModel/UG/mm/ug_bitext_pstats_cache.h"
+#include "moses/TranslationModel/UG/mm/ug_bitext_journal.h"
 #include "moses/TranslationModel/UG/mm/ug_lexical_phrase_scorer2.h"
 
 #include "moses/TranslationModel/UG/TargetPhraseCollectionCache.h"
@@ -36,6 +38,7 @@
 #include <boost/dynamic_bitset.hpp>
 #include "moses/TargetPhraseCollection.h"
 #include "util/usage.hh"
+#include "util/file.hh"
 #include <map>
 
 #include "moses/TranslationModel/PhraseDictionary.h"
@@ -74,6 +77,9 @@ namespace Moses
     SPTR<mmbitext> btfix;
     SPTR<imbitext> btdyn;
     std::string m_bname, m_extra_data, m_bias_file,m_bias_server;
+    std::string m_journal; // prefix of the log of sentence pairs added at run time
+    util::scoped_fd m_journal_fd;
+    uint64_t m_journal_size; // length of the committed part of the journal
     std::string L1;
     std::string L2;
     float  m_lbop_conf; // confidence level for lbop smoothing
@@ -102,6 +108,9 @@ namespace Moses
     boost::shared_ptr<sapt::SamplingBias> m_bias; // for global default bias
     boost::shared_ptr<TPCollCache> m_cache; // for global default bias
     size_t m_cache_size;  //
+    // bias-independent sampling results shared by all requests; requests
+    // with a document bias derive their statistics from these
+    boost::scoped_ptr<sapt::PstatsCache> m_raw_cache;
     // size_t input_factor;  //
     // size_t output_factor; // we can actually return entire Tokens!
 
@@ -149,6 +158,13 @@ namespace Moses
     // PScoreLogCounts<Token>   add_logcounts_dyn;
     void init(std::string const& line);
     mutable boost::shared_mutex m_lock;
+    // Updates of the dynamic bitext are built outside of m_lock, so that
+    // decoding is not blocked while the in-memory index is extended.
+    // m_update_lock serializes updates; sentence pairs that arrive while
+    // an update is in progress are queued and added in one batch.
+    boost::mutex m_update_lock;
+    boost::mutex m_queue_lock;
+    std::vector<std::string> m_queue1, m_queue2, m_queueA;
     // mutable boost::shared_mutex m_cache_lock;
     // for more complex operations on the cache
     bool withPbwd;
@@ -158,6 +174,9 @@ namespace Moses
     void setup_local_feature_functions();
     void setup_bias(ttasksptr const& ttask);
 
+    SPTR<sapt::pstats>
+    get_raw_pstats(tsa::tree_iterator const& m) const;
+
 #if PROVIDES_RANKED_SAMPLING
     void 
     set_bias_for_ranking(ttasksptr const& ttask, SPTR<sapt::Bitext<Token> const> bt);
@@ -205,6 +224,10 @@ namespace Moses
      TargetPhraseCollection::shared_ptr  tpcoll) const;
 
     void load_extra_data(std::string bname, bool locking);
+    void load_journal();
+    void write_journal(std::vector<std::string> const& s1,
+                       std::vector<std::string> const& s2,
+                       std::vector<std::string> const& a);
     void load_bias(std::string bname);
 
   public:
@@ -0,0 +1,82 @@
+//
+//  BitParallelEditDistance.cpp
+//  moses
+//
+
+#include "BitParallelEditDistance.h"
+
+namespace tmmt
+{
+
+BitParallelEditDistance::BitParallelEditDistance(const std::vector<WORD_ID> &pattern)
+  :m_length(pattern.size())
+  ,m_blocks((pattern.size() + 63) / 64)
+  ,m_lastBit(Block(1) << ((pattern.size() + 63) % 64))
+{
+  for (size_t i = 0; i < m_length; ++i) {
+    boost::unordered_map<WORD_ID, size_t>::iterator iter
+    = m_peqIndex.insert(std::make_pair(pattern[i], m_peqIndex.size())).first;
+    m_peq.resize(m_peqIndex.size() * m_blocks, 0);
+    m_peq[iter->second * m_blocks + i / 64] |= Block(1) << (i % 64);
+  }
+}
+
+unsigned int BitParallelEditDistance::Distance(const std::vector<WORD_ID> &text,
+    unsigned int maxCost,
+    Workspace &ws) const
+{
+  const size_t n = text.size();
+  const unsigned int lengthDiff = (m_length > n) ? m_length - n : n - m_length;
+  if (lengthDiff > maxCost) {
+    return maxCost + 1;
+  }
+  if (m_length == 0) {
+    return n;
+  }
+
+  // vertical deltas of the current column: +1 everywhere in column 0
+  ws.pv.assign(m_blocks, ~Block(0));
+  ws.mv.assign(m_blocks, 0);
+  Block *pv = &ws.pv[0];
+  Block *mv = &ws.mv[0];
+  const Block highBit = Block(1) << 63;
+
+  unsigned int score = m_length; // D[m][0]
+  for (size_t j = 0; j < n; ++j) {
+    boost::unordered_map<WORD_ID, size_t>::const_iterator found
+    = m_peqIndex.find(text[j]);
+    const Block *peq = (found == m_peqIndex.end()) ? NULL : &m_peq[found->second * m_blocks];
+
+    // horizontal delta entering the block from above; the first row of
+    // the matrix is 0,1,2,... so it is +1 for the first block
+    int hin = 1;
+    for (size_t b = 0; b < m_blocks; ++b) {
+      Block eq = peq ? peq[b] : 0;
+      const Block xv = eq | mv[b];
+      if (hin < 0) eq |= 1;
+      const Block xh = (((eq & pv[b]) + pv[b]) ^ pv[b]) | eq;
+      Block ph = mv[b] | ~(xh | pv[b]);
+      Block mh = pv[b] & xh;
+
+      const Block top = (b + 1 == m_blocks) ? m_lastBit : highBit;
+      const int hout = (ph & top) ? 1 : ((mh & top) ? -1 : 0);
+
+      ph <<= 1;
+      mh <<= 1;
+      if (hin < 0) mh |= 1;
+      else if (hin > 0) ph |= 1;
+      pv[b] = mh | ~(xv | ph);
+      mv[b] = ph & xv;
+      hin = hout;
+    }
+    score += hin;
+
+    // each remaining column can lower the score by at most one
+    if (score > maxCost + (n - j - 1)) {
+      return maxCost + 1;
+    }
+  }
+  return score;
+}
+
+}
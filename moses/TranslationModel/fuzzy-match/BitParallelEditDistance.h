@@ -0,0 +1,59 @@
+//
+//  BitParallelEditDistance.h
+//  moses
+//
+
+#ifndef moses_BitParallelEditDistance_h
+#define moses_BitParallelEditDistance_h
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+#include "Vocabulary.h"
+
+namespace tmmt
+{
+
+/** Word-level edit distance (unit costs) between a fixed pattern and
+ * many texts, computed with the bit-parallel algorithm of Myers (1999)
+ * in the blocked formulation of Hyyro (2003): each column of the DP
+ * matrix is processed 64 cells at a time. The pattern is preprocessed
+ * once, so a single object can be shared by threads that each have their
+ * own Workspace.
+ */
+class BitParallelEditDistance
+{
+public:
+  typedef boost::uint64_t Block;
+
+  //! per-thread scratch space, reused across calls
+  struct Workspace {
+    std::vector<Block> pv, mv;
+  };
+
+  BitParallelEditDistance(const std::vector<WORD_ID> &pattern);
+
+  /** edit distance between pattern and text. If the distance exceeds
+   * maxCost, computation stops early and maxCost+1 is returned. */
+  unsigned int Distance(const std::vector<WORD_ID> &text,
+                        unsigned int maxCost,
+                        Workspace &ws) const;
+
+  size_t GetPatternLength() const {
+    return m_length;
+  }
+
+protected:
+  size_t m_length;  // pattern length in words
+  size_t m_blocks;  // number of 64-bit blocks per column
+  Block m_lastBit;  // bit of the last pattern position in the last block
+
+  // match masks: m_peq[m_peqIndex[w] * m_blocks + b] has bit i set if
+  // word w occurs at pattern position b*64+i
+  boost::unordered_map<WORD_ID, size_t> m_peqIndex;
+  std::vector<Block> m_peq;
+};
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+// Compare the word-level string edit distance of the fuzzy match
+// validation step computed by dynamic programming (as the sed() of
+// FuzzyMatchWrapper does, without the path) and by the bit-parallel
+// kernel, with and without a cost threshold, on synthetic sentences.
+//
+// usage: fuzzy_match_benchmark [inputs [candidates-per-input [max-length]]]
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "BitParallelEditDistance.h"
+
+using namespace std;
+using namespace tmmt;
+
+namespace
+{
+
+double Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+unsigned int EditDistance(const vector<WORD_ID> &a, const vector<WORD_ID> &b)
+{
+  vector<unsigned int> prev(b.size() + 1), cur(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); ++j) prev[j] = j;
+  for (size_t i = 1; i <= a.size(); ++i) {
+    cur[0] = i;
+    for (size_t j = 1; j <= b.size(); ++j) {
+      cur[j] = min(min(prev[j], cur[j-1]) + 1,
+                   prev[j-1] + (a[i-1] == b[j-1] ? 0 : 1));
+    }
+    prev.swap(cur);
+  }
+  return prev[b.size()];
+}
+
+// tm sentences are noisy copies of the input, as the candidates that
+// survive the suffix array filters tend to be
+vector<WORD_ID> Perturb(const vector<WORD_ID> &input, WORD_ID vocabSize)
+{
+  vector<WORD_ID> ret;
+  for (size_t i = 0; i < input.size(); ++i) {
+    switch (rand() % 10) {
+    case 0:
+      break;
+    case 1:
+      ret.push_back(rand() % vocabSize);
+      break;
+    case 2:
+      ret.push_back(rand() % vocabSize);
+      ret.push_back(input[i]);
+      break;
+    default:
+      ret.push_back(input[i]);
+    }
+  }
+  return ret;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t inputs_count = argc > 1 ? atol(argv[1]) : 1000;
+  size_t candidates = argc > 2 ? atol(argv[2]) : 200;
+  size_t max_length = argc > 3 ? atol(argv[3]) : 80;
+  const WORD_ID vocab_size = 5000;
+
+  srand(1234);
+  vector<vector<WORD_ID> > inputs;
+  vector<vector<vector<WORD_ID> > > tms(inputs_count);
+  for (size_t s = 0; s < inputs_count; ++s) {
+    vector<WORD_ID> input(1 + rand() % max_length);
+    for (size_t i = 0; i < input.size(); ++i) input[i] = rand() % vocab_size;
+    inputs.push_back(input);
+    for (size_t c = 0; c < candidates; ++c) {
+      tms[s].push_back(Perturb(input, vocab_size));
+    }
+  }
+
+  vector<vector<unsigned int> > reference(inputs_count);
+  double start = Now();
+  for (size_t s = 0; s < inputs_count; ++s) {
+    for (size_t c = 0; c < candidates; ++c) {
+      reference[s].push_back(EditDistance(inputs[s], tms[s][c]));
+    }
+  }
+  double dp = Now() - start;
+  cout << inputs_count << " inputs, " << candidates << " candidates each" << endl;
+  cout << "dynamic programming: " << dp << " s" << endl;
+
+  // as in ExtractTM, the kernel is built once per input sentence, and its
+  // construction is part of the measurement
+  BitParallelEditDistance::Workspace ws;
+  for (int threshold = -1; threshold <= 20; threshold += 7) {
+    start = Now();
+    for (size_t s = 0; s < inputs_count; ++s) {
+      BitParallelEditDistance kernel(inputs[s]);
+      for (size_t c = 0; c < candidates; ++c) {
+        const vector<WORD_ID> &tm = tms[s][c];
+        unsigned int max_cost = threshold < 0 ? inputs[s].size() + tm.size() : threshold;
+        unsigned int cost = kernel.Distance(tm, max_cost, ws);
+        unsigned int expected = reference[s][c];
+        if (cost <= max_cost ? cost != expected : expected <= max_cost) {
+          cerr << "bit-parallel distance differs from dynamic programming for input "
+               << s << ", candidate " << c << endl;
+          return 1;
+        }
+      }
+    }
+    double elapsed = Now() - start;
+    cout << "bit-parallel, ";
+    if (threshold < 0) cout << "no threshold";
+    else cout << "threshold " << threshold;
+    cout << ": " << elapsed << " s, " << dp / elapsed << "x" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "BitParallelEditDistance.h"
+
+using namespace tmmt;
+using namespace std;
+
+namespace
+{
+// reference implementation: plain dynamic programming
+unsigned int EditDistance(const vector<WORD_ID> &a, const vector<WORD_ID> &b)
+{
+  vector<unsigned int> prev(b.size() + 1), cur(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); ++j) prev[j] = j;
+  for (size_t i = 1; i <= a.size(); ++i) {
+    cur[0] = i;
+    for (size_t j = 1; j <= b.size(); ++j) {
+      cur[j] = min(min(prev[j], cur[j-1]) + 1,
+                   prev[j-1] + (a[i-1] == b[j-1] ? 0 : 1));
+    }
+    prev.swap(cur);
+  }
+  return prev[b.size()];
+}
+
+vector<WORD_ID> RandomSentence(size_t maxLength, WORD_ID vocabSize)
+{
+  vector<WORD_ID> ret(rand() % (maxLength + 1));
+  for (size_t i = 0; i < ret.size(); ++i) ret[i] = rand() % vocabSize;
+  return ret;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(bit_parallel_edit_distance)
+
+BOOST_AUTO_TEST_CASE(short_sentences)
+{
+  WORD_ID a[] = {1, 2, 3, 4, 5};
+  WORD_ID b[] = {1, 3, 4, 6, 5, 7};
+  vector<WORD_ID> input(a, a + 5), tm(b, b + 6), empty;
+  BitParallelEditDistance::Workspace ws;
+
+  BOOST_CHECK_EQUAL(BitParallelEditDistance(input).Distance(tm, 100, ws), 3);
+  BOOST_CHECK_EQUAL(BitParallelEditDistance(input).Distance(input, 100, ws), 0);
+  BOOST_CHECK_EQUAL(BitParallelEditDistance(input).Distance(empty, 100, ws), 5);
+  BOOST_CHECK_EQUAL(BitParallelEditDistance(empty).Distance(tm, 100, ws), 6);
+}
+
+BOOST_AUTO_TEST_CASE(matches_dynamic_programming)
+{
+  srand(1234);
+  BitParallelEditDistance::Workspace ws;
+  for (size_t n = 0; n < 2000; ++n) {
+    // lengths beyond 64 words exercise the multi-block case
+    vector<WORD_ID> input = RandomSentence(150, 8);
+    vector<WORD_ID> tm = RandomSentence(150, 8);
+    BitParallelEditDistance kernel(input);
+    unsigned int expected = EditDistance(input, tm);
+    BOOST_CHECK_EQUAL(kernel.Distance(tm, 1000, ws), expected);
+
+    // early termination: exact up to the threshold, above it otherwise
+    unsigned int maxCost = rand() % 40;
+    unsigned int bounded = kernel.Distance(tm, maxCost, ws);
+    if (expected <= maxCost) {
+      BOOST_CHECK_EQUAL(bounded, expected);
+    } else {
+      BOOST_CHECK_GT(bounded, maxCost);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
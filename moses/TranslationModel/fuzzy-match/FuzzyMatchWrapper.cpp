@@ -7,7 +7,12 @@
 //
 
 #include <iostream>
+#include <algorithm>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
 #include "FuzzyMatchWrapper.h"
+#include "BitParallelEditDistance.h"
 #include "SentenceAlignment.h"
 #include "Match.h"
 #include "create_xml.h"
@@ -20,7 +25,14 @@ using namespace std;
 namespace tmmt
 {
 
-FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::string &targetPath, const std::string &alignmentPath)
+namespace
+{
+// with several threads, string edit distance candidates are validated in
+// batches of this many candidates per thread
+const size_t kSedCandidatesPerThread = 64;
+}
+
+FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::string &targetPath, const std::string &alignmentPath, size_t numThreads)
   :basic_flag(false)
   ,lsed_flag(true)
   ,refined_flag(true)
@@ -30,7 +42,16 @@ FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::s
   ,multiple_flag(true)
   ,multiple_slack(0)
   ,multiple_max(100)
+  ,m_numThreads(std::max(numThreads, size_t(1)))
 {
+#ifdef WITH_THREADS
+  if (m_numThreads > 1) {
+    m_pool.reset(new Moses::ThreadPool(m_numThreads - 1));
+  }
+#else
+  m_numThreads = 1;
+#endif
+
   cerr << "creating suffix array" << endl;
   suffixArray = new tmmt::SuffixArray( sourcePath );
 
@@ -247,8 +268,17 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
     init_short_matches(wordIndex, translationId, input[sentenceInd] );
   }
   vector< int > best_tm;
+  vector< pair< int, int > > tm_cost; // (tm sentence, cost) of validated matches
+  vector< int > sed_tm; // candidates to be validated by string edit distance
   typedef map< int, vector< Match > >::iterator I;
 
+  // with several threads, string edit distance candidates are validated in
+  // batches, and best_cost is tightened after each batch; a single thread
+  // validates each candidate right away, as tight as best_cost gets
+  BitParallelEditDistance kernel( input[sentenceInd] );
+  BitParallelEditDistance::Workspace ws;
+  size_t sed_batch_size = m_numThreads > 1 ? kSedCandidatesPerThread * m_numThreads : 1;
+
   clock_t clock_validation_sum = 0;
 
   for(I tm=sentence_match.begin(); tm!=sentence_match.end(); tm++) {
@@ -283,28 +313,40 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
     tm_count_word_match2++;
 
     pruned_match_count += pruned.size();
-    int prior_best_cost = best_cost;
-    int cost;
 
-    clock_t clock_validation_start = clock();
     if (! parse_flag ||
         pruned.size()>=10) { // to prevent worst cases
-      string path;
-      cost = sed( input[sentenceInd], source[tmID], path, false );
-      if (cost <  best_cost) {
-        best_cost = cost;
+      clock_t clock_validation_start = clock();
+      if (sed_batch_size == 1) {
+        int cost = kernel.Distance( source[tmID], best_cost, ws );
+        tm_cost.push_back( make_pair( tmID, cost ) );
+        if (cost < best_cost) best_cost = cost;
+      } else {
+        sed_tm.push_back( tmID );
+        if (sed_tm.size() >= sed_batch_size) {
+          sed_candidates( kernel, ws, sed_tm, best_cost, tm_cost );
+        }
       }
+      clock_validation_sum += clock() - clock_validation_start;
+      continue;
     }
 
-    else {
-      cost = parse_matches( pruned, input_length, tm_length, best_cost );
-      if (prior_best_cost != best_cost) {
-        best_tm.clear();
-      }
-    }
+    clock_t clock_validation_start = clock();
+    int cost = parse_matches( pruned, input_length, tm_length, best_cost );
     clock_validation_sum += clock() - clock_validation_start;
-    if (cost == best_cost) {
-      best_tm.push_back( tmID );
+    tm_cost.push_back( make_pair( tmID, cost ) );
+  }
+
+  // compute string edit distance for the last batch of candidates
+  clock_t clock_validation_start = clock();
+  sed_candidates( kernel, ws, sed_tm, best_cost, tm_cost );
+  clock_validation_sum += clock() - clock_validation_start;
+
+  // best matches, in order of tm sentence id
+  sort( tm_cost.begin(), tm_cost.end() );
+  for(size_t c=0; c<tm_cost.size(); c++) {
+    if (tm_cost[c].second == best_cost) {
+      best_tm.push_back( tm_cost[c].first );
     }
   }
   cerr << "reduced best cost from " << old_best_cost << " to " << best_cost << endl;
@@ -686,6 +728,122 @@ unsigned int FuzzyMatchWrapper::sed( const vector< WORD_ID > &a, const vector< W
   return final;
 }
 
+/* string edit distance (unit costs, no path) between the input and a batch
+ of tm sentences. The batch is split over up to m_numThreads threads: the
+ calling thread, which uses ws, and the threads of m_pool, which each keep
+ a workspace of their own. The (tm sentence, cost) pairs are appended to
+ tm_cost, best_cost is lowered to the smallest cost and the batch is
+ cleared. Distances above the best one found so far are not computed
+ exactly: the result is then some value larger than that best cost. */
+
+namespace
+{
+struct SedBatch {
+  SedBatch(const BitParallelEditDistance &kernel,
+           const vector< vector< WORD_ID > > &source,
+           const vector< int > &candidates,
+           vector< unsigned int > &cost,
+           size_t step, unsigned int max_cost)
+    : kernel(kernel), source(source), candidates(candidates), cost(cost)
+    , step(step), max_cost(max_cost), pending(step - 1) {
+  }
+
+  // validate every step-th candidate, starting with the first-th one
+  void Run(size_t first, BitParallelEditDistance::Workspace &ws) {
+    unsigned int local_max_cost;
+    {
+#ifdef WITH_THREADS
+      boost::lock_guard<boost::mutex> guard(lock);
+#endif
+      local_max_cost = max_cost;
+    }
+    for(size_t c=first, n=0; c<candidates.size(); c+=step, ++n) {
+      cost[c] = kernel.Distance( source[candidates[c]], local_max_cost, ws );
+      if (cost[c] < local_max_cost || n % 64 == 0) {
+        // share tighter thresholds with the other threads
+#ifdef WITH_THREADS
+        boost::lock_guard<boost::mutex> guard(lock);
+#endif
+        if (cost[c] < max_cost) max_cost = cost[c];
+        local_max_cost = max_cost;
+      }
+    }
+  }
+
+  const BitParallelEditDistance &kernel;
+  const vector< vector< WORD_ID > > &source;
+  const vector< int > &candidates;
+  vector< unsigned int > &cost;
+  size_t step;
+  unsigned int max_cost; // tightest threshold found so far
+  size_t pending; // slices that the pool has not finished yet
+#ifdef WITH_THREADS
+  boost::mutex lock;
+  boost::condition_variable finished;
+#endif
+};
+
+#ifdef WITH_THREADS
+// workspace of each pool thread
+boost::thread_specific_ptr<BitParallelEditDistance::Workspace> s_workspace;
+
+class SedTask : public Moses::Task
+{
+public:
+  SedTask(SedBatch &batch, size_t first) : m_batch(batch), m_first(first) {}
+
+  void Run() {
+    if (!s_workspace.get()) {
+      s_workspace.reset(new BitParallelEditDistance::Workspace);
+    }
+    m_batch.Run(m_first, *s_workspace);
+    boost::lock_guard<boost::mutex> guard(m_batch.lock);
+    if (--m_batch.pending == 0) {
+      m_batch.finished.notify_one();
+    }
+  }
+
+private:
+  SedBatch &m_batch;
+  size_t m_first;
+};
+#endif
+}
+
+void FuzzyMatchWrapper::sed_candidates( const BitParallelEditDistance &kernel, BitParallelEditDistance::Workspace &ws, vector< int > &candidates, int &best_cost, vector< pair< int, int > > &tm_cost )
+{
+  if (candidates.empty()) return;
+  const vector< vector< WORD_ID > > &source = suffixArray->GetCorpus();
+  vector< unsigned int > cost( candidates.size() );
+
+  // a full batch keeps all m_numThreads threads busy
+  size_t num_threads = min( m_numThreads,
+                            (candidates.size() + kSedCandidatesPerThread - 1) / kSedCandidatesPerThread );
+  SedBatch batch( kernel, source, candidates, cost, num_threads, best_cost );
+#ifdef WITH_THREADS
+  for(size_t t=1; t<num_threads; t++) {
+    m_pool->Submit( boost::shared_ptr<Moses::Task>( new SedTask( batch, t ) ) );
+  }
+#endif
+  batch.Run( 0, ws );
+#ifdef WITH_THREADS
+  {
+    boost::unique_lock<boost::mutex> guard(batch.lock);
+    while (batch.pending) {
+      batch.finished.wait(guard);
+    }
+  }
+#endif
+
+  for(size_t c=0; c<candidates.size(); c++) {
+    tm_cost.push_back( make_pair( candidates[c], (int) cost[c] ) );
+    if ((int) cost[c] < best_cost) {
+      best_cost = cost[c];
+    }
+  }
+  candidates.clear();
+}
+
 /* utlility function: compute length of sentence in characters
  (spaces do not count) */
 
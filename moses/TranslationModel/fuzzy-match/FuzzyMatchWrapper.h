@@ -10,7 +10,9 @@
 #define moses_FuzzyMatchWrapper_h
 
 #ifdef WITH_THREADS
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread/shared_mutex.hpp>
+#include "moses/ThreadPool.h"
 #endif
 
 #include <fstream>
@@ -18,6 +20,7 @@
 #include "SuffixArray.h"
 #include "Vocabulary.h"
 #include "Match.h"
+#include "BitParallelEditDistance.h"
 #include "moses/InputType.h"
 
 namespace tmmt
@@ -28,7 +31,7 @@ struct SentenceAlignment;
 class FuzzyMatchWrapper
 {
 public:
-  FuzzyMatchWrapper(const std::string &source, const std::string &target, const std::string &alignment);
+  FuzzyMatchWrapper(const std::string &source, const std::string &target, const std::string &alignment, size_t numThreads = 1);
 
   std::string Extract(long translationId, const std::string &dirNameStr);
 
@@ -45,6 +48,11 @@ protected:
   int multiple_flag;
   int multiple_slack;
   int multiple_max;
+  size_t m_numThreads; // threads used to validate candidate TM sentences
+#ifdef WITH_THREADS
+  // helpers of the threads that call Extract(), if m_numThreads > 1
+  boost::scoped_ptr<Moses::ThreadPool> m_pool;
+#endif
 
   typedef std::map< WORD_ID,std::vector< int > > WordIndex;
 
@@ -68,6 +76,7 @@ protected:
   unsigned int compute_length( const std::vector< tmmt::WORD_ID > &sentence );
   unsigned int letter_sed( WORD_ID aIdx, WORD_ID bIdx );
   unsigned int sed( const std::vector< WORD_ID > &a, const std::vector< WORD_ID > &b, std::string &best_path, bool use_letter_sed );
+  void sed_candidates( const BitParallelEditDistance &kernel, BitParallelEditDistance::Workspace &ws, std::vector< int > &candidates, int &best_cost, std::vector< std::pair< int, int > > &tm_cost );
   void init_short_matches(WordIndex &wordIndex, long translationId, const std::vector< WORD_ID > &input );
   int short_match_max_length( int input_length );
   void add_short_matches(WordIndex &wordIndex, long translationId, std::vector< Match > &match, const std::vector< WORD_ID > &tm, int input_length, int best_cost );
@@ -68,12 +68,12 @@ bool TranslationOption::Overlap(const Hypothesis &hypothesis) const
 
 void
 TranslationOption::
-CacheLexReorderingScores(const LexicalReordering &producer, const Scores &score)
+SetLexReorderingScores(const LexicalReordering &producer, float const* scores)
 {
-  if (score.empty()) return;
-  boost::shared_ptr<Scores> stored(new Scores(score));
-  m_targetPhrase.SetExtraScores(&producer,stored);
-  // m_lexReorderingScores[&producer] = score;
+  size_t idx = producer.GetIndex();
+  if (idx >= m_lexReorderingScores.size())
+    m_lexReorderingScores.resize(idx + 1, NULL);
+  m_lexReorderingScores[idx] = scores;
 }
 
 void TranslationOption::EvaluateWithSourceContext(const InputType &input)
@@ -110,17 +110,17 @@ ostream& operator<<(ostream& out, const TranslationOption& possibleTranslation)
 }
 
 /** returns cached scores */
-const Scores*
+float const*
 TranslationOption::
 GetLexReorderingScores(LexicalReordering const* scoreProducer) const
 {
-  return m_targetPhrase.GetExtraScores(scoreProducer);
-  // _ScoreCacheMap::const_iterator it;
-  // it = m_lexReorderingScores.find(scoreProducer);
-  // if(it == m_lexReorderingScores.end())
-  //   return NULL;
-  // else
-  //   return &(it->second);
+  size_t idx = scoreProducer->GetIndex();
+  if (idx < m_lexReorderingScores.size())
+    return m_lexReorderingScores[idx];
+
+  // option was not part of a TranslationOptionCollection
+  Scores const* extra = m_targetPhrase.GetExtraScores(scoreProducer);
+  return (extra && extra->size()) ? &(*extra)[0] : NULL;
 }
 
 }
@@ -70,11 +70,12 @@ protected:
   const Range	m_sourceWordsRange; /*< word position in the input that are covered by this translation option */
   float             m_futureScore; /*< estimate of total cost when using this translation option, includes language model probabilities */
 
-  // typedef std::map<const LexicalReordering*, Scores> _ScoreCacheMap;
-  // _ScoreCacheMap m_lexReorderingScores;
-  // m_lexReorderingScores was moved to TargetPhrase.h so that phrase tables
-  // can add information (such as lexical reordering scores) to target phrases
-  // during lookup.
+  // Lexical reordering scores, indexed by LexicalReordering::GetIndex().
+  // They point into the per-sentence score buffer of the
+  // TranslationOptionCollection, see CacheLexReordering(). Phrase tables
+  // can still add scores to target phrases during lookup (see
+  // TargetPhrase::SetExtraScores()); these are copied into the buffer.
+  std::vector<float const*> m_lexReorderingScores;
 
 public:
   struct Better {
@@ -156,15 +157,12 @@ public:
   }
 
   /** returns cached scores */
-  // inline
-  const Scores*
+  /** returns cached reordering scores, NULL if there are none */
+  float const*
   GetLexReorderingScores(const LexicalReordering *scoreProducer) const;
-  // {
-  //   return m_targetPhrase.GetExtraScores(scoreProducer);
-  // }
 
-  void CacheLexReorderingScores(const LexicalReordering &scoreProducer,
-                                const Scores &score);
+  void SetLexReorderingScores(const LexicalReordering &scoreProducer,
+                              float const* scores);
 
   TO_STRING();
 
@@ -614,14 +614,44 @@ void
 TranslationOptionCollection::
 CacheLexReordering()
 {
+  // All reordering scores of the sentence go into one flat buffer, filled
+  // in a single pass. The options point into it once it is complete, so
+  // the reordering states read their scores by index during search.
   size_t const stop = m_source.GetSize();
+  std::vector<LexicalReordering const*> lrs;
+  std::vector<size_t> offsets; // one per option and feature; NOT_FOUND if none
+  std::vector<Scores> scores;
+  m_lexReorderingScores.clear();
+
   typedef StatefulFeatureFunction sfFF;
   BOOST_FOREACH(sfFF const* ff, sfFF::GetStatefulFeatureFunctions()) {
     if (typeid(*ff) != typeid(LexicalReordering)) continue;
     LexicalReordering const& lr = static_cast<const LexicalReordering&>(*ff);
+    lrs.push_back(&lr);
+    for (size_t s = 0 ; s < stop ; s++)
+      BOOST_FOREACH(TranslationOptionList& tol, m_collection[s]) {
+      lr.GetScores(tol, scores);
+      BOOST_FOREACH(Scores const& sc, scores) {
+        if (sc.empty()) {
+          offsets.push_back(NOT_FOUND);
+        } else {
+          offsets.push_back(m_lexReorderingScores.size());
+          m_lexReorderingScores.insert(m_lexReorderingScores.end(),
+                                       sc.begin(), sc.end());
+        }
+      }
+    }
+  }
+
+  std::vector<size_t>::const_iterator off = offsets.begin();
+  BOOST_FOREACH(LexicalReordering const* lr, lrs) {
     for (size_t s = 0 ; s < stop ; s++)
       BOOST_FOREACH(TranslationOptionList& tol, m_collection[s])
-      lr.SetCache(tol);
+      BOOST_FOREACH(TranslationOption* to, tol) {
+      size_t o = *off++;
+      to->SetLexReorderingScores(*lr, o == NOT_FOUND ? NULL
+                                 : &m_lexReorderingScores[o]);
+    }
   }
 }
 
@@ -67,6 +67,7 @@ class TranslationOptionCollection
 protected:
   ttaskwptr m_ttask; // that is and must be a weak pointer!
   std::vector< std::vector< TranslationOptionList > >	m_collection; /*< contains translation options */
+  std::vector<float> m_lexReorderingScores; /*< flat store of the lexical reordering scores of all options, see CacheLexReordering() */
   InputType const &m_source; /*< reference to the input */
   SquareMatrix m_estimatedScores; /*< matrix of future costs for contiguous parts (span) of the input */
   const size_t m_maxNoTransOptPerCoverage; /*< maximum number of translation options per input span */
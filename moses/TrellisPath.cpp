@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TrellisPathCollection.h"
 #include "StaticData.h"
 #include "Manager.h"
+#include <boost/functional/hash.hpp>
 using namespace std;
 
 namespace Moses
@@ -77,6 +78,13 @@ TrellisPath::TrellisPath(const TrellisPath &copy, size_t edgeIndex, const Hypoth
   InitTotalScore();
 }
 
+TrellisPath::TrellisPath(const vector<const Hypothesis*> &path, size_t prevEdgeChanged)
+  : m_path(path)
+  , m_prevEdgeChanged(prevEdgeChanged)
+{
+  InitTotalScore();
+}
+
 TrellisPath::TrellisPath(const vector<const Hypothesis*> edges)
   :m_prevEdgeChanged(NOT_FOUND)
 {
@@ -226,6 +234,25 @@ Phrase TrellisPath::GetSurfacePhrase() const
   return ret;
 }
 
+size_t TrellisPath::GetSurfaceHash() const
+{
+  std::vector<FactorType> const& oFactor = manager().options()->output.factor_order;
+  size_t seed = 0;
+
+  // factors are unique, so hashing their addresses is enough
+  int numHypo = (int) m_path.size();
+  for (int node = numHypo - 2 ; node >= 0 ; --node) {
+    const Phrase &currTargetPhrase = m_path[node]->GetCurrTargetPhrase();
+    for (size_t pos = 0 ; pos < currTargetPhrase.GetSize() ; ++pos) {
+      for (size_t i = 0 ; i < oFactor.size() ; i++) {
+        boost::hash_combine(seed, currTargetPhrase.GetFactor(pos, oFactor[i]));
+      }
+    }
+  }
+
+  return seed;
+}
+
 Range TrellisPath::GetTargetWordsRange(const Hypothesis &hypo) const
 {
   size_t startPos = 0;
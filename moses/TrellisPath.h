@@ -44,6 +44,7 @@ class TrellisPath
 {
   friend std::ostream& operator<<(std::ostream&, const TrellisPath&);
   friend class Manager;
+  friend class TrellisPathEnumerator;
 
 protected:
   std::vector<const Hypothesis *> m_path; //< list of hypotheses/arcs
@@ -58,6 +59,9 @@ protected:
   //Used by Manager::LatticeSample()
   explicit TrellisPath(const std::vector<const Hypothesis*> edges);
 
+  //Used by TrellisPathEnumerator: path in the order of m_path
+  TrellisPath(const std::vector<const Hypothesis*> &path, size_t prevEdgeChanged);
+
   void InitTotalScore();
 
   Manager const& manager() const {
@@ -106,6 +110,9 @@ public:
   Phrase GetTargetPhrase() const;
   Phrase GetSurfacePhrase() const;
 
+  //! hash of GetSurfacePhrase(), without building it
+  size_t GetSurfaceHash() const;
+
   TO_STRING();
 
 };
@@ -0,0 +1,151 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <functional>
+#include "TrellisPathEnumerator.h"
+#include "TrellisPath.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+TrellisPathEnumerator::TrellisPathEnumerator(const vector<const Hypothesis*> &finalHypos)
+{
+  for (size_t i = 0; i < finalHypos.size(); ++i) {
+    const Hypothesis *hypo = finalHypos[i];
+    Contender contender;
+    contender.parent = NOT_FOUND;
+    contender.edgeIndex = NOT_FOUND;
+    contender.arcRank = 0;
+    contender.replaced = NULL;
+    contender.arc = hypo;
+    contender.pathScore = hypo->GetWinningHypo()->GetFutureScore() + ChainDelta(hypo);
+    // pure paths are ranked by their own score, as TrellisPath(hypo) does
+    Push(contender, hypo->GetFutureScore());
+  }
+}
+
+void TrellisPathEnumerator::Push(const Contender &contender, float score)
+{
+  QueueEntry entry;
+  entry.score = score;
+  entry.index = m_contenders.size();
+  m_contenders.push_back(contender);
+  m_queue.push(entry);
+}
+
+void TrellisPathEnumerator::GetPath(size_t index, vector<const Hypothesis*> &path) const
+{
+  const Contender &contender = m_contenders[index];
+  if (contender.parent == NOT_FOUND) {
+    path.clear();
+  } else {
+    GetPath(contender.parent, path);
+    path.resize(contender.edgeIndex);
+  }
+  for (const Hypothesis *hypo = contender.arc; hypo != NULL; hypo = hypo->GetPrevHypo()) {
+    path.push_back(hypo);
+  }
+}
+
+float TrellisPathEnumerator::ChainDelta(const Hypothesis *hypo)
+{
+  // walk back to the first hypo already known, then fill in forwards
+  vector<const Hypothesis*> unknown;
+  float delta = 0;
+  for (; hypo != NULL; hypo = hypo->GetPrevHypo()) {
+    boost::unordered_map<const Hypothesis*, float>::const_iterator found = m_chainDelta.find(hypo);
+    if (found != m_chainDelta.end()) {
+      delta = found->second;
+      break;
+    }
+    unknown.push_back(hypo);
+  }
+  for (vector<const Hypothesis*>::reverse_iterator i = unknown.rbegin(); i != unknown.rend(); ++i) {
+    delta += (*i)->GetFutureScore() - (*i)->GetWinningHypo()->GetFutureScore();
+    m_chainDelta[*i] = delta;
+  }
+  return delta;
+}
+
+const TrellisPathEnumerator::SortedArcList &TrellisPathEnumerator::GetSortedArcs(const Hypothesis *hypo)
+{
+  boost::unordered_map<const Hypothesis*, SortedArcList>::iterator found = m_sortedArcs.find(hypo);
+  if (found != m_sortedArcs.end()) return found->second;
+
+  SortedArcList &ret = m_sortedArcs[hypo];
+  const ArcList *arcList = hypo->GetArcList();
+  if (arcList) {
+    ret.reserve(arcList->size());
+    for (ArcList::const_iterator i = arcList->begin(); i != arcList->end(); ++i) {
+      ret.push_back(make_pair(ChainDelta(*i), static_cast<const Hypothesis*>(*i)));
+    }
+    stable_sort(ret.begin(), ret.end(), greater<pair<float, const Hypothesis*> >());
+  }
+  return ret;
+}
+
+TrellisPath *TrellisPathEnumerator::Next()
+{
+  const size_t index = m_queue.top().index;
+  m_queue.pop();
+  const Contender contender = m_contenders[index];
+
+  vector<const Hypothesis*> path;
+  GetPath(index, path);
+
+  // the next arc at the same position of the parent
+  if (contender.parent != NOT_FOUND) {
+    const SortedArcList &arcs = GetSortedArcs(contender.replaced);
+    if (contender.arcRank + 1 < arcs.size()) {
+      Contender sibling(contender);
+      ++sibling.arcRank;
+      sibling.arc = arcs[sibling.arcRank].second;
+      sibling.pathScore = m_contenders[contender.parent].pathScore
+                          - ChainDelta(contender.replaced) + arcs[sibling.arcRank].first;
+      Push(sibling, sibling.pathScore);
+    }
+  }
+
+  // the best arc at each later position of this path
+  const size_t firstEdge = (contender.edgeIndex == NOT_FOUND) ? 0 : contender.edgeIndex + 1;
+  for (size_t edge = firstEdge; edge < path.size(); ++edge) {
+    const SortedArcList &arcs = GetSortedArcs(path[edge]);
+    if (arcs.empty()) continue;
+    Contender child;
+    child.parent = index;
+    child.edgeIndex = edge;
+    child.arcRank = 0;
+    child.replaced = path[edge];
+    child.arc = arcs[0].second;
+    child.pathScore = contender.pathScore - ChainDelta(path[edge]) + arcs[0].first;
+    Push(child, child.pathScore);
+  }
+
+  if (contender.parent == NOT_FOUND) {
+    return new TrellisPath(contender.arc);
+  }
+  return new TrellisPath(path, contender.edgeIndex);
+}
+
+}
@@ -0,0 +1,91 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <deque>
+#include <queue>
+#include <utility>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "Hypothesis.h"
+
+namespace Moses
+{
+
+class TrellisPath;
+
+/** Enumerates the paths through the search graph of phrase-based decoding,
+ *  best first, for n-best lists.  Contenders are not copied: each one is its
+ *  parent contender plus one deviation (an arc replacing the hypothesis at
+ *  one position, after which the path follows back pointers).  Arc lists are
+ *  sorted once, so a popped path only adds the next arc at its own deviation
+ *  and the best arc at each later position, as in Huang and Chiang's lazy
+ *  k-best algorithm.  Only the paths that are popped become TrellisPaths.
+ */
+class TrellisPathEnumerator
+{
+public:
+  //! start from the pure paths ending in each of the given hypotheses
+  explicit TrellisPathEnumerator(const std::vector<const Hypothesis*> &finalHypos);
+
+  bool Empty() const {
+    return m_queue.empty();
+  }
+
+  //! remove the best remaining path; the caller owns it
+  TrellisPath *Next();
+
+private:
+  typedef std::vector<std::pair<float, const Hypothesis*> > SortedArcList;
+
+  struct Contender {
+    size_t parent; //< index in m_contenders, NOT_FOUND for a pure path
+    size_t edgeIndex; //< position of the deviation, NOT_FOUND for a pure path
+    size_t arcRank; //< rank of arc in the sorted arc list of replaced
+    const Hypothesis *replaced; //< hypothesis of the parent at edgeIndex
+    const Hypothesis *arc; //< the deviation, or the last hypothesis of a pure path
+    float pathScore; //< as TrellisPath::InitTotalScore() computes it
+  };
+
+  struct QueueEntry {
+    float score;
+    size_t index;
+    bool operator<(const QueueEntry &other) const {
+      return score < other.score || (score == other.score && index > other.index);
+    }
+  };
+
+  void Push(const Contender &contender, float score);
+  void GetPath(size_t index, std::vector<const Hypothesis*> &path) const;
+  float ChainDelta(const Hypothesis *hypo);
+  const SortedArcList &GetSortedArcs(const Hypothesis *hypo);
+
+  std::deque<Contender> m_contenders;
+  std::priority_queue<QueueEntry> m_queue;
+
+  //! sum of (score - score of winning hypo) along the back pointers
+  boost::unordered_map<const Hypothesis*, float> m_chainDelta;
+  //! arcs of a hypothesis by descending ChainDelta
+  boost::unordered_map<const Hypothesis*, SortedArcList> m_sortedArcs;
+};
+
+}
@@ -9,6 +9,7 @@ namespace Moses
     : pop_limit(DEFAULT_CUBE_PRUNING_POP_LIMIT)
     , diversity(DEFAULT_CUBE_PRUNING_DIVERSITY)
     , lazy_scoring(false)
+    , lazy_gate(DEFAULT_CUBE_PRUNING_LAZY_GATE)
     , deterministic_search(false)
   {}
 
@@ -21,6 +22,8 @@ namespace Moses
     param.SetParameter(diversity, "cube-pruning-diversity",
 		       DEFAULT_CUBE_PRUNING_DIVERSITY);
     param.SetParameter(lazy_scoring, "cube-pruning-lazy-scoring", false);
+    param.SetParameter(lazy_gate, "cube-pruning-lazy-gate",
+		       DEFAULT_CUBE_PRUNING_LAZY_GATE);
     param.SetParameter(deterministic_search, "cube-pruning-deterministic-search", false);
     return true;
   }
@@ -38,6 +41,9 @@ namespace Moses
       si = params.find("cube-pruning-diversity");
       if (si != params.end()) diversity = xmlrpc_c::value_int(si->second);
       
+      si = params.find("cube-pruning-lazy-gate");
+      if (si != params.end()) lazy_gate = xmlrpc_c::value_int(si->second);
+
       si = params.find("cube-pruning-lazy-scoring");
       if (si != params.end())
 	    {
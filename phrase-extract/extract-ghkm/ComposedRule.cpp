@@ -40,8 +40,12 @@ ComposedRule::ComposedRule(const Subgraph &baseRule)
   , m_size(baseRule.GetSize())
   , m_nodeCount(baseRule.GetNodeCount())
 {
-  const std::set<const Node *> &leaves = baseRule.GetLeaves();
-  for (std::set<const Node *>::const_iterator p = leaves.begin();
+  // Attachment points are visited in left-to-right order.  (Iterating over
+  // the leaf set would make the order of the composed rules depend on the
+  // node addresses.)
+  std::vector<const Node *> leaves;
+  baseRule.GetTargetLeaves(leaves);
+  for (std::vector<const Node *>::const_iterator p = leaves.begin();
        p != leaves.end(); ++p) {
     if ((*p)->GetType() == TREE) {
       m_openAttachmentPoints.push(*p);
@@ -110,21 +114,21 @@ ComposedRule *ComposedRule::AttemptComposition(const Subgraph &rule,
 
 Subgraph ComposedRule::CreateSubgraph()
 {
-  std::set<const Node *> leaves;
-  const std::set<const Node *> &baseLeaves = m_baseRule.GetLeaves();
+  std::set<const Node *> leaves = m_baseRule.GetLeaves();
+  std::vector<const Node *> baseLeaves;
+  m_baseRule.GetTargetLeaves(baseLeaves);
   size_t i = 0;
-  for (std::set<const Node *>::const_iterator p = baseLeaves.begin();
-       p != baseLeaves.end(); ++p) {
+  for (std::vector<const Node *>::const_iterator p = baseLeaves.begin();
+       p != baseLeaves.end() && i < m_attachedRules.size(); ++p) {
     const Node *baseLeaf = *p;
-    if (baseLeaf->GetType() == TREE && i < m_attachedRules.size()) {
+    if (baseLeaf->GetType() == TREE) {
       const Subgraph *attachedRule = m_attachedRules[i++];
       if (attachedRule) {
+        leaves.erase(baseLeaf);
         leaves.insert(attachedRule->GetLeaves().begin(),
                       attachedRule->GetLeaves().end());
-        continue;
       }
     }
-    leaves.insert(baseLeaf);
   }
   return Subgraph(m_baseRule.GetRoot(), leaves);
 }
@@ -28,7 +28,16 @@
 #include <sstream>
 #include <vector>
 
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
 #include <boost/program_options.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+
+#include "moses/ThreadPool.h"
+#include "util/pcqueue.hh"
+#endif
 
 #include "syntax-common/exception.h"
 #include "syntax-common/xml_tree_parser.h"
@@ -60,6 +69,266 @@ namespace Syntax
 namespace GHKM
 {
 
+namespace
+{
+
+// Reads the next line from each of the three input files.  Returns false at
+// the end of the input.  Throws an Exception if the files do not have the
+// same number of lines.
+bool ReadSentencePair(std::istream &targetStream,
+                      std::istream &sourceStream,
+                      std::istream &alignmentStream,
+                      std::string &targetLine,
+                      std::string &sourceLine,
+                      std::string &alignmentLine)
+{
+  std::getline(targetStream, targetLine);
+  std::getline(sourceStream, sourceLine);
+  std::getline(alignmentStream, alignmentLine);
+
+  if (targetStream.eof() && sourceStream.eof() && alignmentStream.eof()) {
+    return false;
+  }
+
+  if (targetStream.eof() || sourceStream.eof() || alignmentStream.eof()) {
+    throw Exception("Files must contain same number of lines");
+  }
+
+  return true;
+}
+
+}  // namespace
+
+#ifdef WITH_THREADS
+
+// Number of sentence pairs that are extracted by a single task.
+const size_t kBlockSize = 1000;
+
+// A block of consecutive sentence pairs and, once the ExtractionTask has run,
+// its output.  The reader thread creates the blocks, the writer (the main
+// thread) deletes them after writing their output.
+struct ExtractionBlock {
+  ExtractionBlock(size_t firstLineNum)
+    : firstLineNum(firstLineNum)
+    , context(fwdBuffer, invBuffer, logBuffer)
+    , done(false) {}
+
+  // Input.
+  size_t firstLineNum;
+  std::vector<std::string> targetLines;
+  std::vector<std::string> sourceLines;
+  std::vector<std::string> alignmentLines;
+
+  // Output.
+  std::ostringstream fwdBuffer;
+  std::ostringstream invBuffer;
+  std::ostringstream logBuffer;
+  ExtractionContext context;
+  std::string fwd;
+  std::string inv;
+  std::string error;
+
+  bool done;
+  boost::mutex mutex;
+  boost::condition_variable finished;
+};
+
+namespace
+{
+
+// Compresses text into a single gzip member.  A sequence of gzip members is a
+// valid gzip file, so the blocks can be compressed independently.
+std::string GzipCompress(const std::string &text)
+{
+  std::string compressed;
+  if (!text.empty()) {
+    boost::iostreams::filtering_ostream out;
+    out.push(boost::iostreams::gzip_compressor());
+    out.push(boost::iostreams::back_inserter(compressed));
+    out.write(text.data(), text.size());
+    out.reset();
+  }
+  return compressed;
+}
+
+}  // namespace
+
+class ExtractionTask : public Moses::Task
+{
+public:
+  ExtractionTask(const ExtractGHKM &tool, const Options &options,
+                 ExtractionBlock &block)
+    : m_tool(tool)
+    , m_options(options)
+    , m_block(block) {}
+
+  void Run() {
+    ExtractionBlock &block = m_block;
+    try {
+      for (size_t i = 0; i < block.targetLines.size(); ++i) {
+        m_tool.ExtractSentencePair(block.targetLines[i], block.sourceLines[i],
+                                   block.alignmentLines[i],
+                                   block.firstLineNum + i, m_options,
+                                   block.context);
+      }
+    } catch (const Exception &e) {
+      block.error = e.msg();
+    }
+    block.context.RecordLabelSets();
+
+    block.targetLines.clear();
+    block.sourceLines.clear();
+    block.alignmentLines.clear();
+    if (m_options.gzOutput) {
+      block.fwd = GzipCompress(block.fwdBuffer.str());
+      block.inv = GzipCompress(block.invBuffer.str());
+    } else {
+      block.fwd = block.fwdBuffer.str();
+      block.inv = block.invBuffer.str();
+    }
+    block.fwdBuffer.str("");
+    block.invBuffer.str("");
+
+    boost::mutex::scoped_lock lock(block.mutex);
+    block.done = true;
+    block.finished.notify_one();
+  }
+
+private:
+  const ExtractGHKM &m_tool;
+  const Options &m_options;
+  ExtractionBlock &m_block;
+};
+
+namespace
+{
+
+// The reader thread: splits the input into blocks, submits an ExtractionTask
+// for each block and passes the blocks, in corpus order, to the writer.  A
+// NULL block marks the end of the input.
+void ReadBlocks(const ExtractGHKM &tool, const Options &options,
+                std::istream &targetStream, std::istream &sourceStream,
+                std::istream &alignmentStream, Moses::ThreadPool &pool,
+                util::PCQueue<ExtractionBlock *> &queue)
+{
+  size_t lineNum = options.sentenceOffset;
+  std::string targetLine;
+  std::string sourceLine;
+  std::string alignmentLine;
+  bool more = true;
+  while (more) {
+    ExtractionBlock *block = new ExtractionBlock(lineNum + 1);
+    try {
+      while (block->targetLines.size() < kBlockSize &&
+             (more = ReadSentencePair(targetStream, sourceStream,
+                                      alignmentStream, targetLine, sourceLine,
+                                      alignmentLine))) {
+        block->targetLines.push_back(targetLine);
+        block->sourceLines.push_back(sourceLine);
+        block->alignmentLines.push_back(alignmentLine);
+        ++lineNum;
+      }
+    } catch (const Exception &e) {
+      // Report the error after the rules of the lines that were read so far.
+      ExtractionBlock *errorBlock = new ExtractionBlock(lineNum + 1);
+      errorBlock->error = e.msg();
+      errorBlock->done = true;
+      pool.Submit(boost::shared_ptr<Moses::Task>(
+                    new ExtractionTask(tool, options, *block)));
+      queue.Produce(block);
+      queue.Produce(errorBlock);
+      break;
+    }
+    if (block->targetLines.empty()) {
+      delete block;
+      break;
+    }
+    pool.Submit(boost::shared_ptr<Moses::Task>(
+                  new ExtractionTask(tool, options, *block)));
+    queue.Produce(block);
+  }
+  queue.Produce(NULL);
+}
+
+// The writer: waits for each block in turn, writes its rules and messages, and
+// merges its statistics.  Returns the first error message, if any, in which
+// case the remaining blocks are not written.
+std::string WriteBlocks(util::PCQueue<ExtractionBlock *> &queue,
+                        std::ostream &fwdStream, std::ostream &invStream,
+                        ExtractionStatistics &stats)
+{
+  ExtractionBlock *block;
+  while ((block = queue.Consume()) != NULL) {
+    {
+      boost::mutex::scoped_lock lock(block->mutex);
+      while (!block->done) {
+        block->finished.wait(lock);
+      }
+    }
+    fwdStream << block->fwd;
+    invStream << block->inv;
+    std::cerr << block->logBuffer.str();
+    std::string error = block->error;
+    stats.Merge(block->context.stats);
+    delete block;
+    if (!error.empty()) {
+      return error;
+    }
+  }
+  return "";
+}
+
+}  // namespace
+
+#endif  // WITH_THREADS
+
+ExtractionStatistics::ExtractionStatistics()
+  : l2rOrientationCounts(PhraseOrientation::REO_CLASS_UNKNOWN+1, 0)
+  , r2lOrientationCounts(PhraseOrientation::REO_CLASS_UNKNOWN+1, 0)
+{
+}
+
+void ExtractionStatistics::Merge(const ExtractionStatistics &other)
+{
+  for (std::map<std::string, int>::const_iterator p =
+         other.targetWordCount.begin(); p != other.targetWordCount.end(); ++p) {
+    targetWordCount[p->first] += p->second;
+  }
+  // Labels are overwritten: the last occurrence of a word determines its label.
+  for (std::map<std::string, std::string>::const_iterator p =
+         other.targetWordLabel.begin(); p != other.targetWordLabel.end(); ++p) {
+    targetWordLabel[p->first] = p->second;
+  }
+  for (std::map<std::string, int>::const_iterator p =
+         other.sourceWordCount.begin(); p != other.sourceWordCount.end(); ++p) {
+    sourceWordCount[p->first] += p->second;
+  }
+  for (std::map<std::string, std::string>::const_iterator p =
+         other.sourceWordLabel.begin(); p != other.sourceWordLabel.end(); ++p) {
+    sourceWordLabel[p->first] = p->second;
+  }
+  targetLabelSet.insert(other.targetLabelSet.begin(),
+                        other.targetLabelSet.end());
+  for (std::map<std::string, int>::const_iterator p =
+         other.targetTopLabelSet.begin();
+       p != other.targetTopLabelSet.end(); ++p) {
+    targetTopLabelSet[p->first] += p->second;
+  }
+  sourceLabelSet.insert(other.sourceLabelSet.begin(),
+                        other.sourceLabelSet.end());
+  for (size_t i = 0; i < l2rOrientationCounts.size(); ++i) {
+    l2rOrientationCounts[i] += other.l2rOrientationCounts[i];
+    r2lOrientationCounts[i] += other.r2lOrientationCounts[i];
+  }
+}
+
+void ExtractionContext::RecordLabelSets()
+{
+  stats.targetLabelSet = targetXmlTreeParser.label_set();
+  stats.targetTopLabelSet = targetXmlTreeParser.top_label_set();
+  stats.sourceLabelSet = sourceXmlTreeParser.label_set();
+}
+
 int ExtractGHKM::Main(int argc, char *argv[])
 {
   using Moses::InputFileStream;
@@ -99,8 +368,23 @@ int ExtractGHKM::Main(int argc, char *argv[])
     fwdFileName += ".gz";
     invFileName += ".gz";
   }
-  OpenOutputFileOrDie(fwdFileName, fwdExtractStream);
-  OpenOutputFileOrDie(invFileName, invExtractStream);
+  // Threaded extraction writes blocks that the workers have already
+  // compressed, so in that case the extract files are opened as plain files.
+  std::ofstream fwdCompressedStream;
+  std::ofstream invCompressedStream;
+  if (options.gzOutput && options.threads > 1) {
+    fwdCompressedStream.open(fwdFileName.c_str(),
+                             std::ios_base::out | std::ios_base::binary);
+    invCompressedStream.open(invFileName.c_str(),
+                             std::ios_base::out | std::ios_base::binary);
+    if (!fwdCompressedStream || !invCompressedStream) {
+      Error("failed to open output file: " +
+            (fwdCompressedStream ? invFileName : fwdFileName));
+    }
+  } else {
+    OpenOutputFileOrDie(fwdFileName, fwdExtractStream);
+    OpenOutputFileOrDie(invFileName, invExtractStream);
+  }
 
   if (!options.glueGrammarFile.empty()) {
     OpenOutputFileOrDie(options.glueGrammarFile, glueGrammarStream);
@@ -121,195 +405,70 @@ int ExtractGHKM::Main(int argc, char *argv[])
     OpenOutputFileOrDie(options.unknownWordSoftMatchesFile, unknownWordSoftMatchesStream);
   }
 
-  // Word count statistics for producing unknown word labels.
-  std::map<std::string, int> targetWordCount;
-  std::map<std::string, std::string> targetWordLabel;
-
-  // Word count statistics for producing unknown word labels: source side.
-  std::map<std::string, int> sourceWordCount;
-  std::map<std::string, std::string> sourceWordLabel;
-
-  std::string targetLine;
-  std::string sourceLine;
-  std::string alignmentLine;
-  Alignment alignment;
-  XmlTreeParser targetXmlTreeParser;
-  XmlTreeParser sourceXmlTreeParser;
-  ScfgRuleWriter scfgWriter(fwdExtractStream, invExtractStream, options);
-  StsgRuleWriter stsgWriter(fwdExtractStream, invExtractStream, options);
-  size_t lineNum = options.sentenceOffset;
-  while (true) {
-    std::getline(targetStream, targetLine);
-    std::getline(sourceStream, sourceLine);
-    std::getline(alignmentStream, alignmentLine);
-
-    if (targetStream.eof() && sourceStream.eof() && alignmentStream.eof()) {
-      break;
+  ExtractionStatistics stats;
+  if (options.threads > 1) {
+#ifdef WITH_THREADS
+    // Each block of sentence pairs is extracted by a worker into its own
+    // buffers; the blocks are written in corpus order, so the output is
+    // identical to that of serial extraction.  Compressed output is compressed
+    // by the workers, block by block.
+    std::ostream &fwdStream = options.gzOutput ? fwdCompressedStream
+                              : static_cast<std::ostream &>(fwdExtractStream);
+    std::ostream &invStream = options.gzOutput ? invCompressedStream
+                              : static_cast<std::ostream &>(invExtractStream);
+    Moses::ThreadPool pool(options.threads);
+    util::PCQueue<ExtractionBlock *> queue(4 * options.threads);
+    boost::thread reader(ReadBlocks, boost::cref(*this), boost::cref(options),
+                         boost::ref(targetStream), boost::ref(sourceStream),
+                         boost::ref(alignmentStream), boost::ref(pool),
+                         boost::ref(queue));
+    std::string error = WriteBlocks(queue, fwdStream, invStream, stats);
+    if (!error.empty()) {
+      Error(error);
     }
-
-    if (targetStream.eof() || sourceStream.eof() || alignmentStream.eof()) {
-      Error("Files must contain same number of lines");
-    }
-
-    ++lineNum;
-
-    // Parse target tree.
-    if (targetLine.size() == 0) {
-      std::cerr << "skipping line " << lineNum << " with empty target tree\n";
-      continue;
-    }
-    std::auto_ptr<SyntaxTree> targetParseTree;
+    reader.join();
+    pool.Stop(true);
+#endif
+  } else {
+    ExtractionContext context(fwdExtractStream, invExtractStream, std::cerr);
+    std::string targetLine;
+    std::string sourceLine;
+    std::string alignmentLine;
+    size_t lineNum = options.sentenceOffset;
     try {
-      targetParseTree = targetXmlTreeParser.Parse(targetLine);
-      assert(targetParseTree.get());
-    } catch (const Exception &e) {
-      std::ostringstream oss;
-      oss << "Failed to parse target XML tree at line " << lineNum;
-      if (!e.msg().empty()) {
-        oss << ": " << e.msg();
-      }
-      Error(oss.str());
-    }
-
-    // Read source tokens (and parse tree if using source labels).
-    std::vector<std::string> sourceTokens;
-    std::auto_ptr<SyntaxTree> sourceParseTree;
-    if (!options.sourceLabels) {
-      sourceTokens = ReadTokens(sourceLine);
-    } else {
-      try {
-        sourceParseTree = sourceXmlTreeParser.Parse(sourceLine);
-        assert(sourceParseTree.get());
-      } catch (const Exception &e) {
-        std::ostringstream oss;
-        oss << "Failed to parse source XML tree at line " << lineNum;
-        if (!e.msg().empty()) {
-          oss << ": " << e.msg();
-        }
-        Error(oss.str());
+      while (ReadSentencePair(targetStream, sourceStream, alignmentStream,
+                              targetLine, sourceLine, alignmentLine)) {
+        ExtractSentencePair(targetLine, sourceLine, alignmentLine, ++lineNum,
+                            options, context);
       }
-      sourceTokens = sourceXmlTreeParser.words();
-    }
-
-    // Read word alignments.
-    try {
-      ReadAlignment(alignmentLine, alignment);
     } catch (const Exception &e) {
-      std::ostringstream oss;
-      oss << "Failed to read alignment at line " << lineNum << ": ";
-      oss << e.msg();
-      Error(oss.str());
-    }
-    if (alignment.size() == 0) {
-      std::cerr << "skipping line " << lineNum << " without alignment points\n";
-      continue;
-    }
-    if (options.t2s) {
-      FlipAlignment(alignment);
-    }
-
-    // Record word counts.
-    if (!options.targetUnknownWordFile.empty()) {
-      CollectWordLabelCounts(*targetParseTree, options, targetWordCount,
-                             targetWordLabel);
-    }
-
-    // Record word counts: source side.
-    if (options.sourceLabels && !options.sourceUnknownWordFile.empty()) {
-      CollectWordLabelCounts(*sourceParseTree, options, sourceWordCount,
-                             sourceWordLabel);
-    }
-
-    // Form an alignment graph from the target tree, source words, and
-    // alignment.
-    AlignmentGraph graph(targetParseTree.get(), sourceTokens, alignment);
-
-    // Extract minimal rules, adding each rule to its root node's rule set.
-    graph.ExtractMinimalRules(options);
-
-    // Extract composed rules.
-    if (!options.minimal) {
-      graph.ExtractComposedRules(options);
-    }
-
-    // Initialize phrase orientation scoring object
-    PhraseOrientation phraseOrientation(sourceTokens.size(),
-                                        targetXmlTreeParser.words().size(), alignment);
-
-    // Write the rules, subject to scope pruning.
-    const std::vector<Node *> &targetNodes = graph.GetTargetNodes();
-    for (std::vector<Node *>::const_iterator p = targetNodes.begin();
-         p != targetNodes.end(); ++p) {
-
-      const std::vector<const Subgraph *> &rules = (*p)->GetRules();
-
-      PhraseOrientation::REO_CLASS l2rOrientation=PhraseOrientation::REO_CLASS_UNKNOWN, r2lOrientation=PhraseOrientation::REO_CLASS_UNKNOWN;
-      if (options.phraseOrientation && !rules.empty()) {
-        int sourceSpanBegin = *((*p)->GetSpan().begin());
-        int sourceSpanEnd   = *((*p)->GetSpan().rbegin());
-        l2rOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_L2R);
-        r2lOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_R2L);
-        // std::cerr << "span " << sourceSpanBegin << " " << sourceSpanEnd << std::endl;
-        // std::cerr << "phraseOrientation " << phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd) << std::endl;
-      }
-
-      for (std::vector<const Subgraph *>::const_iterator q = rules.begin();
-           q != rules.end(); ++q) {
-        // STSG output.
-        if (options.stsg) {
-          StsgRule rule(**q);
-          if (rule.Scope() <= options.maxScope) {
-            stsgWriter.Write(rule);
-          }
-          continue;
-        }
-        // SCFG output.
-        ScfgRule *r = 0;
-        if (options.sourceLabels) {
-          r = new ScfgRule(**q, &sourceXmlTreeParser.node_collection());
-        } else {
-          r = new ScfgRule(**q);
-        }
-        // TODO Can scope pruning be done earlier?
-        if (r->Scope() <= options.maxScope) {
-          scfgWriter.Write(*r,lineNum,false);
-          if (options.treeFragments) {
-            fwdExtractStream << " {{Tree ";
-            (*q)->PrintTree(fwdExtractStream);
-            fwdExtractStream << "}}";
-          }
-          if (options.partsOfSpeech) {
-            fwdExtractStream << " {{POS";
-            (*q)->PrintPartsOfSpeech(fwdExtractStream);
-            fwdExtractStream << "}}";
-          }
-          if (options.phraseOrientation) {
-            fwdExtractStream << " {{Orientation ";
-            phraseOrientation.WriteOrientation(fwdExtractStream,l2rOrientation);
-            fwdExtractStream << " ";
-            phraseOrientation.WriteOrientation(fwdExtractStream,r2lOrientation);
-            fwdExtractStream << "}}";
-            phraseOrientation.IncrementPriorCount(PhraseOrientation::REO_DIR_L2R,l2rOrientation,1);
-            phraseOrientation.IncrementPriorCount(PhraseOrientation::REO_DIR_R2L,r2lOrientation,1);
-          }
-          fwdExtractStream << std::endl;
-          invExtractStream << std::endl;
-        }
-        delete r;
-      }
+      Error(e.msg());
     }
+    context.RecordLabelSets();
+    stats.Merge(context.stats);
   }
 
   if (options.phraseOrientation) {
     std::string phraseOrientationPriorsFileName = options.extractFile + std::string(".phraseOrientationPriors");
     OutputFileStream phraseOrientationPriorsStream;
     OpenOutputFileOrDie(phraseOrientationPriorsFileName, phraseOrientationPriorsStream);
+    // The priors are float counts: add them one at a time, as if they had
+    // been incremented during extraction.
+    PhraseOrientation phraseOrientation;
+    for (size_t orient = 0; orient < stats.l2rOrientationCounts.size(); ++orient) {
+      for (size_t i = 0; i < stats.l2rOrientationCounts[orient]; ++i) {
+        phraseOrientation.IncrementPriorCount(PhraseOrientation::REO_DIR_L2R,(PhraseOrientation::REO_CLASS)orient,1);
+      }
+      for (size_t i = 0; i < stats.r2lOrientationCounts[orient]; ++i) {
+        phraseOrientation.IncrementPriorCount(PhraseOrientation::REO_DIR_R2L,(PhraseOrientation::REO_CLASS)orient,1);
+      }
+    }
     PhraseOrientation::WritePriorCounts(phraseOrientationPriorsStream);
   }
 
   std::map<std::string,size_t> sourceLabels;
   if (options.sourceLabels && !options.sourceLabelSetFile.empty()) {
-    std::set<std::string> extendedLabelSet = sourceXmlTreeParser.label_set();
+    std::set<std::string> extendedLabelSet = stats.sourceLabelSet;
     extendedLabelSet.insert("XLHS"); // non-matching label (left-hand side)
     extendedLabelSet.insert("XRHS"); // non-matching label (right-hand side)
     extendedLabelSet.insert("TOPLABEL");  // as used in the glue grammar
@@ -326,8 +485,7 @@ int ExtractGHKM::Main(int argc, char *argv[])
   std::map<std::string, int> strippedTargetTopLabelSet;
   if (options.stripBitParLabels &&
       (!options.glueGrammarFile.empty() || !options.unknownWordSoftMatchesFile.empty())) {
-    StripBitParLabels(targetXmlTreeParser.label_set(),
-                      targetXmlTreeParser.top_label_set(),
+    StripBitParLabels(stats.targetLabelSet, stats.targetTopLabelSet,
                       strippedTargetLabelSet, strippedTargetTopLabelSet);
   }
 
@@ -335,25 +493,24 @@ int ExtractGHKM::Main(int argc, char *argv[])
     if (options.stripBitParLabels) {
       WriteGlueGrammar(strippedTargetLabelSet, strippedTargetTopLabelSet, sourceLabels, options, glueGrammarStream);
     } else {
-      WriteGlueGrammar(targetXmlTreeParser.label_set(),
-                       targetXmlTreeParser.top_label_set(),
+      WriteGlueGrammar(stats.targetLabelSet, stats.targetTopLabelSet,
                        sourceLabels, options, glueGrammarStream);
     }
   }
 
   if (!options.targetUnknownWordFile.empty()) {
-    WriteUnknownWordLabel(targetWordCount, targetWordLabel, options, targetUnknownWordStream);
+    WriteUnknownWordLabel(stats.targetWordCount, stats.targetWordLabel, options, targetUnknownWordStream);
   }
 
   if (options.sourceLabels && !options.sourceUnknownWordFile.empty()) {
-    WriteUnknownWordLabel(sourceWordCount, sourceWordLabel, options, sourceUnknownWordStream, true);
+    WriteUnknownWordLabel(stats.sourceWordCount, stats.sourceWordLabel, options, sourceUnknownWordStream, true);
   }
 
   if (!options.unknownWordSoftMatchesFile.empty()) {
     if (options.stripBitParLabels) {
       WriteUnknownWordSoftMatches(strippedTargetLabelSet, unknownWordSoftMatchesStream);
     } else {
-      WriteUnknownWordSoftMatches(targetXmlTreeParser.label_set(),
+      WriteUnknownWordSoftMatches(stats.targetLabelSet,
                                   unknownWordSoftMatchesStream);
     }
   }
@@ -361,6 +518,169 @@ int ExtractGHKM::Main(int argc, char *argv[])
   return 0;
 }
 
+void ExtractGHKM::ExtractSentencePair(const std::string &targetLine,
+                                      const std::string &sourceLine,
+                                      const std::string &alignmentLine,
+                                      size_t lineNum,
+                                      const Options &options,
+                                      ExtractionContext &context) const
+{
+  XmlTreeParser &targetXmlTreeParser = context.targetXmlTreeParser;
+  XmlTreeParser &sourceXmlTreeParser = context.sourceXmlTreeParser;
+  ExtractionStatistics &stats = context.stats;
+
+  // Parse target tree.
+  if (targetLine.size() == 0) {
+    context.log << "skipping line " << lineNum << " with empty target tree\n";
+    return;
+  }
+  std::auto_ptr<SyntaxTree> targetParseTree;
+  try {
+    targetParseTree = targetXmlTreeParser.Parse(targetLine);
+    assert(targetParseTree.get());
+  } catch (const Exception &e) {
+    std::ostringstream oss;
+    oss << "Failed to parse target XML tree at line " << lineNum;
+    if (!e.msg().empty()) {
+      oss << ": " << e.msg();
+    }
+    throw Exception(oss.str());
+  }
+
+  // Read source tokens (and parse tree if using source labels).
+  std::vector<std::string> sourceTokens;
+  std::auto_ptr<SyntaxTree> sourceParseTree;
+  if (!options.sourceLabels) {
+    sourceTokens = ReadTokens(sourceLine);
+  } else {
+    try {
+      sourceParseTree = sourceXmlTreeParser.Parse(sourceLine);
+      assert(sourceParseTree.get());
+    } catch (const Exception &e) {
+      std::ostringstream oss;
+      oss << "Failed to parse source XML tree at line " << lineNum;
+      if (!e.msg().empty()) {
+        oss << ": " << e.msg();
+      }
+      throw Exception(oss.str());
+    }
+    sourceTokens = sourceXmlTreeParser.words();
+  }
+
+  // Read word alignments.
+  Alignment alignment;
+  try {
+    ReadAlignment(alignmentLine, alignment);
+  } catch (const Exception &e) {
+    std::ostringstream oss;
+    oss << "Failed to read alignment at line " << lineNum << ": ";
+    oss << e.msg();
+    throw Exception(oss.str());
+  }
+  if (alignment.size() == 0) {
+    context.log << "skipping line " << lineNum << " without alignment points\n";
+    return;
+  }
+  if (options.t2s) {
+    FlipAlignment(alignment);
+  }
+
+  // Record word counts.
+  if (!options.targetUnknownWordFile.empty()) {
+    CollectWordLabelCounts(*targetParseTree, options, stats.targetWordCount,
+                           stats.targetWordLabel);
+  }
+
+  // Record word counts: source side.
+  if (options.sourceLabels && !options.sourceUnknownWordFile.empty()) {
+    CollectWordLabelCounts(*sourceParseTree, options, stats.sourceWordCount,
+                           stats.sourceWordLabel);
+  }
+
+  // Form an alignment graph from the target tree, source words, and
+  // alignment.
+  AlignmentGraph graph(targetParseTree.get(), sourceTokens, alignment);
+
+  // Extract minimal rules, adding each rule to its root node's rule set.
+  graph.ExtractMinimalRules(options);
+
+  // Extract composed rules.
+  if (!options.minimal) {
+    graph.ExtractComposedRules(options);
+  }
+
+  // Initialize phrase orientation scoring object
+  PhraseOrientation phraseOrientation(sourceTokens.size(),
+                                      targetXmlTreeParser.words().size(), alignment);
+
+  // Write the rules, subject to scope pruning.
+  std::ostream &fwdExtractStream = context.fwd;
+  std::ostream &invExtractStream = context.inv;
+  ScfgRuleWriter scfgWriter(fwdExtractStream, invExtractStream, options);
+  StsgRuleWriter stsgWriter(fwdExtractStream, invExtractStream, options);
+  const std::vector<Node *> &targetNodes = graph.GetTargetNodes();
+  for (std::vector<Node *>::const_iterator p = targetNodes.begin();
+       p != targetNodes.end(); ++p) {
+
+    const std::vector<const Subgraph *> &rules = (*p)->GetRules();
+
+    PhraseOrientation::REO_CLASS l2rOrientation=PhraseOrientation::REO_CLASS_UNKNOWN, r2lOrientation=PhraseOrientation::REO_CLASS_UNKNOWN;
+    if (options.phraseOrientation && !rules.empty()) {
+      int sourceSpanBegin = *((*p)->GetSpan().begin());
+      int sourceSpanEnd   = *((*p)->GetSpan().rbegin());
+      l2rOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_L2R);
+      r2lOrientation = phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd,PhraseOrientation::REO_DIR_R2L);
+      // std::cerr << "span " << sourceSpanBegin << " " << sourceSpanEnd << std::endl;
+      // std::cerr << "phraseOrientation " << phraseOrientation.GetOrientationInfo(sourceSpanBegin,sourceSpanEnd) << std::endl;
+    }
+
+    for (std::vector<const Subgraph *>::const_iterator q = rules.begin();
+         q != rules.end(); ++q) {
+      // STSG output.
+      if (options.stsg) {
+        StsgRule rule(**q);
+        if (rule.Scope() <= options.maxScope) {
+          stsgWriter.Write(rule);
+        }
+        continue;
+      }
+      // SCFG output.
+      ScfgRule *r = 0;
+      if (options.sourceLabels) {
+        r = new ScfgRule(**q, &sourceXmlTreeParser.node_collection());
+      } else {
+        r = new ScfgRule(**q);
+      }
+      // TODO Can scope pruning be done earlier?
+      if (r->Scope() <= options.maxScope) {
+        scfgWriter.Write(*r,lineNum,false);
+        if (options.treeFragments) {
+          fwdExtractStream << " {{Tree ";
+          (*q)->PrintTree(fwdExtractStream);
+          fwdExtractStream << "}}";
+        }
+        if (options.partsOfSpeech) {
+          fwdExtractStream << " {{POS";
+          (*q)->PrintPartsOfSpeech(fwdExtractStream);
+          fwdExtractStream << "}}";
+        }
+        if (options.phraseOrientation) {
+          fwdExtractStream << " {{Orientation ";
+          phraseOrientation.WriteOrientation(fwdExtractStream,l2rOrientation);
+          fwdExtractStream << " ";
+          phraseOrientation.WriteOrientation(fwdExtractStream,r2lOrientation);
+          fwdExtractStream << "}}";
+          ++stats.l2rOrientationCounts[l2rOrientation];
+          ++stats.r2lOrientationCounts[r2lOrientation];
+        }
+        fwdExtractStream << std::endl;
+        invExtractStream << std::endl;
+      }
+      delete r;
+    }
+  }
+}
+
 void ExtractGHKM::ProcessOptions(int argc, char *argv[],
                                  Options &options) const
 {
@@ -456,6 +776,9 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
    "output STSG rules (default is SCFG)")
   ("T2S",
    "enable tree-to-string rule extraction (string-to-tree is assumed by default)")
+  ("Threads",
+   po::value(&options.threads)->default_value(options.threads),
+   "extract rules using N threads (the output is identical to that of a single thread)")
   ("TreeFragments",
    "output parse tree information")
   ("SourceLabels",
@@ -591,6 +914,15 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
     options.unpairedExtractFormat = true;
   }
 
+  if (options.threads < 1) {
+    Error("--Threads must be at least 1");
+  }
+#ifndef WITH_THREADS
+  if (options.threads > 1) {
+    Error("thread support not compiled in");
+  }
+#endif
+
   // Workaround for extract-parallel issue.
   if (options.sentenceOffset > 0) {
     options.targetUnknownWordFile.clear();
@@ -768,7 +1100,7 @@ void ExtractGHKM::CollectWordLabelCounts(
   SyntaxTree &root,
   const Options &options,
   std::map<std::string, int> &wordCount,
-  std::map<std::string, std::string> &wordLabel)
+  std::map<std::string, std::string> &wordLabel) const
 {
   for (SyntaxTree::ConstLeafIterator p(root);
        p != SyntaxTree::ConstLeafIterator(); ++p) {
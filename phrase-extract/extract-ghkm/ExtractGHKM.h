@@ -29,6 +29,7 @@
 #include "SyntaxTree.h"
 
 #include "syntax-common/tool.h"
+#include "syntax-common/xml_tree_parser.h"
 
 namespace MosesTraining
 {
@@ -37,8 +38,50 @@ namespace Syntax
 namespace GHKM
 {
 
+class ExtractionTask;
 struct Options;
 
+// Statistics that are collected during extraction and written out at the end
+// (unknown word labels, glue grammar, source label set, and phrase orientation
+// priors).  Merge() adds the statistics of a later part of the corpus, so
+// merging partial statistics in corpus order gives the same result as
+// collecting them in a single pass.
+struct ExtractionStatistics {
+  ExtractionStatistics();
+
+  void Merge(const ExtractionStatistics &);
+
+  std::map<std::string, int> targetWordCount;
+  std::map<std::string, std::string> targetWordLabel;
+  std::map<std::string, int> sourceWordCount;
+  std::map<std::string, std::string> sourceWordLabel;
+  std::set<std::string> targetLabelSet;
+  std::map<std::string, int> targetTopLabelSet;
+  std::set<std::string> sourceLabelSet;
+  std::vector<size_t> l2rOrientationCounts;
+  std::vector<size_t> r2lOrientationCounts;
+};
+
+// Where the extraction of a sequence of sentence pairs goes: the extract
+// streams, a stream for messages about skipped lines, the XML parsers (which
+// accumulate the label sets), and the statistics.
+struct ExtractionContext {
+  ExtractionContext(std::ostream &fwd, std::ostream &inv, std::ostream &log)
+    : fwd(fwd)
+    , inv(inv)
+    , log(log) {}
+
+  // Copy the label sets accumulated by the parsers into stats.
+  void RecordLabelSets();
+
+  std::ostream &fwd;
+  std::ostream &inv;
+  std::ostream &log;
+  XmlTreeParser targetXmlTreeParser;
+  XmlTreeParser sourceXmlTreeParser;
+  ExtractionStatistics stats;
+};
+
 class ExtractGHKM : public Tool
 {
 public:
@@ -47,11 +90,22 @@ public:
   virtual int Main(int argc, char *argv[]);
 
 private:
+  friend class ExtractionTask;
+
+  // Extract the rules from a single sentence pair.  Throws an Exception if the
+  // input is malformed.
+  void ExtractSentencePair(const std::string &targetLine,
+                           const std::string &sourceLine,
+                           const std::string &alignmentLine,
+                           size_t lineNum,
+                           const Options &,
+                           ExtractionContext &) const;
+
   void RecordTreeLabels(const SyntaxTree &, std::set<std::string> &);
   void CollectWordLabelCounts(SyntaxTree &,
                               const Options &,
                               std::map<std::string, int> &,
-                              std::map<std::string, std::string> &);
+                              std::map<std::string, std::string> &) const;
   void WriteUnknownWordLabel(const std::map<std::string, int> &,
                              const std::map<std::string, std::string> &,
                              const Options &,
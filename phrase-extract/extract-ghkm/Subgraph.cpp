@@ -112,8 +112,12 @@ float Subgraph::CalcPcfgScore() const
     return 0.0f;
   }
   float score = m_root->GetPcfgScore();
-  for (std::set<const Node *>::const_iterator p = m_leaves.begin();
-       p != m_leaves.end(); ++p) {
+  // Subtract in left-to-right order, which unlike the order of m_leaves does
+  // not depend on the node addresses.
+  std::vector<const Node *> leaves;
+  GetTargetLeaves(leaves);
+  for (std::vector<const Node *>::const_iterator p = leaves.begin();
+       p != leaves.end(); ++p) {
     const Node *leaf = *p;
     if (leaf->GetType() == TREE) {
       score -= leaf->GetPcfgScore();
@@ -48,6 +48,8 @@ my $opt_hierarchical = 0;
 my $binarizer = undef;
 my $threads = 1; # Default is single-thread, i.e. $threads=1
 my $syntax_filter_cmd = "$SCRIPTS_ROOTDIR/../bin/filter-rule-table hierarchical";
+my $phrase_filter_cmd = "$SCRIPTS_ROOTDIR/../bin/phrase_table_filter";
+my $opt_native_filter = 0; # filter phrase-based tables with $phrase_filter_cmd
 my $min_score = undef;
 my $opt_min_non_initial_rule_count = undef;
 my $opt_gzip = 1; # gzip output files (so far only phrase-based ttable until someone tests remaining models and formats)
@@ -65,6 +67,7 @@ GetOptions(
     "tempdir=s" => \$tempdir,
     "MinScore=s" => \$min_score,
     "threads=i" => \$threads,
+    "NativeFilter" => \$opt_native_filter,
     "MinNonInitialRuleCount=i" => \$opt_min_non_initial_rule_count,  # DEPRECATED
 ) or exit(1);
 
@@ -74,7 +77,9 @@ my $config = shift;
 my $input = shift;
 
 if (!defined $dir || !defined $config || !defined $input) {
-  print STDERR "usage: filter-model-given-input.pl targetdir moses.ini input.text [-Binarizer binarizer] [-Hierarchical] [-MinScore id:threshold[,id:threshold]*] [-SyntaxFilterCmd cmd] [-threads num]\n";
+  print STDERR "usage: filter-model-given-input.pl targetdir moses.ini input.text [-Binarizer binarizer] [-Hierarchical] [-MinScore id:threshold[,id:threshold]*] [-SyntaxFilterCmd cmd] [-threads num] [-NativeFilter]\n";
+  print STDERR "  -NativeFilter filters phrase-based tables with the multi-threaded bin/phrase_table_filter\n";
+  print STDERR "                instead of this script (not with -MinScore)\n";
   exit 1;
 }
 $dir = ensure_full_path($dir);
@@ -298,8 +303,16 @@ if ($opt_hierarchical) {
   }
 }
 
+# use the multi-threaded filter binary for phrase-based tables if asked to
+# (it does not support -MinScore)
+my $native_filter = $opt_native_filter && !$opt_hierarchical;
+if ($native_filter) {
+  die "-NativeFilter can't be combined with -MinScore" if $min_score;
+  die "-NativeFilter needs $phrase_filter_cmd" unless -x $phrase_filter_cmd;
+}
+
 my %PHRASE_USED;
-if ($opt_filter && !$opt_hierarchical) {
+if ($opt_filter && !$opt_hierarchical && !$native_filter) {
     # get the phrase pairs appearing in the input text, up to the $MAX_LENGTH
     open(INPUT,mk_open_string($input)) or die "Can't read $input";
     while(my $line = <INPUT>) {
@@ -371,6 +384,27 @@ for(my $i=0;$i<=$#TABLE;$i++) {
               print FILE_OUT $line
           }
           close(FILEHANDLE);
+      } elsif ($native_filter) {
+          # the filter reports "<used> of <total> lines kept" on stderr
+          my $log = "$mid_file.log";
+          $cmd = "$openstring $phrase_filter_cmd threads:$threads max_length:$MAX_LENGTH factors:$factors $input 2> $log |";
+          print STDERR "Executing: $cmd\n";
+          open(PIPE,$cmd) or die "Can't run '$cmd'";
+          my $buffer;
+          while (read(PIPE, $buffer, 1048576)) {
+              print FILE_OUT $buffer;
+          }
+          my $filtered = close(PIPE);
+          open(LOG,$log) or die "Can't read $log";
+          while(my $line = <LOG>) {
+              print STDERR $line;
+              ($used,$total) = ($1,$2) if $line =~ /^(\d+) of (\d+) lines kept/;
+          }
+          close(LOG);
+          unlink($log);
+          die "Failed to filter $file" unless $filtered;
+          die "No phrases found in $file!" if $total == 0;
+          printf STDERR "$used of $total phrases pairs used (%.2f%s) - note: max length $MAX_LENGTH\n",(100*$used/$total),'%';
       } else {
           open(FILE,$openstring) or die "Can't open '$openstring'";
           while(my $entry = <FILE>) {
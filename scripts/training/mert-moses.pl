@@ -116,6 +116,12 @@ my $__REMOVE_SEGMENTATION = "$SCRIPTS_ROOTDIR/ems/support/remove-segmentation-ma
 
 my $__THREADS = 0;
 
+# Keep the n-best lists of all iterations in one binary tuning store, which
+# skips hypotheses seen in earlier iterations, instead of one features.dat
+# and scores.dat per iteration.
+my $___TUNING_STORE = 0;
+my $tuning_store_file = "tuning.store";
+
 # Parameter for effective reference length when computing BLEU score
 # Default is to use shortest reference
 # Use "--shortest" to use shortest reference length
@@ -231,6 +237,7 @@ GetOptions(
   "promix-training=s" => \$__PROMIX_TRAINING,
   "promix-table=s" => \@__PROMIX_TABLES,
   "threads=i" => \$__THREADS,
+  "tuning-store" => \$___TUNING_STORE,
   "spe-symal=s" => \$___DEV_SYMAL,
   "multi-moses" => \$___USE_MULTI_MOSES
 ) or exit(1);
@@ -326,6 +333,10 @@ Options:
   --promix-training=STRING  ... PRO-based mixture model training (Haddow, NAACL 2013)
   --promix-tables=STRING    ... Phrase tables for PRO-based mixture model training.
   --threads=NUMBER          ... Use multi-threaded mert (must be compiled in).
+  --tuning-store            ... Collect the features and scores of all iterations in
+                                one binary store ($tuning_store_file) that keeps each
+                                hypothesis once, instead of runN.features.dat and
+                                runN.scores.dat. Implies --prev-aggregate-nbestlist=-1.
   --historic-interpolation  ... Interpolate optimized weights with prior iterations' weight
                                 (parameter sets factor [0;1] given to current weights)
   --spe-symal=SYMAL      ... Use simulated post-editing when decoding.
@@ -391,6 +402,13 @@ if (($___PAIRWISE_RANKED_OPTIMIZER || $___PRO_STARTING_POINT) && ! -x $pro_optim
   die("ERROR: Installation of megam_i686.opt failed! Install by hand from $megam_url") unless -x $pro_optimizer;
 }
 
+if ($___TUNING_STORE) {
+  die "--tuning-store keeps all previous iterations, it can't be combined with --prev-aggregate-nbestlist"
+    if $prev_aggregate_nbl_size != -1;
+  die "--tuning-store can't be combined with --hg-mira or --promix-training"
+    if $___HG_MIRA || $__PROMIX_TRAINING;
+}
+
 if ($__PROMIX_TRAINING) {
   die "Not executable $__PROMIX_TRAINING" unless -x $__PROMIX_TRAINING;
   die "For promix training, specify the tables using --promix-table arguments" unless @__PROMIX_TABLES;
@@ -625,6 +643,11 @@ for (my $i = 0; $i < scalar(@{$featlist->{"names"}}); $i++) {
   }
 }
 
+# a store left over from an earlier optimization would be appended to
+if ($___TUNING_STORE && !$continue && -e $tuning_store_file) {
+  unlink $tuning_store_file or die "Can't remove $tuning_store_file: $!";
+}
+
 if ($continue) {
   # getting the last finished step
   print STDERR "Trying to continue an interrupted optimization.\n";
@@ -648,10 +671,12 @@ if ($continue) {
   if ($firststep <= $step) {
     print STDERR "First previous needed data index is $firststep\n";
     print STDERR "Checking whether all needed data (from step $firststep to step $step) are available\n";
+    die "Can't start from step $step, because $tuning_store_file was not found!"
+      if $___TUNING_STORE && ! -e $tuning_store_file;
 
     for (my $prevstep = $firststep; $prevstep <= $step; $prevstep++) {
         print STDERR "Checking whether data of step $prevstep are available\n";
-      if (! -e "run$prevstep.features.dat") {
+      if (! $___TUNING_STORE && ! -e "run$prevstep.features.dat") {
           die "Can't start from step $step, because run$prevstep.features.dat was not found!";
       } else {
         if (defined $prev_feature_file) {
@@ -660,7 +685,7 @@ if ($continue) {
           $prev_feature_file = "run$prevstep.features.dat";
         }
       }
-      if (! -e "run$prevstep.scores.dat") {
+      if (! $___TUNING_STORE && ! -e "run$prevstep.scores.dat") {
           die "Can't start from step $step, because run$prevstep.scores.dat was not found!";
       } else {
         if (defined $prev_score_file) {
@@ -843,6 +868,7 @@ while (1) {
     $cmd .= " -d" if $__PROMIX_TRAINING; # Allow duplicates
     # remove segmentation
     $cmd .= " -l $__REMOVE_SEGMENTATION" if  $__PROMIX_TRAINING;
+    $cmd .= " --store $tuning_store_file" if $___TUNING_STORE;
     $cmd = &create_extractor_script($cmd, $___WORKING_DIR);
     &submit_or_exec($cmd, "extract.out","extract.err", 1);
   }
@@ -903,6 +929,12 @@ while (1) {
     $scfiles = "$score_file";
   }
 
+  if ($___TUNING_STORE) {
+    # the store already holds the hypotheses of all previous iterations
+    $ffiles  = $tuning_store_file;
+    $scfiles = $tuning_store_file;
+  }
+
   my $mira_settings = "";
   if (($___BATCH_MIRA || $___HG_MIRA) && $batch_mira_args) {
     $mira_settings .= "$batch_mira_args ";
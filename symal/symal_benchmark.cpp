@@ -0,0 +1,98 @@
+// Measure the throughput of alignment symmetrization (grow-diag-final-and)
+// with 1 up to the given number of threads, on synthetic alignment pairs in
+// the .bal format.
+//
+// usage: symal_benchmark [sentence-pairs [max-threads]]
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/time.h>
+
+#include "symmetrize.h"
+
+using namespace std;
+using namespace symal;
+
+namespace
+{
+
+double Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Roughly diagonal alignments with some noise and unaligned words, so that
+// grow-diag-final-and has to grow and finalize.
+string MakeCorpus(size_t pairs)
+{
+  ostringstream corpus;
+  srand(1234);
+  for (size_t s = 0; s < pairs; ++s) {
+    int n = 5 + rand() % 40;
+    int m = n + rand() % 7 - 3;
+    if (m < 1) m = 1;
+    corpus << 1 << '\n' << n;
+    for (int i = 1; i <= n; ++i) corpus << " t" << rand() % 1000;
+    corpus << " #";
+    for (int i = 1; i <= n; ++i) {
+      int j = rand() % 8 ? (i * m) / n + rand() % 3 - 1 : 0;
+      corpus << ' ' << (j >= 1 && j <= m ? j : 0);
+    }
+    corpus << '\n' << m;
+    for (int j = 1; j <= m; ++j) corpus << " s" << rand() % 1000;
+    corpus << " #";
+    for (int j = 1; j <= m; ++j) {
+      int i = rand() % 8 ? (j * n) / m + rand() % 3 - 1 : 0;
+      corpus << ' ' << (i >= 1 && i <= n ? i : 0);
+    }
+    corpus << '\n';
+  }
+  return corpus.str();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t pairs = argc > 1 ? atol(argv[1]) : 200000;
+  size_t max_threads = argc > 2 ? atol(argv[2]) : 4;
+
+  try {
+    const string corpus = MakeCorpus(pairs);
+    const Symmetrizer symmetrizer(GROW, true, true, true);
+    string reference;
+
+    for (size_t threads = 1; threads <= max_threads; ++threads) {
+#ifndef WITH_THREADS
+      if (threads > 1) {
+        cerr << "thread support not compiled in\n";
+        break;
+      }
+#endif
+      istringstream in(corpus);
+      ostringstream out;
+      double start = Now();
+      size_t sents = SymmetrizeStream(in, out, symmetrizer, threads);
+      double elapsed = Now() - start;
+
+      if (threads == 1) {
+        reference = out.str();
+      } else if (out.str() != reference) {
+        cerr << "output with " << threads << " threads differs from the output with 1 thread\n";
+        return 1;
+      }
+      cout << threads << " threads: " << sents << " sentence pairs in "
+           << elapsed << " s, " << sents / elapsed << " sentence pairs/s\n";
+    }
+  } catch (const std::exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
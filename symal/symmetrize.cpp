@@ -0,0 +1,535 @@
+#include "symmetrize.h"
+
+#include <cstring>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include <stdint.h>
+#include <zlib.h>
+
+#ifdef WITH_THREADS
+#include <boost/utility/in_place_factory.hpp>
+#include "util/thread_pool.hh"
+#endif
+
+using namespace std;
+
+namespace symal
+{
+
+namespace
+{
+
+// Number of sentence pairs that are written (and compressed) at once.
+const size_t kBlockSize = 10000;
+
+// Append "j-i " to out.
+void AppendPoint(string &out, int j, int i)
+{
+  char buf[32];
+  char *end = buf + sizeof(buf);
+  char *p = end;
+  *--p = ' ';
+  do {
+    *--p = '0' + i % 10;
+    i /= 10;
+  } while (i);
+  *--p = '-';
+  do {
+    *--p = '0' + j % 10;
+    j /= 10;
+  } while (j);
+  out.append(p, end);
+}
+
+// Replace the trailing space of the points appended since start with the end
+// of line (or add the end of line if there are no points).
+void EndLine(string &out, size_t start)
+{
+  if (out.size() == start)
+    out += '\n';
+  else
+    out[out.size()-1] = '\n';
+}
+
+// Compress text into a single gzip member.  A sequence of gzip members is a
+// valid gzip file, so blocks can be compressed independently.
+string GzipCompress(const string &text)
+{
+  string compressed;
+  if (text.empty()) return compressed;
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // 16 for a gzip header and trailer, 15 for maximum window size.
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + 15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    throw runtime_error("failed to initialize zlib");
+  compressed.resize(deflateBound(&stream, text.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+  stream.avail_in = text.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+  stream.avail_out = compressed.size();
+  int result = deflate(&stream, Z_FINISH);
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END)
+    throw runtime_error("zlib failed to compress the output");
+  compressed.resize(stream.total_out);
+  return compressed;
+}
+
+void WriteBlock(ostream &out, string &text, bool compress)
+{
+  if (compress) {
+    string compressed = GzipCompress(text);
+    out.write(compressed.data(), compressed.size());
+  } else {
+    out.write(text.data(), text.size());
+  }
+  text.clear();
+}
+
+string SentenceError(size_t sentence, const string &what)
+{
+  ostringstream msg;
+  msg << "sentence pair " << sentence << ": " << what;
+  return msg.str();
+}
+
+size_t SymmetrizeSerial(istream &in, ostream &out, Symmetrizer symmetrizer,
+                        bool compress)
+{
+  AlignmentPair sentence;
+  string text;
+  size_t sents = 0;
+  try {
+    while (ReadAlignmentPair(in, sentence)) {
+      symmetrizer.Symmetrize(sentence, text);
+      if (++sents % kBlockSize == 0)
+        WriteBlock(out, text, compress);
+    }
+  } catch (const runtime_error &e) {
+    WriteBlock(out, text, compress);
+    out.flush();
+    throw runtime_error(SentenceError(sents + 1, e.what()));
+  }
+  WriteBlock(out, text, compress);
+  out.flush();
+  return sents;
+}
+
+#ifdef WITH_THREADS
+
+// A block of sentence pairs: the input lines, filled by the reading thread,
+// and the (possibly compressed) output, filled by a SymmetrizeWorker.
+struct Batch {
+  Batch() : sequence(0), first(0), count(0) {}
+
+  uint64_t sequence;
+  size_t first; // number of sentence pairs before this batch
+  size_t count;
+  string input;
+  string output;
+  string error;
+};
+
+class SymmetrizeWorker
+{
+public:
+  typedef Batch *Request;
+
+  SymmetrizeWorker(const Symmetrizer &symmetrizer, bool compress,
+                   util::PCQueue<Request> &done)
+    : symmetrizer_(symmetrizer), compress_(compress), done_(done) {}
+
+  void operator()(Request batch) {
+    batch->output.clear();
+    batch->error.clear();
+    istringstream in(batch->input);
+    size_t i = 0;
+    try {
+      for (; i < batch->count; ++i) {
+        if (!ReadAlignmentPair(in, pair_))
+          throw runtime_error("unexpected end of input");
+        symmetrizer_.Symmetrize(pair_, batch->output);
+      }
+      in >> ws;
+      if (!in.eof())
+        throw runtime_error("more than three lines per sentence pair");
+    } catch (const runtime_error &e) {
+      batch->error = SentenceError(batch->first + i + 1, e.what());
+    }
+    if (compress_)
+      batch->output = GzipCompress(batch->output);
+    done_.Produce(batch);
+  }
+
+private:
+  Symmetrizer symmetrizer_;
+  AlignmentPair pair_;
+  bool compress_;
+  util::PCQueue<Request> &done_;
+};
+
+// Writes the batches in input order and passes them back to the reading
+// thread.  There should only be one OutputWorker.  Nothing is written after
+// the first batch with an error.
+class OutputWorker
+{
+public:
+  typedef Batch *Request;
+
+  OutputWorker(ostream &out, util::PCQueue<Request> &done, string &error)
+    : out_(out), done_(done), error_(error), base_sequence_(0) {}
+
+  void operator()(Request batch) {
+    uint64_t pos = batch->sequence - base_sequence_;
+    if (pos >= ordering_.size()) {
+      ordering_.resize(pos + 1, NULL);
+    }
+    ordering_[pos] = batch;
+    while (!ordering_.empty() && ordering_.front()) {
+      Batch *next = ordering_.front();
+      if (error_.empty()) {
+        out_.write(next->output.data(), next->output.size());
+        error_ = next->error;
+      }
+      done_.Produce(next);
+      ordering_.pop_front();
+      ++base_sequence_;
+    }
+  }
+
+private:
+  ostream &out_;
+  util::PCQueue<Request> &done_;
+  string &error_;
+  deque<Request> ordering_;
+  uint64_t base_sequence_;
+};
+
+size_t SymmetrizeThreaded(istream &in, ostream &out,
+                          const Symmetrizer &symmetrizer, size_t threads,
+                          bool compress)
+{
+  const size_t queue = 2 * threads + 2;
+  vector<Batch> batches(queue);
+  util::PCQueue<Batch*> to_read(queue);
+  vector<Batch*> free_batches;
+  for (size_t i = 0; i < queue; ++i) free_batches.push_back(&batches[i]);
+
+  string error;
+  size_t sents = 0;
+  {
+    util::ThreadPool<OutputWorker> output(queue, 1, boost::in_place(boost::ref(out), boost::ref(to_read), boost::ref(error)), NULL);
+    util::ThreadPool<SymmetrizeWorker> workers(queue, threads, boost::in_place(boost::cref(symmetrizer), compress, boost::ref(output.In())), NULL);
+
+    uint64_t sequence = 0;
+    size_t outstanding = 0;
+    bool more = true;
+    string line;
+    while (more) {
+      if (free_batches.empty()) {
+        free_batches.push_back(to_read.Consume());
+        --outstanding;
+        // Stop reading after an error.
+        if (!free_batches.back()->error.empty()) break;
+      }
+      Batch *batch = free_batches.back();
+      batch->sequence = sequence;
+      batch->first = sents;
+      batch->count = 0;
+      batch->input.clear();
+      // Cut the input at sentence pair boundaries: three lines per pair, as
+      // written by giza2bal.pl, which writes empty lines for skipped pairs.
+      size_t lines = 0;
+      while (batch->count < kBlockSize && (more = !getline(in, line).fail())) {
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+        batch->input += line;
+        batch->input += '\n';
+        if (++lines % 3 == 0) ++batch->count;
+      }
+      if (lines % 3) ++batch->count;
+      if (!batch->count) break;
+      free_batches.pop_back();
+      ++sequence;
+      sents += batch->count;
+      workers.Produce(batch);
+      ++outstanding;
+    }
+    for (; outstanding; --outstanding) to_read.Consume();
+  }
+  out.flush();
+  if (!error.empty()) throw runtime_error(error);
+  return sents;
+}
+
+#endif // WITH_THREADS
+
+} // namespace
+
+bool ReadAlignmentPair(istream &in, AlignmentPair &sentence)
+{
+  int freq;
+  if (!(in >> freq)) return false;
+
+  string w;
+  int &n = sentence.n, &m = sentence.m;
+  vector<int> &a = sentence.a, &b = sentence.b;
+
+  //target sentence
+  if (!(in >> n) || n < 0) throw runtime_error("bad target length");
+  for (int i = 1; i <= n; i++) in >> w;
+
+  in >> w; //# separator
+  // inverse alignment
+  b.resize(n + 1);
+  b[0] = 0;
+  for (int i = 1; i <= n; i++) in >> b[i];
+
+  //source sentence
+  if (!(in >> m) || m < 0) throw runtime_error("bad source length");
+  for (int j = 1; j <= m; j++) in >> w;
+
+  in >> w; //# separator
+
+  // direct alignment
+  a.resize(m + 1);
+  a[0] = 0;
+  for (int j = 1; j <= m; j++) in >> a[j];
+
+  if (!in) throw runtime_error("unexpected end of input");
+
+  for (int j = 1; j <= m; j++)
+    if (a[j] < 0 || a[j] > n) throw runtime_error("alignment point out of range");
+  for (int i = 1; i <= n; i++)
+    if (b[i] < 0 || b[i] > m) throw runtime_error("alignment point out of range");
+
+  return true;
+}
+
+Symmetrizer::Symmetrizer(Alignment alignment, bool diagonal, bool isfinal,
+                         bool bothuncovered)
+  : m_alignment(alignment)
+  , m_diagonal(diagonal)
+  , m_final(isfinal)
+  , m_bothUncovered(bothuncovered)
+{
+  m_neighbors.push_back(make_pair(-1,-0));
+  m_neighbors.push_back(make_pair(0,-1));
+  m_neighbors.push_back(make_pair(1,0));
+  m_neighbors.push_back(make_pair(0,1));
+
+  if (diagonal) {
+    m_neighbors.push_back(make_pair(-1,-1));
+    m_neighbors.push_back(make_pair(-1,1));
+    m_neighbors.push_back(make_pair(1,-1));
+    m_neighbors.push_back(make_pair(1,1));
+  }
+}
+
+void Symmetrizer::Symmetrize(const AlignmentPair &sentence, string &out)
+{
+  switch (m_alignment) {
+  case UNION:
+    Union(sentence, out);
+    break;
+  case INTERSECT:
+    Intersect(sentence, out);
+    break;
+  case GROW:
+    Grow(sentence, out);
+    break;
+  case SRCTOTGT:
+    SourceToTarget(sentence, out);
+    break;
+  case TGTTOSRC:
+    TargetToSource(sentence, out);
+    break;
+  default:
+    throw runtime_error("Unknown alignment");
+  }
+}
+
+//compute union alignment
+void Symmetrizer::Union(const AlignmentPair &sentence, string &out) const
+{
+  const int m = sentence.m, n = sentence.n;
+  const vector<int> &a = sentence.a, &b = sentence.b;
+  const size_t start = out.size();
+
+  for (int j=1; j<=m; j++)
+    if (a[j])
+      AppendPoint(out, j-1, a[j]-1);
+
+  for (int i=1; i<=n; i++)
+    if (b[i] && a[b[i]]!=i)
+      AppendPoint(out, b[i]-1, i-1);
+
+  EndLine(out, start);
+}
+
+//Compute intersection alignment
+void Symmetrizer::Intersect(const AlignmentPair &sentence, string &out) const
+{
+  const int m = sentence.m;
+  const vector<int> &a = sentence.a, &b = sentence.b;
+  const size_t start = out.size();
+
+  for (int j=1; j<=m; j++)
+    if (a[j] && b[a[j]]==j)
+      AppendPoint(out, j-1, a[j]-1);
+
+  EndLine(out, start);
+}
+
+//Compute target-to-source alignment
+void Symmetrizer::TargetToSource(const AlignmentPair &sentence, string &out) const
+{
+  const int n = sentence.n;
+  const vector<int> &b = sentence.b;
+  const size_t start = out.size();
+
+  for (int i=1; i<=n; i++)
+    if (b[i])
+      AppendPoint(out, b[i]-1, i-1);
+
+  EndLine(out, start);
+}
+
+//Compute source-to-target alignment
+void Symmetrizer::SourceToTarget(const AlignmentPair &sentence, string &out) const
+{
+  const int m = sentence.m;
+  const vector<int> &a = sentence.a;
+  const size_t start = out.size();
+
+  for (int j=1; j<=m; j++)
+    if (a[j])
+      AppendPoint(out, j-1, a[j]-1);
+
+  EndLine(out, start);
+}
+
+//Compute Grow Diagonal Alignment
+//Nice property: you will never introduce more points
+//than the unionalignment alignemt. Hence, you will always be able
+//to represent the grow alignment as the unionalignment of a
+//directed and inverted alignment
+void Symmetrizer::Grow(const AlignmentPair &sentence, string &out)
+{
+  const int m = sentence.m, n = sentence.n;
+  const vector<int> &a = sentence.a, &b = sentence.b;
+  const size_t start = out.size();
+
+  int i,j;
+  size_t o;
+
+  //covered foreign and english positions
+  m_fa.assign(m+1, 0);
+  m_ea.assign(n+1, 0);
+  int *fa = &m_fa[0];
+  int *ea = &m_ea[0];
+
+  //matrix to quickly check if one point is in the symmetric
+  //alignment (value=2), direct alignment (=1) and inverse alignment
+  const int stride = m+1;
+  m_A.assign((n+1)*stride, 0);
+  int *A = &m_A[0];
+
+  set <pair <int,int> > currentpoints; //symmetric alignment
+  set <pair <int,int> > unionalignment; //union alignment
+
+  pair <int,int> point; //variable to store points
+  set<pair <int,int> >::const_iterator k; //iterator over sets
+
+  //fill in the alignments
+  for (j=1; j<=m; j++) {
+    if (a[j]) {
+      unionalignment.insert(make_pair(a[j],j));
+      if (b[a[j]]==j) {
+        fa[j]=1;
+        ea[a[j]]=1;
+        A[a[j]*stride+j]=2;
+        currentpoints.insert(make_pair(a[j],j));
+      } else
+        A[a[j]*stride+j]=-1;
+    }
+  }
+
+  for (i=1; i<=n; i++)
+    if (b[i] && a[b[i]]!=i) { //not intersection
+      unionalignment.insert(make_pair(i,b[i]));
+      A[i*stride+b[i]]=1;
+    }
+
+  int added=1;
+
+  while (added) {
+    added=0;
+    ///scan the current alignment
+    for (k=currentpoints.begin(); k!=currentpoints.end(); k++) {
+      for (o=0; o<m_neighbors.size(); o++) {
+        point.first=k->first+m_neighbors[o].first;
+        point.second=k->second+m_neighbors[o].second;
+        //check if neighbor is inside 'matrix'
+        if (point.first>0 && point.first <=n && point.second>0 && point.second<=m)
+          //check if neighbor is in the unionalignment alignment
+          if (b[point.first]==point.second || a[point.second]==point.first) {
+            //check if it connects at least one uncovered word
+            if (!(ea[point.first] && fa[point.second])) {
+              //insert point in currentpoints!
+              currentpoints.insert(point);
+              A[point.first*stride+point.second]=2;
+              ea[point.first]=1;
+              fa[point.second]=1;
+              added=1;
+            }
+          }
+      }
+    }
+  }
+
+  if (m_final) {
+    // first the points of the inverse alignment, then those of the direct one
+    for (int which = 1; which >= -1; which -= 2) {
+      for (k=unionalignment.begin(); k!=unionalignment.end(); k++)
+        if (A[k->first*stride+k->second]==which) {
+          point.first=k->first;
+          point.second=k->second;
+          //one of the two words is not covered yet
+          if ((m_bothUncovered &&  !ea[point.first] && !fa[point.second]) ||
+              (!m_bothUncovered && !(ea[point.first] && fa[point.second]))) {
+            //add it!
+            currentpoints.insert(point);
+            A[point.first*stride+point.second]=2;
+            //keep track of new covered positions
+            ea[point.first]=1;
+            fa[point.second]=1;
+          }
+        }
+    }
+  }
+
+  for (k=currentpoints.begin(); k!=currentpoints.end(); k++)
+    AppendPoint(out, k->second-1, k->first-1);
+
+  EndLine(out, start);
+}
+
+size_t SymmetrizeStream(istream &in, ostream &out,
+                        const Symmetrizer &symmetrizer, size_t threads,
+                        bool compress)
+{
+#ifdef WITH_THREADS
+  if (threads > 1)
+    return SymmetrizeThreaded(in, out, symmetrizer, threads, compress);
+#endif
+  return SymmetrizeSerial(in, out, symmetrizer, compress);
+}
+
+} // namespace symal
@@ -0,0 +1,90 @@
+#ifndef SYMAL_SYMMETRIZE_H
+#define SYMAL_SYMMETRIZE_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace symal
+{
+
+enum Alignment {
+  UNION = 1,
+  INTERSECT,
+  GROW,
+  SRCTOTGT,
+  TGTTOSRC
+};
+
+// The two directed alignments of a sentence pair, as read from a .bal file.
+// Positions are 1-based and 0 means unaligned: a[j] is the target position
+// aligned to source position j (j=1..m), b[i] the source position aligned to
+// target position i (i=1..n).  a[0] and b[0] are unused.
+struct AlignmentPair {
+  AlignmentPair() : m(0), n(0) {}
+
+  int m;
+  int n;
+  std::vector<int> a;
+  std::vector<int> b;
+};
+
+// Read the next alignment pair in .bal format (see giza2bal.pl).  Returns
+// false at the end of the input and throws std::runtime_error if the input is
+// malformed.
+bool ReadAlignmentPair(std::istream &in, AlignmentPair &sentence);
+
+// Symmetrizes alignment pairs.  All state is per instance (the scratch space
+// of grow-diag-final is sized to the longest sentence pair seen so far), so
+// separate instances can be used from separate threads.
+class Symmetrizer
+{
+public:
+  Symmetrizer(Alignment alignment, bool diagonal=false, bool isfinal=false,
+              bool bothuncovered=false);
+
+  // Append the symmetrized alignment of sentence to out as space-separated
+  // 0-based source-target points, followed by a newline.
+  void Symmetrize(const AlignmentPair &sentence, std::string &out);
+
+  Alignment GetAlignment() const {
+    return m_alignment;
+  }
+
+private:
+  void Union(const AlignmentPair &, std::string &) const;
+  void Intersect(const AlignmentPair &, std::string &) const;
+  void SourceToTarget(const AlignmentPair &, std::string &) const;
+  void TargetToSource(const AlignmentPair &, std::string &) const;
+  void Grow(const AlignmentPair &, std::string &);
+
+  Alignment m_alignment;
+  bool m_diagonal;
+  bool m_final;
+  bool m_bothUncovered;
+  std::vector<std::pair<int, int> > m_neighbors;
+
+  // Scratch space of Grow(): covered source (fa) and target (ea) positions,
+  // and the (n+1)x(m+1) matrix telling whether a point is in the symmetric
+  // alignment (2), the inverse alignment only (1) or the direct alignment
+  // only (-1).
+  std::vector<int> m_fa;
+  std::vector<int> m_ea;
+  std::vector<int> m_A;
+};
+
+// Symmetrize all alignment pairs read from in and write the alignments to out,
+// in input order.  With threads > 1, blocks of sentence pairs are symmetrized
+// by a pool of worker threads; this needs the input in the line format written
+// by giza2bal.pl (three lines per sentence pair).  If compress is set, the
+// output is gzip-compressed, one gzip member per block.  Returns the number of
+// sentence pairs.  Throws std::runtime_error on malformed input.
+std::size_t SymmetrizeStream(std::istream &in, std::ostream &out,
+                             const Symmetrizer &symmetrizer,
+                             std::size_t threads=1, bool compress=false);
+
+} // namespace symal
+
+#endif
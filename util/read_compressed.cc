@@ -11,6 +11,15 @@
 #include <climits>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include "util/pcqueue.hh"
+#include "util/thread_pool.hh"
+
+#include <boost/thread.hpp>
+#endif
 
 #ifdef HAVE_ZLIB
 #include <zlib.h>
@@ -401,6 +410,383 @@ ReadBase *ReadFactory(int fd, uint64_t &raw_amount, const void *already_data, co
   }
 }
 
+#ifdef WITH_THREADS
+// Decompressing ahead on a background thread.  The thread fills one buffer
+// while the reader consumes the other.
+
+const std::size_t kReadAheadSize = 1 << 22;
+// Enough to recognise bgzip.
+const std::size_t kBGZFHeader = 18;
+
+// Set by ReadCompressed::SetReadAhead.
+boost::mutex read_ahead_mutex;
+std::size_t read_ahead_threads = 0;
+
+std::size_t ReadAheadThreads() {
+  boost::lock_guard<boost::mutex> lock(read_ahead_mutex);
+  return read_ahead_threads;
+}
+
+struct ReadAheadBuffer {
+  scoped_malloc mem;
+  std::size_t capacity;
+  // 0 only at the end of the file or after an error.
+  std::size_t size;
+  // Compressed bytes consumed up to the end of this buffer.
+  uint64_t raw;
+  std::string error;
+};
+
+class ReadAheadSource {
+  public:
+    virtual ~ReadAheadSource() {}
+
+    // Called on the background thread.
+    virtual void Fill(ReadAheadBuffer &buffer) = 0;
+
+    // After Fill, whether the rest of the file is for another source.  If so,
+    // gives up the file and the bytes of it already read.
+    virtual bool HandOff(int &/*fd*/, std::vector<uint8_t> &/*header*/, uint64_t &/*raw_amount*/) {
+      return false;
+    }
+};
+
+// Any input ReadFactory handles, decompressed by one thread.
+class SequentialSource : public ReadAheadSource {
+  public:
+    ReadCompressed &Thunk() { return thunk_; }
+
+    void Fill(ReadAheadBuffer &buffer) {
+      buffer.size = thunk_.ReadOrEOF(buffer.mem.get(), buffer.capacity);
+      buffer.raw = thunk_.RawAmount();
+    }
+
+  private:
+    ReadCompressed thunk_;
+};
+
+#ifdef HAVE_ZLIB
+/* Blocked gzip as written by bgzip: a series of gzip members of at most 64 KB
+ * whose extra field "BC" gives the size of the member.  Members are independent
+ * so a batch of them can be inflated by several threads, each writing to the
+ * offset given by the uncompressed sizes in the trailers.
+ */
+bool IsBGZF(const uint8_t *header, std::size_t size) {
+  return size >= kBGZFHeader && header[0] == 0x1f && header[1] == 0x8b && header[2] == 8 && (header[3] & 4) &&
+    (header[10] | (header[11] << 8)) >= 6 && header[12] == 'B' && header[13] == 'C' && header[14] == 2 && header[15] == 0;
+}
+
+uint32_t ReadLittle32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+class BGZFSource;
+
+// One stride of a BGZFSource batch.
+struct StrideRequest {
+  StrideRequest(BGZFSource *source_in = NULL, std::size_t stride_in = 0)
+    : source(source_in), stride(stride_in) {}
+
+  bool operator==(const StrideRequest &other) const {
+    return source == other.source && stride == other.stride;
+  }
+
+  BGZFSource *source;
+  std::size_t stride;
+};
+
+class StrideHandler {
+  public:
+    typedef StrideRequest Request;
+
+    void operator()(const Request &request);
+};
+
+typedef ThreadPool<StrideHandler> InflatePool;
+
+// All bgzip readers of the process share one pool of inflating threads.  It
+// is started by the first bgzip reader after SetReadAhead asked for more than
+// one thread, keeps its size from then on, and is never stopped, so that
+// readers held by static objects don't have to go before it.
+InflatePool *inflate_pool = NULL;
+std::size_t inflate_workers = 0;
+
+// Returns the pool, if any, and its number of workers.
+InflatePool *SharedInflatePool(std::size_t &workers) {
+  boost::lock_guard<boost::mutex> lock(read_ahead_mutex);
+  if (!inflate_pool && read_ahead_threads > 1) {
+    // The reading thread inflates, too.
+    inflate_workers = read_ahead_threads - 1;
+    inflate_pool = new InflatePool(4 * inflate_workers, inflate_workers, StrideHandler(), StrideRequest());
+  }
+  workers = inflate_workers;
+  return inflate_pool;
+}
+
+class BGZFSource : public ReadAheadSource {
+  public:
+    BGZFSource(int fd, const uint8_t *header, std::size_t header_size)
+      : file_(fd), pending_(header, header + header_size), raw_amount_(header_size),
+        pool_(SharedInflatePool(threads_)), to_(NULL), strides_(0), unfinished_(0) {
+      // SharedInflatePool set threads_ to the workers of the pool, to which
+      // the calling thread is added.
+      ++threads_;
+      errors_.resize(threads_);
+    }
+
+    void Fill(ReadAheadBuffer &buffer) {
+      raw_.clear();
+      blocks_.clear();
+      std::size_t out = 0;
+      while (out < kReadAheadSize && ReadBlock(out)) {}
+      if (out > buffer.capacity) {
+        buffer.mem.call_realloc(out);
+        buffer.capacity = out;
+      }
+      to_ = static_cast<uint8_t*>(buffer.mem.get());
+      strides_ = std::min<std::size_t>(threads_, blocks_.size());
+      unfinished_ = strides_ ? strides_ - 1 : 0;
+      for (std::size_t t = 1; t < strides_; ++t) {
+        pool_->Produce(StrideRequest(this, t));
+      }
+      if (strides_) InflateStride(0);
+      {
+        boost::unique_lock<boost::mutex> lock(done_mutex_);
+        while (unfinished_) done_.wait(lock);
+      }
+      for (std::size_t t = 0; t < strides_; ++t) {
+        UTIL_THROW_IF(!errors_[t].empty(), GZException, errors_[t]);
+      }
+      buffer.size = out;
+      buffer.raw = raw_amount_;
+    }
+
+    bool HandOff(int &fd, std::vector<uint8_t> &header, uint64_t &raw_amount) {
+      if (next_header_.empty()) return false;
+      fd = file_.release();
+      header.swap(next_header_);
+      raw_amount = raw_amount_;
+      return true;
+    }
+
+  private:
+    friend class StrideHandler;
+
+    struct Block {
+      std::size_t raw_offset, raw_size, out_offset, out_size;
+      uint32_t crc;
+    };
+
+    // Read from the pending header bytes, then the file.
+    std::size_t ReadRaw(void *to_void, std::size_t amount) {
+      uint8_t *to = static_cast<uint8_t*>(to_void);
+      std::size_t from_pending = std::min(amount, pending_.size());
+      std::copy(pending_.begin(), pending_.begin() + from_pending, to);
+      pending_.erase(pending_.begin(), pending_.begin() + from_pending);
+      std::size_t got = from_pending + ReadOrEOF(file_.get(), to + from_pending, amount - from_pending);
+      raw_amount_ += got - from_pending;
+      return got;
+    }
+
+    // Append one member to raw_ and blocks_.  Returns false at the end of the file.
+    bool ReadBlock(std::size_t &out) {
+      std::size_t start = raw_.size();
+      raw_.resize(start + kBGZFHeader);
+      std::size_t got = ReadRaw(&raw_[start], kBGZFHeader);
+      if (!got) {
+        raw_.resize(start);
+        return false;
+      }
+      if (!IsBGZF(&raw_[start], got)) {
+        // Not a bgzip member: the rest of the file goes to ReadFactory.
+        next_header_.assign(&raw_[start], &raw_[start] + got);
+        raw_.resize(start);
+        return false;
+      }
+      std::size_t extra = raw_[start + 10] | (raw_[start + 11] << 8);
+      std::size_t total = (raw_[start + 16] | (raw_[start + 17] << 8)) + 1;
+      UTIL_THROW_IF(total < 12 + extra + 8, GZException, "Bad bgzip block size " << total);
+      raw_.resize(start + total);
+      UTIL_THROW_IF(ReadRaw(&raw_[start + kBGZFHeader], total - kBGZFHeader) != total - kBGZFHeader, GZException, "Truncated bgzip block");
+      Block block;
+      block.raw_offset = start + 12 + extra;
+      block.raw_size = total - 12 - extra - 8;
+      block.crc = ReadLittle32(&raw_[start + total - 8]);
+      block.out_size = ReadLittle32(&raw_[start + total - 4]);
+      block.out_offset = out;
+      out += block.out_size;
+      blocks_.push_back(block);
+      return true;
+    }
+
+    void InflateStride(std::size_t stride) {
+      errors_[stride].clear();
+      try {
+        for (std::size_t i = stride; i < blocks_.size(); i += strides_) {
+          Inflate(blocks_[i], to_ + blocks_[i].out_offset);
+        }
+      } catch (const std::exception &e) {
+        errors_[stride] = e.what();
+      }
+    }
+
+    // Called by the pool after InflateStride.
+    void StrideDone() {
+      boost::lock_guard<boost::mutex> lock(done_mutex_);
+      if (!--unfinished_) done_.notify_one();
+    }
+
+    void Inflate(const Block &block, uint8_t *to) const {
+      z_stream stream;
+      stream.zalloc = Z_NULL;
+      stream.zfree = Z_NULL;
+      stream.opaque = Z_NULL;
+      stream.next_in = const_cast<Bytef*>(&raw_[block.raw_offset]);
+      stream.avail_in = block.raw_size;
+      stream.next_out = to;
+      stream.avail_out = block.out_size;
+      // Raw deflate: the gzip header and trailer are handled here.
+      UTIL_THROW_IF(Z_OK != inflateInit2(&stream, -15), GZException, "Failed to initialize zlib.");
+      int result = inflate(&stream, Z_FINISH);
+      std::size_t total_out = stream.total_out;
+      inflateEnd(&stream);
+      UTIL_THROW_IF(result != Z_STREAM_END || total_out != block.out_size, GZException, "zlib failed to inflate a bgzip block, code " << result);
+      UTIL_THROW_IF(crc32(crc32(0L, Z_NULL, 0), to, block.out_size) != block.crc, GZException, "CRC mismatch in bgzip block");
+    }
+
+    scoped_fd file_;
+    std::vector<uint8_t> pending_;
+    uint64_t raw_amount_;
+    std::size_t threads_;
+    InflatePool *pool_;
+
+    // The current batch.
+    std::vector<uint8_t> raw_;
+    std::vector<Block> blocks_;
+    uint8_t *to_;
+    std::size_t strides_;
+    std::vector<std::string> errors_;
+
+    // Start of the first member that is not bgzip, once it was read.
+    std::vector<uint8_t> next_header_;
+
+    // Strides of the current batch still being inflated by the pool.
+    std::size_t unfinished_;
+    boost::mutex done_mutex_;
+    boost::condition_variable done_;
+};
+
+void StrideHandler::operator()(const Request &request) {
+  request.source->InflateStride(request.stride);
+  request.source->StrideDone();
+}
+#endif // HAVE_ZLIB
+
+class ReadAhead : public ReadBase {
+  public:
+    static const std::size_t kBuffers = 2;
+
+    // Takes ownership of fd, of which header was already read.
+    ReadAhead(int fd, const uint8_t *header, std::size_t header_size)
+      : free_(kBuffers + 1), full_(kBuffers), current_(NULL), offset_(0) {
+#ifdef HAVE_ZLIB
+      if (IsBGZF(header, header_size)) {
+        source_.reset(new BGZFSource(fd, header, header_size));
+      } else
+#endif
+      {
+        source_.reset(Sequential(fd, header, header_size, header_size, false));
+      }
+      for (std::size_t i = 0; i < kBuffers; ++i) {
+        buffers_[i].mem.reset(MallocOrThrow(kReadAheadSize));
+        buffers_[i].capacity = kReadAheadSize;
+        free_.Produce(&buffers_[i]);
+      }
+      thread_.reset(new boost::thread(&ReadAhead::Run, this));
+    }
+
+    ~ReadAhead() {
+      // The thread may still fill the buffers it already has.
+      free_.Produce(NULL);
+      thread_->join();
+    }
+
+    std::size_t Read(void *to, std::size_t amount, ReadCompressed &thunk) {
+      if (!current_ || offset_ == current_->size) {
+        if (current_) {
+          // End of file or an error, which was reported.
+          if (!current_->size) return 0;
+          free_.Produce(current_);
+        }
+        current_ = full_.Consume();
+        offset_ = 0;
+        ReadCount(thunk) = current_->raw;
+        UTIL_THROW_IF(!current_->error.empty(), CompressedException, current_->error);
+        if (!current_->size) return 0;
+      }
+      std::size_t sending = std::min(amount, current_->size - offset_);
+      memcpy(to, static_cast<const uint8_t*>(current_->mem.get()) + offset_, sending);
+      offset_ += sending;
+      return sending;
+    }
+
+  private:
+    static SequentialSource *Sequential(int fd, const uint8_t *header, std::size_t header_size, uint64_t raw_amount, bool require_compressed) {
+      scoped_ptr<SequentialSource> sequential(new SequentialSource());
+      ReadCount(sequential->Thunk()) = raw_amount;
+      ReplaceThis(ReadFactory(fd, ReadCount(sequential->Thunk()), header, header_size, require_compressed), sequential->Thunk());
+      return sequential.release();
+    }
+
+    void Run() {
+      ReadAheadBuffer *buffer;
+      while ((buffer = free_.Consume())) {
+        try {
+          source_->Fill(*buffer);
+          int fd;
+          std::vector<uint8_t> header;
+          uint64_t raw_amount;
+          if (source_->HandOff(fd, header, raw_amount)) {
+            // e.g. a gzip member appended to a bgzip file
+            source_.reset(Sequential(fd, &header[0], header.size(), raw_amount, true));
+            if (!buffer->size) source_->Fill(*buffer);
+          }
+        } catch (const std::exception &e) {
+          buffer->size = 0;
+          buffer->error = e.what();
+        }
+        full_.Produce(buffer);
+        if (!buffer->size) return;
+      }
+    }
+
+    scoped_ptr<ReadAheadSource> source_;
+
+    ReadAheadBuffer buffers_[kBuffers];
+    PCQueue<ReadAheadBuffer*> free_, full_;
+
+    // Being read by the consumer.
+    ReadAheadBuffer *current_;
+    std::size_t offset_;
+
+    scoped_ptr<boost::thread> thread_;
+};
+
+ReadBase *ReadAheadFactory(int fd, uint64_t &raw_amount) {
+  scoped_fd hold(fd);
+  uint8_t header[kBGZFHeader];
+  std::size_t got = ReadOrEOF(fd, header, sizeof(header));
+  raw_amount += got;
+  if (got < ReadCompressed::kMagicSize || DetectMagic(header, got) == UTIL_UNKNOWN) {
+    // Reading uncompressed files on another thread does not help.
+    return ReadFactory(hold.release(), raw_amount, header, got, false);
+  }
+  return new ReadAhead(hold.release(), header, got);
+}
+#else
+std::size_t ReadAheadThreads() { return 0; }
+#endif // WITH_THREADS
+
 } // namespace
 
 bool ReadCompressed::DetectCompressedMagic(const void *from_void) {
@@ -419,9 +805,26 @@ ReadCompressed::ReadCompressed() {}
 
 ReadCompressed::~ReadCompressed() {}
 
+void ReadCompressed::SetReadAhead(std::size_t threads) {
+#ifdef WITH_THREADS
+  boost::lock_guard<boost::mutex> lock(read_ahead_mutex);
+  read_ahead_threads = threads;
+#endif
+}
+
 void ReadCompressed::Reset(int fd) {
+  Reset(fd, ReadAheadThreads() != 0);
+}
+
+void ReadCompressed::Reset(int fd, bool read_ahead) {
   raw_amount_ = 0;
   internal_.reset();
+#ifdef WITH_THREADS
+  if (read_ahead) {
+    internal_.reset(ReadAheadFactory(fd, raw_amount_));
+    return;
+  }
+#endif
   internal_.reset(ReadFactory(fd, raw_amount_, NULL, 0, false));
 }
 
@@ -41,7 +41,15 @@ class ReadCompressed {
     // Must have at least kMagicSize bytes.
     static bool DetectCompressedMagic(const void *from);
 
-    // Takes ownership of fd.
+    // Decompressing ahead is off by default.  With threads > 0, readers
+    // opened afterwards decompress compressed input ahead on a background
+    // thread (if util was compiled with threads), and blocked gzip (as
+    // written by bgzip) is inflated by up to threads threads, taken from one
+    // pool that all readers of the process share.  The size of that pool is
+    // fixed by the first bgzip reader that uses it.  0 turns read-ahead off.
+    static void SetReadAhead(std::size_t threads);
+
+    // Takes ownership of fd.  See SetReadAhead.
     explicit ReadCompressed(int fd);
 
     // Try to avoid using this.  Use the fd instead.
@@ -56,6 +64,11 @@ class ReadCompressed {
     // Takes ownership of fd.
     void Reset(int fd);
 
+    // Same, but read_ahead overrides SetReadAhead for this reader: false
+    // decompresses in the calling thread, true decompresses ahead even if
+    // SetReadAhead was not called (with one thread for bgzip then).
+    void Reset(int fd, bool read_ahead);
+
     // Same advice as the constructor.
     void Reset(std::istream &in);
 
@@ -9,8 +9,13 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
 #include <cstdlib>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #if defined __MINGW32__
 #include <ctime>
 #include <fcntl.h>
@@ -115,6 +120,100 @@ BOOST_AUTO_TEST_CASE(ReadXZ) {
 #ifdef HAVE_ZLIB
 BOOST_AUTO_TEST_CASE(AppendGZ) {
 }
+
+void WriteLittle(std::string &to, uint32_t value, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i, value >>= 8) {
+    to += static_cast<char>(value & 0xff);
+  }
+}
+
+// Blocked gzip, as written by bgzip, ending with the empty EOF block.
+void WriteBGZFBlock(int fd, const uint8_t *data, std::size_t size) {
+  std::string deflated(compressBound(size) + 64, 0);
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  BOOST_REQUIRE_EQUAL(Z_OK, deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY));
+  stream.next_in = const_cast<Bytef*>(data);
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef*>(&deflated[0]);
+  stream.avail_out = deflated.size();
+  BOOST_REQUIRE_EQUAL(Z_STREAM_END, deflate(&stream, Z_FINISH));
+  deflated.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  const char kHeader[] = {31, -117, 8, 4, 0, 0, 0, 0, 0, -1, 6, 0, 'B', 'C', 2, 0};
+  std::string block(kHeader, sizeof(kHeader));
+  WriteLittle(block, 18 + deflated.size() + 8 - 1, 2);
+  block += deflated;
+  WriteLittle(block, crc32(crc32(0L, Z_NULL, 0), data, size), 4);
+  WriteLittle(block, size, 4);
+  WriteOrThrow(fd, block.data(), block.size());
+}
+
+// A plain gzip member, as gzip writes it.
+void WriteGZMember(int fd, const uint8_t *data, std::size_t size) {
+  std::string deflated(compressBound(size) + 64, 0);
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  BOOST_REQUIRE_EQUAL(Z_OK, deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + 15, 8, Z_DEFAULT_STRATEGY));
+  stream.next_in = const_cast<Bytef*>(data);
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef*>(&deflated[0]);
+  stream.avail_out = deflated.size();
+  BOOST_REQUIRE_EQUAL(Z_STREAM_END, deflate(&stream, Z_FINISH));
+  deflateEnd(&stream);
+  WriteOrThrow(fd, deflated.data(), stream.total_out);
+}
+
+// bgzip blocks up to plain_from, then a plain gzip member with the rest.
+void TestBGZF(bool read_ahead, std::size_t plain_from = kSize4 * sizeof(uint32_t)) {
+  std::vector<uint32_t> numbers(kSize4);
+  for (uint32_t i = 0; i < kSize4; ++i) numbers[i] = i;
+  const uint8_t *data = reinterpret_cast<const uint8_t*>(&numbers[0]);
+  const std::size_t size = kSize4 * sizeof(uint32_t);
+
+  char name[] = "tempXXXXXX";
+  scoped_fd file(mkstemp(name));
+  BOOST_REQUIRE(file.get() > 0);
+  BOOST_CHECK_EQUAL(0, unlink(name));
+  // Small blocks so that there are many.
+  const std::size_t kBlock = 4000;
+  for (std::size_t offset = 0; offset < plain_from; offset += kBlock) {
+    WriteBGZFBlock(file.get(), data + offset, std::min(kBlock, plain_from - offset));
+  }
+  if (plain_from < size) {
+    WriteGZMember(file.get(), data + plain_from, size - plain_from);
+  } else {
+    WriteBGZFBlock(file.get(), data, 0);
+  }
+  SeekOrThrow(file.get(), 0);
+
+  ReadCompressed reader;
+  reader.Reset(file.release(), read_ahead);
+  VerifyRead(reader);
+}
+
+BOOST_AUTO_TEST_CASE(ReadBGZF) {
+  // on the calling thread and the read-ahead thread only
+  TestBGZF(true);
+  // with the shared pool
+  ReadCompressed::SetReadAhead(4);
+  TestBGZF(true);
+  ReadCompressed::SetReadAhead(0);
+}
+
+BOOST_AUTO_TEST_CASE(ReadBGZFInCallingThread) {
+  TestBGZF(false);
+}
+
+BOOST_AUTO_TEST_CASE(ReadBGZFThenGZ) {
+  TestBGZF(true, 40000);
+  TestBGZF(false, 40000);
+}
 #endif
 
 BOOST_AUTO_TEST_CASE(IStream) {
@@ -65,6 +65,27 @@ public:
    */
   virtual float Predict(const StringPiece &label) = 0;
 
+  /**
+   * Predict the losses of several classes of the current example in one batch. Each element of
+   * labelDependentFeatures holds the label-dependent features of one class, all of them share the
+   * current label-independent features. Like Predict(), starts a new example afterwards.
+   */
+  virtual void PredictBatch(const StringPiece &label
+                            , const std::vector<FeatureVector> &labelDependentFeatures
+                            , std::vector<float> &losses) {
+    losses.resize(labelDependentFeatures.size());
+    for (size_t i = 0; i < labelDependentFeatures.size(); i++) {
+      AddLabelDependentFeatureVector(labelDependentFeatures[i]);
+      losses[i] = Predict(label);
+    }
+  }
+
+  /**
+   * Throw away the current label-dependent features without predicting (e.g. when they were
+   * only added to compute their IDs). Like Predict(), starts a new example afterwards.
+   */
+  virtual void Discard() = 0;
+
   // helper methods for indicator features
   FeatureType AddLabelIndependentFeature(const StringPiece &name) {
     return AddLabelIndependentFeature(name, 1.0);
@@ -113,6 +134,7 @@ public:
   virtual void AddLabelDependentFeatureVector(const FeatureVector &features);
   virtual void Train(const StringPiece &label, float loss);
   virtual float Predict(const StringPiece &label);
+  virtual void Discard();
 
 protected:
   void AddFeature(const StringPiece &name, float value);
@@ -141,6 +163,10 @@ public:
   virtual void AddLabelDependentFeatureVector(const FeatureVector &features);
   virtual void Train(const StringPiece &label, float loss);
   virtual float Predict(const StringPiece &label);
+  virtual void PredictBatch(const StringPiece &label
+                            , const std::vector<FeatureVector> &labelDependentFeatures
+                            , std::vector<float> &losses);
+  virtual void Discard();
 
   friend class ClassifierFactory;
 
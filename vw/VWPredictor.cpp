@@ -112,6 +112,35 @@ float VWPredictor::Predict(const StringPiece &label)
   return loss;
 }
 
+void VWPredictor::PredictBatch(const StringPiece &label
+                               , const std::vector<FeatureVector> &labelDependentFeatures
+                               , std::vector<float> &losses)
+{
+  // the label-independent namespace ('s') stays in the example; for each class, only the
+  // label-dependent namespace ('t') is added, predicted and removed again
+  m_ex->set_label(label.as_string());
+  losses.resize(labelDependentFeatures.size());
+  for (size_t i = 0; i < labelDependentFeatures.size(); i++) {
+    m_ex->addns('t');
+    const FeatureVector &features = labelDependentFeatures[i];
+    for (FeatureVector::const_iterator it = features.begin(); it != features.end(); it++)
+      m_ex->addf(it->first, it->second);
+    losses[i] = m_ex->predict_partial();
+    if (DEBUG) std::cerr << "VW :: Predicted loss: " << losses[i] << "\n";
+    m_ex->remns(); // remove target namespace
+  }
+  m_isFirstSource = true;
+  m_isFirstTarget = true;
+}
+
+void VWPredictor::Discard()
+{
+  if (! m_isFirstTarget)
+    m_ex->remns(); // remove target namespace
+  m_isFirstSource = true;
+  m_isFirstTarget = true;
+}
+
 FeatureType VWPredictor::AddFeature(const StringPiece &name, float value)
 {
   if (DEBUG) std::cerr << "VW :: Adding feature: " << EscapeSpecialChars(name.as_string()) << ":" << value << "\n";
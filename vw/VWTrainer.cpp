@@ -85,6 +85,11 @@ float VWTrainer::Predict(const StringPiece &label)
   throw logic_error("Trying to predict during training!");
 }
 
+void VWTrainer::Discard()
+{
+  throw logic_error("Trying to discard features during training!");
+}
+
 void VWTrainer::AddFeature(const StringPiece &name, float value)
 {
   m_outputBuffer.push_back(EscapeSpecialChars(name.as_string()) + ":" + SPrint(value));